@@ -42,6 +42,7 @@ int main()
     Key name = world.key("name");
     Key highway = world.key("highway");
     Key building = world.key("building");
+    TagProjection keys = world.keys({"name", "highway", "building"});
 
     std::cout << "Keys: " << name << ", " << highway << ", " << building << "\n";
 
@@ -94,6 +95,23 @@ int main()
         std::cout << count1 << " named, "
             << count2 << " highways, "
             << count3 << " buildings\n";
+
+        timer.start();
+        count1 = 0;
+        count2 = 0;
+        count3 = 0;
+        TagValue values[3];
+        for (Feature f : world(bounds))
+        {
+            f.tagValues(keys, values);
+            if (values[0] != "") count1++;
+            if (values[1] != "") count2++;
+            if (values[2] != "") count3++;
+        }
+        timer.stop("Tag lookup via TagProjection");
+        std::cout << count1 << " named, "
+            << count2 << " highways, "
+            << count3 << " buildings\n";
     }
     return 0;
 }
\ No newline at end of file
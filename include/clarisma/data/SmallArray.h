@@ -1,6 +1,8 @@
 // Copyright (c) 2025 Clarisma / GeoDesk contributors
 // SPDX-License-Identifier: LGPL-3.0-only
 
+#pragma once
+
 #include <cstddef>
 #include <memory>
 #include <stdexcept>
@@ -33,7 +35,7 @@ public:
     {
         if(!isInline())    [[unlikely]]
         {
-            ::operator delete(data_);
+            ::operator delete[](data_, std::align_val_t(alignof(T)));
         }
     }
 
@@ -0,0 +1,91 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace clarisma {
+
+/// @brief A regular expression, compiled into a DFA.
+///
+/// Supports the subset of the ECMAScript syntax that queries commonly
+/// use: literals, `.`, character classes (including `\d`, `\w` and `\s`),
+/// groups, alternation, the quantifiers `*`, `+`, `?` and `{n,m}`, and
+/// the anchors `^` and `$`. Patterns that use any other features (such as
+/// backreferences or lookahead), or whose automaton would become too
+/// large, are handed to `std::regex` instead -- which also means that
+/// invalid patterns cause a `std::regex_error`.
+///
+/// Like `std::regex_match()`, match() only succeeds if the pattern
+/// matches the entire string, and strings are treated as sequences of
+/// bytes (just like `std::regex` does). match() never allocates, and
+/// a Regex can be used by multiple threads at the same time.
+///
+class Regex
+{
+public:
+    explicit Regex(std::string_view pattern);
+    Regex(Regex&& other) noexcept;
+    ~Regex();
+
+    Regex(const Regex&) = delete;
+    Regex& operator=(const Regex&) = delete;
+
+    bool match(std::string_view s) const
+    {
+        if (fallback_) [[unlikely]] return matchFallback(s);
+
+        // Every match must start with prefix_ and end with suffix_,
+        // so we check these first (and skip the prefix)
+        if (!s.starts_with(prefix_) || !s.ends_with(suffix_)) return false;
+        const uint32_t* table = table_.data();
+        uint32_t state = prefixState_;
+        for (size_t i = prefix_.size(); i < s.size(); i++)
+        {
+            state = table[state + classes_[static_cast<uint8_t>(s[i])]];
+            if (state == DEAD) return false;
+        }
+        return accepting_[state / classCount_];
+    }
+
+    /// Returns `true` if this Regex uses its own automaton, or
+    /// `false` if it relies on `std::regex`.
+    ///
+    bool isCompiled() const { return !fallback_; }
+
+    /// Returns the number of DFA states (including the dead state),
+    /// or 0 if the pattern is matched by `std::regex`
+    ///
+    size_t stateCount() const { return accepting_.size(); }
+
+private:
+    class Compiler;
+    struct Fallback;
+
+    // The dead state (which no string can escape once it has entered it)
+    // always comes first
+    static constexpr uint32_t DEAD = 0;
+
+    bool matchFallback(std::string_view s) const;
+
+    /// Maps each byte to its equivalence class
+    uint8_t classes_[256];
+    uint32_t classCount_;
+    /// The state after the prefix has been consumed
+    uint32_t prefixState_;
+    /// The transitions, with `classCount_` entries per state. To avoid
+    /// a multiplication for each step, states are represented by the
+    /// offset of their first entry.
+    std::vector<uint32_t> table_;
+    std::vector<bool> accepting_;
+    std::string prefix_;
+    std::string suffix_;
+    std::unique_ptr<Fallback> fallback_;
+};
+
+} // namespace clarisma
@@ -18,5 +18,13 @@ namespace Threads
 	}
 
 	void kill(std::thread& thread);
+
+	/// Pins the calling thread to the given logical CPU.
+	///
+	/// @return `false` if the platform does not support this,
+	///   or the CPU number is invalid
+	///
+	bool setCurrentThreadAffinity(int cpu);
+
 }
 } // namespace clarisma
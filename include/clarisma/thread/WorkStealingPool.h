@@ -0,0 +1,629 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace clarisma {
+
+/// @brief A thread pool in which each worker owns a deque of tasks,
+/// and idle workers steal from the deques of busy workers.
+///
+/// Tasks are submitted into a bounded, lock-free injection queue
+/// (multi-producer/multi-consumer). A worker that takes tasks from
+/// the injection queue grabs a small batch and keeps the surplus in
+/// its own deque, from which other workers can steal without taking
+/// a lock. Workers that run out of work spin briefly and then park
+/// on an atomic wait.
+///
+/// The interface mirrors ThreadPool: tryPost() never blocks and
+/// returns `false` if the injection queue is full, which allows the
+/// caller to run the task on its own thread instead (The query engine
+/// relies on this to avoid deadlocks).
+///
+/// TaskType must be default-constructible, trivially copyable and
+/// callable. Tasks should be small, since they are copied in and
+/// out of the deques word by word (a thief may read a slot that is
+/// concurrently overwritten by the owner, in which case its CAS
+/// fails and the copy is discarded).
+///
+template <typename TaskType>
+class WorkStealingPool
+{
+    static_assert(std::is_trivially_copyable_v<TaskType>,
+        "Tasks are copied through atomic words");
+
+public:
+    /// A snapshot of the pool's activity
+    ///
+    struct Stats
+    {
+        int threadCount;
+        int queueCapacity;
+        int queueDepth;             ///< tasks in the injection queue
+        int dequeDepth;             ///< tasks held in the workers' deques
+        int parkedThreads;
+        uint64_t tasksRun;          ///< by the workers (not counting tasks
+                                    ///< that submitters ran themselves)
+        uint64_t busyNanos;         ///< total time workers spent on tasks
+                                    ///< (updated when a worker goes idle)
+        uint64_t uptimeNanos;
+
+        /// Fraction of the available worker time (0 to 1) spent
+        /// running tasks since the pool was started
+        double utilization() const
+        {
+            double available = static_cast<double>(uptimeNanos) * threadCount;
+            return available > 0 ? busyNanos / available : 0;
+        }
+    };
+
+    /// @param threadInit  if specified, called on each worker thread
+    ///     (with the worker's index) before it starts taking tasks
+    ///
+    WorkStealingPool(int numberOfThreads, int queueSize,
+        std::function<void(int)> threadInit = nullptr) :
+        injected_(queueSize == 0 ?
+            (std::max(numberOfThreads, 1) * 4) : queueSize),
+        threadInit_(std::move(threadInit)),
+        startTime_(std::chrono::steady_clock::now()),
+        pending_(0),
+        sleepers_(0),
+        signal_(0),
+        running_(true)
+    {
+        numberOfThreads = (numberOfThreads == 0) ? 1 : numberOfThreads;
+        workers_.reset(new Worker[numberOfThreads]);
+        threadCount_ = numberOfThreads;
+        threads_.reserve(numberOfThreads);
+        for (int i = 0; i < numberOfThreads; i++)
+        {
+            threads_.emplace_back(&WorkStealingPool::work, this, i);
+        }
+    }
+
+    ~WorkStealingPool()
+    {
+        shutdown();
+    }
+
+    int threadCount() const { return threadCount_; }
+
+    /// Returns the index (0 to threadCount()-1) of the calling thread
+    /// if it is one of this pool's workers, otherwise -1.
+    ///
+    int currentWorkerIndex() const
+    {
+        return currentPool_ == this ? currentWorkerIndex_ : -1;
+    }
+
+    /// Submits a task, blocking (by yielding) until there is
+    /// room in the injection queue.
+    ///
+    void post(const TaskType& task)
+    {
+        while (!tryPost(task)) std::this_thread::yield();
+    }
+
+    bool post(const TaskType& task, bool wait)
+    {
+        if (wait)
+        {
+            post(task);
+            return true;
+        }
+        return tryPost(task);
+    }
+
+    /// Attempts to submit a task without blocking.
+    ///
+    /// @return `false` if the queue is full
+    ///
+    bool tryPost(const TaskType& task)
+    {
+        return tryPostBatch(&task, 1) != 0;
+    }
+
+    /// Attempts to submit up to `count` tasks without blocking,
+    /// in submission order. Wakes up as many parked workers as
+    /// needed, using a single signal.
+    ///
+    /// @return the number of tasks accepted (the first n of `tasks`);
+    ///   the caller is responsible for the remainder
+    ///
+    int tryPostBatch(const TaskType* tasks, int count)
+    {
+        // Count the tasks as pending before they become visible,
+        // so a worker can never drive the counter negative
+        pending_.fetch_add(count, std::memory_order_relaxed);
+        int accepted = injected_.tryPushBatch(tasks, count);
+        if (accepted < count)
+        {
+            completed(count - accepted);
+        }
+        if (accepted)
+        {
+            signal_.fetch_add(1, std::memory_order_seq_cst);
+            int sleepers = sleepers_.load(std::memory_order_seq_cst);
+            if (sleepers)
+            {
+                if (accepted == 1)
+                {
+                    signal_.notify_one();
+                }
+                else
+                {
+                    signal_.notify_all();
+                }
+            }
+        }
+        return accepted;
+    }
+
+    /// Returns the number of free slots in the injection queue.
+    /// This is only an estimate, since other threads may submit
+    /// or take tasks concurrently.
+    ///
+    int minimumRemainingCapacity() const
+    {
+        return injected_.capacity() - injected_.size();
+    }
+
+    /// Returns the current queue depths and the cumulative counters.
+    /// Safe to call from any thread; the values are approximate, as
+    /// they are read without stopping the workers.
+    ///
+    Stats stats() const
+    {
+        Stats stats {};
+        stats.threadCount = threadCount_;
+        stats.queueCapacity = injected_.capacity();
+        stats.queueDepth = injected_.size();
+        stats.parkedThreads = sleepers_.load(std::memory_order_relaxed);
+        for (int i = 0; i < threadCount_; i++)
+        {
+            const Worker& worker = workers_[i];
+            stats.dequeDepth += std::max(worker.size(), 0);
+            stats.tasksRun += worker.tasksRun.load(std::memory_order_relaxed);
+            stats.busyNanos += worker.busyNanos.load(std::memory_order_relaxed);
+        }
+        stats.uptimeNanos = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - startTime_).count());
+        return stats;
+    }
+
+    /// Blocks until all tasks submitted so far have completed.
+    ///
+    void awaitCompletion()
+    {
+        for (;;)
+        {
+            int pending = pending_.load(std::memory_order_acquire);
+            if (pending == 0) return;
+            pending_.wait(pending, std::memory_order_acquire);
+        }
+    }
+
+    void shutdown()
+    {
+        running_.store(false, std::memory_order_seq_cst);
+        signal_.fetch_add(1, std::memory_order_seq_cst);
+        signal_.notify_all();
+        for (auto& th : threads_)
+        {
+            if (th.joinable())
+            {
+                th.join();
+            }
+        }
+    }
+
+private:
+    static constexpr int CACHE_LINE_SIZE = 64;
+    static constexpr int DEQUE_CAPACITY = 64;       // must be power of 2
+    static constexpr int MAX_GRAB = 8;
+    static constexpr int SPIN_COUNT = 64;
+
+    /// Bounded MPMC queue (after Dmitry Vyukov), with support for
+    /// claiming multiple consecutive slots using a single CAS.
+    ///
+    class InjectionQueue
+    {
+    public:
+        explicit InjectionQueue(int minCapacity)
+        {
+            capacity_ = 2;
+            while (capacity_ < minCapacity) capacity_ <<= 1;
+            mask_ = capacity_ - 1;
+            slots_.reset(new Slot[capacity_]);
+            for (int64_t i = 0; i < capacity_; i++)
+            {
+                slots_[i].seq.store(i, std::memory_order_relaxed);
+            }
+            head_.store(0, std::memory_order_relaxed);
+            tail_.store(0, std::memory_order_relaxed);
+        }
+
+        int capacity() const { return static_cast<int>(capacity_); }
+
+        int size() const
+        {
+            int64_t size = tail_.load(std::memory_order_relaxed) -
+                head_.load(std::memory_order_relaxed);
+            return static_cast<int>(std::clamp<int64_t>(size, 0, capacity_));
+        }
+
+        int tryPushBatch(const TaskType* tasks, int count)
+        {
+            if (count <= 0) return 0;
+            int64_t pos = tail_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                // Determine how many consecutive slots are free
+                int n = 0;
+                while (n < count)
+                {
+                    int64_t seq = slots_[(pos + n) & mask_].seq.load(
+                        std::memory_order_acquire);
+                    if (seq != pos + n) break;
+                    n++;
+                }
+                if (n == 0)
+                {
+                    int64_t seq = slots_[pos & mask_].seq.load(
+                        std::memory_order_acquire);
+                    if (seq < pos) return 0;        // queue is full
+                    pos = tail_.load(std::memory_order_relaxed);
+                    continue;                       // pos is stale
+                }
+                if (tail_.compare_exchange_weak(pos, pos + n,
+                    std::memory_order_relaxed))
+                {
+                    for (int i = 0; i < n; i++)
+                    {
+                        Slot& slot = slots_[(pos + i) & mask_];
+                        slot.task = tasks[i];
+                        slot.seq.store(pos + i + 1, std::memory_order_release);
+                    }
+                    return n;
+                }
+                // CAS failure has reloaded pos
+            }
+        }
+
+        bool tryPop(TaskType& task)
+        {
+            int64_t pos = head_.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Slot& slot = slots_[pos & mask_];
+                int64_t seq = slot.seq.load(std::memory_order_acquire);
+                int64_t diff = seq - (pos + 1);
+                if (diff == 0)
+                {
+                    if (head_.compare_exchange_weak(pos, pos + 1,
+                        std::memory_order_relaxed))
+                    {
+                        task = std::move(slot.task);
+                        slot.seq.store(pos + capacity_, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (diff < 0)
+                {
+                    return false;       // empty
+                }
+                else
+                {
+                    pos = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Slot
+        {
+            std::atomic<int64_t> seq;
+            TaskType task;
+        };
+
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> head_;
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> tail_;
+        alignas(CACHE_LINE_SIZE) std::unique_ptr<Slot[]> slots_;
+        int64_t capacity_;
+        int64_t mask_;
+    };
+
+    /// A slot of a worker's deque. The task is stored as a sequence
+    /// of words, which are loaded and stored with relaxed atomics:
+    /// A thief may read a slot while its owner overwrites it, and
+    /// while the copy may be torn (in which case the thief's CAS
+    /// fails and it discards the copy), this isn't a data race.
+    ///
+    struct Slot
+    {
+        static constexpr size_t WORD_COUNT =
+            (sizeof(TaskType) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+        using Words = uint64_t[WORD_COUNT];
+
+        void store(const TaskType& task)
+        {
+            Words copy = {};
+            std::memcpy(copy, &task, sizeof(TaskType));
+            for (size_t i = 0; i < WORD_COUNT; i++)
+            {
+                words[i].store(copy[i], std::memory_order_relaxed);
+            }
+        }
+
+        void load(Words& copy) const
+        {
+            for (size_t i = 0; i < WORD_COUNT; i++)
+            {
+                copy[i] = words[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        static void toTask(const Words& copy, TaskType& task)
+        {
+            std::memcpy(&task, copy, sizeof(TaskType));
+        }
+
+        std::atomic<uint64_t> words[WORD_COUNT];
+    };
+
+    /// Fixed-capacity Chase-Lev deque. Only the owning worker
+    /// calls push() and pop(); any thread may call steal().
+    ///
+    struct alignas(CACHE_LINE_SIZE) Worker
+    {
+        Worker() : top(0), bottom(0), tasksRun(0), busyNanos(0) {}
+
+        int size() const
+        {
+            return static_cast<int>(bottom.load(std::memory_order_relaxed) -
+                top.load(std::memory_order_relaxed));
+        }
+
+        bool push(const TaskType& task)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            if (b - t >= DEQUE_CAPACITY) return false;
+            slots[b & (DEQUE_CAPACITY - 1)].store(task);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+
+        bool pop(TaskType& task)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            typename Slot::Words copy;
+            slots[b & (DEQUE_CAPACITY - 1)].load(copy);
+            Slot::toTask(copy, task);
+            if (t == b)
+            {
+                // Last item: race against thieves
+                bool won = top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        bool steal(TaskType& task)
+        {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return false;
+            typename Slot::Words copy;
+            slots[t & (DEQUE_CAPACITY - 1)].load(copy);
+            if (!top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                return false;
+            }
+            Slot::toTask(copy, task);
+            return true;
+        }
+
+        std::atomic<int64_t> top;
+        alignas(CACHE_LINE_SIZE) std::atomic<int64_t> bottom;
+
+        // Written only by the owner (atomic, so stats() can read them).
+        // Kept on their own cache line, since thieves keep reading
+        // `bottom`, and the owner updates these for every task
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tasksRun;
+        std::atomic<uint64_t> busyNanos;
+
+        alignas(CACHE_LINE_SIZE) Slot slots[DEQUE_CAPACITY];
+    };
+
+    /// Tracks the time a worker spends running tasks. Time is
+    /// accounted per busy period (rather than per task), so the
+    /// clock is only read when a worker starts or runs out of work.
+    ///
+    class BusyTimer
+    {
+    public:
+        explicit BusyTimer(Worker& worker) : worker_(worker), busy_(false) {}
+
+        void taskStarted()
+        {
+            if (!busy_)
+            {
+                busy_ = true;
+                start_ = std::chrono::steady_clock::now();
+            }
+            worker_.tasksRun.store(worker_.tasksRun.load(
+                std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        /// Called when the worker runs out of work
+        void idle()
+        {
+            if (!busy_) return;
+            busy_ = false;
+            uint64_t nanos = static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count());
+            worker_.busyNanos.store(worker_.busyNanos.load(
+                std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+        }
+
+    private:
+        Worker& worker_;
+        std::chrono::steady_clock::time_point start_;
+        bool busy_;
+    };
+
+    void completed(int count)
+    {
+        if (pending_.fetch_sub(count, std::memory_order_acq_rel) == count)
+        {
+            pending_.notify_all();
+        }
+    }
+
+    /// Takes a task from the injection queue, and moves a few more
+    /// into the worker's own deque, where they can be stolen by
+    /// other workers.
+    ///
+    bool takeInjected(Worker& self, TaskType& task)
+    {
+        if (!injected_.tryPop(task)) return false;
+        int grab = std::min(injected_.size() / threadCount_, MAX_GRAB);
+        TaskType extra;
+        while (grab > 0 && self.size() < DEQUE_CAPACITY)
+        {
+            if (!injected_.tryPop(extra)) break;
+            self.push(extra);   // can't fail, we checked the size
+            grab--;
+        }
+        if (self.size() > 0 && sleepers_.load(std::memory_order_seq_cst))
+        {
+            // Let parked workers know there is something to steal
+            signal_.fetch_add(1, std::memory_order_seq_cst);
+            signal_.notify_all();
+        }
+        return true;
+    }
+
+    bool steal(int selfIndex, TaskType& task)
+    {
+        for (int i = 1; i < threadCount_; i++)
+        {
+            int victim = selfIndex + i;
+            if (victim >= threadCount_) victim -= threadCount_;
+            if (workers_[victim].steal(task)) return true;
+        }
+        return false;
+    }
+
+    bool findTask(int selfIndex, TaskType& task)
+    {
+        Worker& self = workers_[selfIndex];
+        return self.pop(task) || takeInjected(self, task) ||
+            steal(selfIndex, task);
+    }
+
+    void work(int selfIndex)
+    {
+        currentPool_ = this;
+        currentWorkerIndex_ = selfIndex;
+        if (threadInit_) threadInit_(selfIndex);
+        BusyTimer timer(workers_[selfIndex]);
+        TaskType task;
+        for (;;)
+        {
+            if (findTask(selfIndex, task))
+            {
+                timer.taskStarted();
+                task();
+                completed(1);
+                continue;
+            }
+            timer.idle();
+
+            bool found = false;
+            for (int i = 0; i < SPIN_COUNT; i++)
+            {
+                std::this_thread::yield();
+                if (findTask(selfIndex, task))
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (found)
+            {
+                timer.taskStarted();
+                task();
+                completed(1);
+                continue;
+            }
+
+            // Announce that we're about to park, then check once more
+            // (A submitter bumps the signal *after* making its tasks
+            // visible, so we'll either see the tasks, or the wait
+            // returns immediately)
+            uint32_t signal = signal_.load(std::memory_order_seq_cst);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            if (!running_.load(std::memory_order_seq_cst))
+            {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                return;
+            }
+            if (findTask(selfIndex, task))
+            {
+                sleepers_.fetch_sub(1, std::memory_order_relaxed);
+                timer.taskStarted();
+                task();
+                completed(1);
+                continue;
+            }
+            signal_.wait(signal, std::memory_order_seq_cst);
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+
+    static inline thread_local const WorkStealingPool* currentPool_ = nullptr;
+    static inline thread_local int currentWorkerIndex_ = -1;
+
+    InjectionQueue injected_;
+    std::unique_ptr<Worker[]> workers_;
+    int threadCount_;
+    std::function<void(int)> threadInit_;
+    std::chrono::steady_clock::time_point startTime_;
+    std::vector<std::thread> threads_;
+    alignas(CACHE_LINE_SIZE) std::atomic<int> pending_;
+    alignas(CACHE_LINE_SIZE) std::atomic<int> sleepers_;
+    std::atomic<uint32_t> signal_;
+    std::atomic<bool> running_;
+};
+
+} // namespace clarisma
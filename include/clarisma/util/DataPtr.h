@@ -23,17 +23,13 @@ public:
     DataPtr(std::byte* p) noexcept : p_(reinterpret_cast<uint8_t*>(p)) {}
     DataPtr(const std::byte* p) noexcept : p_(const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(p))) {}
     DataPtr(const uint8_t* p) noexcept : p_(const_cast<uint8_t*>(p)) {}
-    DataPtr(const DataPtr& other) noexcept : p_(other.p_) {}
+    DataPtr(const DataPtr& other) noexcept = default;
 
     uint8_t* ptr() const noexcept { return p_; }
     std::byte* bytePtr() const noexcept { return reinterpret_cast<std::byte*>(p_); }
     char* charPtr() const noexcept { return reinterpret_cast<char*>(p_); }
 
-    DataPtr& operator=(const DataPtr& other) noexcept
-    {
-        p_ = other.p_;
-        return *this;
-    }
+    DataPtr& operator=(const DataPtr& other) noexcept = default;
 
     DataPtr& operator=(uint8_t* p) noexcept
     {
@@ -0,0 +1,161 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace clarisma {
+
+/// @brief A bounded map that evicts its least-recently-used entry
+/// once it is full.
+///
+/// LruCache does no locking of its own; if it is shared by multiple
+/// threads, the owner must guard it (lookups modify the recency
+/// order, so even get() requires exclusive access).
+///
+/// Evicted values are handed to a callback, so the owner can release
+/// the resources they hold (e.g. drop a reference).
+///
+template<typename K, typename V, typename Hash = std::hash<K>>
+class LruCache
+{
+public:
+    struct Stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        size_t size;
+        size_t capacity;
+
+        double hitRate() const
+        {
+            uint64_t lookups = hits + misses;
+            return lookups ? static_cast<double>(hits) / lookups : 0;
+        }
+    };
+
+    explicit LruCache(size_t capacity) :
+        capacity_(capacity),
+        hits_(0),
+        misses_(0),
+        evictions_(0)
+    {
+    }
+
+    size_t size() const { return map_.size(); }
+    size_t capacity() const { return capacity_; }
+
+    /// Returns a pointer to the value for `key` (and marks it as the
+    /// most recently used), or `nullptr` if the cache has no such entry.
+    /// The pointer remains valid until the entry is evicted.
+    ///
+    V* get(const K& key)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end())
+        {
+            misses_++;
+            return nullptr;
+        }
+        hits_++;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+
+    /// Adds an entry for `key` (which must not be present yet),
+    /// evicting the least-recently-used entry if the cache is full.
+    /// A cache with a capacity of 0 does not hold any entries;
+    /// in that case, `value` itself is evicted right away.
+    ///
+    template<typename Evict>
+    void put(K key, V value, Evict&& evict)
+    {
+        if (capacity_ == 0)
+        {
+            evict(value);
+            return;
+        }
+        while (map_.size() >= capacity_) evictOldest(evict);
+        entries_.emplace_front(std::move(key), std::move(value));
+        map_.emplace(entries_.front().first, entries_.begin());
+    }
+
+    /// Changes the capacity, evicting entries as needed
+    ///
+    template<typename Evict>
+    void setCapacity(size_t capacity, Evict&& evict)
+    {
+        capacity_ = capacity;
+        while (map_.size() > capacity_) evictOldest(evict);
+    }
+
+    /// Evicts the least-recently-used entry. Returns `false` if
+    /// the cache is empty.
+    ///
+    template<typename Evict>
+    bool evictLeastRecent(Evict&& evict)
+    {
+        if (entries_.empty()) return false;
+        evictOldest(evict);
+        return true;
+    }
+
+    /// Removes the entry for `key` (if any), handing its value to
+    /// `evict`. Removals don't count as evictions.
+    ///
+    template<typename Evict>
+    bool remove(const K& key, Evict&& evict)
+    {
+        auto it = map_.find(key);
+        if (it == map_.end()) return false;
+        Iterator entry = it->second;
+        map_.erase(it);
+        evict(entry->second);
+        entries_.erase(entry);
+        return true;
+    }
+
+    /// Removes all entries, handing their values to `evict`.
+    /// Like removals, these don't count as evictions.
+    ///
+    template<typename Evict>
+    void clear(Evict&& evict)
+    {
+        for (Entry& entry : entries_) evict(entry.second);
+        entries_.clear();
+        map_.clear();
+    }
+
+    Stats stats() const
+    {
+        return { hits_, misses_, evictions_, map_.size(), capacity_ };
+    }
+
+private:
+    using Entry = std::pair<K, V>;
+    using Iterator = typename std::list<Entry>::iterator;
+
+    template<typename Evict>
+    void evictOldest(Evict& evict)
+    {
+        Entry& oldest = entries_.back();
+        map_.erase(oldest.first);
+        evict(oldest.second);
+        entries_.pop_back();
+        evictions_++;
+    }
+
+    std::list<Entry> entries_;      // most recently used first
+    std::unordered_map<K, Iterator, Hash> map_;
+    size_t capacity_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t evictions_;
+};
+
+} // namespace clarisma
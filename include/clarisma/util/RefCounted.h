@@ -3,11 +3,8 @@
 
 #pragma once
 
-#ifdef GEODESK_MULTITHREADED
 #include <atomic>
-#else
 #include <cstdint>
-#endif
 
 namespace clarisma {
 
@@ -49,4 +46,30 @@ private:
 #endif
 };
 
+/// Like RefCounted, but the reference count is atomic even if
+/// GEODESK_MULTITHREADED is off.
+///
+class AtomicRefCounted
+{
+public:
+	AtomicRefCounted() : refcount_(1) {}
+	virtual ~AtomicRefCounted() {};
+
+	void addref() const
+	{
+		refcount_.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void release() const
+	{
+		if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete this;
+		}
+	}
+
+private:
+	mutable std::atomic_uint32_t refcount_;
+};
+
 } // namespace clarisma
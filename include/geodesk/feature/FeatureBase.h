@@ -7,6 +7,7 @@
 #include <clarisma/util/TaggedPtr.h>
 #include <geodesk/feature/FeatureStore.h>
 #include <geodesk/feature/FeatureUtils.h>
+#include <geodesk/feature/TagProjection.h>
 #include <geodesk/feature/Tags.h>
 #include <geodesk/feature/NodePtr.h>
 #include <geodesk/feature/WayPtr.h>
@@ -258,6 +259,23 @@ public:
         return tags.tagValue(val, store_.ptr()->strings());
     }
 
+    /// @brief Obtains the values of all keys of a TagProjection
+    /// (in a single pass over the feature's tags).
+    ///
+    /// @param keys   the keys to look up
+    /// @param values an array of `keys.size()` elements, which
+    ///               receives the values in the order of the keys
+    ///               (an empty string for each missing tag)
+    void tagValues(const TagProjection& keys, TagValue* values) const
+    {
+        if(isAnonymousNode())
+        {
+            std::fill(values, values + keys.size(), TagValue());
+            return;
+        }
+        keys.lookup(feature_.ptr.tags(), store_.ptr()->strings(), values);
+    }
+
     /// @brief Checks if this set of tags contains
     /// a tag with the given key.
     ///
@@ -13,8 +13,14 @@ template<typename T>
 class FeatureIterator : protected FeatureIteratorBase
 {
 public:
-    explicit FeatureIterator(const View& view) :
-        FeatureIteratorBase(view) {}
+    /// @param limit  the maximum number of features to return
+    ///   (0 = no limit), which lets a query stop scanning tiles early
+    /// @param stats  if not `nullptr`, a query over tiles records its
+    ///   execution statistics here (ignored by other kinds of views)
+    ///
+    explicit FeatureIterator(const View& view, uint32_t limit = 0,
+        QueryStats* stats = nullptr) :
+        FeatureIteratorBase(view, limit, stats) {}
 
     // Dereference operator
     T operator*() const noexcept
@@ -20,7 +20,8 @@ namespace geodesk {
 class GEODESK_API FeatureIteratorBase
 {
 public:
-    explicit FeatureIteratorBase(const View& view);
+    explicit FeatureIteratorBase(const View& view, uint32_t limit = 0,
+        QueryStats* stats = nullptr);
     ~FeatureIteratorBase();
 
 protected:
@@ -29,7 +30,7 @@ protected:
 
 private:
 	void initNodeIterator(const View& view);
-	void initParentWaysIterator(const View& view);
+	void initParentWaysIterator(const View& view, uint32_t limit);
 	void destroyParentWaysIterator();
 	void initParentRelationsIterator(FeatureStore* store, FeaturePtr member,
 		const MatcherHolder* matcher, const Filter* filter);
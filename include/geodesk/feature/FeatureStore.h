@@ -3,13 +3,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <span>
 #include <unordered_map>
 #ifdef GEODESK_PYTHON
 #include <Python.h>
 #endif
 #include <clarisma/libero/FreeStore.h>
-#include <clarisma/thread/ThreadPool.h>
 #include <clarisma/util/DateTime.h>
 #include <clarisma/util/UUID.h>
 #include <geodesk/export.h>
@@ -17,9 +19,10 @@
 #include <geodesk/feature/StringTable.h>
 #include <geodesk/feature/TilePtr.h>
 #include <geodesk/feature/ZoomLevels.h>
+#include <geodesk/filter/FilterCache.h>
 #include <geodesk/match/Matcher.h>
 #include <geodesk/match/MatcherCompiler.h>
-#include <geodesk/query/TileQueryTask.h>
+#include <geodesk/query/QueryExecutor.h>
 
 // \cond
 
@@ -28,9 +31,7 @@ class PyFeatures;       // not namespaced for now
 namespace geodesk {
 
 class MatcherHolder;
-
-//  Possible threadpool alternatives:
-//  - https://github.com/progschj/ThreadPool (Zlib license, header-only)
+class TileStatistics;
 
 using std::byte;
 using clarisma::DataPtr;
@@ -138,6 +139,10 @@ public:
     std::span<byte> propertiesData() const;
 
     const MatcherHolder* getMatcher(const char* query);
+    /// The compiler (and cache) of this store's matchers
+    MatcherCompiler& matchers() { return matchers_; }
+    /// The prepared spatial filters of this store's features
+    FilterCache& filters() { return filters_; }
     const MatcherHolder* borrowAllMatcher() const { return &allMatcher_; }
     const MatcherHolder* getAllMatcher() 
     { 
@@ -166,7 +171,38 @@ public:
     PyFeatures* getEmptyFeatures();
     #endif
 
-    clarisma::ThreadPool<TileQueryTask>& executor() { return executor_; }
+    /// The executor is shared by all stores (see QueryExecutor)
+    QueryExecutor::Pool& executor() { return QueryExecutor::get(); }
+
+    /// Returns the maximum number of tiles that a query against this
+    /// store may have in flight at once (0 = no limit other than the
+    /// executor's capacity).
+    int maxQueryParallelism() const noexcept
+    {
+        return maxQueryParallelism_.load(std::memory_order_relaxed);
+    }
+
+    /// Caps the number of tiles that each query against this store may
+    /// have in flight, which keeps a single store (or a single large
+    /// query) from occupying all threads of the shared executor.
+    /// Affects queries created after the call; safe to call while
+    /// other threads run queries.
+    void setMaxQueryParallelism(int max) noexcept
+    {
+        maxQueryParallelism_.store(max, std::memory_order_relaxed);
+    }
+
+    /// Returns the per-tile feature counts of this GOL, which are
+    /// loaded from its sidecar file (see TileStatistics) the first
+    /// time they are needed (and again after a transaction has been
+    /// committed) -- or `nullptr` if there is no sidecar, or it is
+    /// out of date.
+    const TileStatistics* tileStatistics();
+
+    /// Replaces the tile statistics of this GOL (e.g. after creating
+    /// them via TileStatistics::build()). Must not be called while
+    /// queries are running.
+    void setTileStatistics(std::unique_ptr<TileStatistics> statistics);
 
     TilePtr fetchTile(Tip tip) const;
     static bool isTileValid(const byte* p);
@@ -205,6 +241,7 @@ private:
     uint32_t* tileIndex_ = nullptr;
     MatcherCompiler matchers_;
     MatcherHolder allMatcher_;
+    FilterCache filters_;
     #ifdef GEODESK_PYTHON
     PyObject* emptyTags_;
     PyFeatures* emptyFeatures_;       
@@ -214,8 +251,11 @@ private:
         // but PyFeatures requires a non-null MatcherHolder, which in turn
         // requires a FeatureStore
     #endif
-    clarisma::ThreadPool<TileQueryTask> executor_;
     ZoomLevels zoomLevels_;
+    std::atomic<int> maxQueryParallelism_ = 0;
+    std::mutex tileStatisticsMutex_;
+    bool tileStatisticsLoaded_ = false;
+    std::unique_ptr<TileStatistics> tileStatistics_;
 
     friend class Transaction;
 };
@@ -8,22 +8,33 @@
 
 namespace geodesk {
 
+class FeaturePtr;
+class QueryStats;
 class Tags;
 class View;
+enum class QueryReduction : uint8_t;
 
 /// \cond internal
 ///
 class GEODESK_API FeatureUtils
 {
 public:
-    static uint64_t count(const View& view);
+    static uint64_t count(const View& view, QueryStats* stats = nullptr);
     static bool isEmpty(const View& view);
+    static QueryStats explain(const View& view);
+    static double length(const View& view, QueryStats* stats = nullptr);
+    static double area(const View& view, QueryStats* stats = nullptr);
+    static int parallelSlotCount(const View& view);
+    static void visitWorld(const View& view,
+        bool (*visitor)(void* closure, int slot, FeaturePtr feature),
+        void* closure);
     static char* format(char* buf, const char* type, int64_t id);
     static std::string label(const Tags& tags);
 
 private:
-    static uint64_t countWorld(const View& view);
     static uint64_t countGeneric(const View& view);
+    static double reduceWorld(const View& view, QueryReduction reduction,
+        QueryStats* stats);
 };
 
 // \endcond
@@ -4,12 +4,17 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <exception>
 #include <optional>
+#include <vector>
 #include <geodesk/filter/Filters.h>
 #include <geodesk/feature/FeatureUtils.h>
 #include <geodesk/feature/QueryException.h>
+#include <geodesk/feature/TagProjection.h>
 #include <geodesk/feature/View.h>
 #include <geodesk/filter/PredicateFilter.h>
+#include <geodesk/query/QueryStats.h>
 #ifdef GEODESK_WITH_GEOS
 #include <geos_c.h>
 #endif
@@ -136,6 +141,103 @@ public:
     ///
     [[nodiscard]] double area() const;
 
+    /// @brief Counts the features in this collection, recording how
+    /// the query was executed in `stats` (see explain()).
+    ///
+    [[nodiscard]] uint64_t count(QueryStats& stats) const
+    {
+        return FeatureUtils::count(view_, &stats);
+    }
+
+    /// @brief Calculates the total length (in meters) of the features
+    /// in this collection, recording how the query was executed in
+    /// `stats` (see explain()).
+    ///
+    [[nodiscard]] double length(QueryStats& stats) const
+    {
+        return FeatureUtils::length(view_, &stats);
+    }
+
+    /// @brief Calculates the total area (in square meters) of the
+    /// features in this collection, recording how the query was
+    /// executed in `stats` (see explain()).
+    ///
+    [[nodiscard]] double area(QueryStats& stats) const
+    {
+        return FeatureUtils::area(view_, &stats);
+    }
+
+    /// @brief Runs this query to completion (as if to count its
+    /// features) and reports how it was executed: how many tiles
+    /// were scanned, skipped or accelerated by a spatial filter,
+    /// how much of each spatial index was visited, how many
+    /// features were handed to the tag matcher and filter, and
+    /// where the time went.
+    ///
+    /// Use this to find out why a query is slow. The instrumented
+    /// query runs somewhat slower than the regular one.
+    ///
+    /// This is a separate pass that counts the features, so it may
+    /// take shortcuts that an iteration can't (such as counting entire
+    /// tiles from the GOL's tile statistics). To find out how an actual
+    /// iteration or reduction was executed (e.g. to log slow queries),
+    /// pass a QueryStats to withStats(), count(), length() or area().
+    ///
+    /// @code
+    /// std::cout << pubs.explain().toString();
+    /// @endcode
+    ///
+    [[nodiscard]] QueryStats explain() const
+    {
+        return FeatureUtils::explain(view_);
+    }
+
+    /// @}
+    /// @name Parallel processing
+    /// @{
+
+    /// @brief Calls `visit(feature)` for each feature in this collection.
+    ///
+    /// For bounding-box and tag queries, `visit` runs directly on the
+    /// query worker threads, so it may be called concurrently and in no
+    /// particular order; it must be thread-safe. If `visit` throws, the
+    /// query stops (no further tiles are scanned), and the first
+    /// exception is rethrown on the calling thread.
+    ///
+    /// `visit` may itself query the same store (e.g. to look up the
+    /// parents of a feature). Since it runs on a query worker, such
+    /// nested queries scan their tiles on that worker rather than
+    /// waiting for the (busy) pool.
+    ///
+    template<typename Visit>
+    void forEachParallel(Visit visit) const;
+
+    /// @brief Reduces the features in this collection using per-thread
+    /// state.
+    ///
+    /// Each thread that takes part in the query works on its own copy
+    /// of `initial`, calling `visit(state, feature)` for each feature
+    /// it encounters (no locking needed). Once all features have been
+    /// visited, the calling thread folds each per-thread state into
+    /// `initial` by calling `merge(initial, std::move(state))`, and
+    /// returns the result.
+    ///
+    /// Exceptions thrown by `visit` are handled as in forEachParallel().
+    ///
+    /// @code
+    /// auto [count, total] = buildings.reduceParallel(
+    ///     std::pair<int64_t,double>(0, 0),
+    ///     [](auto& s, Feature f) { s.first++; s.second += f.area(); },
+    ///     [](auto& a, auto&& b) { a.first += b.first; a.second += b.second; });
+    /// @endcode
+    ///
+    template<typename State, typename Visit, typename Merge>
+    [[nodiscard]] State reduceParallel(State initial, Visit visit, Merge merge) const;
+
+    /// @}
+    /// @name Iteration
+    /// @{
+
     FeatureIterator<T> begin() const;
 
     std::nullptr_t end() const
@@ -143,6 +245,39 @@ public:
         return nullptr;  // Simple sentinel indicating the end of iteration
     }
 
+    /// The features of a collection, iterated by a query that
+    /// records its execution statistics (see withStats())
+    ///
+    class InstrumentedRange
+    {
+    public:
+        InstrumentedRange(const View& view, QueryStats& stats) :
+            view_(view), stats_(stats) {}
+
+        FeatureIterator<T> begin() const;
+        std::nullptr_t end() const { return nullptr; }
+
+    private:
+        View view_;
+        QueryStats& stats_;
+    };
+
+    /// @brief Iterates the features in this collection, recording how
+    /// the query was executed in `stats` (complete once the iteration
+    /// has ended, or the loop has been left). Only queries over the
+    /// tiles of a GOL record their statistics.
+    ///
+    /// @code
+    /// QueryStats stats;
+    /// for (Feature pub : pubs.withStats(stats)) { ... }
+    /// if (stats.totalNanos > SLOW) log(stats.toString());
+    /// @endcode
+    ///
+    [[nodiscard]] InstrumentedRange withStats(QueryStats& stats) const
+    {
+        return { view_, stats };
+    }
+
     /// @}
     /// @name Spatial filters
     /// @{
@@ -364,11 +499,46 @@ public:
         return store()->key(k);
     }
 
+    /// @brief Obtains a TagProjection for the given keys, which
+    /// can be used to look up their values in a single pass.
+    ///
+    /// **Important:** The resulting TagProjection can only be used
+    /// for features that are stored in the same GOL.
+    ///
+    [[nodiscard]] TagProjection keys(std::initializer_list<std::string_view> k) const
+    {
+        return TagProjection(store()->strings(), k);
+    }
+
     /// @brief Returns a pointer to the FeatureStore
     /// which contains the features in this collection.
     ///
     FeatureStore* store() const noexcept { return view_.store(); }
 
+    /// @brief Returns the maximum number of tiles that a query
+    /// against this GOL may scan at once (0 = no limit other than
+    /// the number of query threads).
+    ///
+    int maxQueryParallelism() const noexcept
+    {
+        return store()->maxQueryParallelism();
+    }
+
+    /// @brief Caps the number of tiles that each query against this
+    /// GOL may scan at once.
+    ///
+    /// All GOLs share the same query threads; use this to keep
+    /// large queries against one GOL from occupying all of them.
+    /// The cap applies to every collection of features from this
+    /// GOL, for queries started after the call.
+    ///
+    /// @param max the maximum number of tiles (0 = no limit)
+    ///
+    void setMaxQueryParallelism(int max) const noexcept
+    {
+        store()->setMaxQueryParallelism(max);
+    }
+
 protected:
     FeaturesBase(const View& view) : view_(view)
     {
@@ -22,11 +22,17 @@ FeatureIterator<T> FeaturesBase<T>::begin() const
     return FeatureIterator<T>(view_);
 }
 
+template<typename T>
+FeatureIterator<T> FeaturesBase<T>::InstrumentedRange::begin() const
+{
+    return FeatureIterator<T>(view_, 0, &stats_);
+}
+
 
 template<typename T>
 [[nodiscard]] std::optional<T> FeaturesBase<T>::first() const
 {
-    FeatureIterator<T> query(view_);
+    FeatureIterator<T> query(view_, 1);
     if(query != nullptr) return std::optional<T>(*query);
     return std::nullopt;
 }
@@ -34,7 +40,8 @@ template<typename T>
 template<typename T>
 [[nodiscard]] T FeaturesBase<T>::one() const
 {
-    FeatureIterator<T> query(view_);
+    FeatureIterator<T> query(view_, 2);
+        // We only need to know whether there is more than one
     if(query != nullptr)
     {
         T feature = *query;
@@ -57,17 +64,102 @@ void FeaturesBase<T>::addTo(std::vector<T>& v) const
 template<typename T>
 [[nodiscard]] double FeaturesBase<T>::area() const
 {
-    double total = 0;
-    for(auto f: *this) total += f.area();
-    return total;
+    return FeatureUtils::area(view_);
 }
 
 template<typename T>
 [[nodiscard]] double FeaturesBase<T>::length() const
 {
-    double total = 0;
-    for(auto f: *this) total += f.length();
-    return total;
+    return FeatureUtils::length(view_);
+}
+
+template<typename T>
+template<typename Visit>
+void FeaturesBase<T>::forEachParallel(Visit visit) const
+{
+    struct Stateless {};
+    (void)reduceParallel(Stateless(),
+        [&visit](Stateless&, T feature) { visit(feature); },
+        [](Stateless&, Stateless&&) {});
+}
+
+template<typename T>
+template<typename State, typename Visit, typename Merge>
+[[nodiscard]] State FeaturesBase<T>::reduceParallel(
+    State initial, Visit visit, Merge merge) const
+{
+    // Padded, so threads don't write to each other's cache lines
+    struct alignas(64) Slot
+    {
+        std::optional<State> state;
+    };
+
+    struct Closure
+    {
+        Closure(FeatureStore* store, const State* initial, Visit* visit, int slotCount) :
+            store(store), initial(initial), visit(visit), slots(slotCount), failed(false)
+        {
+        }
+
+        static bool call(void* closure, int slot, FeaturePtr ptr)
+        {
+            Closure* self = static_cast<Closure*>(closure);
+            Feature feature(self->store, ptr);
+            return self->accept(slot, reinterpret_cast<const T&>(feature));
+        }
+
+        /// Returns `false` once a visitor has failed, which stops
+        /// the query
+        ///
+        bool accept(int slot, const T& feature)
+        {
+            if (failed.load(std::memory_order_relaxed)) return false;
+            try
+            {
+                std::optional<State>& state = slots[slot].state;
+                if (!state) state.emplace(*initial);
+                (*visit)(*state, feature);
+                return true;
+            }
+            catch (...)
+            {
+                if (!failed.exchange(true))
+                {
+                    exception = std::current_exception();
+                }
+                return false;
+            }
+        }
+
+        FeatureStore* store;
+        const State* initial;
+        Visit* visit;
+        std::vector<Slot> slots;
+        std::atomic<bool> failed;
+        std::exception_ptr exception;
+    };
+
+    Closure closure(store(), &initial, &visit,
+        FeatureUtils::parallelSlotCount(view_));
+    if (view_.view() == View::WORLD)
+    {
+        FeatureUtils::visitWorld(view_, &Closure::call, &closure);
+    }
+    else
+    {
+        // Other views are iterated on the calling thread
+        int slot = static_cast<int>(closure.slots.size()) - 1;
+        for (T feature : *this)
+        {
+            if (!closure.accept(slot, feature)) break;
+        }
+    }
+    if (closure.exception) std::rethrow_exception(closure.exception);
+    for (Slot& slot : closure.slots)
+    {
+        if (slot.state) merge(initial, std::move(*slot.state));
+    }
+    return initial;
 }
 
 template<typename T>
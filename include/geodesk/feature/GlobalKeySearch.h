@@ -0,0 +1,111 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <clarisma/util/Bits.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define GEODESK_GLOBAL_KEY_SEARCH_SSE2
+#endif
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+namespace GlobalKeySearch
+{
+	/// The layout of a block of 8 words that starts with a global key:
+	/// `keys` has a bit set for each word that is a key (based on the
+	/// wide-value flags of the keys that precede it), `next` is the
+	/// position of the first key after the block.
+	///
+	struct Block
+	{
+		uint8_t keys;
+		uint8_t next;
+	};
+
+	constexpr std::array<Block, 256> createBlocks()
+	{
+		std::array<Block, 256> blocks {};
+		for (int wide = 0; wide < 256; wide++)
+		{
+			int keys = 0;
+			int pos = 0;
+			while (pos < 8)
+			{
+				keys |= 1 << pos;
+				pos += ((wide >> pos) & 1) ? 3 : 2;
+			}
+			blocks[wide] = { static_cast<uint8_t>(keys), static_cast<uint8_t>(pos) };
+		}
+		return blocks;
+	}
+
+	inline constexpr std::array<Block, 256> BLOCKS = createBlocks();
+}
+
+/// Returns a pointer to the first global key in a tag table that is
+/// greater than or equal to `keyBits` (a global-key code shifted left
+/// by 2). This is always a valid key, since the last key has bit 15
+/// set. `p` must point to a global key (usually, the first one).
+///
+/// If SSE2 is available, keys are examined 8 words at a time: a
+/// 256-entry table tells us which of these words are keys, based on
+/// their wide-value flags, so a run of 2 to 4 tags is checked with a
+/// handful of instructions. Such a load may read past the end of the
+/// tag table (and tile), but never beyond the 4-KB page that holds
+/// its start.
+///
+/// This pays off for lookups of arbitrary keys (which defeat branch
+/// prediction in a tag-by-tag scan), but not for matchers, which
+/// look for their keys in ascending order and usually find them at
+/// or right after the current tag -- MatcherEngine::scanGlobalKeys()
+/// therefore sticks to the simple loop.
+///
+inline const uint8_t* findGlobalKey(const uint8_t* p, uint16_t keyBits)
+{
+#ifdef GEODESK_GLOBAL_KEY_SEARCH_SSE2
+	const __m128i operand = _mm_set1_epi16(static_cast<short>(keyBits));
+	const __m128i zero = _mm_setzero_si128();
+	for (;;)
+	{
+		if ((reinterpret_cast<uintptr_t>(p) & 4095) <= 4096 - 16)	[[likely]]
+		{
+			__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			// Move the wide-value flag (bit 1) into the sign bit
+			__m128i wide = _mm_slli_epi16(words, 14);
+			int wideMask = _mm_movemask_epi8(_mm_packs_epi16(wide, zero));
+			// Unsigned (word >= keyBits) is the same as a saturating
+			// (keyBits - word) that is 0
+			__m128i ge = _mm_cmpeq_epi16(_mm_subs_epu16(operand, words), zero);
+			int geMask = _mm_movemask_epi8(_mm_packs_epi16(ge, zero));
+			GlobalKeySearch::Block block = GlobalKeySearch::BLOCKS[wideMask];
+			int hits = geMask & block.keys;
+			if (hits) return p + clarisma::Bits::countTrailingZerosInNonZero(hits) * 2;
+			p += block.next * 2;
+			continue;
+		}
+		uint16_t key;
+		std::memcpy(&key, p, 2);
+		if (key >= keyBits) return p;
+		p += 4 + (key & 2);
+	}
+#else
+	for (;;)
+	{
+		uint16_t key;
+		std::memcpy(&key, p, 2);
+		if (key >= keyBits) return p;
+		p += 4 + (key & 2);
+	}
+#endif
+}
+
+// \endcond
+
+} // namespace geodesk
@@ -0,0 +1,97 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <clarisma/util/ShortVarString.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// The first and last 4 bytes of a key, encoded as a ShortVarString
+/// (i.e. including its length). Checking these against the local keys
+/// of a tag table takes two aligned 32-bit comparisons and rules out
+/// almost all non-matching keys without looking at their characters
+/// (Local keys are 4-byte aligned, and tile data is followed by at
+/// least 4 bytes, so reading the first word of even a short key
+/// is safe). For keys of up to 7 characters, the signature covers
+/// every byte, so a match is definitive.
+///
+class KeySignature
+{
+public:
+	KeySignature(const char* key, size_t len) noexcept
+	{
+		uint8_t bytes[8] {};
+		uint8_t mask[8] {};
+		size_t n = 0;
+		if (len < 128)
+		{
+			bytes[n++] = static_cast<uint8_t>(len);
+		}
+		else
+		{
+			bytes[n++] = static_cast<uint8_t>(len | 0x80);
+			bytes[n++] = static_cast<uint8_t>(len >> 7);
+		}
+		size_t totalSize = n + len;
+		std::memcpy(&bytes[n], key, std::min<size_t>(len, 4 - n));
+		std::memset(mask, 0xff, std::min<size_t>(totalSize, 4));
+		std::memcpy(&head_, bytes, 4);
+		std::memcpy(&headMask_, mask, 4);
+		if (totalSize > 4)
+		{
+			tailOfs_ = static_cast<uint32_t>(totalSize - 4);
+			std::memcpy(&tail_, key + len - 4, 4);
+			tailMask_ = 0xffff'ffff;
+		}
+		else
+		{
+			// The tail check becomes a repeat of the head check
+			tailOfs_ = 0;
+			tail_ = head_;
+			tailMask_ = headMask_;
+		}
+		exact_ = totalSize <= 8;
+	}
+
+	/// Checks whether the given string could be the key;
+	/// the result is definitive if isExact() is `true`.
+	///
+	bool mayMatch(const clarisma::ShortVarString* s) const noexcept
+	{
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(s);
+		uint32_t head;
+		std::memcpy(&head, p, 4);
+		if ((head & headMask_) != head_) return false;
+		// The head includes the length, so the string is long
+		// enough for us to read its tail
+		uint32_t tail;
+		std::memcpy(&tail, p + tailOfs_, 4);
+		return (tail & tailMask_) == tail_;
+	}
+
+	bool isExact() const noexcept { return exact_; }
+
+	bool matches(const clarisma::ShortVarString* s,
+		const char* key, size_t len) const noexcept
+	{
+		return mayMatch(s) && (exact_ || s->equals(key, len));
+	}
+
+private:
+	uint32_t head_;
+	uint32_t headMask_;
+	uint32_t tail_;
+	uint32_t tailMask_;
+	uint32_t tailOfs_;
+	bool exact_;
+};
+
+// \endcond
+
+} // namespace geodesk
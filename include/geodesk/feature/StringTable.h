@@ -6,6 +6,7 @@
 #ifdef GEODESK_PYTHON
 #include <Python.h>
 #endif
+#include <atomic>
 #include <clarisma/util/ShortVarString.h>
 #include <geodesk/feature/types.h>
 
@@ -49,6 +50,29 @@ public:
         assert(code >= 0 && code < static_cast<int>(stringCount_));
         return reinterpret_cast<const clarisma::ShortVarString*>(stringBase_ + entries_[code].relPointer);
     }
+    /// Returns the numeric value of each global string (or NaN if the
+    /// string isn't a number), indexed by code. The table is built on
+    /// first use; afterwards, this method is cheap enough to call
+    /// for each tag value.
+    ///
+    const double* numbers() const
+    {
+        const double* numbers = numbers_.load(std::memory_order_acquire);
+        if (numbers) [[likely]] return numbers;
+        return createNumbers();
+    }
+
+    /// Returns the numeric value of the given global string (or NaN
+    /// if it isn't a number). numbers() must have been called before.
+    ///
+    double getNumber(int code) const noexcept
+    {
+        assert(code >= 0 && code < static_cast<int>(stringCount_));
+        const double* numbers = numbers_.load(std::memory_order_relaxed);
+        assert(numbers);
+        return numbers[code];
+    }
+
     bool isValidCode(int code);
     int getCode(const char* str, size_t len) const;
     int getCode(std::string_view s) const
@@ -83,6 +107,7 @@ private:
     };
 
     int getCode(size_t hash, const char* str, size_t len) const;
+    const double* createNumbers() const;
 
     uint32_t stringCount_;
     uint32_t lookupMask_;
@@ -90,6 +115,7 @@ private:
     uint8_t* arena_;
     uint16_t* buckets_;
     Entry* entries_;
+    mutable std::atomic<const double*> numbers_;
     #ifdef GEODESK_PYTHON
     PyObject** stringObjects_;
     #endif
@@ -0,0 +1,88 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <geodesk/feature/KeySignature.h>
+#include <geodesk/feature/TagTablePtr.h>
+
+namespace geodesk {
+
+/// @brief A fixed list of keys, whose values can be retrieved
+/// in a single pass over a feature's tags.
+///
+/// Looking up K keys one by one via `Feature::operator[]` scans the
+/// tag table K times. A TagProjection sorts its global keys by their
+/// global-string codes (so they can be matched in the same order in
+/// which they appear in a tag table) and prepares its local keys for
+/// fast comparison, so all values are found in one walk.
+///
+/// A TagProjection is obtained via Features::keys() and -- just like
+/// a Key -- can only be used for features that are stored in the
+/// same GOL.
+///
+/// ```
+/// TagProjection keys = buildings.keys({"name", "building", "addr:street"});
+/// TagValue values[3];
+/// for(Feature building: buildings)
+/// {
+///     building.tagValues(keys, values);
+///     // values[0] is the name, values[1] is the building type, etc.
+/// }
+/// ```
+///
+/// @see Key, Feature::tagValues()
+///
+class GEODESK_API TagProjection
+{
+public:
+	TagProjection(const StringTable& strings, std::span<const std::string_view> keys);
+	TagProjection(const StringTable& strings, std::initializer_list<std::string_view> keys) :
+		TagProjection(strings, std::span<const std::string_view>(keys.begin(), keys.size())) {}
+
+	/// @brief The number of keys
+	///
+	size_t size() const noexcept { return size_; }
+
+	/// \cond lowlevel
+
+	/// Stores the raw value of each key in `values` (in the order in
+	/// which the keys were specified), or 0 if the tag table does not
+	/// have a tag with that key.
+	///
+	void lookup(TagTablePtr tags, TagBits* values) const noexcept;
+
+	/// Like lookup(), but stores the values as TagValues
+	/// (an empty string for each missing key).
+	///
+	void lookup(TagTablePtr tags, const StringTable& strings, TagValue* values) const;
+
+	/// \endcond
+
+private:
+	struct GlobalKey
+	{
+		uint16_t keyBits;		// the global-string code, shifted left by 2
+		uint16_t column;
+	};
+
+	struct LocalKey
+	{
+		KeySignature signature;
+		std::string key;
+		uint16_t column;
+	};
+
+	void lookupLocals(TagTablePtr tags, TagBits* values) const noexcept;
+
+	std::vector<GlobalKey> globals_;
+	std::vector<LocalKey> locals_;
+	size_t size_;
+};
+
+} // namespace geodesk
@@ -21,6 +21,7 @@
 // TODO: Migrate Python functionality to PyTags
 
 class PyTagIterator;
+class FeatureRow;
 
 namespace geodesk {
 
@@ -111,7 +112,12 @@ public:
 		case 0:	// narrow number
 			return TagValue((rawNarrowValue(value) << 2) | TagValueType::NARROW_NUMBER);
 		case 1:	// global string
-			return TagValue(TagValueType::GLOBAL_STRING, globalString(value, strings));
+		{
+			// We pass along the pre-parsed numeric value of the string
+			const double* pNumber = strings.numbers() + rawNarrowValue(value);
+			return TagValue(reinterpret_cast<uint64_t>(pNumber) | TagValueType::GLOBAL_STRING,
+				globalString(value, strings));
+		}
 		case 2: // wide number
 		{
 			DataPtr pValue = valuePtr(value);
@@ -196,6 +202,7 @@ private:
 	friend class TagIterator;
 	friend class TagWalker;
 	friend class ::PyTagIterator;
+	friend class ::FeatureRow;
 	friend class FeatureWriter;
 };
 
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <cmath>
 #include <iosfwd>
 #include <clarisma/text/Format.h>
 #include <clarisma/compile/unreachable.h>
@@ -72,7 +73,15 @@ public:
         switch (type())
         {
         case 1:     // global string
-        case 3:     // local string (fall through)
+            if (taggedNumberValue_ > 3)
+            {
+                // The StringTable has already parsed the value (NaN
+                // if the string isn't a number)
+                val = *reinterpret_cast<const double*>(taggedNumberValue_ & ~3ULL);
+                return std::isnan(val) ? 0.0 : val;
+            }
+            [[fallthrough]];
+        case 3:     // local string
         {
             bool valid = clarisma::Math::parseDouble(stringValue_, &val);
             return valid ? val : 0.0;
@@ -288,11 +297,13 @@ public:
     StringValue storedString() const noexcept { return stringValue_; }
 
     /// @brief The tag value as a Decimal, if its native storage format
-    /// is numeric. If the value is stored as a string, returns its
-    /// global-string code (or 0 for a local string).
+    /// is numeric. If the value is stored as a string (global or local),
+    /// returns 0. (Earlier versions returned the code of a global
+    /// string; a TagValue no longer carries this code.)
     ///
     clarisma::Decimal storedNumber() const noexcept
     {
+        if (!isStoredNumeric()) return clarisma::Decimal(0, 0);
         if (type() == TagValues::Type::WIDE_NUMBER)
         {
             return TagValues::decimalFromWideNumber(rawNumberValue());
@@ -343,6 +354,9 @@ private:
     }
 
     uint64_t taggedNumberValue_;
+        // The lower 2 bits hold the type; for a global string, the upper
+        // bits hold a pointer to its numeric value in the StringTable
+        // (or 0 if not available)
     StringValue stringValue_;
 };
 
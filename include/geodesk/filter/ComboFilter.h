@@ -20,6 +20,7 @@ public:
 
     bool accept(FeatureStore* store, FeaturePtr feature, FastFilterHint fast) const override;
     int acceptTile(Tile tile) const override;
+    int acceptChildTile(Tile tile, uint32_t parentTurboFlags) const override;
     const RoleFilter* roleFilter() const;
     const Filter* withoutRoleFilter() const;
 
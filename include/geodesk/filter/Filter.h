@@ -61,6 +61,14 @@ enum FilterFlags
      * If set, `Filter` must derive from `RoleFilter` and implement `acceptRole()`
      */
     ROLE_FILTER = 64,
+
+    /**
+     * Filter tests batches of nodes faster than individual nodes.
+     *
+     * If set, the query engine hands the candidate nodes of each
+     * index leaf to `acceptNodes()`
+     */
+    BATCH_NODES = 128,
 };
 
 
@@ -74,7 +82,10 @@ struct FastFilterHint
 };
 
 
-class GEODESK_API Filter : public clarisma::RefCounted
+// Filters are refcounted atomically, because the FilterCache of a
+// store shares its filters with all threads that query the store
+
+class GEODESK_API Filter : public clarisma::AtomicRefCounted
 {
 public:
     Filter() : flags_(0), acceptedTypes_(FeatureTypes::ALL) {}
@@ -112,6 +123,26 @@ public:
         return 0;
     }
 
+    /**
+     * Same as acceptTile(), for a tile whose parent tile yielded
+     * `parentTurboFlags` (always >= 0, since the children of a skipped
+     * tile are never visited). A tile that lies inside a tile eligible
+     * for acceleration is eligible as well, so only filters that
+     * did not accelerate the parent need to examine the tile.
+     */
+    virtual int acceptChildTile(Tile tile, uint32_t parentTurboFlags) const
+    {
+        return parentTurboFlags ? static_cast<int>(parentTurboFlags) : acceptTile(tile);
+    }
+
+    /**
+     * Tests a batch of nodes, and moves the accepted nodes to the
+     * front of `nodes` (in their original order). Returns the number
+     * of accepted nodes. By default, each node is passed to accept().
+     */
+    virtual size_t acceptNodes(FeatureStore* store, FeaturePtr* nodes,
+        size_t count, FastFilterHint fast) const;
+
 protected:
     int flags_;
 	FeatureTypes acceptedTypes_;
@@ -0,0 +1,139 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <clarisma/util/LruCache.h>
+#include <geodesk/feature/FeaturePtr.h>
+
+namespace geodesk {
+
+class Filter;
+class FeatureStore;
+class PreparedFilterFactory;
+
+/// \cond lowlevel
+
+/// Keeps the spatial filters (intersecting, within, crossing) that
+/// were prepared for the features of a store, so that repeated
+/// queries against the same feature (e.g. the same administrative
+/// area) don't have to segmentize its geometry and build a new
+/// index every time.
+///
+/// Filters are keyed by the feature's pointer and the kind of filter
+/// (the cache belongs to the feature's store, so a pointer identifies
+/// a feature). The cache is bounded both by the number of filters
+/// and by the (estimated) memory used by the filters, including their
+/// indexes; once either limit is reached, the least-recently-used
+/// filters are dropped.
+/// The cache holds a reference to each of its filters, and is safe
+/// to use from multiple threads.
+///
+/// Filters that don't need an index (e.g. for a node) are cheap to
+/// create and are never cached.
+///
+class FilterCache
+{
+public:
+	enum class Kind : uint8_t
+	{
+		INTERSECTS,
+		WITHIN,
+		CROSSES
+	};
+
+	struct Stats
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+		size_t size;			///< number of cached filters
+		size_t capacity;
+		size_t memory;			///< estimated bytes used by cached filters
+		size_t maxMemory;
+
+		double hitRate() const
+		{
+			uint64_t lookups = hits + misses;
+			return lookups ? static_cast<double>(hits) / lookups : 0;
+		}
+	};
+
+	static constexpr size_t DEFAULT_CAPACITY = 64;
+	static constexpr size_t DEFAULT_MAX_MEMORY = 64 * 1024 * 1024;
+
+	FilterCache() :
+		cache_(DEFAULT_CAPACITY),
+		memory_(0),
+		maxMemory_(DEFAULT_MAX_MEMORY)
+	{
+	}
+
+	~FilterCache();
+
+	/// Returns the filter of the given kind for `feature`, creating it
+	/// with `factory` (which must be unused) if it isn't cached yet.
+	/// The caller receives a reference, which it must release.
+	/// Returns `nullptr` if the factory can't create such a filter.
+	///
+	const Filter* getFilter(Kind kind, FeatureStore* store,
+		FeaturePtr feature, PreparedFilterFactory& factory);
+
+	/// Drops the cached filters of `feature` (of any kind). Must be
+	/// called if the geometry of a feature changes, or if its
+	/// storage is reused for another feature.
+	///
+	void invalidate(FeaturePtr feature);
+
+	/// Drops all cached filters
+	///
+	void clear();
+
+	/// Sets the maximum number of cached filters and the maximum
+	/// memory they may use (0 disables caching).
+	///
+	void setLimits(size_t capacity, size_t maxMemory);
+
+	Stats stats();
+
+private:
+	struct Entry
+	{
+		const Filter* filter;
+		size_t size;
+	};
+
+	struct Key
+	{
+		const uint8_t* feature;
+		Kind kind;
+
+		bool operator==(const Key& other) const noexcept = default;
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const noexcept
+		{
+			// Feature pointers are 4-byte aligned, which leaves
+			// room for the kind in the lower bits
+			return std::hash<uintptr_t>()(
+				reinterpret_cast<uintptr_t>(key.feature) |
+				static_cast<uintptr_t>(key.kind));
+		}
+	};
+
+	void evict(Entry& entry);
+	void evictOverLimit();
+
+	std::mutex mutex_;
+	clarisma::LruCache<Key, Entry, KeyHash> cache_;
+	size_t memory_;
+	size_t maxMemory_;
+};
+
+// \endcond
+
+} // namespace geodesk
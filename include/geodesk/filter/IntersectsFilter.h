@@ -21,11 +21,13 @@ public:
 	IntersectsPolygonFilter(const Box& bounds, MCIndex&& index) :
 		PreparedSpatialFilter(bounds, std::move(index))
 	{
-		flags_ |= FilterFlags::FAST_TILE_FILTER;
+		flags_ |= FilterFlags::FAST_TILE_FILTER | FilterFlags::BATCH_NODES;
 	}
 
 	bool accept(FeatureStore* store, FeaturePtr feature, FastFilterHint fast) const override;
 	int acceptTile(Tile tile) const override;
+	size_t acceptNodes(FeatureStore* store, FeaturePtr* nodes,
+		size_t count, FastFilterHint fast) const override;
 
 protected:
 	bool acceptWay(WayPtr way) const override;
@@ -7,6 +7,7 @@
 #include <geos_c.h>
 #endif
 #include <geodesk/feature/RelationPtr.h>
+#include <geodesk/filter/PreparedSpatialFilter.h>
 #include <geodesk/geom/index/MCIndexBuilder.h>
 
 namespace geodesk {
@@ -24,6 +25,14 @@ public:
 
 	const Box& bounds() const { return bounds_; }
 	MCIndex buildIndex() { return indexBuilder_.build(bounds_); }
+	/// Estimated memory used by the filter that was created last,
+	/// including its index and its table of tile locations (0 if
+	/// the filter doesn't need an index)
+	size_t filterSize() const
+	{
+		size_t indexSize = indexBuilder_.estimatedIndexSize();
+		return indexSize ? indexSize + sizeof(PreparedSpatialFilter) : 0;
+	}
 
 protected:
 	virtual const Filter* forPolygonal() { return nullptr; };
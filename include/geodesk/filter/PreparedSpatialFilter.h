@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <geodesk/filter/SpatialFilter.h>
 #include <geodesk/geom/index/MCIndex.h>
 
@@ -18,8 +19,13 @@ public:
 		SpatialFilter(bounds),
 		index_(std::move(index))
 	{
+		for (auto& slot : tileLocations_) slot.store(0, std::memory_order_relaxed);
 	}
 
+	/// The number of tile locations a filter remembers
+	static constexpr int TILE_MEMO_BITS = 10;
+	static constexpr size_t TILE_MEMO_SIZE = size_t(1) << TILE_MEMO_BITS;
+
 protected:
 	static const int MAX_CANDIDATE_MC_LENGTH = 32;
 	
@@ -27,6 +33,28 @@ protected:
 	bool anySegmentsCross(WayPtr way) const;
 	bool wayIntersectsPolygon(WayPtr way) const;
 
+	/// Keeps the nodes whose location relative to the indexed polygon
+	/// (-1 = outside, 0 = on boundary, 1 = inside) is at least
+	/// `minLocation`, locating them all in a single pass over the
+	/// index (see MCIndex::locatePoints). If `insideTile` is given
+	/// (a tile that lies inside the polygon), the nodes within its
+	/// bounds are kept without a test.
+	size_t acceptNodesAt(FeaturePtr* nodes, size_t count, int minLocation,
+		const Tile* insideTile) const;
+
+	/// Returns the location of the tile's bounds relative to the
+	/// indexed polygon (see MCIndex::locateBox). Locations are
+	/// remembered in a direct-mapped table of TILE_MEMO_SIZE slots
+	/// (a tile takes the place of any other tile in its slot), so
+	/// repeated queries with the same (cached) filter rarely classify
+	/// a tile twice. Threads read and update the table without locks.
+	int locateTile(Tile tile) const;
+
 	MCIndex index_;
+
+private:
+	// Each slot holds a tile (28 bits), followed by its location + 2
+	// in the lower 2 bits (0 = empty slot)
+	mutable std::atomic<uint32_t> tileLocations_[TILE_MEMO_SIZE];
 };
 } // namespace geodesk
@@ -20,7 +20,8 @@ public:
 		flags_ |= 
 			FilterFlags::FAST_TILE_FILTER |
 			FilterFlags::MUST_ACCEPT_ALL_MEMBERS | 
-			FilterFlags::STRICT_BBOX;
+			FilterFlags::STRICT_BBOX |
+			FilterFlags::BATCH_NODES;
 	}
 
 	WithinPolygonFilter(FeatureStore* store, RelationPtr areaRelation) :
@@ -32,6 +33,8 @@ public:
 
 	bool accept(FeatureStore* store, FeaturePtr feature, FastFilterHint fast) const override;
 	int acceptTile(Tile tile) const override;
+	size_t acceptNodes(FeatureStore* store, FeaturePtr* nodes,
+		size_t count, FastFilterHint fast) const override;
 	
 protected:
 	bool acceptWay(WayPtr way) const override;
@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <vector>
 #include <clarisma/data/HashMap.h>
+#include <geodesk/feature/TagProjection.h>
 #include <geodesk/feature/TagTablePtr.h>
 
 // \cond lowlevel
@@ -16,7 +17,8 @@ class StringTable;
 class KeySchema 
 {
 public:
-    explicit KeySchema(StringTable* strings) : strings_(strings) {}
+    explicit KeySchema(StringTable* strings) :
+        strings_(strings), projection_(*strings, std::span<const std::string_view>()) {}
     KeySchema(StringTable* strings, std::string_view keys);
 
     enum SpecialKey
@@ -34,6 +36,12 @@ public:
     };
     const std::vector<std::string_view>& columns() const { return columns_; }
 
+    /// The regular keys (i.e. other than special keys and wildcards),
+    /// for looking up their values in a single pass
+    const TagProjection& projection() const { return projection_; }
+    /// The column (1-based) of the i-th key of projection()
+    int columnOfProjected(size_t i) const { return projectedColumns_[i]; }
+
     static constexpr int WILDCARD = -1;
 
 private:
@@ -48,6 +56,8 @@ private:
     std::vector<std::string_view> startsWith_;
     std::vector<std::string_view> endsWith_;
     uint16_t specialKeyCols_[SPECIAL_KEY_COUNT] = {};
+    std::vector<uint16_t> projectedColumns_;
+    TagProjection projection_;
 };
 
 } // namespace geodesk
@@ -15,7 +15,17 @@ class HilbertTreeBuilder
 public:
 	typedef RTree<const void>::Node Node;
 
+	/// Trees with fewer items are always built on the calling thread
+	static constexpr size_t PARALLEL_MIN_ITEMS = 32 * 1024;
+
 	explicit HilbertTreeBuilder(clarisma::Arena* arena);
+
+	/// Sets the number of threads used to build large trees
+	/// (0 = the calling thread plus all threads of the QueryExecutor,
+	/// which it shares with the queries). By default, trees are built
+	/// on the calling thread. The tree is the same either way.
+	void setThreadCount(int count) { threadCount_ = count; }
+
 	const Node* buildNodes(const BoundedItem* items, size_t itemCount, 
 		int maxItemsPerNode, Box totalBounds);
 
@@ -32,10 +42,16 @@ private:
 	typedef std::pair<uint32_t, const BoundedItem*> HilbertItem;
 	
 	static size_t calculateTotalNodeCount(size_t itemCount, int maxItemsPerNode);
-	HilbertItem* buildHilbertIndex(const BoundedItem* items, size_t itemCount, const Box& totalBounds);
+	HilbertItem* buildHilbertIndex(const BoundedItem* items, size_t itemCount,
+		const Box& totalBounds, int threadCount);
+	static void calculateHilbertItems(const BoundedItem* items, size_t itemCount,
+		const Box& totalBounds, HilbertItem* hilbertItems);
+	static void buildParents(Node* pChildStart, Node* pChildEnd, Node* pParentStart,
+		size_t firstParent, size_t endParent, int maxItemsPerNode, int flags);
 
 	clarisma::Arena& arena_;
 	clarisma::Arena ownArena_;
+	int threadCount_ = 1;
 };
 
 } // namespace geodesk
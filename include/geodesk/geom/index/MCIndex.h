@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #pragma once
+#include <span>
 #include <geodesk/geom/index/RTree.h>
 
 namespace geodesk {
@@ -159,6 +160,19 @@ public:
 		return closure.location.location();
 	}
 
+	/**
+	 * Determines the location of a batch of points, with the same
+	 * result as calling locatePoint() for each of them: -1 = outside,
+	 * 0 = on boundary, 1 = inside.
+	 *
+	 * Instead of casting a separate ray for each point, the index is
+	 * searched once for the chains that the rays of the batch may
+	 * cross; each chain is then tested against the points (sorted
+	 * by y) whose ray passes through its y-range. This pays off for
+	 * points that lie close together (e.g. the nodes of a tile).
+	 */
+	void locatePoints(std::span<const Coordinate> points, int8_t* locations) const;
+
 	// static void nextWayChain(Coordinate start, WayCoordinateIterator& iter, MonotoneChain* mc, int maxVertexes);
 
 	template <typename QT>
@@ -187,8 +201,14 @@ private:
 	static bool intersectsLineSegment(const RTree<const MonotoneChain>::Node* node,
 		const Box* bounds);
 	*/
+	struct BatchLocationClosure;
+
 	static bool countCrossings(const RTree<const MonotoneChain>::Node* node,
 		PointLocationClosure* closure);
+	static bool locateOnChain(const RTree<const MonotoneChain>::Node* node,
+		Coordinate c, PointLocation& location);
+	static bool countBatchCrossings(const RTree<const MonotoneChain>::Node* node,
+		BatchLocationClosure* closure);
 
 	RTree<const MonotoneChain> index_;
 	const uint8_t* data_;
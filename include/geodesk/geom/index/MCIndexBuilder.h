@@ -11,6 +11,9 @@
 #include <geodesk/geom/index/MCSlicer.h>
 #include <geodesk/feature/WayPtr.h>
 #include <geodesk/feature/RelationPtr.h>
+#include <memory>
+#include <span>
+#include <vector>
 #include <clarisma/alloc/Arena.h>
 
 namespace geodesk {
@@ -18,9 +21,22 @@ namespace geodesk {
 class MCIndexBuilder
 {
 public:
+	/// Ways with fewer vertexes in total are always segmentized
+	/// on the calling thread
+	static constexpr size_t PARALLEL_MIN_VERTEXES = 64 * 1024;
+
 	MCIndexBuilder();
+
+	/// Sets the number of threads used to segmentize the ways of
+	/// large relations and to build large indexes (1 = always use
+	/// the calling thread, which is the default; 0 = the calling
+	/// thread plus all threads of the QueryExecutor). Other than
+	/// the calling thread, the work runs on the QueryExecutor.
+	void setThreadCount(int count) { threadCount_ = count; }
+
 	void addLineSegment(Coordinate start, Coordinate end);
 	void segmentizeWay(WayPtr way);
+	void segmentizeWays(std::span<const WayPtr> ways);
 	#ifdef GEODESK_WITH_GEOS
 	void segmentizeCoords(GEOSContextHandle_t context, const GEOSCoordSequence* coords);
 	void segmentizePolygon(GEOSContextHandle_t context, const GEOSGeometry* polygon);
@@ -28,12 +44,18 @@ public:
 	void segmentizeAreaRelation(FeatureStore* store, RelationPtr rel);
 	void segmentizeMembers(FeatureStore* store, RelationPtr rel, RecursionGuard& guard);
 	MCIndex build(Box bounds);
-	static MCIndex buildFromAreaRelation(FeatureStore* store, RelationPtr rel)
+
+	/// An estimate of the memory taken up by the index that build()
+	/// creates from the chains added so far: the chains themselves,
+	/// plus the entries of the R-tree (9 per node)
+	size_t estimatedIndexSize() const
 	{
-		MCIndexBuilder builder;
-		builder.segmentizeAreaRelation(store, rel);
-		return builder.build(rel.bounds());
+		return totalChainSize_ + chainCount_ * 9 / 8 *
+			(sizeof(Box) + sizeof(void*));
 	}
+	/// Uses as many threads as a query against `store` may use
+	/// (see FeatureStore::maxQueryParallelism())
+	static MCIndex buildFromAreaRelation(FeatureStore* store, RelationPtr rel);
 
 	template<typename LineString, typename Iter>
 	void segmentize(LineString src)
@@ -73,10 +95,17 @@ private:
 		MonotoneChain chain;
 	};
 
+	static void collectMemberWays(FeatureStore* store, RelationPtr rel,
+		RecursionGuard& guard, std::vector<WayPtr>& ways);
+
 	size_t chainCount_;
 	size_t totalChainSize_;
 	const MCHolder* first_;
 	clarisma::Arena arena_;
+	int threadCount_ = 1;
+	/// Chains segmentized by other threads (each part has its
+	/// own arena)
+	std::vector<std::unique_ptr<MCIndexBuilder>> parts_;
 };
 
 } // namespace geodesk
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <geodesk/geom/Box.h>
 
 namespace geodesk {
@@ -23,6 +24,17 @@ public:
         coords[1] = end;
     }
 
+    /**
+     * Copies `count` (at least 2) vertexes into this chain, which must
+     * have room for them (see storageSize()). The vertexes must form
+     * a monotone chain.
+     */
+    void init(const Coordinate* vertexes, int count)
+    {
+        coordCount = count;
+        std::copy(vertexes, vertexes + count, coords);
+    }
+
     /**
      * Finds the first segment in the given monotone chain for which y <= segment.endY.
      * The function assumes that y is greater or equal to the lowest Y of the chain,
@@ -62,6 +74,11 @@ public:
     Coordinate last() const  { return coords[coordCount-1]; }
 
 private:
+    /// If the longer chain has fewer than this many times the vertexes
+    /// of the shorter chain, intersects() walks both in lockstep
+    static constexpr int MIN_WINDOW_RATIO = 4;
+
+    bool intersectsInLockstep(const MonotoneChain* other, bool compact) const;
     void copyCoordinates(Coordinate* dest, int direction) const;
 
 	int32_t coordCount;
@@ -0,0 +1,70 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <geodesk/export.h>
+#include <geodesk/geom/Box.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// @brief Exact intersection tests of line segments, using integer
+/// arithmetic on the coordinates.
+///
+/// The tests have the same semantics as LineSegment::orientation()
+/// and LineSegment::linesIntersect() (segments that touch, or that
+/// overlap collinearly, intersect), but are never affected by
+/// rounding, even for segments that span the entire world.
+///
+/// If all coordinates lie within compact bounds (see isCompact()),
+/// the differences between them fit into 32 bits and their cross
+/// products into 64 bits, which allows the faster `Compact` tests.
+/// intersectsAny() tests 4 segments per step if the library is
+/// compiled with AVX2 enabled, else it uses scalar code. Both variants
+/// produce identical results.
+///
+namespace SegmentIntersection
+{
+    /// Determines the position of `p` relative to the segment
+    /// [start, end]:
+    ///   -1 clockwise, 1 counter-clockwise, 0 on the segment
+    /// (For a point that is collinear, but lies beyond either end
+    /// of the segment, the result is -1 or 1)
+    ///
+    GEODESK_API int orientation(Coordinate start, Coordinate end, Coordinate p);
+
+    /// Checks whether the segment [start1,end1] intersects the
+    /// segment [start2,end2].
+    ///
+    GEODESK_API bool intersects(Coordinate start1, Coordinate end1,
+        Coordinate start2, Coordinate end2);
+
+    /// Checks whether the width and height of `bounds` fit into
+    /// an int32_t.
+    ///
+    inline bool isCompact(const Box& bounds)
+    {
+        return static_cast<int64_t>(bounds.maxX()) - bounds.minX() <= INT32_MAX &&
+            static_cast<int64_t>(bounds.maxY()) - bounds.minY() <= INT32_MAX;
+    }
+
+    /// Same as intersects(), for segments that lie within
+    /// compact bounds.
+    ///
+    GEODESK_API bool intersectsCompact(Coordinate start1, Coordinate end1,
+        Coordinate start2, Coordinate end2);
+
+    /// Checks whether the segment [start,end] intersects any of the
+    /// `count` segments formed by the `count + 1` vertexes. All
+    /// coordinates must lie within compact bounds.
+    ///
+    GEODESK_API bool intersectsAny(Coordinate start, Coordinate end,
+        const Coordinate* vertexes, int count);
+}
+
+// \endcond
+
+} // namespace geodesk
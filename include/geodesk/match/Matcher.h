@@ -22,6 +22,8 @@ class RoleMatcher;
 /// \cond lowlevel
 
 typedef bool (*MatcherMethod)(const Matcher*, FeaturePtr);
+typedef size_t (*MatcherBatchMethod)(const Matcher*,
+    const FeaturePtr* features, size_t count, FeaturePtr* accepted);
 typedef const Matcher* (*RoleMatcherMethod)(const RoleMatcher*, FeaturePtr);
 
 // MatcherHolder is a variable-length structure that bundles one or more Matchers,
@@ -45,7 +47,9 @@ typedef const Matcher* (*RoleMatcherMethod)(const RoleMatcher*, FeaturePtr);
 class Matcher
 {
 public:
-    Matcher(MatcherMethod func, FeatureStore* store) : function_(func), store_(store) {}
+    Matcher(MatcherMethod func, FeatureStore* store,
+        MatcherBatchMethod batchFunc = acceptEach) :
+        function_(func), batchFunction_(batchFunc), store_(store) {}
 
     // TODO: Can this throw?
     bool accept(FeaturePtr feature) const
@@ -53,10 +57,27 @@ public:
         return function_(this, feature);
     }
 
+    /// Tests `count` features at once, and copies the accepted ones
+    /// (in their original order) to `accepted`, which may be the same
+    /// array as `features`. Returns the number of accepted features.
+    ///
+    /// The result is always the same as calling accept() for each
+    /// feature, but compiled matchers can evaluate a batch faster.
+    ///
+    size_t acceptMany(const FeaturePtr* features, size_t count,
+        FeaturePtr* accepted) const
+    {
+        return batchFunction_(this, features, count, accepted);
+    }
+
     FeatureStore* store() const { return store_; }
     
 private:
+    static size_t acceptEach(const Matcher* matcher,
+        const FeaturePtr* features, size_t count, FeaturePtr* accepted);
+
     MatcherMethod function_;
+    MatcherBatchMethod batchFunction_;
     FeatureStore* store_;           // not refcounted
 };
 
@@ -85,8 +106,11 @@ struct IndexMask
 class GEODESK_API MatcherHolder
 {
 public:
-    MatcherHolder() : MatcherHolder(FeatureTypes::ALL, 0xffff'ffff, 0) {}
-    MatcherHolder(FeatureTypes types) : MatcherHolder(types, 0xffff'ffff, 0) {}
+    MatcherHolder() : MatcherHolder(FeatureTypes::ALL) {}
+    MatcherHolder(FeatureTypes types) : MatcherHolder(types, 0xffff'ffff, 0)
+    {
+        simpleKeyCode_ = 0;
+    }
     MatcherHolder(FeatureTypes types, uint32_t keyMask, uint32_t keyMin);
 
     static const MatcherHolder* createMatchAll(FeatureTypes types);
@@ -132,6 +156,18 @@ public:
         return ((keys & mask.keyMask) >= mask.keyMin);
     }
 
+    /// If this matcher merely checks for a global-string key (`[k]`)
+    /// or tag (`[k=v]`), the code of the key; 0 if it accepts all
+    /// features of its types; -1 for all other matchers.
+    /// (Such queries can be answered from TileStatistics.)
+    ///
+    int simpleKeyCode() const { return simpleKeyCode_; }
+
+    /// The code of the value checked by a `[k=v]` matcher
+    /// (see simpleKeyCode()), or -1.
+    ///
+    int simpleValueCode() const { return simpleValueCode_; }
+
     void explain(clarisma::BufferWriter& out) const;
 
 private:
@@ -153,6 +189,8 @@ private:
         // section (see above) and must be managed via addref() and release()
     uint32_t regexCount_;           // number of regexes in resources
     uint32_t roleMatcherOffset_;    // where to find role Matcher
+    int32_t simpleKeyCode_;         // see simpleKeyCode()
+    int32_t simpleValueCode_;
     IndexMask indexMasks_[4];       // one for each: Nodes, Ways, areas, Relations
     RoleMatcher defaultRoleMatcher_;
     Matcher mainMatcher_;
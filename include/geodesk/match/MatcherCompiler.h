@@ -6,6 +6,10 @@
 // #define ASMJIT_STATIC 
 // #include <asmjit/asmjit.h>
 #include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <clarisma/util/LruCache.h>
 
 namespace geodesk {
 
@@ -16,21 +20,53 @@ struct Selector;
 
 /// \cond lowlevel
 
+/// Compiles query strings into matchers. Compiled matchers are kept
+/// in a bounded cache (keyed by the normalized query text), so that
+/// repeated queries are just a hash lookup. The cache holds a
+/// reference to each of its matchers, and is safe to use from
+/// multiple threads.
+///
 class MatcherCompiler
 {
 public:
+	using CacheStats = clarisma::LruCache<std::string, const MatcherHolder*>::Stats;
+
+	static constexpr size_t DEFAULT_CACHE_CAPACITY = 256;
+
 	explicit MatcherCompiler(FeatureStore* store) :
-		store_(store)
+		store_(store),
+		cache_(DEFAULT_CACHE_CAPACITY)
 	{
 		// TODO: fix this dependency, store not initialized yet
 	}
 
+	~MatcherCompiler();
+
+	/// Returns the matcher for the given query; the caller receives
+	/// a reference, which it must release.
+	///
 	const MatcherHolder* getMatcher(const char* query);
 
+	/// Sets the maximum number of matchers kept in the cache
+	/// (0 disables caching).
+	///
+	void setCacheCapacity(size_t capacity);
+	void clearCache();
+	CacheStats cacheStats();
+
+	/// Returns the cache key for a query: the query text, minus
+	/// whitespace the parser ignores anyway (after `[`, `]` and `,`,
+	/// and at the end). Quoted strings are left untouched.
+	///
+	static std::string normalizeQuery(std::string_view query);
+
 private:
+	const MatcherHolder* compile(const char* query);
 	const MatcherHolder* compileMatcher(OpGraph& graph, Selector* firstSel, uint32_t indexBits);
 
 	FeatureStore* store_;
+	std::mutex cacheMutex_;
+	clarisma::LruCache<std::string, const MatcherHolder*> cache_;
 	// asmjit::JitRuntime runtime_;
 };
 
@@ -0,0 +1,44 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <geodesk/query/TileQueryTask.h>
+
+namespace geodesk {
+
+class ParallelJob;
+
+/// \cond lowlevel
+///
+/// A task run by the QueryExecutor: Either the scan of a tile on
+/// behalf of a query (the common case), or a helper that works on
+/// the items of a QueryExecutor::parallelFor() job.
+///
+class ExecutorTask
+{
+public:
+    ExecutorTask() : job_(nullptr) {}
+
+    // NOLINTNEXTLINE(google-explicit-constructor)
+    ExecutorTask(const TileQueryTask& tile) :
+        job_(nullptr),
+        tile_(tile)
+    {
+    }
+
+    explicit ExecutorTask(ParallelJob* job) :
+        job_(job)
+    {
+    }
+
+    void operator()();
+
+private:
+    ParallelJob* job_;      // nullptr for a tile task
+    TileQueryTask tile_;
+};
+
+// \endcond
+
+} // namespace geodesk
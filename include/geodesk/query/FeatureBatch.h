@@ -3,7 +3,7 @@
 
 #pragma once
 #include <memory>
-#include "QueryResults.h"
+#include <geodesk/query/QueryResultsPool.h>
 
 namespace geodesk {
 
@@ -17,16 +17,16 @@ public:
         while(p)
         {
             const QueryResults *next = p->next;
-            delete p;
+            QueryResultsPool::free(p);
             p = next;
         }
     }
 
-    std::unique_ptr<const QueryResults> takeNext()
+    std::unique_ptr<const QueryResults, QueryResultsPool::Deleter> takeNext()
     {
         const QueryResults *p = results_;
         results_ = p->next;
-        return std::unique_ptr<const QueryResults>(p);
+        return std::unique_ptr<const QueryResults, QueryResultsPool::Deleter>(p);
     }
 
 private:
@@ -0,0 +1,61 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <geodesk/export.h>
+#include <geodesk/geom/Box.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// @brief Filters runs of spatial-index entries against a query box,
+/// several entries at a time.
+///
+/// Each kernel evaluates up to MAX_ENTRIES consecutive entries and
+/// returns a bitmask of the candidates (bit 0 = first entry). Uses
+/// AVX2 (8 entries per step) if the library is compiled with AVX2
+/// enabled, else SSE2 (4 per step) on x86-64, else scalar code. The
+/// kernels never read past the last of the `count` entries.
+///
+namespace IndexFilter
+{
+    static constexpr int MAX_ENTRIES = 32;
+
+    /// Filters 32-byte feature entries of a leaf (bounding box,
+    /// followed by the feature's flags). An entry is a candidate if
+    /// its bounds intersect `box`, none of its flags are in
+    /// `rejectedFlags`, and its type is one of `acceptedTypes`
+    /// (see FeatureTypes::acceptFlags()).
+    ///
+    GEODESK_API uint32_t filterLeaf(const uint8_t* p, int count,
+        const Box& box, uint32_t rejectedFlags, uint32_t acceptedTypes);
+
+    /// Filters 20-byte branch entries (tagged child pointer, followed
+    /// by the child's bounding box). An entry is a candidate if its
+    /// bounds intersect `box`.
+    ///
+    GEODESK_API uint32_t filterBranch(const uint8_t* p, int count, const Box& box);
+
+    /// Returns the number of entries (at most `max`) up to and
+    /// including the one whose 32-bit word at `ofs` has bit 0 set
+    /// (the "last entry" marker).
+    ///
+    inline int countEntries(const uint8_t* p, int stride, int ofs, int max)
+    {
+        p += ofs;
+        int n = 1;
+        while (n < max && (*reinterpret_cast<const int32_t*>(p) & 1) == 0)
+        {
+            p += stride;
+            n++;
+        }
+        return n;
+    }
+}
+
+// \endcond
+
+} // namespace geodesk
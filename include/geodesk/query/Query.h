@@ -3,9 +3,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <geodesk/query/QueryBase.h>
-#include <condition_variable>
 #include <geodesk/query/QueryResults.h>
+#include <geodesk/query/QueryResultsPool.h>
 #include <geodesk/query/TileIndexWalker.h>
 #include <geodesk/feature/FeatureStore.h>
 #include <geodesk/geom/Box.h>
@@ -54,11 +55,25 @@ class Filter;
 class Query : public QueryBase
 {
 public:
+    /// @param limit  the maximum number of features next() returns
+    ///   (0 = all). Once the workers have found this many, they stop
+    ///   scanning.
+    /// @param stats  if not `nullptr`, the query records its execution
+    ///   statistics here (complete once next() has returned `nullptr`,
+    ///   or the query has been cancelled)
+    ///
     Query(FeatureStore* store, const Box& box, FeatureTypes types, 
-        const MatcherHolder* matcher, const Filter* filter); 
+        const MatcherHolder* matcher, const Filter* filter,
+        uint32_t limit = 0, QueryStats* stats = nullptr);
     ~Query();
 
     void offer(QueryResults* results);
+
+    /// Stops the query: Workers abandon the tiles they are scanning,
+    /// and no further tiles are requested. Waits for the outstanding
+    /// tiles to be accounted for, and discards all pending results;
+    /// subsequent calls to next() return `nullptr`.
+    ///
     void cancel();
 
     FeaturePtr next();
@@ -67,22 +82,20 @@ private:
     const QueryResults* take();
     void requestTiles();
     static void consumeResults(QueryBase* query, QueryResults* res);
-    static void deleteResults(const QueryResults* res);
 
-    // these are used by multiple threads:
-    // TODO: padding to avoid false sharing
-    // maybe use TileIndexWalker for padding as it has lots
-    // of unused entries?
+    /// Lock-free (Treiber) stack of completed result chains; each tile
+    /// pushes its buckets as a linear chain, linked via `next` and
+    /// terminated by QueryResults::EMPTY. Written by the workers, so
+    /// it sits on its own cache line.
+    alignas(CACHE_LINE_SIZE) std::atomic<QueryResults*> queuedResults_;
 
-    std::mutex mutex_;
-    std::condition_variable resultsReady_;  // requires mutex_
-    QueryResults* queuedResults_;           // requires mutex_
-    int32_t completedTiles_;                // requires mutex_
+    // Used only by the consumer thread
 
-    int32_t pendingTiles_;      // TODO: rearrange to avoid needless gaps
-    const QueryResults* currentResults_;
+    alignas(CACHE_LINE_SIZE) int32_t pendingTiles_;
     int32_t currentPos_;
-    bool allTilesRequested_;
+    const QueryResults* currentResults_;
+    uint64_t remainingResults_;         // features next() may still return
+    QueryResultsPool::Recycler recycler_;
 };
 
 
@@ -3,9 +3,12 @@
 
 #pragma once
 
-#include <condition_variable>
+#include <atomic>
+#include <limits>
 #include <geodesk/query/QueryResults.h>
+#include <geodesk/query/QueryStats.h>
 #include <geodesk/query/TileIndexWalker.h>
+#include <geodesk/query/TileStatistics.h>
 #include <geodesk/feature/FeatureStore.h>
 #include <geodesk/geom/Box.h>
 
@@ -50,20 +53,28 @@ class Filter;
 // are already present
 
 
+/// The aggregate a query computes in its tile workers,
+/// instead of returning the matching features
+///
+enum class QueryReduction : uint8_t
+{
+    NONE,
+    COUNT,
+    LENGTH,
+    AREA,
+    VISIT       ///< calls a visitor for each feature (see VisitorQuery)
+};
+
+class ExecutorTask;
+
 class QueryBase
 {
 public:
     QueryBase(FeatureStore* store, const Box& box, FeatureTypes types,
         const MatcherHolder* matcher, const Filter* filter,
-        QueryResultsConsumer consumer) :
-        store_(store),
-        types_(types),
-        matcher_(matcher),
-        filter_(filter),
-        consumer_(consumer),
-        tileIndexWalker_(store->tileIndex(), store->zoomLevels(), box, filter)
-    {
-    }
+        QueryResultsConsumer consumer,
+        QueryReduction reduction = QueryReduction::NONE,
+        uint32_t limit = 0, QueryStats* stats = nullptr);
 
     const Box& bounds() const { return tileIndexWalker_.bounds(); }
     FeatureTypes types() const { return types_; }
@@ -71,17 +82,150 @@ public:
     const Filter* filter() const { return filter_; }
     FeatureStore* store() const { return store_; }
     QueryResultsConsumer consumer() const { return consumer_; };
+    QueryReduction reduction() const { return reduction_; }
+
+    /// The maximum number of matching features the query needs to
+    /// find (0 = unlimited). The workers may collectively find a few
+    /// more than this, but stop scanning soon after.
+    ///
+    uint32_t limit() const { return limit_; }
+
+    /// The statistics recorded by this query, or `nullptr` if the
+    /// query isn't instrumented (the default). The query resets the
+    /// statistics when it is constructed.
+    ///
+    QueryStats* stats() const { return stats_; }
+
+    /// Caps the number of tiles this query may have in flight at
+    /// once (by default, the store's maxQueryParallelism()). Takes
+    /// effect the next time the query requests tiles.
+    ///
+    void setMaxParallelism(int max)
+    {
+        maxPendingTiles_ = max > 0 ? max : std::numeric_limits<int32_t>::max();
+    }
+
+    /// Returns `true` once the query has been cancelled, or has found
+    /// as many features as it needs. Workers check this periodically
+    /// and abandon their tile, and no further tiles are requested.
+    ///
+    bool isStopped() const
+    {
+        return stopped_.load(std::memory_order_relaxed);
+    }
+
+    /// Asks the workers to stop scanning (cooperatively) and stops
+    /// the walking of the tile index. Tiles that are already queued
+    /// still complete (quickly), and must be accounted for as usual.
+    /// Safe to call from any thread.
+    ///
+    void stop()
+    {
+        stopped_.store(true, std::memory_order_relaxed);
+    }
+
+    /// Called by a worker for each matching feature, if the query
+    /// has a limit. Stops the query once the limit has been reached.
+    ///
+    void countHit()
+    {
+        if (remainingHits_.fetch_sub(1, std::memory_order_relaxed) <= 1)
+        {
+            stop();
+        }
+    }
 
 protected:
+    static constexpr int CACHE_LINE_SIZE = 64;
+
+    /// Maximum number of tile tasks submitted to the executor at once
+    static constexpr int MAX_BATCH_SIZE = 16;
+
+    /// Number of times the consumer re-checks for completed tiles
+    /// before parking
+    static constexpr int SPIN_COUNT = 32;
+
+    static constexpr uint32_t CONSUMER_WAITING = 0x8000'0000;
+
+    /// Fills `batch` with tasks for up to `maxCount` tiles, advancing
+    /// the TileIndexWalker. Sets `allTilesRequested_` once the walker
+    /// has reached the end, or the query has been stopped.
+    ///
+    /// @return the number of tasks placed into `batch`
+    ///
+    int nextTiles(ExecutorTask* batch, int maxCount);
+
+    /// Called by a worker once it has published the results of a tile.
+    /// Once the count is visible, the consumer may destroy the query at
+    /// any time, so this must be the worker's last access to the query.
+    ///
+    void countCompletedTile();
+
+    /// Blocks until at least one tile has been completed since the last
+    /// call, and returns the number of completed tiles.
+    ///
+    uint32_t awaitCompletedTiles();
+
     FeatureStore* store_;
     FeatureTypes types_;
     const MatcherHolder* matcher_;
     const Filter* filter_;
     QueryResultsConsumer consumer_;
+    QueryReduction reduction_;
+    bool allTilesRequested_;
+
+    /// Set if the query was started on one of the executor's own
+    /// workers (e.g. by a visitor of a VisitorQuery). Such a query
+    /// scans all of its tiles on that worker: If it posted them, it
+    /// could end up waiting for tiles that are stuck behind other
+    /// workers that are likewise waiting.
+    bool nested_;
+    uint32_t limit_;
+    QueryStats* stats_;
+    int32_t maxPendingTiles_;       // used only by the consumer
     TileIndexWalker tileIndexWalker_;
 
-    // TODO: refactor to account for potential false sharing
-};
+    /// If set, tiles that lie fully within the query's bounds are
+    /// not scanned; instead, their features are counted from these
+    /// statistics (see ReductionQuery)
+    const TileStatistics* tileStatistics_;
+    TileStatistics::Criteria statisticsCriteria_;
+    uint64_t precountedFeatures_;   // used only by the consumer
 
+private:
+    // Read by the workers as they scan; written only when the query
+    // stops (or, for limited queries, on every hit), so it is kept
+    // away from the fields that are written by the TIW
+
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> stopped_;
+    std::atomic<int64_t> remainingHits_;
+
+    int walkTiles(ExecutorTask* batch, int maxCount);
+    bool countFromStatistics();
+    uint32_t waitForCompletedTiles();
+
+    /// A futex word on which parked consumers wait. These live in
+    /// static storage (shared by all queries), because a worker may
+    /// still signal it *after* the consumer has accounted for the
+    /// worker's tile and destroyed the query.
+    struct alignas(CACHE_LINE_SIZE) ParkingSpot
+    {
+        std::atomic<uint32_t> ticket;
+    };
+
+    static constexpr int PARKING_SPOT_COUNT = 64;
+    static ParkingSpot parkingSpots_[PARKING_SPOT_COUNT];
+
+    // Written by the workers, read by the consumer (on its own
+    // cache line, away from the fields written by the TIW)
+
+    /// Number of tiles that have been completed since the last call to
+    /// awaitCompletedTiles(). The top bit (CONSUMER_WAITING) is set
+    /// while the consumer is parked.
+    alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> completedTiles_;
+
+    /// Read by workers, but never written after construction
+    ParkingSpot* const parkingSpot_;
+};
 
 } // namespace geodesk
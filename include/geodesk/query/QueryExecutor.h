@@ -0,0 +1,109 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <atomic>
+#include <type_traits>
+#include <vector>
+#include <clarisma/thread/WorkStealingPool.h>
+#include <geodesk/export.h>
+#include <geodesk/query/ExecutorTask.h>
+
+namespace geodesk {
+
+/// @brief The process-wide thread pool that executes the tile tasks
+/// of all queries, shared by every FeatureStore.
+///
+/// The pool is started when the first FeatureStore is opened (or the
+/// first query runs, whichever comes first), using the settings that
+/// have been passed to configure() up to that point.
+///
+class GEODESK_API QueryExecutor
+{
+public:
+    using Pool = clarisma::WorkStealingPool<ExecutorTask>;
+    using Stats = Pool::Stats;
+
+    struct Settings
+    {
+        /// Number of worker threads (0 = one per logical CPU;
+        /// debug builds default to a single thread)
+        int threadCount = 0;
+
+        /// Capacity of the task queue (0 = four tasks per thread)
+        int queueSize = 0;
+
+        /// If not empty, worker `i` is pinned to logical CPU
+        /// `cpus[i % cpus.size()]`
+        std::vector<int> cpus;
+    };
+
+    /// Sets the parameters of the executor. Must be called before
+    /// the first FeatureStore is opened.
+    ///
+    /// @throws std::logic_error if the executor is already running
+    ///
+    static void configure(const Settings& settings);
+
+    /// Returns `true` if the executor has been started.
+    ///
+    static bool isRunning()
+    {
+        return pool_.load(std::memory_order_acquire) != nullptr;
+    }
+
+    /// Returns the executor, starting it if necessary.
+    ///
+    static Pool& get()
+    {
+        Pool* pool = pool_.load(std::memory_order_acquire);
+        return pool ? *pool : start();
+    }
+
+    /// Returns the queue depths, and the number of tasks run and
+    /// the fraction of the workers' time spent running them (since
+    /// the executor was started). If the executor hasn't been started
+    /// yet, all values are zero.
+    ///
+    static Stats stats();
+
+    /// Calls `task(i)` for each `i` in [0, count), using the calling
+    /// thread and up to `threadCount - 1` of the executor's workers
+    /// (0 = all of them). Work that is prepared on behalf of a query
+    /// (such as the index of a large spatial filter) can use this to
+    /// share the query threads, rather than starting threads of its own.
+    ///
+    /// The helpers are posted like any other task; a helper that only
+    /// gets to run once all items have been claimed simply ends. The
+    /// caller therefore never waits for a worker that is busy with
+    /// other tasks, so this may be called on a worker as well. A serial
+    /// call (`threadCount` of 1, or fewer than 2 items) doesn't start
+    /// the executor.
+    ///
+    /// If a task throws, the items that haven't been started are
+    /// skipped, and the first exception is rethrown once the tasks
+    /// that are still running have completed.
+    ///
+    template<typename Task>
+    static void parallelFor(size_t count, int threadCount, Task&& task)
+    {
+        using TaskType = std::remove_reference_t<Task>;
+        run(count, threadCount, [](void* context, size_t i)
+            {
+                (*static_cast<TaskType*>(context))(i);
+            },
+            const_cast<void*>(static_cast<const void*>(&task)));
+    }
+
+private:
+    static void run(size_t count, int threadCount,
+        void (*fn)(void* context, size_t i), void* context);
+
+    static Pool& start();
+    static int defaultThreadCount();
+
+    static std::atomic<Pool*> pool_;
+};
+
+} // namespace geodesk
@@ -19,18 +19,31 @@ struct QueryResultsHeader
     QueryResults* next;
     clarisma::DataPtr pTile;
     uint32_t count;
+    uint32_t capacity;
 };
 
+/// A bucket of query results (relative pointers to features
+/// in the same tile). Buckets are obtained from QueryResultsPool;
+/// they come in two sizes: The first bucket of a tile is small,
+/// so sparse tiles don't each pin a full-size bucket. `items`
+/// holds `capacity` entries.
+///
 struct QueryResults : public QueryResultsHeader
 {
     static const uint32_t DEFAULT_BUCKET_SIZE = 256;
+    static const uint32_t SMALL_BUCKET_SIZE = 16;
 
     static QueryResultsHeader EMPTY_HEADER;
     static QueryResults* const EMPTY;
 
+    static size_t allocationSize(uint32_t capacity)
+    {
+        return sizeof(QueryResultsHeader) + capacity * sizeof(uint32_t);
+    }
+
     bool isFull() const
     {
-        return count == DEFAULT_BUCKET_SIZE;
+        return count == capacity;
     }
 
     class Iterator
@@ -78,7 +91,7 @@ struct QueryResults : public QueryResultsHeader
         return Iterator(this, count);
     }
 
-    uint32_t items[DEFAULT_BUCKET_SIZE];
+    uint32_t items[1];      // variable-length (see allocationSize())
 };
 
 using QueryResultsConsumer = void(*)(QueryBase* query, QueryResults*);
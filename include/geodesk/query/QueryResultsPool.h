@@ -0,0 +1,205 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <geodesk/export.h>
+#include <geodesk/query/QueryResults.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// @brief Recycling allocator for QueryResults buckets.
+///
+/// Buckets are filled by the query worker threads and consumed
+/// (and freed) by the thread that iterates the query results.
+/// Instead of a cross-thread malloc/free pair per bucket:
+///
+/// - Each thread that allocates buckets keeps a thread-local
+///   free list per bucket size (no synchronization), and owns a
+///   "home" with a lock-free inbox per bucket size. Each bucket
+///   remembers the home of the thread that allocated it.
+/// - The consumer collects spent buckets in a Recycler, grouped by
+///   home, and hands them back in batches, by pushing them onto the
+///   inbox of their home (one CAS per batch). Since each worker has
+///   its own inbox, consumers don't all contend for the same list.
+/// - A thread whose free list has run dry takes its entire inbox
+///   (a single exchange, so there's no ABA hazard), or failing that,
+///   the shared overflow list.
+///
+/// A thread keeps at most MAX_LOCAL_BUCKETS spare buckets per size;
+/// a refill that yields more hands the surplus to the shared list.
+/// Buckets whose home is full (or whose thread has ended) go to the
+/// shared list as well. The number of buckets parked in the shared
+/// list is capped; surplus buckets are returned to the heap.
+///
+class GEODESK_API QueryResultsPool
+{
+    struct Home;
+
+public:
+    struct Stats
+    {
+        uint64_t allocated;     ///< buckets handed out
+        uint64_t reused;        ///< ... of which came from a free list
+        uint64_t recycled;      ///< buckets handed back by consumers
+        uint64_t discarded;     ///< ... of which went back to the heap
+        uint64_t trimmed;       ///< surplus buckets moved from a thread to the shared list
+
+        double reuseRate() const
+        {
+            return allocated ? static_cast<double>(reused) / allocated : 0;
+        }
+    };
+
+    static constexpr int SIZE_CLASS_COUNT = 2;
+
+    /// Maximum number of spare buckets a thread keeps for itself
+    /// (small and default-size buckets)
+    static constexpr int64_t MAX_LOCAL_BUCKETS[SIZE_CLASS_COUNT] = { 1024, 256 };
+
+    /// Obtains an empty bucket that can hold `capacity` items
+    /// (either SMALL_BUCKET_SIZE or DEFAULT_BUCKET_SIZE).
+    /// `next` and `pTile` are uninitialized.
+    ///
+    static QueryResults* allocate(uint32_t capacity);
+
+    /// Returns a single bucket directly to the heap.
+    ///
+    static void free(const QueryResults* res);
+
+    /// Returns the allocator counters. Each thread publishes its
+    /// counts whenever it refills its free list (and when it ends),
+    /// so the numbers may lag slightly behind.
+    ///
+    static Stats stats();
+
+    /// Returns the number of spare buckets of the given size that
+    /// the calling thread holds in its free list
+    ///
+    static int64_t localBucketCount(uint32_t capacity);
+
+    /// Collects spent buckets on the consumer thread, and hands
+    /// them back to their homes in batches.
+    ///
+    class Recycler
+    {
+    public:
+        Recycler() : batchCount_(0), count_(0) {}
+        ~Recycler() { flush(); }
+
+        void recycle(const QueryResults* res)
+        {
+            QueryResults* p = const_cast<QueryResults*>(res);
+            Home* home = homeOf(p);
+            int sizeClass = sizeClassOf(p->capacity);
+            Batch* batch = batches_;
+            Batch* end = batches_ + batchCount_;
+            for (; batch < end; batch++)
+            {
+                if (batch->home == home && batch->sizeClass == sizeClass) break;
+            }
+            if (batch == end)
+            {
+                if (batchCount_ == MAX_BATCHES)
+                {
+                    flush();
+                    batch = batches_;
+                }
+                batchCount_++;
+                batch->home = home;
+                batch->sizeClass = sizeClass;
+                batch->head = nullptr;
+                batch->tail = p;
+                batch->count = 0;
+            }
+            p->next = batch->head;
+            batch->head = p;
+            batch->count++;
+            if (++count_ == BATCH_SIZE) flush();
+        }
+
+        /// Recycles a chain of buckets, terminated by QueryResults::EMPTY
+        ///
+        void recycleAll(const QueryResults* res)
+        {
+            while (res != QueryResults::EMPTY)
+            {
+                const QueryResults* next = res->next;
+                recycle(res);
+                res = next;
+            }
+        }
+
+        void flush();
+
+    private:
+        static constexpr int BATCH_SIZE = 32;
+        static constexpr int MAX_BATCHES = 8;
+
+        struct Batch
+        {
+            Home* home;
+            QueryResults* head;
+            QueryResults* tail;
+            int sizeClass;
+            int count;
+        };
+
+        Batch batches_[MAX_BATCHES];
+        int batchCount_;
+        int count_;
+    };
+
+    struct Deleter
+    {
+        void operator()(const QueryResults* res) const { free(res); }
+    };
+
+private:
+    static constexpr int64_t MAX_SHARED_BUCKETS[SIZE_CLASS_COUNT] = { 16384, 4096 };
+
+    /// Each bucket is preceded by a pointer to the home of the
+    /// thread that allocated it (padded to keep the alignment)
+    static constexpr size_t PREFIX_SIZE = 16;
+
+    static int sizeClassOf(uint32_t capacity)
+    {
+        return capacity == QueryResults::SMALL_BUCKET_SIZE ? 0 : 1;
+    }
+
+    static Home*& homeOf(QueryResults* p)
+    {
+        return reinterpret_cast<Home**>(p)[-1];
+    }
+
+    struct alignas(64) SharedList
+    {
+        std::atomic<QueryResults*> head;
+        std::atomic<int64_t> count;     // approximate
+
+        void push(QueryResults* first, QueryResults* last, int64_t n);
+        QueryResults* takeAll();
+    };
+
+    struct LocalCache;
+
+    static void giveBack(int sizeClass, QueryResults* first,
+        QueryResults* last, int64_t n);
+    static void freeChain(QueryResults* p);
+
+    static thread_local LocalCache localCache_;
+    static SharedList shared_[SIZE_CLASS_COUNT];
+    static std::atomic<uint64_t> allocated_;
+    static std::atomic<uint64_t> reused_;
+    static std::atomic<uint64_t> recycled_;
+    static std::atomic<uint64_t> discarded_;
+    static std::atomic<uint64_t> trimmed_;
+};
+
+// \endcond
+
+} // namespace geodesk
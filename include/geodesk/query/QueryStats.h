@@ -0,0 +1,125 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <geodesk/export.h>
+
+namespace clarisma {
+class Buffer;
+}
+
+namespace geodesk {
+
+/// @brief Execution statistics of a query (the "plan shape" of a
+/// query, and where it spent its time).
+///
+/// Collecting statistics is opt-in: A query only records them if
+/// it is given a QueryStats object; otherwise, the tile workers run
+/// a version of the search code that has no instrumentation at all.
+/// (see FeaturesBase::explain()).
+///
+/// Counters are collected per thread, without synchronization, and
+/// are only meaningful once the query has completed.
+///
+class GEODESK_API QueryStats
+{
+public:
+    /// Counters kept by the tile workers
+    struct Counters
+    {
+        uint64_t tilesScanned = 0;
+        uint64_t indexesAccepted = 0;       ///< key-index roots accepted by the matcher
+        uint64_t indexesRejected = 0;       ///< ... and rejected
+        uint64_t branchesVisited = 0;       ///< R-tree branch nodes scanned
+        uint64_t branchEntriesPruned = 0;   ///< child nodes skipped (bbox)
+        uint64_t leavesVisited = 0;
+        uint64_t entriesTested = 0;         ///< leaf entries tested (bbox, flags, type)
+        uint64_t matcherCalls = 0;
+        uint64_t filterCalls = 0;
+        uint64_t hits = 0;
+
+        void add(const Counters& other);
+    };
+
+    /// Activity of a single thread
+    struct alignas(64) Worker
+    {
+        Counters counters;
+        uint64_t tiles = 0;
+        uint64_t nanos = 0;                 ///< time spent scanning tiles
+    };
+
+    /// @param workerCount number of executor threads; one extra slot
+    ///   is reserved for tiles scanned by the querying thread itself
+    ///
+    explicit QueryStats(int workerCount = 0);
+
+    /// Resets the statistics, and sizes them for the given number
+    /// of executor threads. Starts the clock for totalNanos.
+    void reset(int workerCount);
+
+    /// Sets totalNanos to the time since reset(), unless it has
+    /// already been set (A query calls this once it has run to
+    /// completion or has been cancelled)
+    void stop();
+
+    /// Returns the slot of the given worker (or of the querying
+    /// thread, if the index is negative)
+    Worker& worker(int index)
+    {
+        return workers_[index < 0 ? workers_.size() - 1 : index];
+    }
+
+    /// Per-thread activity; the last slot is the querying thread
+    const std::vector<Worker>& workers() const { return workers_; }
+
+    /// Sum of the counters of all threads
+    Counters totals() const;
+
+    /// Sum of the time all threads spent scanning tiles
+    uint64_t scanNanos() const;
+
+    // Tile-index phase (recorded by the querying thread)
+
+    uint64_t tilesVisited = 0;          ///< tiles submitted for scanning
+    uint64_t tilesSkipped = 0;          ///< rejected by the filter's acceptTile()
+    uint64_t tilesFastAccepted = 0;     ///< fully accepted by acceptTile()
+    uint64_t tilesMissing = 0;          ///< not present in the library
+    uint64_t tilesCounted = 0;          ///< counted from TileStatistics, not scanned
+
+    uint64_t walkNanos = 0;             ///< walking the tile index
+    uint64_t waitNanos = 0;             ///< waiting for workers
+    uint64_t totalNanos = 0;            ///< wall time of the entire query
+
+    /// Writes a human-readable summary
+    void format(clarisma::Buffer& out) const;
+    std::string toString() const;
+
+    /// Measures the time between construction and the call to stop()
+    class Timer
+    {
+    public:
+        Timer() : start_(std::chrono::steady_clock::now()) {}
+
+        uint64_t stop() const
+        {
+            return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start_).count());
+        }
+
+    private:
+        std::chrono::steady_clock::time_point start_;
+    };
+
+private:
+    std::vector<Worker> workers_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace geodesk
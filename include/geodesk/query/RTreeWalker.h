@@ -0,0 +1,141 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <clarisma/util/Bits.h>
+#include <clarisma/util/DataPtr.h>
+#include <clarisma/util/prefetch.h>
+#include <geodesk/geom/Box.h>
+#include <geodesk/query/IndexFilter.h>
+
+namespace geodesk {
+
+using clarisma::DataPtr;
+
+/// \cond lowlevel
+
+/// @brief Iterative traversal of the spatial index of a tile.
+///
+/// Branch nodes (of the node index as well as the feature indexes)
+/// consist of 20-byte entries: a tagged relative pointer to the child
+/// (bit 0 = last entry, bit 1 = child is a leaf), followed by the
+/// child's bounding box.
+///
+/// Instead of recursing once per level (which makes each child a
+/// dependent load), the walker scans a branch node in full (testing
+/// several entries at once, see IndexFilter), issues a
+/// prefetch for every child whose bounds intersect the query box,
+/// and only then descends. Accepted leaves are collected and handed
+/// to the visitor in batches; pending branches are kept on an
+/// explicit stack. This way, the cache misses (or page faults) for
+/// the children of a node overlap with each other, and with the
+/// scanning of the leaves that are already in the cache.
+///
+/// Leaves are not visited in the same order as by a depth-first
+/// recursive search.
+///
+class RTreeWalker
+{
+public:
+    /// Visits all leaves below the branch node `p` whose bounds
+    /// intersect `box`.
+    ///
+    /// @param visitLeaf    called with a pointer to the first entry
+    ///                     of each accepted leaf
+    /// @param isStopped    checked before each leaf and before each
+    ///                     branch; the walk ends once it returns `true`
+    ///
+    template<typename LeafVisitor, typename StopCondition>
+    static void walk(DataPtr p, Box box,
+        LeafVisitor&& visitLeaf, StopCondition&& isStopped)
+    {
+        walk(p, box, visitLeaf, isStopped, NullObserver());
+    }
+
+    /// An observer that ignores the walker's progress
+    struct NullObserver
+    {
+        void branchVisited() {}
+        void branchEntriesTested(int, int) {}
+    };
+
+    /// Same as above, but also reports its progress to `observer`
+    /// (used to collect QueryStats)
+    ///
+    template<typename LeafVisitor, typename StopCondition, typename Observer>
+    static void walk(DataPtr p, Box box,
+        LeafVisitor&& visitLeaf, StopCondition&& isStopped, Observer&& observer)
+    {
+        DataPtr stack[STACK_SIZE];
+        DataPtr leaves[LEAF_BATCH_SIZE];
+        int stackSize = 0;
+        int leafCount = 0;
+
+        for (;;)
+        {
+            observer.branchVisited();
+            for (;;)
+            {
+                int count = IndexFilter::countEntries(p, 20, 0, IndexFilter::MAX_ENTRIES);
+                uint32_t candidates = IndexFilter::filterBranch(p, count, box);
+                observer.branchEntriesTested(count, clarisma::Bits::bitCount(candidates));
+                while (candidates)
+                {
+                    int i = clarisma::Bits::countTrailingZerosInNonZero(candidates);
+                    candidates &= candidates - 1;
+                    DataPtr pEntry = p + i * 20;
+                    int32_t ptr = pEntry.getInt();
+                    DataPtr pChild = pEntry + (ptr & 0xffff'fffc);
+                    clarisma::prefetch(pChild.ptr());
+                    if (ptr & 2)
+                    {
+                        clarisma::prefetch(pChild.ptr() + 64);
+                            // leaves are usually larger than a cache line
+                        leaves[leafCount++] = pChild;
+                        if (leafCount == LEAF_BATCH_SIZE)
+                        {
+                            if (!visitLeaves(leaves, leafCount, visitLeaf, isStopped)) return;
+                            leafCount = 0;
+                        }
+                    }
+                    else if (stackSize < STACK_SIZE) [[likely]]
+                    {
+                        stack[stackSize++] = pChild;
+                    }
+                    else
+                    {
+                        // Stack exhausted (only for pathological trees)
+                        walk(pChild, box, visitLeaf, isStopped, observer);       // NOLINT recursion
+                    }
+                }
+                if ((p + (count - 1) * 20).getInt() & 1) break;
+                p += count * 20;
+            }
+            if (!visitLeaves(leaves, leafCount, visitLeaf, isStopped)) return;
+            leafCount = 0;
+            if (stackSize == 0 || isStopped()) return;
+            p = stack[--stackSize];
+        }
+    }
+
+private:
+    static constexpr int STACK_SIZE = 64;
+    static constexpr int LEAF_BATCH_SIZE = 16;
+
+    template<typename LeafVisitor, typename StopCondition>
+    static bool visitLeaves(const DataPtr* leaves, int count,
+        LeafVisitor& visitLeaf, StopCondition& isStopped)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            if (isStopped()) [[unlikely]] return false;
+            visitLeaf(leaves[i]);
+        }
+        return true;
+    }
+};
+
+// \endcond
+
+} // namespace geodesk
@@ -0,0 +1,55 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <atomic>
+#include <geodesk/query/QueryBase.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// @brief A query that computes an aggregate (count, total length or
+/// total area) of the matching features, rather than returning them.
+///
+/// Each TileQueryTask reduces the features of its tile to a partial
+/// result (no result buckets are materialized); the partials are
+/// folded into this query as tiles complete, so the calling thread
+/// merely walks the tile index and waits. When the executor's queue
+/// is full, the calling thread scans tiles itself.
+///
+class ReductionQuery : public QueryBase
+{
+public:
+    struct Result
+    {
+        uint64_t count;
+        double measure;     // meters or square meters (0 for COUNT)
+    };
+
+    ReductionQuery(FeatureStore* store, const Box& box, FeatureTypes types,
+        const MatcherHolder* matcher, const Filter* filter,
+        QueryReduction reduction, uint32_t limit = 0,
+        QueryStats* stats = nullptr);
+
+    /// Runs the query to completion.
+    ///
+    Result run();
+
+    /// Called by a worker once it has reduced a tile.
+    ///
+    void offer(uint64_t count, double measure);
+
+protected:
+    // Written by the workers
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> count_;
+    std::atomic<double> measure_;
+
+    // Used only by the calling thread
+    alignas(CACHE_LINE_SIZE) int32_t pendingTiles_;
+};
+
+// \endcond
+
+} // namespace geodesk
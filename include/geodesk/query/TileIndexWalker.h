@@ -3,7 +3,7 @@
 
 #pragma once
 
-#include <unordered_set>
+#include <memory>
 #include <geodesk/feature/FeatureStore.h>
 #include <geodesk/feature/TileIndexEntry.h>
 #include <geodesk/feature/Tip.h>
@@ -13,6 +13,7 @@
 namespace geodesk {
 
 class Filter;
+class QueryStats;
 
 /// \cond lowlevel
 
@@ -38,7 +39,7 @@ class TileIndexWalker
 {
 public:
     TileIndexWalker(DataPtr pIndex, uint32_t zoomLevels,
-        const Box& box, const Filter* filter);
+        const Box& box, const Filter* filter, QueryStats* stats = nullptr);
 
     /// Moves to the next tile (depth-first).
     ///
@@ -83,13 +84,23 @@ private:
         int16_t endRow;
         int16_t currentCol;
         int16_t currentRow;
-        uint32_t turboFlags;
+        uint32_t turboFlags;    // turbo flags of the parent tile
+        // Area of the query bounds at this level's zoom (in tiles),
+        // and the position of its first bit in acceptedTiles_
+        int32_t gridLeft;
+        int32_t gridTop;
+        int32_t gridWidth;
+        int32_t gridHeight;
+        size_t gridOffset;
 	};
 
     void startLevel(Level* level, int tip);
+    void initAcceptedTiles(int levelCount);
+    size_t acceptedTileBit(const Level* level, int col, int row) const;
 
     Box box_;
     const Filter* filter_;
+    QueryStats* stats_;     // optional; tracks skipped/accelerated tiles
     DataPtr pIndex_;
     int currentLevel_;
     Tile currentTile_;
@@ -98,7 +109,11 @@ private:
     uint32_t turboFlags_;
     bool tileBasedAcceleration_;
     bool trackAcceptedTiles_;
-    std::unordered_set<Tile> acceptedTiles_;
+    size_t acceptedTileWords_;
+    std::unique_ptr<uint64_t[]> acceptedTiles_;
+        // one bit for each tile within the query bounds at each level,
+        // only allocated (with acceptedTileWords_ words) once a tile
+        // has been accepted, if trackAcceptedTiles_ is set
     Level levels_[MAX_LEVELS-1];
         // -1 because leaf tiles don't need a Level
 };
@@ -8,6 +8,7 @@
 #include <geodesk/feature/types.h>
 #include <geodesk/filter/Filter.h>
 #include <geodesk/match/Matcher.h>
+#include <geodesk/query/QueryStats.h>
 
 namespace geodesk {
 
@@ -27,7 +28,9 @@ public:
         query_(query),
         tipAndFlags_(tipAndFlags),
         fastFilterHint_(fastFilterHint),     
-        results_(QueryResults::EMPTY)
+        results_(QueryResults::EMPTY),
+        partialCount_(0),
+        partialMeasure_(0)
     {
     }
 
@@ -37,19 +40,35 @@ public:
     void operator()();
 
 private:
-    void searchNodeIndexes();
-    void searchNodeBranch(DataPtr p);
-    void searchNodeLeaf(DataPtr p);
-    void searchIndexes(FeatureIndexType indexType);
-    void searchBranch(DataPtr p);
-    void searchLeaf(DataPtr p);
+    /// The maximum number of nodes handed to Filter::acceptNodes()
+    /// at once
+    static constexpr size_t NODE_BATCH_SIZE = 64;
+
+    // The search methods come in two flavors: With STATS enabled,
+    // they record their activity in counters_ (see QueryStats)
+
+    template<bool STATS> void scan();
+    void scanWithStats(QueryStats& stats);
+    template<bool STATS> void searchNodeIndexes();
+    template<bool STATS> void searchNodeBranch(DataPtr p);
+    template<bool STATS> void searchNodeLeaf(DataPtr p);
+    template<bool STATS> void searchNodeLeafBatched(DataPtr p, const Filter* filter);
+    template<bool STATS> bool addNodes(const Filter* filter, FeaturePtr* nodes, size_t count);
+    template<bool STATS> void searchIndexes(FeatureIndexType indexType);
+    template<bool STATS> void searchBranch(DataPtr p);
+    template<bool STATS> void searchLeaf(DataPtr p);
+    void addFeature(FeaturePtr feature);
     void addResult(uint32_t item);
+    void reduce(FeaturePtr feature);
 
     QueryBase* query_;
     uint32_t tipAndFlags_;
     FastFilterHint fastFilterHint_;
     DataPtr pTile_;
     QueryResults* results_;
+    uint64_t partialCount_;         // only used by ReductionQuery
+    double partialMeasure_;
+    QueryStats::Counters* counters_;    // only used if STATS enabled
 };
 
 // \endcond
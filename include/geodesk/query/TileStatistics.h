@@ -0,0 +1,194 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <clarisma/util/UUID.h>
+#include <geodesk/export.h>
+#include <geodesk/feature/FeaturePtr.h>
+#include <geodesk/feature/FeatureTypes.h>
+#include <geodesk/feature/Tip.h>
+
+namespace geodesk {
+
+class FeatureStore;
+class MatcherHolder;
+
+/// \cond lowlevel
+
+/// @brief Per-tile feature counts of a GOL, kept in an optional
+/// sidecar file next to the library (`<name>.gol-stats`).
+///
+/// For each tile, the statistics hold the number of features per
+/// *bucket* -- a combination of the type flags that are tested against
+/// FeatureTypes and the multi-tile flags -- for all features, for the
+/// features that have an indexed key (with a value other than `no`),
+/// and for the most common global-string values of each indexed key.
+/// Since the multi-tile flags are kept, a count can leave out the
+/// features that a query has already seen in a neighboring tile, just
+/// like a tile scan does.
+///
+/// A count query without a Filter whose matcher is a plain type
+/// selector, or a single `[k]` or `[k=v]` (for an indexed key `k`),
+/// takes the count of each tile that lies fully within its bounds from
+/// the statistics; only the tiles along the edges of the bounding box
+/// are scanned.
+///
+/// The statistics are created by a one-off pass over all tiles (see
+/// build()). The sidecar records the GUID and revision of the GOL (it
+/// is ignored if the GOL has been updated to a new revision), as well
+/// as the revision of each tile: the counts of a tile that has since
+/// been replaced are unknown.
+///
+class GEODESK_API TileStatistics
+{
+public:
+    /// The value code of the entries that count the features which
+    /// have a key (with any value other than the global string `no`)
+    static constexpr uint16_t ANY_VALUE = 0xffff;
+
+    /// The value code of an entry that marks a key that has more
+    /// global-string values (in a given tile) than were recorded;
+    /// for a value without entries, the count is unknown. If a key
+    /// doesn't have this entry, a value without entries has a count
+    /// of zero.
+    static constexpr uint16_t MORE_VALUES = 0xfffe;
+
+    /// The maximum number of values recorded per key and tile
+    static constexpr int MAX_VALUES = 16;
+
+    /// The number of buckets: the type flags (bits 1 to 5 of the
+    /// feature flags) and the multi-tile flags (bits 6 and 7)
+    static constexpr int BUCKET_COUNT = 128;
+
+    struct Entry
+    {
+        uint16_t key;       ///< code of the key (0 = all features)
+        uint16_t value;     ///< code of the value, ANY_VALUE or MORE_VALUES
+        uint16_t bucket;    ///< feature flags, shifted right by 1
+        uint16_t reserved;
+        uint32_t count;
+    };
+
+    /// The features counted by a query, in terms of the statistics
+    struct Criteria
+    {
+        FeatureTypes types = FeatureTypes::ALL;
+        uint16_t key = 0;           ///< 0 = all features of the given types
+        uint16_t value = ANY_VALUE; ///< ANY_VALUE for `[k]`
+    };
+
+    /// @brief Accumulates the entries of a single tile.
+    ///
+    class TileBuilder
+    {
+    public:
+        explicit TileBuilder(const TileStatistics& statistics);
+
+        void addFeature(FeaturePtr feature);
+
+        /// Appends the entries of the tile (sorted by key, value and
+        /// bucket) to `entries`, and resets the builder
+        void finish(std::vector<Entry>& entries);
+
+    private:
+        void addTags(FeaturePtr feature, int bucket);
+
+        const TileStatistics& statistics_;
+        uint32_t typeCounts_[BUCKET_COUNT];
+        std::vector<uint32_t> keyCounts_;       // BUCKET_COUNT per key
+        // per key: (value << 8 | bucket) -> count
+        std::vector<std::unordered_map<uint32_t, uint32_t>> valueCounts_;
+    };
+
+    /// Creates empty statistics, which record the given keys.
+    ///
+    TileStatistics(const clarisma::UUID& guid, uint32_t revision,
+        std::vector<uint16_t> keys);
+
+    /// Creates the statistics of all tiles of `store` (or rather,
+    /// those tiles that are present), using the calling thread and
+    /// up to `threadCount - 1` threads of the QueryExecutor
+    /// (0 = all of them).
+    ///
+    static std::unique_ptr<TileStatistics> build(FeatureStore* store,
+        int threadCount = 0);
+
+    /// Loads statistics from the given file. Returns `nullptr` if the
+    /// file does not exist, isn't valid, or belongs to a different GOL
+    /// (or a different revision of the GOL) than the one identified by
+    /// `guid` and `revision`.
+    ///
+    static std::unique_ptr<TileStatistics> load(const char* fileName,
+        const clarisma::UUID& guid, uint32_t revision);
+
+    void save(const char* fileName) const;
+
+    /// The name of the sidecar file of the given store
+    ///
+    static std::string defaultFileName(const FeatureStore* store);
+
+    const clarisma::UUID& guid() const { return guid_; }
+    uint32_t revision() const { return revision_; }
+
+    /// The codes of the keys whose counts are recorded, in
+    /// ascending order
+    ///
+    const std::vector<uint16_t>& keys() const { return keys_; }
+
+    /// Records the entries of a tile (whose revision is `tileRevision`),
+    /// replacing any existing entries. The entries must be sorted (as
+    /// produced by TileBuilder).
+    ///
+    void setTile(Tip tip, uint32_t tileRevision, std::vector<Entry> entries);
+
+    /// Determines the criteria for a query with the given types and
+    /// matcher. Returns `false` if the statistics cannot answer
+    /// the query.
+    ///
+    bool criteria(FeatureTypes types, const MatcherHolder* matcher,
+        Criteria& criteria) const;
+
+    /// Returns the number of features in the given tile that meet the
+    /// criteria, leaving out those that have any of the multi-tile
+    /// flags in `northwestFlags` -- or -1 if the count isn't known
+    /// (This includes a tile whose revision is no longer the recorded
+    /// `tileRevision`).
+    ///
+    int64_t count(Tip tip, uint32_t tileRevision, uint32_t northwestFlags,
+        const Criteria& criteria) const;
+
+private:
+    static constexpr uint32_t MAGIC = 0x54534447;   // "GDST"
+    static constexpr uint16_t VERSION = 2;
+
+    static constexpr size_t HEADER_SIZE = 36;
+    static constexpr size_t ENTRY_SIZE = 12;
+
+    static bool compareTag(const Entry& a, const Entry& b)
+    {
+        return a.key < b.key || (a.key == b.key && a.value < b.value);
+    }
+
+    int keySlot(uint32_t keyCode) const
+    {
+        return keyCode < keySlots_.size() ? keySlots_[keyCode] : -1;
+    }
+
+    clarisma::UUID guid_;
+    uint32_t revision_;
+    std::vector<uint16_t> keys_;
+    std::vector<int16_t> keySlots_;     // key code -> index in keys_, or -1
+    std::vector<std::vector<Entry>> tiles_;     // indexed by TIP
+    std::vector<uint32_t> revisions_;   // revision of each recorded tile
+    std::vector<bool> present_;     // tiles that have been recorded
+};
+
+// \endcond
+
+} // namespace geodesk
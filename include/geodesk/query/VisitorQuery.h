@@ -0,0 +1,54 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#pragma once
+
+#include <geodesk/query/ReductionQuery.h>
+
+namespace geodesk {
+
+/// \cond lowlevel
+
+/// Callback invoked by a VisitorQuery for each matching feature.
+/// `slot` identifies the calling thread: each worker thread has its
+/// own slot (0 to slotCount-2), and the thread that runs the query
+/// uses the last slot. Two threads never use the same slot at the
+/// same time, so visitors can keep per-slot state without locking.
+/// Returns `false` to stop the query (no further tiles are scanned).
+///
+using FeatureVisitor = bool(*)(void* closure, int slot, FeaturePtr feature);
+
+/// @brief A query that calls a visitor for each matching feature
+/// directly on the query worker threads, rather than handing the
+/// features to a single consumer.
+///
+class VisitorQuery : public ReductionQuery
+{
+public:
+    VisitorQuery(FeatureStore* store, const Box& box, FeatureTypes types,
+        const MatcherHolder* matcher, const Filter* filter,
+        FeatureVisitor visitor, void* closure);
+
+    /// The number of distinct slots a visitor may be called with.
+    ///
+    static int slotCount(FeatureStore* store)
+    {
+        return store->executor().threadCount() + 1;
+    }
+
+    void visit(FeaturePtr feature)
+    {
+        int slot = store_->executor().currentWorkerIndex();
+        if (slot < 0) slot = callerSlot_;
+        if (!visitor_(closure_, slot, feature)) stop();
+    }
+
+private:
+    FeatureVisitor visitor_;
+    void* closure_;
+    int callerSlot_;
+};
+
+// \endcond
+
+} // namespace geodesk
@@ -0,0 +1,721 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <clarisma/text/Regex.h>
+#include <algorithm>
+#include <bitset>
+#include <cassert>
+#include <map>
+#include <regex>
+
+namespace clarisma {
+
+struct Regex::Fallback
+{
+    explicit Fallback(std::string_view pattern) :
+        regex(pattern.begin(), pattern.end()) {}
+
+    std::regex regex;
+};
+
+/// Parses a pattern into a syntax tree, turns the tree into an NFA
+/// (using Thompson's construction), and the NFA into a DFA (using
+/// the subset construction).
+///
+/// Any pattern that this class does not support, or does not
+/// fully understand, causes an Unsupported exception; Regex then
+/// delegates the pattern to std::regex (which either supports it,
+/// or throws a proper syntax error).
+///
+class Regex::Compiler
+{
+public:
+    struct Unsupported {};
+
+    explicit Compiler(std::string_view pattern) :
+        p_(pattern.data()),
+        end_(pattern.data() + pattern.size()),
+        depth_(0)
+    {
+    }
+
+    void compile(Regex& regex)
+    {
+        int root = parseAlternatives();
+        if (p_ != end_) throw Unsupported();    // unbalanced ')'
+        uint32_t start = build(root, newState(State::MATCH, 0, 0));
+        computeClasses(regex);
+        buildDfa(regex, start);
+        regex.suffix_ = suffix(root);
+        computePrefix(regex);
+    }
+
+private:
+    using ByteSet = std::bitset<256>;
+
+    static constexpr int MAX_DEPTH = 64;
+    static constexpr int MAX_REPEAT = 1000;
+    static constexpr size_t MAX_NFA_STATES = 4096;
+    static constexpr size_t MAX_DFA_STATES = 2048;
+    static constexpr size_t MAX_PREFIX = 64;
+
+    struct Node
+    {
+        enum Kind : uint8_t { EMPTY, SET, CONCAT, ALTERNATIVES, REPEAT, BEGIN, END };
+
+        Kind kind;
+        int set;        // SET: index into sets_
+        int min;        // REPEAT
+        int max;        // REPEAT (-1 = unbounded)
+        std::vector<int> children;
+    };
+
+    struct State
+    {
+        enum Type : uint8_t { SET, SPLIT, BEGIN, END, MATCH };
+
+        Type type;
+        int set;        // SET: index into sets_
+        uint32_t out;
+        uint32_t out1;  // SPLIT only
+    };
+
+    // ---- Parser ----
+
+    int newNode(Node::Kind kind)
+    {
+        nodes_.push_back({ kind, 0, 0, 0, {} });
+        return static_cast<int>(nodes_.size() - 1);
+    }
+
+    int newSetNode(const ByteSet& set)
+    {
+        int node = newNode(Node::SET);
+        nodes_[node].set = static_cast<int>(sets_.size());
+        sets_.push_back(set);
+        return node;
+    }
+
+    int parseAlternatives()
+    {
+        int first = parseSequence();
+        if (p_ == end_ || *p_ != '|') return first;
+        std::vector<int> children;
+        children.push_back(first);
+        while (p_ < end_ && *p_ == '|')
+        {
+            p_++;
+            children.push_back(parseSequence());
+        }
+        int node = newNode(Node::ALTERNATIVES);
+        nodes_[node].children = std::move(children);
+        return node;
+    }
+
+    int parseSequence()
+    {
+        std::vector<int> children;
+        while (p_ < end_ && *p_ != '|' && *p_ != ')')
+        {
+            children.push_back(parseQuantified());
+        }
+        if (children.size() == 1) return children[0];
+        int node = newNode(children.empty() ? Node::EMPTY : Node::CONCAT);
+        nodes_[node].children = std::move(children);
+        return node;
+    }
+
+    static bool isQuantifier(char ch)
+    {
+        return ch == '*' || ch == '+' || ch == '?' || ch == '{';
+    }
+
+    int parseQuantified()
+    {
+        int atom = parseAtom();
+        if (p_ == end_ || !isQuantifier(*p_)) return atom;
+        Node::Kind kind = nodes_[atom].kind;
+        if (kind == Node::BEGIN || kind == Node::END) throw Unsupported();
+
+        int min;
+        int max;
+        switch (*p_++)
+        {
+        case '*':
+            min = 0;
+            max = -1;
+            break;
+        case '+':
+            min = 1;
+            max = -1;
+            break;
+        case '?':
+            min = 0;
+            max = 1;
+            break;
+        default:
+            parseBounds(min, max);
+            break;
+        }
+        if (p_ < end_ && *p_ == '?') p_++;
+            // A lazy quantifier makes no difference, since we only
+            // check whether the entire string matches
+        if (p_ < end_ && isQuantifier(*p_)) throw Unsupported();
+
+        int node = newNode(Node::REPEAT);
+        nodes_[node].min = min;
+        nodes_[node].max = max;
+        nodes_[node].children.push_back(atom);
+        return node;
+    }
+
+    int parseNumber()
+    {
+        if (p_ == end_ || *p_ < '0' || *p_ > '9') throw Unsupported();
+        int n = 0;
+        while (p_ < end_ && *p_ >= '0' && *p_ <= '9')
+        {
+            n = n * 10 + (*p_++ - '0');
+            if (n > MAX_REPEAT) throw Unsupported();
+        }
+        return n;
+    }
+
+    // Parses the remainder of {n}, {n,} or {n,m}
+    void parseBounds(int& min, int& max)
+    {
+        min = parseNumber();
+        max = min;
+        if (p_ < end_ && *p_ == ',')
+        {
+            p_++;
+            max = (p_ < end_ && *p_ == '}') ? -1 : parseNumber();
+        }
+        if (p_ == end_ || *p_ != '}') throw Unsupported();
+        p_++;
+        if (max >= 0 && max < min) throw Unsupported();
+    }
+
+    int parseAtom()
+    {
+        char ch = *p_++;
+        switch (ch)
+        {
+        case '(':
+        {
+            if (p_ < end_ && *p_ == '?')
+            {
+                // Only non-capturing groups; lookahead is not supported
+                if (end_ - p_ < 2 || p_[1] != ':') throw Unsupported();
+                p_ += 2;
+            }
+            if (++depth_ > MAX_DEPTH) throw Unsupported();
+            int node = parseAlternatives();
+            depth_--;
+            if (p_ == end_ || *p_ != ')') throw Unsupported();
+            p_++;
+            return node;
+        }
+        case '[':
+            return newSetNode(parseClass());
+        case '.':
+        {
+            ByteSet set;
+            set.set();
+            set.reset('\n');
+            set.reset('\r');
+            return newSetNode(set);
+        }
+        case '^':
+            return newNode(Node::BEGIN);
+        case '$':
+            return newNode(Node::END);
+        case '\\':
+        {
+            ByteSet set;
+            parseEscape(set);
+            return newSetNode(set);
+        }
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+        case '}':
+        case ']':
+            throw Unsupported();
+        default:
+        {
+            ByteSet set;
+            set.set(static_cast<uint8_t>(ch));
+            return newSetNode(set);
+        }
+        }
+    }
+
+    static void addRange(ByteSet& set, int from, int to)
+    {
+        for (int ch = from; ch <= to; ch++) set.set(ch);
+    }
+
+    static ByteSet digits()
+    {
+        ByteSet set;
+        addRange(set, '0', '9');
+        return set;
+    }
+
+    static ByteSet wordChars()
+    {
+        ByteSet set;
+        addRange(set, '0', '9');
+        addRange(set, 'A', 'Z');
+        addRange(set, 'a', 'z');
+        set.set('_');
+        return set;
+    }
+
+    static ByteSet spaces()
+    {
+        ByteSet set;
+        addRange(set, '\t', '\r');      // \t \n \v \f \r
+        set.set(' ');
+        return set;
+    }
+
+    static int hexDigit(char ch)
+    {
+        if (ch >= '0' && ch <= '9') return ch - '0';
+        if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+        if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+        throw Unsupported();
+    }
+
+    /// Parses the escape sequence after a backslash, and adds the
+    /// characters it stands for to `set`. Returns `true` if the escape
+    /// is a class (such as `\d`), or `false` if it is a single character.
+    ///
+    bool parseEscape(ByteSet& set)
+    {
+        if (p_ == end_) throw Unsupported();
+        char ch = *p_++;
+        switch (ch)
+        {
+        case 'd': set |= digits(); return true;
+        case 'D': set |= ~digits(); return true;
+        case 'w': set |= wordChars(); return true;
+        case 'W': set |= ~wordChars(); return true;
+        case 's': set |= spaces(); return true;
+        case 'S': set |= ~spaces(); return true;
+        case 'n': set.set('\n'); return false;
+        case 'r': set.set('\r'); return false;
+        case 't': set.set('\t'); return false;
+        case 'f': set.set('\f'); return false;
+        case 'v': set.set('\v'); return false;
+        case '0':
+            if (p_ < end_ && *p_ >= '0' && *p_ <= '9') throw Unsupported();
+            set.set(0);
+            return false;
+        case 'x':
+        {
+            if (end_ - p_ < 2) throw Unsupported();
+            int hi = hexDigit(p_[0]);
+            int lo = hexDigit(p_[1]);
+            p_ += 2;
+            set.set((hi << 4) | lo);
+            return false;
+        }
+        default:
+            // Backreferences, word boundaries, \cX, \uXXXX etc.
+            if ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'z') ||
+                (ch >= 'A' && ch <= 'Z'))
+            {
+                throw Unsupported();
+            }
+            set.set(static_cast<uint8_t>(ch));
+            return false;
+        }
+    }
+
+    /// Parses a single character of a class (or the start of a
+    /// class escape, which is added to `set` directly). Returns the
+    /// character, or -1 if it was a class escape.
+    ///
+    int parseClassChar(ByteSet& set)
+    {
+        if (p_ == end_) throw Unsupported();
+        char ch = *p_++;
+        if (ch == '[') throw Unsupported();       // [:alpha:] etc.
+        if (ch != '\\') return static_cast<uint8_t>(ch);
+        ByteSet escaped;
+        if (parseEscape(escaped))
+        {
+            set |= escaped;
+            return -1;
+        }
+        for (int i = 0; ; i++)
+        {
+            if (escaped.test(i)) return i;
+        }
+    }
+
+    ByteSet parseClass()
+    {
+        ByteSet set;
+        bool negated = false;
+        if (p_ < end_ && *p_ == '^')
+        {
+            negated = true;
+            p_++;
+        }
+        if (p_ < end_ && *p_ == ']') throw Unsupported();   // empty class
+        for (;;)
+        {
+            if (p_ == end_) throw Unsupported();
+            if (*p_ == ']')
+            {
+                p_++;
+                break;
+            }
+            int from = parseClassChar(set);
+            if (end_ - p_ >= 2 && p_[0] == '-' && p_[1] != ']')
+            {
+                p_++;
+                int to = parseClassChar(set);
+                if (from < 0 || to < 0 || to < from) throw Unsupported();
+                if (to >= 128) throw Unsupported();
+                    // std::regex compares signed chars, so we leave
+                    // ranges of non-ASCII bytes to it
+                addRange(set, from, to);
+            }
+            else if (from >= 0)
+            {
+                set.set(from);
+            }
+        }
+        if (negated) set.flip();
+        return set;
+    }
+
+    /// Returns the literal that every match must end with
+    ///
+    std::string suffix(int root) const
+    {
+        const Node& node = nodes_[root];
+        std::vector<int> single;
+        if (node.kind == Node::CONCAT)
+        {
+            single = node.children;
+        }
+        else
+        {
+            single.push_back(root);
+        }
+        std::string s;
+        for (auto it = single.rbegin(); it != single.rend(); ++it)
+        {
+            const Node& child = nodes_[*it];
+            if (child.kind == Node::END) continue;
+            if (child.kind != Node::SET) break;
+            const ByteSet& set = sets_[child.set];
+            if (set.count() != 1) break;
+            for (int ch = 0; ch < 256; ch++)
+            {
+                if (set.test(ch))
+                {
+                    s += static_cast<char>(ch);
+                    break;
+                }
+            }
+        }
+        std::reverse(s.begin(), s.end());
+        return s;
+    }
+
+    // ---- NFA ----
+
+    uint32_t newState(State::Type type, uint32_t out, uint32_t out1)
+    {
+        if (states_.size() >= MAX_NFA_STATES) throw Unsupported();
+        states_.push_back({ type, 0, out, out1 });
+        return static_cast<uint32_t>(states_.size() - 1);
+    }
+
+    /// Creates the states for `node`, which continue with
+    /// state `out`. Returns the first state.
+    ///
+    uint32_t build(int node, uint32_t out)
+    {
+        const Node& n = nodes_[node];
+        switch (n.kind)
+        {
+        case Node::EMPTY:
+            return out;
+        case Node::SET:
+        {
+            uint32_t state = newState(State::SET, out, 0);
+            states_[state].set = n.set;
+            return state;
+        }
+        case Node::BEGIN:
+            return newState(State::BEGIN, out, 0);
+        case Node::END:
+            return newState(State::END, out, 0);
+        case Node::CONCAT:
+            for (auto it = n.children.rbegin(); it != n.children.rend(); ++it)
+            {
+                out = build(*it, out);
+            }
+            return out;
+        case Node::ALTERNATIVES:
+        {
+            uint32_t start = build(n.children.back(), out);
+            for (int i = static_cast<int>(n.children.size()) - 2; i >= 0; i--)
+            {
+                start = newState(State::SPLIT, build(n.children[i], out), start);
+            }
+            return start;
+        }
+        case Node::REPEAT:
+        {
+            int child = n.children[0];
+            uint32_t start = out;
+            if (n.max < 0)
+            {
+                uint32_t loop = newState(State::SPLIT, 0, out);
+                states_[loop].out = build(child, loop);
+                start = loop;
+            }
+            else
+            {
+                for (int i = n.min; i < n.max; i++)
+                {
+                    start = newState(State::SPLIT, build(child, start), out);
+                }
+            }
+            for (int i = 0; i < n.min; i++) start = build(child, start);
+            return start;
+        }
+        }
+        assert(false);
+        return out;
+    }
+
+    // ---- DFA ----
+
+    /// Partitions the bytes into classes whose members are
+    /// treated the same by every state
+    ///
+    void computeClasses(Regex& regex)
+    {
+        std::map<std::vector<bool>, int> classes;
+        for (int ch = 0; ch < 256; ch++)
+        {
+            std::vector<bool> signature(sets_.size());
+            for (size_t i = 0; i < sets_.size(); i++) signature[i] = sets_[i].test(ch);
+            auto [it, added] = classes.try_emplace(std::move(signature),
+                static_cast<int>(classes.size()));
+            regex.classes_[ch] = static_cast<uint8_t>(it->second);
+            if (added) classRepresentatives_.push_back(ch);
+        }
+        regex.classCount_ = static_cast<uint32_t>(classes.size());
+    }
+
+    /// Adds the states reachable from `state` without consuming
+    /// any input (following ^ only if at the start, and $ only
+    /// if at the end of the string).
+    ///
+    void addClosure(std::vector<uint32_t>& members, uint32_t state,
+        bool atStart, bool atEnd)
+    {
+        std::vector<uint32_t> stack;
+        stack.push_back(state);
+        while (!stack.empty())
+        {
+            uint32_t s = stack.back();
+            stack.pop_back();
+            if (visited_[s] == generation_) continue;
+            visited_[s] = generation_;
+            const State& st = states_[s];
+            switch (st.type)
+            {
+            case State::SPLIT:
+                stack.push_back(st.out1);
+                stack.push_back(st.out);
+                break;
+            case State::BEGIN:
+                if (atStart) stack.push_back(st.out);
+                break;
+            case State::END:
+                if (atEnd)
+                {
+                    stack.push_back(st.out);
+                }
+                else
+                {
+                    members.push_back(s);
+                }
+                break;
+            default:
+                members.push_back(s);
+                break;
+            }
+        }
+    }
+
+    bool isAccepting(const std::vector<uint32_t>& members, bool atStart)
+    {
+        generation_++;
+        std::vector<uint32_t> reached;
+        for (uint32_t s : members)
+        {
+            if (states_[s].type == State::MATCH) return true;
+            if (states_[s].type == State::END)
+            {
+                addClosure(reached, states_[s].out, atStart, true);
+            }
+        }
+        for (uint32_t s : reached)
+        {
+            if (states_[s].type == State::MATCH) return true;
+        }
+        return false;
+    }
+
+    void buildDfa(Regex& regex, uint32_t nfaStart)
+    {
+        visited_.assign(states_.size(), 0);
+        generation_ = 0;
+
+        std::map<std::vector<uint32_t>, uint32_t> dfaStates;
+        std::vector<std::vector<uint32_t>> pending;
+        uint32_t classCount = regex.classCount_;
+
+        // The dead state
+        regex.table_.assign(classCount, DEAD);
+        regex.accepting_.push_back(false);
+        dfaStates[{}] = 0;
+
+        // The start state; ^ only applies here, so we mark its set
+        // of NFA states to keep it apart from any other state
+        std::vector<uint32_t> start;
+        generation_++;
+        addClosure(start, nfaStart, true, false);
+        std::sort(start.begin(), start.end());
+        regex.accepting_.push_back(isAccepting(start, true));
+        regex.table_.resize(classCount * 2);
+        start.push_back(UINT32_MAX);
+        dfaStates[start] = 1;
+        start.pop_back();
+        pending.push_back(std::move(start));
+
+        for (uint32_t dfaState = 1; dfaState <= pending.size(); dfaState++)
+        {
+            const std::vector<uint32_t> members = pending[dfaState - 1];
+            for (uint32_t cls = 0; cls < classCount; cls++)
+            {
+                int ch = classRepresentatives_[cls];
+                std::vector<uint32_t> next;
+                generation_++;
+                for (uint32_t s : members)
+                {
+                    const State& st = states_[s];
+                    if (st.type == State::SET && sets_[st.set].test(ch))
+                    {
+                        addClosure(next, st.out, false, false);
+                    }
+                }
+                std::sort(next.begin(), next.end());
+                auto [it, added] = dfaStates.try_emplace(next,
+                    static_cast<uint32_t>(regex.accepting_.size()));
+                if (added)
+                {
+                    if (regex.accepting_.size() >= MAX_DFA_STATES) throw Unsupported();
+                    regex.accepting_.push_back(isAccepting(next, false));
+                    regex.table_.resize(regex.table_.size() + classCount);
+                    pending.push_back(std::move(next));
+                }
+                regex.table_[dfaState * classCount + cls] = it->second * classCount;
+            }
+        }
+    }
+
+    /// Determines the literal that every match must start with, by
+    /// following the start state for as long as there is only one
+    /// single byte that doesn't lead to the dead state
+    ///
+    void computePrefix(Regex& regex)
+    {
+        uint32_t classCount = regex.classCount_;
+        uint32_t state = classCount;        // the start state
+        while (regex.prefix_.size() < MAX_PREFIX &&
+            !regex.accepting_[state / classCount])
+        {
+            int onlyClass = -1;
+            for (uint32_t cls = 0; cls < classCount; cls++)
+            {
+                if (regex.table_[state + cls] == DEAD) continue;
+                if (onlyClass >= 0)
+                {
+                    onlyClass = -1;
+                    break;
+                }
+                onlyClass = static_cast<int>(cls);
+            }
+            if (onlyClass < 0) break;
+            int ch = classRepresentatives_[onlyClass];
+            for (int other = ch + 1; other < 256; other++)
+            {
+                if (regex.classes_[other] == onlyClass)
+                {
+                    ch = -1;
+                    break;
+                }
+            }
+            if (ch < 0) break;      // class has more than one byte
+            regex.prefix_ += static_cast<char>(ch);
+            state = regex.table_[state + onlyClass];
+        }
+        regex.prefixState_ = state;
+    }
+
+    const char* p_;
+    const char* end_;
+    int depth_;
+    std::vector<Node> nodes_;
+    std::vector<ByteSet> sets_;
+    std::vector<State> states_;
+    std::vector<int> classRepresentatives_;
+    std::vector<uint32_t> visited_;
+    uint32_t generation_ = 0;
+};
+
+
+Regex::Regex(std::string_view pattern) :
+    classes_{},
+    classCount_(0),
+    prefixState_(0)
+{
+    try
+    {
+        Compiler compiler(pattern);
+        compiler.compile(*this);
+    }
+    catch (const Compiler::Unsupported&)
+    {
+        table_.clear();
+        accepting_.clear();
+        prefix_.clear();
+        suffix_.clear();
+        fallback_.reset(new Fallback(pattern));   // may throw std::regex_error
+    }
+}
+
+Regex::Regex(Regex&& other) noexcept = default;
+Regex::~Regex() = default;
+
+bool Regex::matchFallback(std::string_view s) const
+{
+    return std::regex_match(s.begin(), s.end(), fallback_->regex);
+}
+
+} // namespace clarisma
@@ -6,6 +6,9 @@
 #include <windows.h>
 #else
 #include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
 #endif
 
 namespace clarisma {
@@ -22,5 +25,24 @@ namespace Threads
         pthread_cancel(nativeThread);
         #endif
     }
+
+    bool setCurrentThreadAffinity(int cpu)
+    {
+        if (cpu < 0) return false;
+        #if defined(_WIN32)
+        if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) return false;
+            // TODO: processor groups (more than 64 CPUs)
+        return SetThreadAffinityMask(GetCurrentThread(),
+            static_cast<DWORD_PTR>(1) << cpu) != 0;
+        #elif defined(__linux__)
+        if (cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        #else
+        return false;       // not supported (e.g. macOS)
+        #endif
+    }
 }
 } // namespace clarisma
@@ -19,7 +19,8 @@ enum IterType
 };
 
 
-FeatureIteratorBase::FeatureIteratorBase(const View& view) :
+FeatureIteratorBase::FeatureIteratorBase(const View& view, uint32_t limit,
+    QueryStats* stats) :
     current_(view.store())
 {
     switch (view.view())
@@ -33,7 +34,7 @@ FeatureIteratorBase::FeatureIteratorBase(const View& view) :
     case View::WORLD:
         type_ = WORLD;
         new (&storage_.worldQuery) Query(view.store(), view.bounds(),
-            view.types(), view.matcher(), view.filter());
+            view.types(), view.matcher(), view.filter(), limit, stats);
         break;
     case View::MEMBERS:
         type_ = RELATION_MEMBERS;
@@ -44,7 +45,7 @@ FeatureIteratorBase::FeatureIteratorBase(const View& view) :
     case View::PARENTS:
         if (view.types() & FeatureTypes::WAYS)
         {
-            initParentWaysIterator(view);   // sets type_
+            initParentWaysIterator(view, limit);   // sets type_
             type_ = (view.types() & FeatureTypes::RELATIONS)?
                 PARENTS_ALL : PARENTS_WAYS;
         }
@@ -84,7 +85,7 @@ void FeatureIteratorBase::initNodeIterator(const View& view)
     }
 }
 
-void FeatureIteratorBase::initParentWaysIterator(const View& view)
+void FeatureIteratorBase::initParentWaysIterator(const View& view, uint32_t limit)
 {
     type_ = PARENTS_WAYS;
     NodePtr node(view.relatedFeature());
@@ -104,7 +105,7 @@ void FeatureIteratorBase::initParentWaysIterator(const View& view)
     }
     new (&storage_.parents.parentWayQuery) Query(
         view.store(), Box(xy),
-        view.types() & FeatureTypes::WAYS, view.matcher(), filter);
+        view.types() & FeatureTypes::WAYS, view.matcher(), filter, limit);
 }
 
 void FeatureIteratorBase::initParentRelationsIterator(FeatureStore* store, FeaturePtr member,
@@ -3,6 +3,7 @@
 
 #include <geodesk/feature/FeatureStore.h>
 #include <geodesk/feature/TileIndexEntry.h>
+#include <geodesk/query/TileStatistics.h>
 #include <filesystem>
 #include <clarisma/io/FilePath.h>
 #include <clarisma/util/log.h>
@@ -19,24 +20,19 @@ namespace geodesk {
 
 using namespace clarisma;
 
-// TODO: std::thread::hardware_concurrency() can return 0, so use
-// a default value in that case (e.g. 4 threads)
-
 // std::unordered_map<std::string, FeatureStore*> FeatureStore::openStores_;
 
 FeatureStore::FeatureStore() :
     refcount_(1),
-	matchers_(this),	// TODO: this not initialized yet!
+	matchers_(this)		// TODO: this not initialized yet!
 	#ifdef GEODESK_PYTHON
-	emptyTags_(nullptr),
-	emptyFeatures_(nullptr),
-	#endif
-	#ifdef NDEBUG
-	executor_(std::thread::hardware_concurrency(), 0)
-	#else
-	executor_(1, 0)		// run single-threaded in debug mode
+	, emptyTags_(nullptr),
+	emptyFeatures_(nullptr)
 	#endif
 {
+	QueryExecutor::get();
+		// Start the shared executor, so its settings are fixed
+		// once the first store has been opened
 }
 
 FeatureStore* FeatureStore::openSingle(std::string_view relativeFileName)
@@ -122,6 +118,29 @@ FeatureStore::~FeatureStore()
 }
 
 
+const TileStatistics* FeatureStore::tileStatistics()
+{
+	std::lock_guard lock(tileStatisticsMutex_);
+	if (!tileStatisticsLoaded_)
+	{
+		tileStatisticsLoaded_ = true;
+		if (!fileName().empty())
+		{
+			tileStatistics_ = TileStatistics::load(
+				TileStatistics::defaultFileName(this).c_str(), guid(), revision());
+		}
+	}
+	return tileStatistics_.get();
+}
+
+void FeatureStore::setTileStatistics(std::unique_ptr<TileStatistics> statistics)
+{
+	std::lock_guard lock(tileStatisticsMutex_);
+	tileStatisticsLoaded_ = true;
+	tileStatistics_ = std::move(statistics);
+}
+
+
 TilePtr FeatureStore::fetchTile(Tip tip) const
 {
 	TileIndexEntry entry(tileIndex_[tip]);
@@ -3,6 +3,7 @@
 
 #include <geodesk/feature/FeatureStore_Transaction.h>
 #include <geodesk/feature/TileIndexEntry.h>
+#include <geodesk/query/TileStatistics.h>
 #include <filesystem>
 #include <random>
 #include <clarisma/io/FilePath.h>
@@ -142,6 +143,15 @@ void FeatureStore::Transaction::commit(bool isFinal)
 	activeSnapshot.tileIndex = addBlob(
 		{reinterpret_cast<uint8_t*>(tileIndex_.get()), tileIndexSize});
 	FreeStore::Transaction::commit(isFinal);
+	store().filters().clear();
+		// Features of replaced tiles may have moved or changed
+	{
+		// Likewise, the counts of replaced tiles are out of date; the
+		// statistics are reloaded (without these tiles) when needed
+		std::lock_guard lock(store().tileStatisticsMutex_);
+		store().tileStatisticsLoaded_ = false;
+		store().tileStatistics_.reset();
+	}
 }
 
 
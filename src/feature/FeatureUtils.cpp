@@ -7,18 +7,23 @@
 #include <geodesk/feature/FeatureIterator.h>
 #include <geodesk/feature/Tags.h>
 #include <geodesk/feature/View.h>
+#include <geodesk/query/QueryStats.h>
+#include <geodesk/query/ReductionQuery.h>
+#include <geodesk/query/VisitorQuery.h>
 
 using namespace clarisma;
 
 namespace geodesk {
 
-uint64_t FeatureUtils::countWorld(const View &view)
+/// Computes the total length or area of the features in a WORLD
+/// view; the measuring is done by the query workers
+///
+double FeatureUtils::reduceWorld(const View &view, QueryReduction reduction,
+    QueryStats* stats)
 {
-    uint64_t count = 0;
-    Query query(view.store(), view.bounds(),
-        view.types(), view.matcher(), view.filter());
-    while (!query.next().isNull()) count++;
-    return count;
+    ReductionQuery query(view.store(), view.bounds(),
+        view.types(), view.matcher(), view.filter(), reduction, 0, stats);
+    return query.run().measure;
 }
 
 uint64_t FeatureUtils::countGeneric(const View &view)
@@ -33,7 +38,7 @@ uint64_t FeatureUtils::countGeneric(const View &view)
     return count;
 }
 
-uint64_t FeatureUtils::count(const View &view)
+uint64_t FeatureUtils::count(const View &view, QueryStats* stats)
 {
     switch (view.view())
     {
@@ -46,20 +51,100 @@ uint64_t FeatureUtils::count(const View &view)
         }
         break;
     case View::WORLD:
-        return countWorld(view);
+    {
+        ReductionQuery query(view.store(), view.bounds(),
+            view.types(), view.matcher(), view.filter(), QueryReduction::COUNT,
+            0, stats);
+        return query.run().count;
+    }
     default:
         break;
     }
     return countGeneric(view);
 }
 
+double FeatureUtils::length(const View& view, QueryStats* stats)
+{
+    if(view.view() == View::EMPTY) return 0;
+    if(view.view() == View::WORLD) return reduceWorld(view, QueryReduction::LENGTH, stats);
+    double total = 0;
+    FeatureIterator<Feature> iter(view);
+    while (iter != nullptr)
+    {
+        total += (*iter).length();
+        ++iter;
+    }
+    return total;
+}
+
+double FeatureUtils::area(const View& view, QueryStats* stats)
+{
+    if(view.view() == View::EMPTY) return 0;
+    if(view.view() == View::WORLD) return reduceWorld(view, QueryReduction::AREA, stats);
+    double total = 0;
+    FeatureIterator<Feature> iter(view);
+    while (iter != nullptr)
+    {
+        total += (*iter).area();
+        ++iter;
+    }
+    return total;
+}
+
+int FeatureUtils::parallelSlotCount(const View& view)
+{
+    return VisitorQuery::slotCount(view.store());
+}
+
+/// Calls `visitor` for each feature in a WORLD view,
+/// on the query worker threads.
+///
+void FeatureUtils::visitWorld(const View& view, FeatureVisitor visitor, void* closure)
+{
+    assert(view.view() == View::WORLD);
+    VisitorQuery query(view.store(), view.bounds(),
+        view.types(), view.matcher(), view.filter(), visitor, closure);
+    query.run();
+}
+
 bool FeatureUtils::isEmpty(const View& view)
 {
     if(view.view() == View::EMPTY) return true;
-    FeatureIterator<Feature> iter(view);
+    if(view.view() == View::WORLD)
+    {
+        // The workers stop as soon as any of them finds a feature
+        ReductionQuery query(view.store(), view.bounds(),
+            view.types(), view.matcher(), view.filter(),
+            QueryReduction::COUNT, 1);
+        return query.run().count == 0;
+    }
+    FeatureIterator<Feature> iter(view, 1);
     return iter == nullptr;
 }
 
+/// Counts the features in the view (as a separate pass), recording
+/// how the query was executed. Only WORLD views run through the tile
+/// workers; for all others, only the hits and total time are recorded.
+///
+QueryStats FeatureUtils::explain(const View& view)
+{
+    QueryStats stats;
+    QueryStats::Timer timer;
+    if(view.view() == View::WORLD)
+    {
+        ReductionQuery query(view.store(), view.bounds(),
+            view.types(), view.matcher(), view.filter(),
+            QueryReduction::COUNT, 0, &stats);
+        query.run();
+    }
+    else
+    {
+        stats.worker(-1).counters.hits = countGeneric(view);
+    }
+    stats.totalNanos = timer.stop();
+    return stats;
+}
+
 char* FeatureUtils::format(char* buf, const char* type, int64_t id)
 {
     char* p = buf;
@@ -3,7 +3,9 @@
 
 #include <geodesk/feature/StringTable.h>
 
+#include <limits>
 #include <geodesk/feature/StringValue.h>
+#include <clarisma/math/Math.h>
 #include <clarisma/util/Bits.h>
 #include <clarisma/util/Strings.h>
 #ifdef GEODESK_PYTHON
@@ -41,7 +43,8 @@ using namespace clarisma;
 
 
 StringTable::StringTable() :
-	arena_(nullptr)
+	arena_(nullptr),
+	numbers_(nullptr)
 {
 	// TODO: clear all other members?
 }
@@ -128,6 +131,7 @@ StringTable::~StringTable()
 		#endif
 		delete[] arena_;
 	}
+	delete[] numbers_.load(std::memory_order_relaxed);
 }
 
 
@@ -154,6 +158,27 @@ PyObject* StringTable::getStringObject(int code)
 }
 #endif
 
+// Multiple threads may race to create the table; the loser discards its copy
+const double* StringTable::createNumbers() const
+{
+	double* numbers = new double[stringCount_];
+	for (uint32_t i = 0; i < stringCount_; i++)
+	{
+		if (!Math::parseDouble(getGlobalString(i)->toStringView(), &numbers[i]))
+		{
+			numbers[i] = std::numeric_limits<double>::quiet_NaN();
+		}
+	}
+	const double* expected = nullptr;
+	if (!numbers_.compare_exchange_strong(expected, numbers,
+		std::memory_order_acq_rel, std::memory_order_acquire))
+	{
+		delete[] numbers;
+		return expected;
+	}
+	return numbers;
+}
+
 int StringTable::getCode(size_t hash, const char* str, size_t len) const
 {
 	int bucket = hash & lookupMask_;
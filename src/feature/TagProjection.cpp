@@ -0,0 +1,114 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/feature/TagProjection.h>
+#include <algorithm>
+#include <cassert>
+#include <clarisma/data/SmallArray.h>
+#include <clarisma/util/ShortVarString.h>
+
+namespace geodesk {
+
+using namespace clarisma;
+
+TagProjection::TagProjection(const StringTable& strings,
+	std::span<const std::string_view> keys) :
+	size_(keys.size())
+{
+	assert(keys.size() < (1 << 16));
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		std::string_view key = keys[i];
+		uint16_t column = static_cast<uint16_t>(i);
+		int code = strings.getCode(key.data(), key.size());
+		if (code >= 0 && code <= TagValues::MAX_COMMON_KEY)
+		{
+			globals_.push_back({ static_cast<uint16_t>(code << 2), column });
+		}
+		else
+		{
+			locals_.push_back({ KeySignature(key.data(), key.size()),
+				std::string(key), column });
+		}
+	}
+	// Global keys must be in the same order as in a tag table; the
+	// sort is stable, so a key that is listed more than once fills
+	// its columns in order
+	std::stable_sort(globals_.begin(), globals_.end(),
+		[](const GlobalKey& a, const GlobalKey& b) { return a.keyBits < b.keyBits; });
+}
+
+
+void TagProjection::lookup(TagTablePtr tags, TagBits* values) const noexcept
+{
+	std::fill(values, values + size_, 0);
+
+	// Global tags and our global keys are both sorted by key,
+	// so we can match them up in a single merge-style pass
+	const GlobalKey* k = globals_.data();
+	const GlobalKey* end = k + globals_.size();
+	if (k != end)
+	{
+		DataPtr p = tags.ptr();
+		for (;;)
+		{
+			uint32_t tag = p.getUnsignedIntUnaligned();
+			uint32_t keyBits = tag & 0x7ffc;
+			while (k->keyBits <= keyBits)
+			{
+				if (k->keyBits == keyBits)
+				{
+					values[k->column] = (static_cast<TagBits>(
+						tags.pointerOffset(p) + 2) << 32) | tag;
+				}
+				if (++k == end) break;
+			}
+			if (k == end || (tag & 0x8000)) break;
+			p += 4 + (tag & 2);
+		}
+	}
+	if (!locals_.empty() && tags.hasLocalKeys()) lookupLocals(tags, values);
+}
+
+
+void TagProjection::lookupLocals(TagTablePtr tags, TagBits* values) const noexcept
+{
+	DataPtr p = tags.ptr() - 6;
+	DataPtr origin = tags.alignedBasePtr();
+	size_t remaining = locals_.size();
+	for (;;)
+	{
+		TagBits tag = p.getLongUnaligned();
+		int32_t rawPointer = static_cast<int32_t>(tag >> 16);
+		int32_t flags = rawPointer & 7;
+		// uncommon keys are relative to the 4-byte-aligned tagtable address
+		const ShortVarString* keyString = reinterpret_cast<const ShortVarString*>
+			(origin.ptr() + ((rawPointer ^ flags) >> 1));
+		for (const LocalKey& k : locals_)
+		{
+			if (k.signature.matches(keyString, k.key.data(), k.key.size()))
+			{
+				values[k.column] = (static_cast<TagBits>(
+					tags.pointerOffset(p) - 2) << 32) |
+					((tag & 0xffff) << 16) | flags;
+				if (--remaining == 0) return;
+			}
+		}
+		if (flags & 4) return;
+		p -= 6 + (flags & 2);
+	}
+}
+
+
+void TagProjection::lookup(TagTablePtr tags, const StringTable& strings,
+	TagValue* values) const
+{
+	SmallArray<TagBits, 32> bits(size_);
+	lookup(tags, &bits[0]);
+	for (size_t i = 0; i < size_; i++)
+	{
+		values[i] = tags.tagValue(bits[i], strings);
+	}
+}
+
+} // namespace geodesk
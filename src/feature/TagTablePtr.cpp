@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/feature/TagTablePtr.h>
+#include <geodesk/feature/GlobalKeySearch.h>
+#include <geodesk/feature/KeySignature.h>
 #include <clarisma/util/ShortVarString.h>
 #include <clarisma/util/StringBuilder.h>
 
@@ -66,6 +68,7 @@ TagBits TagTablePtr::getLocalKeyValue(const char* key, size_t len) const
 	if (!hasLocalKeys()) return 0;
 	DataPtr p = ptr();
 	DataPtr origin = alignedBasePtr();
+	KeySignature signature(key, len);
 	p -= 6;
 	for (; ; )
 	{
@@ -75,7 +78,7 @@ TagBits TagTablePtr::getLocalKeyValue(const char* key, size_t len) const
 		// uncommon keys are relative to the 4-byte-aligned tagtable address
 		const ShortVarString* keyString = reinterpret_cast<const ShortVarString*>
 			(origin.ptr() + ((rawPointer ^ flags) >> 1));
-		if (keyString->equals(key, len))
+		if (signature.matches(keyString, key, len))
 		{
 			return (static_cast<TagBits>(pointerOffset(p) - 2) << 32) |
 				((tag & 0xffff) << 16) | flags;
@@ -88,20 +91,10 @@ TagBits TagTablePtr::getLocalKeyValue(const char* key, size_t len) const
 TagBits TagTablePtr::getGlobalKeyValue(int key) const
 {
 	uint16_t keyBits = key << 2;
-	DataPtr pTable = ptr();
-	DataPtr p = pTable;
-	for (; ; )
-	{
-		// TODO: maybe just fetch key/value separately
-		// to avoid unaligned read issue altogether
-		uint32_t tag = p.getUnsignedIntUnaligned();
-		if ((tag & 0xffff) >= keyBits)
-		{
-			if ((tag & 0x7ffc) != keyBits) return 0;
-			return (static_cast<TagBits>(pointerOffset(p) + 2) << 32) | tag;
-		}
-		p += 4 + (tag & 2);
-	}
+	DataPtr p(findGlobalKey(ptr().ptr(), keyBits));
+	uint32_t tag = p.getUnsignedIntUnaligned();
+	if ((tag & 0x7ffc) != keyBits) return 0;
+	return (static_cast<TagBits>(pointerOffset(p) + 2) << 32) | tag;
 }
 
 
@@ -195,8 +188,8 @@ PyObject* TagTablePtr::valueAsNumber(TagBits value, StringTable& strings) const
 		return PyFloat_FromDouble(val);
 	}
 	assert(type == TagValueType::GLOBAL_STRING);
-	double val;
-	if(!Math::parseDouble(globalString(value, strings)->toStringView(), &val)) val = 0.0;
+	double val = strings.numbers()[rawNarrowValue(value)];
+	if (std::isnan(val)) val = 0.0;
 	return PyFloat_FromDouble(val);
 }
 
@@ -95,6 +95,29 @@ int ComboFilter::acceptTile(Tile tile) const
     return fast;
 }
 
+int ComboFilter::acceptChildTile(Tile tile, uint32_t parentTurboFlags) const
+{
+    // Filters that accelerated the parent tile accelerate its children
+    // as well; only ask the others
+    int fast = 0;
+    uint32_t nextFlag = 1;
+    for (auto it = filters_.begin(); it != filters_.end(); ++it)
+    {
+        if ((parentTurboFlags & nextFlag) == 0)
+        {
+            int accept = (*it)->acceptTile(tile);
+            if (accept < 0) return accept;
+            fast |= accept == 0 ? 0 : nextFlag;
+        }
+        else
+        {
+            fast |= nextFlag;
+        }
+        nextFlag <<= 1;
+    }
+    return fast;
+}
+
 
 const RoleFilter* ComboFilter::roleFilter() const
 {
@@ -13,6 +13,17 @@ Box Filter::getBounds() const
         reinterpret_cast<const SpatialFilter*>(this)->bounds() : Box::ofWorld();
 }
 
+size_t Filter::acceptNodes(FeatureStore* store, FeaturePtr* nodes,
+    size_t count, FastFilterHint fast) const
+{
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (accept(store, nodes[i], fast)) nodes[accepted++] = nodes[i];
+    }
+    return accepted;
+}
+
 
 
 
@@ -0,0 +1,106 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/filter/FilterCache.h>
+#include <geodesk/filter/Filter.h>
+#include <geodesk/filter/PreparedFilterFactory.h>
+
+namespace geodesk {
+
+FilterCache::~FilterCache()
+{
+	clear();
+}
+
+
+const Filter* FilterCache::getFilter(Kind kind, FeatureStore* store,
+	FeaturePtr feature, PreparedFilterFactory& factory)
+{
+	Key key { feature.ptr().ptr(), kind };
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		Entry* cached = cache_.get(key);
+		if (cached)
+		{
+			cached->filter->addref();
+			return cached->filter;
+		}
+	}
+
+	// Build the filter without holding the lock; if another thread
+	// built the same filter in the meantime, we use its filter instead
+
+	const Filter* filter = factory.forFeature(store, feature);
+	if (filter == nullptr) return nullptr;
+	size_t size = factory.filterSize();
+	if (size == 0) return filter;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	Entry* cached = cache_.get(key);
+	if (cached)
+	{
+		filter->release();
+		filter = cached->filter;
+		filter->addref();
+		return filter;
+	}
+	filter->addref();		// one reference for the cache, one for the caller
+	memory_ += size;
+	cache_.put(key, Entry{ filter, size }, [this](Entry& e) { evict(e); });
+	evictOverLimit();
+	return filter;
+}
+
+
+void FilterCache::evict(Entry& entry)
+{
+	memory_ -= entry.size;
+	entry.filter->release();
+}
+
+
+void FilterCache::evictOverLimit()
+{
+	while (memory_ > maxMemory_ &&
+		cache_.evictLeastRecent([this](Entry& e) { evict(e); }))
+	{
+	}
+}
+
+
+void FilterCache::invalidate(FeaturePtr feature)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (Kind kind : { Kind::INTERSECTS, Kind::WITHIN, Kind::CROSSES })
+	{
+		cache_.remove(Key{ feature.ptr().ptr(), kind },
+			[this](Entry& e) { evict(e); });
+	}
+}
+
+
+void FilterCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	cache_.clear([this](Entry& e) { evict(e); });
+}
+
+
+void FilterCache::setLimits(size_t capacity, size_t maxMemory)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	maxMemory_ = maxMemory;
+	cache_.setCapacity(maxMemory ? capacity : 0, [this](Entry& e) { evict(e); });
+	evictOverLimit();
+}
+
+
+FilterCache::Stats FilterCache::stats()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto s = cache_.stats();
+	return { s.hits, s.misses, s.evictions, s.size, s.capacity,
+		memory_, maxMemory_ };
+}
+
+} // namespace geodesk
@@ -3,6 +3,7 @@
 
 #include <geodesk/filter/Filters.h>
 #include <geodesk/feature/FeatureBase.h>
+#include <geodesk/feature/FeatureStore.h>
 #include <geodesk/feature/QueryException.h>
 #include <geodesk/filter/CrossesFilter.h>
 #include <geodesk/filter/IntersectsFilter.h>
@@ -14,7 +15,8 @@
 
 namespace geodesk {
 
-const Filter* filter(PreparedFilterFactory&& factory, Feature feature)
+const Filter* filter(FilterCache::Kind kind, PreparedFilterFactory&& factory,
+    Feature feature)
 {
     const Filter* filter;
     if(feature.isAnonymousNode())
@@ -23,7 +25,8 @@ const Filter* filter(PreparedFilterFactory&& factory, Feature feature)
     }
     else
     {
-        filter = factory.forFeature(feature.store(), feature.ptr());
+        FeatureStore* store = feature.store();
+        filter = store->filters().getFilter(kind, store, feature.ptr(), factory);
     }
     if(filter == nullptr)
     {
@@ -34,12 +37,12 @@ const Filter* filter(PreparedFilterFactory&& factory, Feature feature)
 
 const Filter* Filters::intersects(Feature feature)
 {
-    return filter(IntersectsFilterFactory(), feature);
+    return filter(FilterCache::Kind::INTERSECTS, IntersectsFilterFactory(), feature);
 }
 
 const Filter* Filters::within(Feature feature)
 {
-    return filter(WithinFilterFactory(), feature);
+    return filter(FilterCache::Kind::WITHIN, WithinFilterFactory(), feature);
 }
 
 const Filter* Filters::containsPoint(Coordinate xy)
@@ -49,7 +52,7 @@ const Filter* Filters::containsPoint(Coordinate xy)
 
 const Filter* Filters::crossing(Feature feature)
 {
-    return filter(CrossesFilterFactory(), feature);
+    return filter(FilterCache::Kind::CROSSES, CrossesFilterFactory(), feature);
 }
 
 const Filter* Filters::maxMetersFrom(double meters, Coordinate xy)
@@ -81,10 +81,17 @@ bool IntersectsPolygonFilter::accept(FeatureStore* store, FeaturePtr feature, Fa
 	return acceptFeature(store, feature);
 }
 
+size_t IntersectsPolygonFilter::acceptNodes(FeatureStore*, FeaturePtr* nodes,
+	size_t count, FastFilterHint fast) const
+{
+	if (fast.turboFlags) return count;
+	// Nodes on the boundary intersect (same as acceptNode)
+	return acceptNodesAt(nodes, count, 0, nullptr);
+}
+
 int IntersectsPolygonFilter::acceptTile(Tile tile) const
 {
-	Box tileBounds = tile.bounds();
-	int loc = index_.locateBox(tileBounds);
+	int loc = locateTile(tile);
 	if (loc > 0) return 1;
 	// TODO: Don't use 1 to indicate tile acceleration, use enum constant
 	return loc;
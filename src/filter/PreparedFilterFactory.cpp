@@ -2,12 +2,16 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/filter/PreparedFilterFactory.h>
+#include <geodesk/feature/FeatureStore.h>
 #include <geodesk/geom/geos/Geos.h>
 
 namespace geodesk {
 
 const Filter* PreparedFilterFactory::forFeature(FeatureStore* store, FeaturePtr feature)
 {
+	// The index of a large feature may be built by the query threads,
+	// within the same limit as the queries against its store
+	indexBuilder_.setThreadCount(store->maxQueryParallelism());
 	if (feature.isType(FeatureTypes::RELATIONS & FeatureTypes::AREAS))
 	{
 		RelationPtr relation(feature);
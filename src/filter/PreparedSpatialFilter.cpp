@@ -2,11 +2,63 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/filter/PreparedSpatialFilter.h>
+#include <clarisma/data/SmallArray.h>
 #include <geodesk/feature/WayCoordinateIterator.h>
 #include <geodesk/geom/index/WaySlicer.h>
 
 namespace geodesk {
 
+using namespace clarisma;
+
+int PreparedSpatialFilter::locateTile(Tile tile) const
+{
+	uint32_t t = static_cast<uint32_t>(tile);
+	std::atomic<uint32_t>& slot = tileLocations_[
+		(t * 0x9E37'79B1u) >> (32 - TILE_MEMO_BITS)];
+	uint32_t entry = slot.load(std::memory_order_relaxed);
+	if ((entry & 3) && (entry >> 2) == t) return static_cast<int>(entry & 3) - 2;
+	int loc = index_.locateBox(tile.bounds());
+	slot.store((t << 2) | static_cast<uint32_t>(loc + 2), std::memory_order_relaxed);
+	return loc;
+}
+
+size_t PreparedSpatialFilter::acceptNodesAt(FeaturePtr* nodes, size_t count,
+	int minLocation, const Tile* insideTile) const
+{
+	SmallArray<Coordinate, 64> points(count);
+	SmallArray<int8_t, 64> locations(count);
+	size_t pointCount = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		Coordinate c = NodePtr(nodes[i]).xy();
+		if (insideTile && c.y >= insideTile->bottomY() && c.x <= insideTile->rightX())
+		{
+			locations[i] = 1;
+			continue;
+		}
+		locations[i] = -2;		// must be located
+		points[pointCount++] = c;
+	}
+	if (pointCount)
+	{
+		SmallArray<int8_t, 64> pointLocations(pointCount);
+		index_.locatePoints({ &points[0], pointCount }, &pointLocations[0]);
+		size_t n = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (locations[i] == -2) locations[i] = pointLocations[n++];
+		}
+	}
+
+	size_t accepted = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (locations[i] >= minLocation) nodes[accepted++] = nodes[i];
+	}
+	return accepted;
+}
+
+
 bool PreparedSpatialFilter::anyNodesInPolygon(WayPtr way) const
 {
 	WayCoordinateIterator iter;
@@ -161,10 +161,17 @@ bool WithinPolygonFilter::accept(FeatureStore* store, FeaturePtr feature, FastFi
 }
 
 
+size_t WithinPolygonFilter::acceptNodes(FeatureStore*, FeaturePtr* nodes,
+	size_t count, FastFilterHint fast) const
+{
+	// Nodes must lie in the interior (same as acceptNode)
+	return acceptNodesAt(nodes, count, 1, fast.turboFlags ? &fast.tile : nullptr);
+}
+
+
 int WithinPolygonFilter::acceptTile(Tile tile) const
 {
-	Box tileBounds = tile.bounds();
-	int loc = index_.locateBox(tileBounds);
+	int loc = locateTile(tile);
 	if (loc > 0) return 1; 
 		// TODO: Don't use 1 to indicate tile acceleration, use enum constant
 	return loc; 
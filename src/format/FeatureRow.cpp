@@ -76,35 +76,67 @@ FeatureRow::FeatureRow(const KeySchema& keys, FeatureStore* store,
         }
     }
 
-    TagWalker tw(feature.tags(), store->strings());
-    while (tw.next())
+    if(tagsCol)
     {
-        int col;
-        if(tw.keyCode() >= 0) [[likely]]
-        {
-            col = keys.columnOfGlobal(tw.keyCode());
-        }
-        else
-        {
-            col = keys.columnOfLocal(tw.key()->toStringView());
-        }
-        if (col > 0)
+        // We need to look at all tags, since any that don't have
+        // their own column go into the `tags` column
+        TagWalker tw(feature.tags(), store->strings());
+        while (tw.next())
         {
-            assert(col <= colCount);
-            if (tw.isStringValue()) [[likely]]
+            int col;
+            if(tw.keyCode() >= 0) [[likely]]
             {
-                (*this)[col-1] = StringHolder(tw.stringValueFast());
+                col = keys.columnOfGlobal(tw.keyCode());
             }
             else
             {
-                (*this)[col-1] = StringHolder(tw.numberValueFast());
+                col = keys.columnOfLocal(tw.key()->toStringView());
+            }
+            if (col > 0)
+            {
+                assert(col <= colCount);
+                if (tw.isStringValue()) [[likely]]
+                {
+                    (*this)[col-1] = StringHolder(tw.stringValueFast());
+                }
+                else
+                {
+                    (*this)[col-1] = StringHolder(tw.numberValueFast());
+                }
+            }
+            else if(col < 0)        // wildcard
+            {
+                stringBuilder.writeByte(stringBuilder.isEmpty() ?
+                    '{' : ',');
+                writeTag(stringBuilder, tw);
             }
         }
-        else if(col < 0 && tagsCol)        // wildcard
+    }
+    else
+    {
+        // Otherwise, we look up the values of all keys in one pass
+        const TagProjection& projection = keys.projection();
+        TagTablePtr tags = feature.tags();
+        SmallArray<TagBits,32> values(projection.size());
+        projection.lookup(tags, &values[0]);
+        for (size_t i=0; i<projection.size(); i++)
         {
-            stringBuilder.writeByte(stringBuilder.isEmpty() ?
-                '{' : ',');
-            writeTag(stringBuilder, tw);
+            TagBits value = values[i];
+            if (value == 0) continue;
+            int col = keys.columnOfProjected(i);
+            assert(col > 0 && col <= colCount);
+            if (value & 1) [[likely]]
+            {
+                (*this)[col-1] = StringHolder((value & 2) ?
+                    tags.localString(value) :
+                    tags.globalString(value, store->strings()));
+            }
+            else
+            {
+                (*this)[col-1] = StringHolder((value & 2) ?
+                    tags.wideNumber(value) :
+                    Decimal(TagTablePtr::narrowNumber(value), 0));
+            }
         }
     }
 
@@ -10,9 +10,17 @@ namespace geodesk {
 using namespace clarisma;
 
 KeySchema::KeySchema(StringTable* strings, std::string_view keys) :
-    strings_(strings)
+    strings_(strings),
+    projection_(*strings, std::span<const std::string_view>())
 {
     addKeys(keys);
+    std::vector<std::string_view> projectedKeys;
+    projectedKeys.reserve(projectedColumns_.size());
+    for (uint16_t col : projectedColumns_)
+    {
+        projectedKeys.push_back(columns_[col - 1]);
+    }
+    projection_ = TagProjection(*strings, projectedKeys);
     if(specialKeyCols_[TAGS] && startsWith_.empty() &&
         endsWith_.empty())
     {
@@ -82,6 +90,8 @@ void KeySchema::addKey(std::string_view key)
         return;
     }
 
+    projectedColumns_.push_back(col);
+
     int code = strings_->getCode(key);
     if (code >= 0 && code <= FeatureConstants::MAX_COMMON_KEY)
     {
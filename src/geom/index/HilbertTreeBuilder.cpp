@@ -6,6 +6,7 @@
 #include <cmath>
 #include <utility>
 #include <geodesk/geom/index/hilbert.h>
+#include <geodesk/query/QueryExecutor.h>
 
 namespace geodesk {
 
@@ -39,6 +40,30 @@ HilbertTreeBuilder::HilbertTreeBuilder(clarisma::Arena* arena) :
 
 }
 
+// Splits [0, count) into batches of at least MIN_BATCH_SIZE elements
+// and calls fn(start, end) for each, using up to threadCount threads
+// (small ranges are handled by the calling thread in a single batch)
+template<typename Fn>
+static void forEachBatch(size_t count, int threadCount, Fn&& fn)
+{
+	constexpr size_t MIN_BATCH_SIZE = 4096;
+	size_t batchCount = std::min(
+		static_cast<size_t>(std::max(threadCount, 1)) * 4,
+		count / MIN_BATCH_SIZE);
+	if (threadCount <= 1 || batchCount <= 1)
+	{
+		fn(0, count);
+		return;
+	}
+	size_t batchSize = (count + batchCount - 1) / batchCount;
+	QueryExecutor::parallelFor(batchCount, threadCount,
+		[count, batchSize, &fn](size_t i)
+		{
+			size_t start = i * batchSize;
+			fn(start, std::min(start + batchSize, count));
+		});
+}
+
 // TODO: what happens if tree ie empty??
 // Not allowed --> enforce in PyRTree
 // or could have an empty-box root, with a world-box child
@@ -56,22 +81,27 @@ const HilbertTreeBuilder::Node* HilbertTreeBuilder::buildNodes(
 		}
 	}
 
-	HilbertItem* hilbertItems = buildHilbertIndex(items, itemCount, totalBounds);
+	int threadCount = 1;
+	if (itemCount >= PARALLEL_MIN_ITEMS)
+	{
+		threadCount = threadCount_ > 0 ? threadCount_ :
+			QueryExecutor::get().threadCount() + 1;
+	}
+
+	HilbertItem* hilbertItems = buildHilbertIndex(items, itemCount, totalBounds, threadCount);
 
 	size_t totalNodeCount = calculateTotalNodeCount(itemCount, maxItemsPerNode);
 
 	Node* tree = new Node[totalNodeCount];
 	Node* pChildEnd = tree + totalNodeCount;
 	Node* pChildStart = tree + totalNodeCount - itemCount;
-	Node* p = pChildStart;
-	HilbertItem* pItem = hilbertItems;
-	do
+	forEachBatch(itemCount, threadCount, [pChildStart, hilbertItems](size_t start, size_t end)
 	{
-		p->init(pItem->second->bounds, pItem->second->item, 0);
-		p++;
-		pItem++;
-	} 
-	while (p < pChildEnd);
+		for (size_t i = start; i < end; i++)
+		{
+			pChildStart[i].init(hilbertItems[i].second->bounds, hilbertItems[i].second->item, 0);
+		}
+	});
 
 	size_t childCount = itemCount;
 	int flags = Node::Flags::LEAF;
@@ -81,29 +111,14 @@ const HilbertTreeBuilder::Node* HilbertTreeBuilder::buildNodes(
 		// For each level
 		assert(childCount == pChildEnd - pChildStart);
 		size_t parentCount = (childCount + maxItemsPerNode - 1) / maxItemsPerNode;
-		Node* pChild = pChildStart;
 
 		// Place parents before children
 		Node* pParentStart = pChildStart - parentCount;
-		Node* pParent = pParentStart;
-		do
+		forEachBatch(parentCount, threadCount, [=](size_t start, size_t end)
 		{
-			Box parentBounds;
-			Node* pFirstChild = pChild;
-			Node* pNextChild = pChild + maxItemsPerNode;
-			pNextChild = std::min(pNextChild, pChildEnd);
-			do
-			{
-				parentBounds.expandToIncludeSimple(pChild->bounds);
-				pChild++;
-			} 
-			while (pChild < pNextChild);
-			(pChild - 1)->markLast();
-			pParent->init(parentBounds, pFirstChild, flags);
-			pParent++;
-			parentBounds.setEmpty();
-		} 
-		while (pChild < pChildEnd);		
+			buildParents(pChildStart, pChildEnd, pParentStart, start, end,
+				maxItemsPerNode, flags);
+		});
 		flags = 0;
 		pChildEnd = pChildStart;
 		pChildStart = pParentStart;
@@ -118,15 +133,40 @@ const HilbertTreeBuilder::Node* HilbertTreeBuilder::buildNodes(
 }
 
 
-HilbertTreeBuilder::HilbertItem* HilbertTreeBuilder::buildHilbertIndex(
-	const BoundedItem* items, size_t itemCount, const Box& totalBounds)
+// Builds the parents in [firstParent, endParent) of one level; each
+// parent covers the next maxItemsPerNode children (the last parent may
+// have fewer), so ranges of parents can be built independently
+void HilbertTreeBuilder::buildParents(Node* pChildStart, Node* pChildEnd,
+	Node* pParentStart, size_t firstParent, size_t endParent,
+	int maxItemsPerNode, int flags)
+{
+	Node* pChild = pChildStart + firstParent * maxItemsPerNode;
+	for (Node* pParent = pParentStart + firstParent;
+		pParent < pParentStart + endParent; pParent++)
+	{
+		Box parentBounds;
+		Node* pFirstChild = pChild;
+		Node* pNextChild = pChild + maxItemsPerNode;
+		pNextChild = std::min(pNextChild, pChildEnd);
+		do
+		{
+			parentBounds.expandToIncludeSimple(pChild->bounds);
+			pChild++;
+		} 
+		while (pChild < pNextChild);
+		(pChild - 1)->markLast();
+		pParent->init(parentBounds, pFirstChild, flags);
+	}
+}
+
+
+void HilbertTreeBuilder::calculateHilbertItems(const BoundedItem* items,
+	size_t itemCount, const Box& totalBounds, HilbertItem* hilbertItems)
 {
 	int64_t totalWidth = totalBounds.widthSimple();
 	int64_t totalHeight = totalBounds.height();
 
-	HilbertItem* hilbertItems = arena_.allocArray<HilbertItem>(itemCount);
 	HilbertItem* p = hilbertItems;
-
 	for (const BoundedItem* pBounded = items; pBounded < items + itemCount; pBounded++)
 	{
 		const Box& b = pBounded->bounds;
@@ -145,8 +185,63 @@ HilbertTreeBuilder::HilbertItem* HilbertTreeBuilder::buildHilbertIndex(
 		p->second = pBounded;
 		p++;
 	}
-	std::sort(hilbertItems, p);
-	return hilbertItems;
+}
+
+
+HilbertTreeBuilder::HilbertItem* HilbertTreeBuilder::buildHilbertIndex(
+	const BoundedItem* items, size_t itemCount, const Box& totalBounds,
+	int threadCount)
+{
+	HilbertItem* hilbertItems = arena_.allocArray<HilbertItem>(itemCount);
+	if (threadCount <= 1)
+	{
+		calculateHilbertItems(items, itemCount, totalBounds, hilbertItems);
+		std::sort(hilbertItems, hilbertItems + itemCount);
+		return hilbertItems;
+	}
+
+	// Calculate and sort runs of items in parallel, then merge pairs
+	// of runs (also in parallel) until a single run is left. Items are
+	// ordered by distance and address, so the result is the same as
+	// if all items had been sorted at once.
+
+	std::vector<size_t> runs;
+	size_t runCount = std::min(static_cast<size_t>(threadCount) * 4,
+		std::max<size_t>(itemCount / 4096, 1));
+	size_t runSize = (itemCount + runCount - 1) / runCount;
+	for (size_t start = 0; start < itemCount; start += runSize) runs.push_back(start);
+	runs.push_back(itemCount);
+	runCount = runs.size() - 1;
+
+	QueryExecutor::parallelFor(runCount, threadCount,
+		[&](size_t i)
+		{
+			calculateHilbertItems(items + runs[i], runs[i + 1] - runs[i],
+				totalBounds, hilbertItems + runs[i]);
+			std::sort(hilbertItems + runs[i], hilbertItems + runs[i + 1]);
+		});
+
+	HilbertItem* src = hilbertItems;
+	HilbertItem* dest = arena_.allocArray<HilbertItem>(itemCount);
+	while (runs.size() > 2)
+	{
+		size_t pairCount = runs.size() / 2;
+		QueryExecutor::parallelFor(pairCount, threadCount,
+			[&](size_t i)
+			{
+				size_t start = runs[i * 2];
+				size_t middle = runs[std::min(i * 2 + 1, runs.size() - 1)];
+				size_t end = runs[std::min(i * 2 + 2, runs.size() - 1)];
+				std::merge(src + start, src + middle, src + middle, src + end,
+					dest + start);
+			});
+		std::vector<size_t> merged;
+		for (size_t i = 0; i < runs.size(); i += 2) merged.push_back(runs[i]);
+		if (merged.back() != itemCount) merged.push_back(itemCount);
+		runs.swap(merged);
+		std::swap(src, dest);
+	}
+	return src;
 }
 
 size_t HilbertTreeBuilder::calculateTotalNodeCount(size_t itemCount, int maxItemsPerNode)
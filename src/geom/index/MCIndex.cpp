@@ -2,11 +2,15 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/geom/index/MCIndex.h>
+#include <algorithm>
+#include <clarisma/data/SmallArray.h>
 #include <geodesk/geom/index/MonotoneChain.h>
 #include <clarisma/util/log.h>
 
 namespace geodesk {
 
+using namespace clarisma;
+
 bool MCIndex::intersects(const MonotoneChain* mc) const
 {
 	assert(mc->isNormalized());
@@ -59,20 +63,30 @@ bool MCIndex::pointOnBoundary(Coordinate c) const
 bool MCIndex::countCrossings(const RTree<const MonotoneChain>::Node* node,
 	PointLocationClosure* closure)
 {
-	Coordinate c = closure->point;
+	return locateOnChain(node, closure->point, closure->location);
+}
+
+
+/// Counts the crossing (if any) of the ray cast eastward from `c` with
+/// the chain of `node`; returns `true` if the point lies on the chain
+/// (in which case the location is final)
+///
+bool MCIndex::locateOnChain(const RTree<const MonotoneChain>::Node* node,
+	Coordinate c, PointLocation& location)
+{
 	if (c.y == node->bounds.maxY())
 	{
 		if (c.y == node->bounds.minY() && c.x >= node->bounds.minX())
 		{
 			// The point lies on a horizontal segment
-			closure->location.setOnBoundary();
+			location.setOnBoundary();
 			return true;	// stop r-tree search
 		}
 
 		// Check if point is coincident with the end vertex of the chain
 		if (c.x == node->item()->last().x)
 		{
-			closure->location.setOnBoundary();
+			location.setOnBoundary();
 			return true;    // stop r-tree search
 		}
 
@@ -92,7 +106,7 @@ bool MCIndex::countCrossings(const RTree<const MonotoneChain>::Node* node,
 		{
 			// If point lies to the left of the MC's bounding box,
 			// it is guaranteed to cross the MC
-			closure->location.addCrossing();
+			location.addCrossing();
 		}
 		else
 		{
@@ -106,18 +120,82 @@ bool MCIndex::countCrossings(const RTree<const MonotoneChain>::Node* node,
 
 			if (crossProduct == 0)
 			{
-				closure->location.setOnBoundary();
+				location.setOnBoundary();
 				return true;
 			}
 			else if (crossProduct > 0)
 			{
-				closure->location.addCrossing();
+				location.addCrossing();
 			}
 		}
 	}
 	return false; // keep going
 }
 
+struct MCIndex::BatchLocationClosure
+{
+	std::span<const Coordinate> points;
+	const uint32_t* order;			// indexes of the points, sorted by y
+	const int32_t* ys;				// y of each point in `order`
+	PointLocation* locations;
+};
+
+
+bool MCIndex::countBatchCrossings(const RTree<const MonotoneChain>::Node* node,
+	BatchLocationClosure* closure)
+{
+	// The rays that may cross the chain are those of the points
+	// within its y-range that lie west of its eastern edge (the
+	// same test that the R-tree applies to the ray of a single point)
+
+	size_t count = closure->points.size();
+	const int32_t* ys = closure->ys;
+	size_t i = std::lower_bound(ys, ys + count, node->bounds.minY()) - ys;
+	for (; i < count && ys[i] <= node->bounds.maxY(); i++)
+	{
+		uint32_t n = closure->order[i];
+		Coordinate c = closure->points[n];
+		PointLocation& location = closure->locations[n];
+		if (c.x > node->bounds.maxX() || location.isOnBoundary()) continue;
+		locateOnChain(node, c, location);
+	}
+	return false;	// visit all chains
+}
+
+
+void MCIndex::locatePoints(std::span<const Coordinate> points, int8_t* locations) const
+{
+	size_t count = points.size();
+	if (count == 0) return;
+	SmallArray<uint32_t, 64> order(count);
+	for (uint32_t i = 0; i < count; i++) order[i] = i;
+	std::sort(&order[0], &order[0] + count, [points](uint32_t a, uint32_t b)
+	{
+		return points[a].y < points[b].y;
+	});
+	SmallArray<int32_t, 64> ys(count);
+	SmallArray<PointLocation, 64> pointLocations(count);
+	int32_t minX = std::numeric_limits<int32_t>::max();
+	for (size_t i = 0; i < count; i++)
+	{
+		Coordinate c = points[order[i]];
+		ys[i] = c.y;
+		minX = std::min(minX, c.x);
+		pointLocations[i] = PointLocation();
+	}
+	BatchLocationClosure closure{ points, &order[0], &ys[0], &pointLocations[0] };
+
+	// A single search covers the rays of all points
+	index_.search(
+		Box(minX, ys[0], std::numeric_limits<int32_t>::max(), ys[count - 1]),
+		countBatchCrossings, &closure);
+	for (size_t i = 0; i < count; i++)
+	{
+		locations[i] = static_cast<int8_t>(pointLocations[i].location());
+	}
+}
+
+
 /*
 static bool intersectsLineSegment(const RTree<const MonotoneChain>::Node* node,
 	const Box* bounds)
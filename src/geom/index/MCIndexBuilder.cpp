@@ -8,6 +8,7 @@
 #include <geodesk/feature/MemberIterator.h>
 #include <geodesk/feature/FastMemberIterator.h>
 #include <geodesk/geom/index/HilbertTreeBuilder.h>
+#include <geodesk/query/QueryExecutor.h>
 
 namespace geodesk {
 
@@ -22,6 +23,15 @@ MCIndexBuilder::MCIndexBuilder() :
 }
 
 
+MCIndex MCIndexBuilder::buildFromAreaRelation(FeatureStore* store, RelationPtr rel)
+{
+	MCIndexBuilder builder;
+	builder.setThreadCount(store->maxQueryParallelism());
+	builder.segmentizeAreaRelation(store, rel);
+	return builder.build(rel.bounds());
+}
+
+
 void MCIndexBuilder::segmentizeWay(WayPtr way)
 {
 	WaySlicer slicer(way);
@@ -41,8 +51,64 @@ void MCIndexBuilder::segmentizeWay(WayPtr way)
 	while (slicer.hasMore());
 }
 
+void MCIndexBuilder::segmentizeWays(std::span<const WayPtr> ways)
+{
+	size_t vertexCount = 0;
+	if (threadCount_ != 1 && ways.size() > 1)
+	{
+		for (WayPtr way : ways) vertexCount += way.nodeCount();
+	}
+	if (vertexCount < PARALLEL_MIN_VERTEXES)
+	{
+		for (WayPtr way : ways) segmentizeWay(way);
+		return;
+	}
+
+	// Split the ways into batches with roughly the same number of
+	// vertexes; each batch is segmentized into a separate part
+	// (with its own arena), which build() then combines
+
+	int threadCount = threadCount_ > 0 ? threadCount_ :
+		QueryExecutor::get().threadCount() + 1;
+	size_t batchVertexes = std::max<size_t>(vertexCount / (threadCount * 4), 1);
+	std::vector<size_t> batches;
+	size_t n = batchVertexes;
+	for (size_t i = 0; i < ways.size(); i++)
+	{
+		if (n >= batchVertexes)
+		{
+			batches.push_back(i);
+			n = 0;
+		}
+		n += ways[i].nodeCount();
+	}
+	batches.push_back(ways.size());
+
+	size_t firstPart = parts_.size();
+	size_t batchCount = batches.size() - 1;
+	for (size_t i = 0; i < batchCount; i++)
+	{
+		parts_.push_back(std::make_unique<MCIndexBuilder>());
+	}
+	QueryExecutor::parallelFor(batchCount, threadCount, [&](size_t i)
+	{
+		MCIndexBuilder& part = *parts_[firstPart + i];
+		for (size_t j = batches[i]; j < batches[i + 1]; j++)
+		{
+			part.segmentizeWay(ways[j]);
+		}
+	});
+	for (size_t i = firstPart; i < parts_.size(); i++)
+	{
+		chainCount_ += parts_[i]->chainCount_;
+		totalChainSize_ += parts_[i]->totalChainSize_;
+	}
+}
+
+
 void MCIndexBuilder::segmentizeAreaRelation(FeatureStore* store, RelationPtr rel)
 {
+	std::vector<WayPtr> ways;
 	FastMemberIterator iter(store, rel);
 	for (;;)
 	{
@@ -51,9 +117,10 @@ void MCIndexBuilder::segmentizeAreaRelation(FeatureStore* store, RelationPtr rel
 		if (member.isWay())
 		{
 			WayPtr way(member);
-			if(!way.isPlaceholder()) segmentizeWay(way);
+			if(!way.isPlaceholder()) ways.push_back(way);
 		}
 	}
+	segmentizeWays(ways);
 
 	// If no ways were extracted, attempt to extract any features
 	// (i.e. treat like non-area relation)
@@ -70,6 +137,15 @@ void MCIndexBuilder::segmentizeAreaRelation(FeatureStore* store, RelationPtr rel
 
 
 void MCIndexBuilder::segmentizeMembers(FeatureStore* store, RelationPtr rel, RecursionGuard& guard)
+{
+	std::vector<WayPtr> ways;
+	collectMemberWays(store, rel, guard, ways);
+	segmentizeWays(ways);
+}
+
+
+void MCIndexBuilder::collectMemberWays(FeatureStore* store, RelationPtr rel,
+	RecursionGuard& guard, std::vector<WayPtr>& ways)
 {
 	FastMemberIterator iter(store, rel);
 	for (;;)
@@ -81,13 +157,13 @@ void MCIndexBuilder::segmentizeMembers(FeatureStore* store, RelationPtr rel, Rec
 		{
 			WayPtr memberWay(member);
 			if (memberWay.isPlaceholder()) continue;
-			segmentizeWay(memberWay);
+			ways.push_back(memberWay);
 		}
 		else if(memberType == 2)
 		{
 			RelationPtr childRel(member);
 			if (childRel.isPlaceholder() || !guard.checkAndAdd(childRel)) continue;
-			segmentizeMembers(store, childRel, guard);
+			collectMemberWays(store, childRel, guard, ways);
 		}
 	}
 }
@@ -99,23 +175,55 @@ MCIndex MCIndexBuilder::build(Box bounds)
 	assert(totalChainSize_ > 0);
 	uint8_t* data = new uint8_t[totalChainSize_];
 	BoundedItem* boundedItems = arena_.allocArray<BoundedItem>(chainCount_);
-	const MCHolder* holder = first_;
-	BoundedItem* p = boundedItems;
-	uint8_t* pNextNormalizedChain = data;
-	while (holder)
+
+	// Our own chains come first, followed by the chains of each part;
+	// since we know how much space each part needs, the parts can
+	// be copied in parallel
+
+	size_t partChainCount = 0;
+	size_t partChainSize = 0;
+	for (const auto& part : parts_)
 	{
-		MonotoneChain* pNormalizedChain = reinterpret_cast<MonotoneChain*>(pNextNormalizedChain);
-		holder->chain.copyNormalized(pNormalizedChain);
-		pNextNormalizedChain += pNormalizedChain->storageSize();
-		p->item = pNormalizedChain;
-		p->bounds = pNormalizedChain->bounds();
-		p++;
-		holder = holder->next;
+		partChainCount += part->chainCount_;
+		partChainSize += part->totalChainSize_;
 	}
-	assert(pNextNormalizedChain == data + totalChainSize_);
-	assert(p == boundedItems + chainCount_);
+	std::vector<const MCIndexBuilder*> sources;
+	std::vector<std::pair<size_t,size_t>> starts;	// (data offset, item index)
+	sources.push_back(this);
+	starts.emplace_back(0, 0);
+	size_t dataOfs = totalChainSize_ - partChainSize;
+	size_t itemIndex = chainCount_ - partChainCount;
+	for (const auto& part : parts_)
+	{
+		sources.push_back(part.get());
+		starts.emplace_back(dataOfs, itemIndex);
+		dataOfs += part->totalChainSize_;
+		itemIndex += part->chainCount_;
+	}
+	starts.emplace_back(totalChainSize_, chainCount_);
+
+	QueryExecutor::parallelFor(sources.size(), parts_.empty() ? 1 : threadCount_,
+		[&](size_t i)
+		{
+			const MCHolder* holder = sources[i]->first_;
+			BoundedItem* p = boundedItems + starts[i].second;
+			uint8_t* pNextNormalizedChain = data + starts[i].first;
+			while (holder)
+			{
+				MonotoneChain* pNormalizedChain = reinterpret_cast<MonotoneChain*>(pNextNormalizedChain);
+				holder->chain.copyNormalized(pNormalizedChain);
+				pNextNormalizedChain += pNormalizedChain->storageSize();
+				p->item = pNormalizedChain;
+				p->bounds = pNormalizedChain->bounds();
+				p++;
+				holder = holder->next;
+			}
+			assert(pNextNormalizedChain == data + starts[i + 1].first);
+			assert(p == boundedItems + starts[i + 1].second);
+		});
 
 	HilbertTreeBuilder indexBuilder(&arena_);
+	indexBuilder.setThreadCount(threadCount_);
 	return MCIndex(data, indexBuilder.build<const MonotoneChain>(
 		boundedItems, chainCount_, 9, bounds));
 }
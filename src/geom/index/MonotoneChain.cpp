@@ -3,7 +3,7 @@
 
 #include <geodesk/geom/index/MonotoneChain.h>
 #include <algorithm>
-#include <geodesk/geom/LineSegment.h>
+#include <geodesk/geom/index/SegmentIntersection.h>
 
 namespace geodesk {
 
@@ -45,44 +45,105 @@ const Coordinate* MonotoneChain::findSegmentForY(int32_t y) const
 /**
  * @brief Checks whether two monotone chains intersect.
  *
- * Given two monotone chains that increment monotonically along the Y axis,
- * this function checks if they intersect using a linearithmic approach.
+ * Both chains must be normalized (their Y-coordinates increase). All
+ * segment tests use exact integer arithmetic (see SegmentIntersection).
  *
- * The monotone chains are represented as arrays of `int32_t` values:
- * - The first `int32_t` value represents the number of vertices in the chain.
- * - The subsequent `int32_t` values are interleaved x/y coordinates of the vertices.
+ * If one chain has far more vertexes than the other (e.g. a long
+ * river segment vs. a detailed boundary):
+ * 1. For each segment of the shorter ("outer") chain, determine the
+ *    window of consecutive segments of the longer ("inner") chain
+ *    whose Y-interval overlaps the segment's Y-interval. Since both
+ *    chains increase along the Y axis, the start and end of this
+ *    window only ever move forward.
+ * 2. Test the segment against all segments in the window at once
+ *    (see SegmentIntersection::intersectsAny()).
  *
- * Algorithm Overview:
- * 1. Determine which chain starts at a lower Y-coordinate (`chainLow`) and
- *    which starts higher (`chainHigh`).
- * 2. Use binary search on `chainLow` to find the first segment whose end Y-coordinate
- *    is equal to or above the starting Y-coordinate of `chainHigh`.
- * 3. From this found position, iterate over the segments of both chains, checking
- *    for intersections.
- *    a. For each step, test the intersection of the current segment of `chainLow`
- *       with the current segment of `chainHigh`.
- *    b. If an intersection is found, return true.
- *    c. After each segment intersection check, advance the pointer of the chain
- *       whose current segment's end Y-coordinate is lower. If any pointer reaches
- *       the end of its chain without finding an intersection, the chains do not
- *       intersect.
+ * Otherwise (or if the chains span more than half the world), the
+ * windows would hold only a few segments, and we walk both chains
+ * in lockstep instead:
+ * 1. Use binary search on the chain that starts lower to find the
+ *    first segment whose end Y-coordinate is equal to or above the
+ *    starting Y-coordinate of the other chain.
+ * 2. Test the current segments of both chains, then advance the
+ *    chain whose current segment ends lower, until either chain
+ *    runs out of segments.
  *
- * @param chain1   pointer to the first monotone chain.
- * @param chain2   pointer to the second monotone chain.
+ * Both approaches test all pairs of segments that overlap along
+ * the Y axis (the only ones that can intersect).
+ *
+ * @param other   the other monotone chain
  * @return Returns `true` if the chains intersect, `false` otherwise.
  */
 
- // TODO: the binary search may not work correctly if the chain includes a
- // segment that runs parallel to the x-axis (its start-Y and end-Y are the same)
- // May need to treat such a segment as its own chain (better for spatial indexing
- // anyway, as such a segment needlessly inflates the bbox)
-
 // If we use quadrant-MCs, we only need to check a single segment if their 
 //  quadrants are different (i.e. one moves east and one moves west), as those
 //  chains can only intersect in one segment 
 //  (y direction always moves north)
 
 bool MonotoneChain::intersects(const MonotoneChain* other) const
+{
+	Box bounds = this->bounds();
+	bounds.expandToIncludeSimple(other->bounds());
+	bool compact = SegmentIntersection::isCompact(bounds);
+		// Chains that span more than half the world need the slower tests
+
+	const MonotoneChain* outer = this;
+	const MonotoneChain* inner = other;
+	if (inner->coordCount < outer->coordCount) std::swap(outer, inner);
+	if (!compact || inner->coordCount < outer->coordCount * MIN_WINDOW_RATIO)
+	{
+		return intersectsInLockstep(other, compact);
+	}
+
+	const Coordinate* p = outer->coords;
+	const Coordinate* pEnd = p + outer->coordCount - 1;
+	const Coordinate* innerLast = inner->coords + inner->coordCount - 1;
+	const Coordinate* windowStart = inner->coords;
+	const Coordinate* windowEnd = inner->coords;
+		// start vertex of the last segment in the window
+	int32_t innerMinY = inner->coords[0].y;
+	int32_t innerMaxY = innerLast->y;
+
+	for (; p < pEnd; p++)
+	{
+		Coordinate start = p[0];
+		Coordinate end = p[1];
+		if (end.y < innerMinY) continue;
+		if (start.y > innerMaxY) break;
+
+		// Skip the inner segments that end below this segment
+		// (The last inner segment ends at innerMaxY >= start.y,
+		// so we never move past it)
+		while (windowStart[1].y < start.y) windowStart++;
+
+		// Include the inner segments that start at or below
+		// the end of this segment
+		windowEnd = std::max(windowEnd, windowStart);
+		while (windowEnd + 1 < innerLast && windowEnd[1].y <= end.y) windowEnd++;
+
+		// The inner chain is monotone along the X axis as well, so the
+		// window's X-interval is defined by its first and last vertex;
+		// if it doesn't overlap the segment's, none of them intersect
+
+		int32_t windowX1 = windowStart[0].x;
+		int32_t windowX2 = windowEnd[1].x;
+		if (std::max(start.x, end.x) < std::min(windowX1, windowX2) ||
+			std::min(start.x, end.x) > std::max(windowX1, windowX2))
+		{
+			continue;
+		}
+
+		if (SegmentIntersection::intersectsAny(start, end, windowStart,
+			static_cast<int>(windowEnd - windowStart) + 1))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool MonotoneChain::intersectsInLockstep(const MonotoneChain* other, bool compact) const
 {
 	const MonotoneChain* chain1 = this;
 	const MonotoneChain* chain2 = other;
@@ -106,8 +167,9 @@ bool MonotoneChain::intersects(const MonotoneChain* other) const
 
 	for (;;)
 	{
-		// check for line segment intersection
-		if (LineSegment::linesIntersect(start1, end1, start2, end2))
+		if (compact ?
+			SegmentIntersection::intersectsCompact(start1, end1, start2, end2) :
+			SegmentIntersection::intersects(start1, end1, start2, end2))
 		{
 			return true;
 		}
@@ -0,0 +1,197 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/geom/index/SegmentIntersection.h>
+#include <cstring>
+#include <clarisma/util/Bits.h>
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define GEODESK_SEGMENT_INTERSECTION_AVX2
+#endif
+
+namespace geodesk {
+
+using namespace clarisma;
+
+namespace SegmentIntersection
+{
+    /// Checks whether `v` can be represented as an int32_t
+    /// (other than INT32_MIN), so that the sum of two products
+    /// of such values cannot overflow an int64_t
+    static bool isSmall(int64_t v)
+    {
+        return static_cast<uint64_t>(v + INT32_MAX) <= 2ULL * INT32_MAX;
+    }
+
+    /// Returns the sign of a*b + c*d, for values with an absolute
+    /// value below 2^34 (the sum may need up to 69 bits)
+    static int signOfSum(int64_t a, int64_t b, int64_t c, int64_t d)
+    {
+        if (isSmall(a) & isSmall(b) & isSmall(c) & isSmall(d))
+        {
+            int64_t sum = a * b + c * d;
+            return (sum > 0) - (sum < 0);
+        }
+
+        // Split each value into its upper bits and its lower 17 bits
+        // (which are always positive), so that all partial products
+        // fit into 64 bits
+
+        constexpr int SHIFT = 17;
+        constexpr int64_t MASK = (1 << SHIFT) - 1;
+        int64_t aHigh = a >> SHIFT;
+        int64_t aLow = a & MASK;
+        int64_t bHigh = b >> SHIFT;
+        int64_t bLow = b & MASK;
+        int64_t cHigh = c >> SHIFT;
+        int64_t cLow = c & MASK;
+        int64_t dHigh = d >> SHIFT;
+        int64_t dLow = d & MASK;
+        int64_t high = aHigh * bHigh + cHigh * dHigh;
+        int64_t mid = aHigh * bLow + aLow * bHigh + cHigh * dLow + cLow * dHigh;
+        int64_t low = aLow * bLow + cLow * dLow;
+
+        // sum = (high << 34) + (mid << 17) + low
+        //     = (upper << 17) + low, with 0 <= low < 2^17
+        int64_t upper = (high << SHIFT) + mid + (low >> SHIFT);
+        low &= MASK;
+        if (upper != 0) return upper > 0 ? 1 : -1;
+        return low != 0;
+    }
+
+    int orientation(Coordinate start, Coordinate end, Coordinate p)
+    {
+        int64_t dx = static_cast<int64_t>(end.x) - start.x;
+        int64_t dy = static_cast<int64_t>(end.y) - start.y;
+        int64_t px = static_cast<int64_t>(p.x) - start.x;
+        int64_t py = static_cast<int64_t>(p.y) - start.y;
+        int ccw = signOfSum(px, dy, -py, dx);
+        if (ccw == 0)
+        {
+            // Collinear: Does p lie before, on or beyond the segment?
+            ccw = signOfSum(px, dx, py, dy);
+            if (ccw > 0)
+            {
+                ccw = signOfSum(px - dx, dx, py - dy, dy);
+                if (ccw < 0) ccw = 0;
+            }
+        }
+        return ccw;
+    }
+
+    bool intersects(Coordinate start1, Coordinate end1,
+        Coordinate start2, Coordinate end2)
+    {
+        return orientation(start1, end1, start2) *
+            orientation(start1, end1, end2) <= 0 &&
+            orientation(start2, end2, start1) *
+            orientation(start2, end2, end1) <= 0;
+    }
+
+    /// (p - origin) x (dx,dy), for coordinates within compact bounds
+    static int64_t cross(Coordinate origin, int64_t dx, int64_t dy, Coordinate p)
+    {
+        return (static_cast<int64_t>(p.x) - origin.x) * dy -
+            (static_cast<int64_t>(p.y) - origin.y) * dx;
+    }
+
+    // Only collinear cases need the full test
+
+    bool intersectsCompact(Coordinate start1, Coordinate end1,
+        Coordinate start2, Coordinate end2)
+    {
+        int64_t dx = static_cast<int64_t>(end1.x) - start1.x;
+        int64_t dy = static_cast<int64_t>(end1.y) - start1.y;
+        int64_t c1 = cross(start1, dx, dy, start2);
+        int64_t c2 = cross(start1, dx, dy, end2);
+        if ((c1 < 0) == (c2 < 0) && c1 != 0 && c2 != 0) return false;
+        int64_t ex = static_cast<int64_t>(end2.x) - start2.x;
+        int64_t ey = static_cast<int64_t>(end2.y) - start2.y;
+        int64_t c3 = cross(start2, ex, ey, start1);
+        int64_t c4 = cross(start2, ex, ey, end1);
+        if ((c1 == 0) | (c2 == 0) | (c3 == 0) | (c4 == 0))
+        {
+            return intersects(start1, end1, start2, end2);
+        }
+        return (c3 < 0) != (c4 < 0);
+    }
+
+#if defined(GEODESK_SEGMENT_INTERSECTION_AVX2)
+
+    static __m256i broadcast(Coordinate c)
+    {
+        int64_t v;
+        memcpy(&v, &c, sizeof(v));
+        return _mm256_set1_epi64x(v);
+    }
+
+    static __m256i load4(const Coordinate* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    /// For 4 pairs of vectors (x in the lower, y in the upper 32 bits
+    /// of each 64-bit lane), calculates px * dy - py * dx
+    static __m256i cross4(__m256i p, __m256i d)
+    {
+        return _mm256_sub_epi64(
+            _mm256_mul_epi32(p, _mm256_srli_epi64(d, 32)),
+            _mm256_mul_epi32(_mm256_srli_epi64(p, 32), d));
+    }
+
+#endif
+
+    bool intersectsAny(Coordinate start, Coordinate end,
+        const Coordinate* vertexes, int count)
+    {
+        int i = 0;
+
+#if defined(GEODESK_SEGMENT_INTERSECTION_AVX2)
+        // Since all coordinate differences fit into 32 bits, we can
+        // calculate them with 32-bit arithmetic
+
+        __m256i a = broadcast(start);
+        __m256i b = broadcast(end);
+        __m256i d = _mm256_sub_epi32(b, a);
+        __m256i zero = _mm256_setzero_si256();
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256i v0 = load4(vertexes + i);
+            __m256i v1 = load4(vertexes + i + 1);
+            __m256i e = _mm256_sub_epi32(v1, v0);
+            __m256i c1 = cross4(_mm256_sub_epi32(v0, a), d);
+            __m256i c2 = cross4(_mm256_sub_epi32(v1, a), d);
+            __m256i c3 = cross4(_mm256_sub_epi32(a, v0), e);
+            __m256i c4 = cross4(_mm256_sub_epi32(b, v0), e);
+            __m256i collinear = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi64(c1, zero), _mm256_cmpeq_epi64(c2, zero)),
+                _mm256_or_si256(_mm256_cmpeq_epi64(c3, zero), _mm256_cmpeq_epi64(c4, zero)));
+            // The sign bit is set if the endpoints of each segment
+            // lie on opposite sides of the other segment
+            __m256i crossing = _mm256_and_si256(
+                _mm256_xor_si256(c1, c2), _mm256_xor_si256(c3, c4));
+            if (_mm256_movemask_pd(_mm256_castsi256_pd(
+                _mm256_andnot_si256(collinear, crossing))))
+            {
+                return true;
+            }
+            uint32_t special = static_cast<uint32_t>(
+                _mm256_movemask_pd(_mm256_castsi256_pd(collinear)));
+            while (special)
+            {
+                int n = i + Bits::countTrailingZerosInNonZero(special);
+                if (intersects(start, end, vertexes[n], vertexes[n + 1])) return true;
+                special &= special - 1;
+            }
+        }
+#endif
+
+        for (; i < count; i++)
+        {
+            if (intersectsCompact(start, end, vertexes[i], vertexes[i + 1])) return true;
+        }
+        return false;
+    }
+}
+
+} // namespace geodesk
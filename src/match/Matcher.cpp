@@ -3,7 +3,7 @@
 
 #include <geodesk/match/Matcher.h>
 #include <cstddef>   // for offsetof
-#include <regex>
+#include <clarisma/text/Regex.h>
 #include <clarisma/util/pointer.h>
 #include "MatcherDecoder.h"
 
@@ -11,6 +11,18 @@ namespace geodesk {
 
 using namespace clarisma;
 
+size_t Matcher::acceptEach(const Matcher* matcher,
+	const FeaturePtr* features, size_t count, FeaturePtr* accepted)
+{
+	size_t acceptedCount = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		FeaturePtr feature = features[i];
+		if (matcher->accept(feature)) accepted[acceptedCount++] = feature;
+	}
+	return acceptedCount;
+}
+
 const Matcher* MatcherHolder::defaultRoleMethod(const RoleMatcher* matcher, FeaturePtr)
 {
 	// TODO: fix!
@@ -31,6 +43,8 @@ MatcherHolder::MatcherHolder(FeatureTypes types, uint32_t keyMask, uint32_t keyM
 	referencedMatcherHoldersCount_(0),
 	regexCount_(0),
 	roleMatcherOffset_(offsetof(MatcherHolder, defaultRoleMatcher_)),
+	simpleKeyCode_(-1),
+	simpleValueCode_(-1),
 	defaultRoleMatcher_(defaultRoleMethod, nullptr),
 	mainMatcher_(matchAllMethod, nullptr)
 {
@@ -63,15 +77,16 @@ void MatcherHolder::dealloc() const
 	// Destroy regex patterns
 	if (regexCount_)
 	{
-		static_assert(alignof(std::regex) <= 8, "std:regex alignment must not be stricter than 8 bytes");
+		static_assert(alignof(Regex) <= 8, "Regex alignment must not be stricter than 8 bytes");
+		static_assert(sizeof(Regex) % 8 == 0, "Regexes must be contiguous in the resources");
 		// (all resources are 8-byte aligned to accommodate natural alignment
-		// of pointers, doubes and std::regex)
-		const std::regex* pRegex = reinterpret_cast<const std::regex*>(
+		// of pointers, doubes and Regex)
+		const Regex* pRegex = reinterpret_cast<const Regex*>(
 			p + sizeof(MatcherHolder*) * referencedMatcherHoldersCount_);
-		const std::regex* pEndRegex = pRegex + regexCount_;
+		const Regex* pEndRegex = pRegex + regexCount_;
 		while (pRegex < pEndRegex)
 		{
-			pRegex->std::regex::~regex();
+			pRegex->~Regex();
 			pRegex++;
 		}
 	}
@@ -82,7 +97,11 @@ void MatcherHolder::dealloc() const
 
 const MatcherHolder* MatcherHolder::createMatchAll(FeatureTypes types)
 {
-	return new MatcherHolder(types);
+	// Must be allocated the same way as all other matchers,
+	// since dealloc() frees it as an array of bytes
+	MatcherHolder* self = (MatcherHolder*)alloc(sizeof(MatcherHolder));
+	new (self) MatcherHolder(types);
+	return self;
 }
 
 /**
@@ -138,7 +157,7 @@ public:
 		for (; ; )
 		{
 			uint32_t key = p.getUnsignedShort();
-			if (key > keyBits)
+			if (key >= keyBits)
 			{
 				uint32_t tag = (p.getUnsignedShort(2) << 16) | (key & 3);
 				return (key & 0x7ffc) == keyBits && tag != 
@@ -154,7 +173,6 @@ private:
 };
 
 
-// TODO: doesn't work, need mask, check "no"
 const MatcherHolder* MatcherHolder::createMatchKey(
 	FeatureTypes types, uint32_t indexBits, int keyCode, int codeNo)
 {
@@ -164,6 +182,7 @@ const MatcherHolder* MatcherHolder::createMatchKey(
 	// Since there is only one tag, mask and min are the same
 	new (self) MatcherHolder(types, indexBits, indexBits);
 	new (&self->mainMatcher_)GlobalKeyMatcher(keyCode, codeNo);
+	self->simpleKeyCode_ = keyCode;
 	return self;
 }
 
@@ -177,6 +196,8 @@ const MatcherHolder* MatcherHolder::createMatchKeyValue(
 	// Since there is only one tag, mask and min are the same
 	new (self) MatcherHolder(types, indexBits, indexBits);
 	new (&self->mainMatcher_)GlobalTagMatcher(keyCode, valueCode);
+	self->simpleKeyCode_ = keyCode;
+	self->simpleValueCode_ = valueCode;
 	return self;
 }
 
@@ -15,7 +15,105 @@ namespace geodesk {
 
 using namespace clarisma;
 
+static void releaseMatcher(const MatcherHolder* matcher)
+{
+	matcher->release();
+}
+
+MatcherCompiler::~MatcherCompiler()
+{
+	cache_.clear(releaseMatcher);
+}
+
 const MatcherHolder* MatcherCompiler::getMatcher(const char* query)
+{
+	std::string key = normalizeQuery(query);
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex_);
+		const MatcherHolder** cached = cache_.get(key);
+		if (cached)
+		{
+			(*cached)->addref();
+			return *cached;
+		}
+	}
+
+	// Compile without holding the lock; if another thread compiled
+	// the same query in the meantime, we use its matcher instead
+
+	const MatcherHolder* matcher = compile(query);
+	std::lock_guard<std::mutex> lock(cacheMutex_);
+	const MatcherHolder** cached = cache_.get(key);
+	if (cached)
+	{
+		matcher->release();
+		matcher = *cached;
+	}
+	else
+	{
+		cache_.put(std::move(key), matcher, releaseMatcher);
+	}
+	matcher->addref();		// one reference for the cache, one for the caller
+	return matcher;
+}
+
+void MatcherCompiler::setCacheCapacity(size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex_);
+	cache_.setCapacity(capacity, releaseMatcher);
+}
+
+void MatcherCompiler::clearCache()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex_);
+	cache_.clear(releaseMatcher);
+}
+
+MatcherCompiler::CacheStats MatcherCompiler::cacheStats()
+{
+	std::lock_guard<std::mutex> lock(cacheMutex_);
+	return cache_.stats();
+}
+
+std::string MatcherCompiler::normalizeQuery(std::string_view query)
+{
+	std::string key;
+	key.reserve(query.size());
+	const char* p = query.data();
+	const char* end = p + query.size();
+	while (p < end)
+	{
+		char ch = *p++;
+		if (ch == '\'' || ch == '"')
+		{
+			// Copy quoted strings verbatim (including escapes)
+			key += ch;
+			while (p < end)
+			{
+				char c = *p++;
+				key += c;
+				if (c == ch) break;
+				if (c == '\\' && p < end) key += *p++;
+			}
+			continue;
+		}
+		if (static_cast<unsigned char>(ch - 1) <= 31)
+		{
+			// Whitespace (same definition as Parser::skipWhitespace)
+			const char* start = p - 1;
+			while (p < end && static_cast<unsigned char>(*p - 1) <= 31) p++;
+			if (p == end) break;
+			char prev = key.empty() ? 0 : key.back();
+			if (prev == '[' || prev == ']' || prev == ',') continue;
+			key.append(start, p - start);
+			continue;
+		}
+		key += ch;
+	}
+	return key;
+}
+
+const MatcherHolder* MatcherCompiler::compile(const char* query)
 {
 	MatcherParser parser(store_, query);
 	Selector* sel = parser.parse();
@@ -96,7 +194,7 @@ const MatcherHolder* MatcherCompiler::getMatcher(const char* query)
 
 const MatcherHolder* MatcherCompiler::compileMatcher(OpGraph& graph, Selector* firstSel, uint32_t indexBits)
 {
-	MatcherValidator validator(graph);
+	MatcherValidator validator(graph, store_->strings());
 	OpNode* root = validator.validate(firstSel);
 
 	size_t resourceSize = validator.resourceSize();
@@ -118,7 +216,8 @@ const MatcherHolder* MatcherCompiler::compileMatcher(OpGraph& graph, Selector* f
 	emitter.emit();
 	emitter.fixJumps();
 
-	new (&matcherHolder->mainMatcher_)Matcher((MatcherMethod)MatcherEngine::accept, store_);
+	new (&matcherHolder->mainMatcher_)Matcher(
+		(MatcherMethod)MatcherEngine::accept, store_, MatcherEngine::acceptMany);
 
 	return matcherHolder;
 }
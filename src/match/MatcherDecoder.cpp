@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include "MatcherDecoder.h"
+#include <bit>
 #include <clarisma/util/ShortVarString.h>
 #include "MatcherEmitter.h"			// TODO: refactor
 #include "OpGraph.h"
@@ -100,6 +101,21 @@ void MatcherDecoder::writeBranchingOp(const uint16_t* p)
 		}
 		break;
 
+		case OperandType::CODE_PAIR:
+		{
+			for (int i = 0; i < 2; i++)
+			{
+				uint16_t code = *p++;
+				const ShortVarString* str = store_->strings().getGlobalString(code);
+				out_.writeString(i ? " = " : " ");
+				out_.writeBytes(str->data(), str->length());
+				out_.writeString(" (");
+				out_.formatInt(code);
+				out_.writeByte(')');
+			}
+		}
+		break;
+
 		case OperandType::STRING:
 		{
 			uint16_t ofs = *p;
@@ -123,12 +139,51 @@ void MatcherDecoder::writeBranchingOp(const uint16_t* p)
 		}
 		break;
 
+		case OperandType::DOUBLE_RANGE:
+		{
+			uint16_t ofs = *p;
+			const double* pBounds = reinterpret_cast<const double*>(
+				reinterpret_cast<const uint8_t*>(p) - ofs);
+			out_.writeString(" ");
+			out_.formatDouble(pBounds[0]);
+			out_.writeString(" .. ");
+			out_.formatDouble(pBounds[1]);
+			p++;
+		}
+		break;
+
+		case OperandType::CODE_SET:
+		{
+			uint16_t ofs = *p;
+			const CodeSet* pCodeSet = reinterpret_cast<const CodeSet*>(
+				reinterpret_cast<const uint8_t*>(p) - ofs);
+			int count = 0;
+			for (uint32_t i = 0; i < (pCodeSet->limit + 63) / 64; i++)
+			{
+				count += std::popcount(pCodeSet->bits[i]);
+			}
+			out_.writeString(" <");
+			out_.formatInt(count);
+			out_.writeString(" codes>");
+			p++;
+		}
+		break;
+
 		case OperandType::REGEX:
 		{
 			uint16_t ofs = *p;
-			const std::regex* pRegex = reinterpret_cast<const std::regex*>(
+			const Regex* pRegex = reinterpret_cast<const Regex*>(
 				reinterpret_cast<const uint8_t*>(p) - ofs);
-			out_.writeString(" <regex>");
+			if (pRegex->isCompiled())
+			{
+				out_.writeString(" <regex: ");
+				out_.formatInt(static_cast<int64_t>(pRegex->stateCount()));
+				out_.writeString(" states>");
+			}
+			else
+			{
+				out_.writeString(" <std::regex>");
+			}
 			p++;
 		}
 		break;
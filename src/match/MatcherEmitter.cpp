@@ -58,19 +58,39 @@ void MatcherEmitter::emit()
 		case Opcode::EQ_CODE:
 		case Opcode::GLOBAL_KEY:
 		case Opcode::FIRST_GLOBAL_KEY:
+		case Opcode::GLOBAL_KEY_CODE:
+		case Opcode::FIRST_GLOBAL_KEY_CODE:
 			*p++ = node->operand.code;
 			break;
 
+			// branch based on <key code> and <value code> operands
+		case Opcode::GLOBAL_KEY_EQ_CODE:
+		case Opcode::FIRST_GLOBAL_KEY_EQ_CODE:
+			*p++ = node->operand.code;
+			*p++ = node->operand2.code;
+			break;
+
 			// branch based on <string> operand
 		case Opcode::EQ_STR:
 		case Opcode::STARTS_WITH:
 		case Opcode::ENDS_WITH:
 		case Opcode::CONTAINS:
+		{
+			uint16_t len = node->operandLen;
+			StringResource* str = resources_.allocString(len);
+			str->len = len;
+			std::memcpy(str->data, node->operand.string, len);
+			putResourceOffset(p++, str);
+		}
+		break;
+
+			// branch based on <key string> operand
 		case Opcode::LOCAL_KEY:
 		case Opcode::FIRST_LOCAL_KEY:
 		{
 			uint16_t len = node->operandLen;
-			StringResource* str = resources_.allocString(len);
+			StringResource* str = resources_.allocLocalKey(
+				std::string_view(node->operand.string, len));
 			str->len = len;
 			std::memcpy(str->data, node->operand.string, len);
 			putResourceOffset(p++, str);
@@ -84,6 +104,17 @@ void MatcherEmitter::emit()
 			assert(regex->regexResource());
 			putResourceOffset(p++, regex->regexResource());
 		}
+		break;
+
+			// branch based on <code set> operand
+		case Opcode::CODE_IN_SET:
+		{
+			const CodeSet* codeSet = node->operand.codeSet;
+			size_t size = codeSet->byteSize();
+			CodeSet* pCodeSet = resources_.allocCodeSet(size);
+			std::memcpy(pCodeSet, codeSet, size);
+			putResourceOffset(p++, pCodeSet);
+		}
 		break;
 
 			// branch based on <number> operand
@@ -97,6 +128,18 @@ void MatcherEmitter::emit()
 			*pDouble = node->operand.number;
 			putResourceOffset(p++, pDouble);
 		}
+		break;
+
+			// branch based on <lower> and <upper> (consecutive doubles)
+		case Opcode::IN_RANGE:
+		{
+			double* pLower = resources_.allocDouble();
+			double* pUpper = resources_.allocDouble();
+			assert(pUpper == pLower + 1);
+			*pLower = node->operand.number;
+			*pUpper = node->operand2.number;
+			putResourceOffset(p++, pLower);
+		}
 		break;
 
 			// branch without operand
@@ -105,6 +148,7 @@ void MatcherEmitter::emit()
 		case Opcode::LOAD_STRING:
 		case Opcode::LOAD_NUM:
 		case Opcode::STR_TO_NUM:
+		case Opcode::CODE_TO_NUM:
 			// nothing else to do
 			break;
 
@@ -146,7 +190,8 @@ void MatcherEmitter::emit()
 		assert(ifFalse);
 		assert(ifTrue);
 
-		assert(ifTrue != ifFalse || opcode==Opcode::STR_TO_NUM);   // str_to_num can go to same target (because invalid strign becomes NaN)
+		assert(ifTrue != ifFalse || opcode==Opcode::STR_TO_NUM ||
+			opcode==Opcode::CODE_TO_NUM);   // str_to_num can go to same target (because invalid strign becomes NaN)
 
 		*pOpcode = opcode | (node->isNegated() ? 256 : 0);
 		p++;				// slot for the jump address
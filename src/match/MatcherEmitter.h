@@ -3,6 +3,7 @@
 
 #pragma once
 #include "OpGraph.h"
+#include <geodesk/feature/KeySignature.h>
 #include <clarisma/alloc/ArenaPool.h>
 #include <clarisma/alloc/ArenaStack.h>
 
@@ -34,11 +35,11 @@ public:
 		return (double*)alloc(sizeof(double));
 	}
 
-	std::regex* allocRegex(RegexOperand* pRegexOperand)		
+	clarisma::Regex* allocRegex(RegexOperand* pRegexOperand)		
 	{
 		// TODO: must use a special area at front of resources!
-		std::regex* pRegex = reinterpret_cast<std::regex*>(alloc(sizeof(std::regex)));
-		new (pRegex) std::regex(std::move(pRegexOperand->regex()));
+		clarisma::Regex* pRegex = reinterpret_cast<clarisma::Regex*>(alloc(sizeof(clarisma::Regex)));
+		new (pRegex) clarisma::Regex(std::move(pRegexOperand->regex()));
 		pRegexOperand->setRegexResource(pRegex);
 		return pRegex;
 	}
@@ -48,6 +49,23 @@ public:
 		return (StringResource*)alloc((size_t)len + 2);
 	}
 
+	/// Allocates a key string for LOCAL_KEY ops, which is preceded by
+	/// its KeySignature (The instruction refers to the string, so it
+	/// can be decoded like any other string operand)
+	///
+	StringResource* allocLocalKey(std::string_view key)
+	{
+		static_assert(sizeof(KeySignature) % 8 == 0);
+		uint8_t* p = alloc(sizeof(KeySignature) + key.size() + 2);
+		new(p) KeySignature(key.data(), key.size());
+		return (StringResource*)(p + sizeof(KeySignature));
+	}
+
+	CodeSet* allocCodeSet(size_t size)
+	{
+		return (CodeSet*)alloc(size);
+	}
+
 
 private:
 	uint8_t* alloc(size_t size)
@@ -3,9 +3,12 @@
 
 #include "MatcherEngine.h"
 #include "OpGraph.h"
+#include <cmath>
 #include <geodesk//feature/StringValue.h>
 #include <geodesk/feature/FeatureStore.h>
+#include <geodesk/feature/KeySignature.h>
 #include <clarisma/math/Math.h>
+#include <clarisma/util/Bits.h>
 
 namespace geodesk {
 
@@ -46,14 +49,20 @@ int MatcherEngine::scanLocalKeys()
 {
     pointer pTagTableAligned = pointer::ofTagged(pTagTable_, -4);
     std::string_view operand = getStringOperand();
+    // The emitter places the key's signature just before the string,
+    // which lets us skip most non-matching keys without comparing
+    // their characters
+    const KeySignature* signature = reinterpret_cast<const KeySignature*>(
+        reinterpret_cast<const uint8_t*>(operand.data()) - 2 - sizeof(KeySignature));
     pointer pTagOld = pTag_;
     for (;;)
     {
         int32_t key = pTag_.getUnalignedInt();
         pTag_ -= 6 + (key & 2);
         pointer pKey = pTagTableAligned + ((key >> 3) << 2);
-        StringValue keyString(pKey);
-        if (keyString == operand)
+        const ShortVarString* keyString = reinterpret_cast<const ShortVarString*>(
+            pKey.asBytePointer());
+        if (signature->matches(keyString, operand.data(), operand.size()))
         {
             tagKey_ = key;
             return 1;
@@ -83,14 +92,30 @@ inline double MatcherEngine::getDoubleOperand()
     return d;
 }
 
-inline const std::regex *MatcherEngine::getRegexOperand()
+inline const Regex* MatcherEngine::getRegexOperand()
 {
     uint16_t opOfs = ip_.getUnsignedShort();
-    std::regex* regex = (std::regex*)(ip_.asBytePointer() - opOfs); // TODO: relative to Matcher*?
+    const Regex* regex = (const Regex*)(ip_.asBytePointer() - opOfs); // TODO: relative to Matcher*?
     ip_ += 2;
     return regex;
 }
 
+inline const double* MatcherEngine::getDoubleRangeOperand()
+{
+    uint16_t opOfs = ip_.getUnsignedShort();
+    const double* bounds = (const double*)(ip_.asBytePointer() - opOfs);
+    ip_ += 2;
+    return bounds;
+}
+
+inline const CodeSet* MatcherEngine::getCodeSetOperand()
+{
+    uint16_t opOfs = ip_.getUnsignedShort();
+    const CodeSet* codeSet = (const CodeSet*)(ip_.asBytePointer() - opOfs);
+    ip_ += 2;
+    return codeSet;
+}
+
 inline uint32_t MatcherEngine::getFeatureTypeOperand()
 {
     uint32_t types = ip_.getUnalignedUnsignedInt();
@@ -100,109 +125,227 @@ inline uint32_t MatcherEngine::getFeatureTypeOperand()
     return types;
 }
 
+// IN: pTag_, tagKey_, valueOfs_; OUT: stringValue
+// Returns 1 if the current value is a local string
+inline int MatcherEngine::loadString(const uint8_t*& stringValue) const
+{
+    // A local-string value is stored as a 4-byte value (wide string)
+    // which represents an offset that, when added to the location
+    // of the value, yields a pointer to a local string.
+    // We can only read a 4-byte value from the value location if the
+    // value is, in fact, a wide value, because the GOL spec does not
+    // guarantee that memory can legally be read at (pVal + 2) if the
+    // value is narrow. Hence, we read the value as two 16-bit values,
+    // reading the upper half at pVal+2 if wide-string, or at pVal+0
+    // if any other type. This pointer arithmetic avoids a branch.
+    // The resulting pointer may therefore be invalid, but we are only 
+    // dereferencing it if the wide-string check succeeds
+
+    // TODO: Can simplify this
+    //  Tile data in GOL 2.0 is followed by a 4-byte checksum,
+    //   so we can safely read up to 4 bytes past the end of
+    //   a tagtable
+    pointer pVal = pTag_ - (int)valueOfs_;
+    int matched = ((tagKey_ & 3) == 3);      // wide string
+    int32_t rel = pVal.getUnsignedShort();   // read lower half
+    rel |= (pVal + matched * 2).getShort() << 16;
+    // read upper half (or lower again if this isn't a wide-string value)
+    stringValue = pVal.asBytePointer() + rel;
+    // The resulting string pointer (may be invalid, but instructions
+    // will only use it if matched==1)
+    return matched;
+}
+
+// IN: pTag_, tagKey_, valueOfs_; OUT: doubleValue
+// Returns 1 if the current value is a number
+inline int MatcherEngine::loadNumber(double& doubleValue) const
+{
+    int type = (tagKey_ & 3);
+    if (type == 0)      // narrow number
+    {
+        pointer pVal = pTag_ - (int)valueOfs_;
+        doubleValue = ((int32_t)pVal.getUnsignedShort()) + TagValues::MIN_NUMBER;
+        return 1;
+    }
+    if (type == 2)      // wide number
+    {
+        pointer pVal = pTag_ - (int)valueOfs_;
+        doubleValue = TagValues::doubleFromWideNumber(pVal.getUnsignedInt());
+        return 1;
+    }
+    return 0;
+}
+
+// GCC and Clang support "labels as values", which lets each instruction
+// jump straight to the handler of the next (the CPU can predict each of
+// these indirect jumps separately, and there is no bounds check). With
+// other compilers (or if GEODESK_MATCHER_NO_COMPUTED_GOTO is defined),
+// the instructions are dispatched via a switch.
+
+#if defined(__GNUC__) && !defined(GEODESK_MATCHER_NO_COMPUTED_GOTO)
+#define GEODESK_MATCHER_COMPUTED_GOTO
+#endif
+
+#ifdef GEODESK_MATCHER_COMPUTED_GOTO
+#define INSTRUCTION(name) op_##name:
+#define NEXT_INSTRUCTION()                  \
+    op = ctx.ip_.getUnsignedShort();        \
+    ctx.ip_ += 2;                           \
+    goto *DISPATCH_TABLE[op & 0xff]
+#define BRANCH()                            \
+    ctx.jumpIf(matched ^ isNegated(op));    \
+    NEXT_INSTRUCTION()
+#else
+#define INSTRUCTION(name) case name:
+#define NEXT_INSTRUCTION() continue
+#define BRANCH() break
+#endif
+
 int MatcherEngine::accept(const Matcher* matcher, FeaturePtr pFeature)
 {
     MatcherEngine ctx;
     uint32_t codeValue;
     const uint8_t* stringValue;
     double doubleValue;
+    int op;
+    int matched;
 
     // The matcher's bytecode begins right after the Matcher structure
     ctx.ip_ = pointer(reinterpret_cast<const uint8_t*>(matcher) + sizeof(Matcher));
     ctx.pTagTable_ = (pFeature.ptr() + 8).follow();
+
+#ifdef GEODESK_MATCHER_COMPUTED_GOTO
+    // Must be in the same order as enum Opcode
+    static const void* const DISPATCH_TABLE[] =
+    {
+        &&op_NOP, &&op_EQ_CODE, &&op_EQ_STR, &&op_STARTS_WITH,
+        &&op_ENDS_WITH, &&op_CONTAINS, &&op_REGEX, &&op_EQ_NUM,
+        &&op_LE, &&op_LT, &&op_GE, &&op_GT,
+        &&op_GLOBAL_KEY, &&op_FIRST_GLOBAL_KEY, &&op_LOCAL_KEY,
+        &&op_FIRST_LOCAL_KEY, &&op_HAS_LOCAL_KEYS, &&op_LOAD_CODE,
+        &&op_LOAD_STRING, &&op_LOAD_NUM, &&op_CODE_TO_STR, &&op_STR_TO_NUM,
+        &&op_FEATURE_TYPE, &&op_GOTO, &&op_RETURN,
+        &&op_GLOBAL_KEY_CODE, &&op_FIRST_GLOBAL_KEY_CODE,
+        &&op_GLOBAL_KEY_EQ_CODE, &&op_FIRST_GLOBAL_KEY_EQ_CODE,
+        &&op_IN_RANGE, &&op_CODE_IN_SET, &&op_CODE_TO_NUM
+    };
+    static_assert(sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0]) ==
+        Opcode::OPCODE_COUNT);
+
+    NEXT_INSTRUCTION();
+#else
     for (;;)
     {
-        int matched;
-        int op = ctx.ip_.getUnsignedShort();
-        int opcode = op & 0xff;
+        op = ctx.ip_.getUnsignedShort();
         ctx.ip_ += 2;   // move to first operand
-        switch (opcode)
+        switch (op & 0xff)
         {
-            case NOP:
+#endif
+            INSTRUCTION(NOP)
                 // do nothing
-                continue;
+                NEXT_INSTRUCTION();
 
-            case EQ_CODE:
+            INSTRUCTION(EQ_CODE)
             {
                 uint16_t operand = ctx.ip_.getUnsignedShort();
                 ctx.ip_ += 2;
                 matched = (codeValue == operand);
             }
-            break;
+            BRANCH();
 
-            case EQ_STR:
+            INSTRUCTION(EQ_STR)
             {
                 geodesk::StringValue str(stringValue);
                 matched = (str == ctx.getStringOperand());
             }
-            break;
+            BRANCH();
 
-            case STARTS_WITH:
+            INSTRUCTION(STARTS_WITH)
                 matched = asStringView(stringValue).starts_with(ctx.getStringOperand());
-                break;
+                BRANCH();
 
-            case ENDS_WITH:
+            INSTRUCTION(ENDS_WITH)
                 matched = asStringView(stringValue).ends_with(ctx.getStringOperand());
-                break;
+                BRANCH();
 
-            case CONTAINS:
+            INSTRUCTION(CONTAINS)
                 matched = asStringView(stringValue).find(ctx.getStringOperand())
                     != std::string_view::npos;
-                break;
+                BRANCH();
 
-            case REGEX:
-            {
-                std::string_view val = asStringView(stringValue);
-                matched = std::regex_match(val.begin(), val.end(), *ctx.getRegexOperand());
-            }
-            break;
+            INSTRUCTION(REGEX)
+                matched = ctx.getRegexOperand()->match(asStringView(stringValue));
+                BRANCH();
 
-            case EQ_NUM:
+            INSTRUCTION(EQ_NUM)
                 matched = (doubleValue == ctx.getDoubleOperand());
-                break;
+                BRANCH();
 
-            case LE:
+            INSTRUCTION(LE)
                 matched = (doubleValue <= ctx.getDoubleOperand());
-                break;
+                BRANCH();
 
-            case LT:
+            INSTRUCTION(LT)
                 matched = (doubleValue < ctx.getDoubleOperand());
-                break;
+                BRANCH();
 
-            case GE:
+            INSTRUCTION(GE)
                 matched = (doubleValue >= ctx.getDoubleOperand());
-                break;
+                BRANCH();
 
-            case GT:
+            INSTRUCTION(GT)
                 matched = (doubleValue > ctx.getDoubleOperand());
-                break;
+                BRANCH();
 
-            case GLOBAL_KEY:
-            /*
-                if (ctx.tagKey_ & 0x8000)
-                {
-                    // We're at last tag --> match failed 
-                    // `matched` already has the correct value
-                    ctx.ip_ += 2;       // move to 2nd operand (jump target)
-                    matched = 0;
-                }
-                else
-                {
-                */
-                    matched = ctx.scanGlobalKeys();
-                // }
-                break;
-
-            case FIRST_GLOBAL_KEY:
+            INSTRUCTION(IN_RANGE)
             {
-                pointer p = ctx.pTagTable_;
-                ctx.pTag_ = p & (uint64_t)~1;       // mask off the local-keys flag
-                ctx.valueOfs_ = -2;
-                matched = ctx.scanGlobalKeys();
+                // The lower and upper bounds are consecutive doubles
+                const double* bounds = ctx.getDoubleRangeOperand();
+                matched = (doubleValue >= bounds[0]) & (doubleValue <= bounds[1]);
             }
-            break;
+            BRANCH();
+
+            INSTRUCTION(CODE_IN_SET)
+                // The outcome of the string test for each global string
+                // has been precomputed by the MatcherCompiler
+                matched = ctx.getCodeSetOperand()->contains(codeValue);
+                BRANCH();
+
+            INSTRUCTION(GLOBAL_KEY)
+                matched = ctx.scanGlobalKeys();
+                BRANCH();
+
+            INSTRUCTION(FIRST_GLOBAL_KEY)
+                ctx.startGlobalKeys();
+                matched = ctx.scanGlobalKeys();
+                BRANCH();
 
-            case LOCAL_KEY:
+            // If the key isn't found, pTag_ doesn't point to a tag,
+            // so the fused key ops only load the value if it is
+
+            INSTRUCTION(GLOBAL_KEY_CODE)
+                matched = ctx.scanGlobalKeys() && ctx.loadCode(codeValue);
+                BRANCH();
+
+            INSTRUCTION(FIRST_GLOBAL_KEY_CODE)
+                ctx.startGlobalKeys();
+                matched = ctx.scanGlobalKeys() && ctx.loadCode(codeValue);
+                BRANCH();
+
+            INSTRUCTION(GLOBAL_KEY_EQ_CODE)
+                matched = ctx.scanGlobalKeys() && ctx.loadCode(codeValue) &&
+                    codeValue == ctx.ip_.getUnsignedShort();
+                ctx.ip_ += 2;
+                BRANCH();
+
+            INSTRUCTION(FIRST_GLOBAL_KEY_EQ_CODE)
+                ctx.startGlobalKeys();
+                matched = ctx.scanGlobalKeys() && ctx.loadCode(codeValue) &&
+                    codeValue == ctx.ip_.getUnsignedShort();
+                ctx.ip_ += 2;
+                BRANCH();
+
+            INSTRUCTION(LOCAL_KEY)
                 if (ctx.tagKey_ & 4)
                 {
                     // We're at last tag --> match failed 
@@ -213,9 +356,9 @@ int MatcherEngine::accept(const Matcher* matcher, FeaturePtr pFeature)
                 {
                     matched = ctx.scanLocalKeys();
                 }
-                break;
+                BRANCH();
 
-            case FIRST_LOCAL_KEY:
+            INSTRUCTION(FIRST_LOCAL_KEY)
                 assert(reinterpret_cast<uintptr_t>(ctx.pTagTable_) & 1); // must have local-keys flag
                 ctx.pTag_ = ctx.pTagTable_ - 5;    // position pTag_ to first key (at -4, but
                                                    // the local_keys flag is set (1), so -5  
@@ -223,94 +366,59 @@ int MatcherEngine::accept(const Matcher* matcher, FeaturePtr pFeature)
                                                    // is negative because valueOfs_ is *subtracted*
                                                    // from pTag_ (but local key/values are laid out
                                                    // in reverse)       
+                ctx.tagKey_ = 0;                   // clear last-tag flag, in case the key
+                                                   // isn't found and LOCAL_KEY comes next
                 matched = ctx.scanLocalKeys();
-                break;
+                BRANCH();
 
-            case HAS_LOCAL_KEYS:
+            INSTRUCTION(HAS_LOCAL_KEYS)
                 matched = reinterpret_cast<uintptr_t>(ctx.pTagTable_) & 1;    // test local-keys flag
-                break;
+                BRANCH();
 
-            case LOAD_CODE:
-                codeValue = ctx.pTag_.getUnsignedShort(-ctx.valueOfs_); // TODO: decide on sign
-                matched = ((ctx.tagKey_ & 3) == 1);
+            INSTRUCTION(LOAD_CODE)
+                matched = ctx.loadCode(codeValue);
                 assert(!matched || matcher->store()->strings().isValidCode(codeValue));
-                break;
+                BRANCH();
 
-            case LOAD_STRING:
-            {
-                // A local-string value is stored as a 4-byte value (wide string)
-                // which represents an offset that, when added to the location
-                // of the value, yields a pointer to a local string.
-                // We can only read a 4-byte value from the value location if the
-                // value is, in fact, a wide value, because the GOL spec does not
-                // guarantee that memory can legally be read at (pVal + 2) if the
-                // value is narrow. Hence, we read the value as two 16-bit values,
-                // reading the upper half at pVal+2 if wide-string, or at pVal+0
-                // if any other type. This pointer arithmetic avoids a branch.
-                // The resulting pointer may therefore be invalid, but we are only 
-                // dereferencing it if the wide-string check succeeds
-
-                // TODO: Can simplify this
-                //  Tile data in GOL 2.0 is followed by a 4-byte checksum,
-                //   so we can safely read up to 4 bytes past the end of
-                //   a tagtable
-                pointer pVal = ctx.pTag_ - (int)ctx.valueOfs_;
-                matched = ((ctx.tagKey_ & 3) == 3);      // wide string
-                int32_t rel = pVal.getUnsignedShort();   // read lower half
-                rel |= (pVal + matched * 2).getShort() << 16;
-                // read upper half (or lower again if this isn't a wide-string value)
-                stringValue = pVal.asBytePointer() + rel;
-                // The resulting string pointer (may be invalid, but instructions
-                // will only use it if matched==1)
-            }
-            break;
+            INSTRUCTION(LOAD_STRING)
+                matched = ctx.loadString(stringValue);
+                BRANCH();
 
-            case LOAD_NUM:
-            {
-                int type = (ctx.tagKey_ & 3);
-                if (type == 0)      // narrow number
-                {
-                    pointer pVal = ctx.pTag_ - (int)ctx.valueOfs_;
-                    doubleValue = ((int32_t)pVal.getUnsignedShort()) + TagValues::MIN_NUMBER;
-                    matched = 1;
-                }
-                else if (type == 2) // wide number
-                {
-                    pointer pVal = ctx.pTag_ - (int)ctx.valueOfs_;
-                    doubleValue = TagValues::doubleFromWideNumber(pVal.getUnsignedInt());
-                    matched = 1;
-                }
-                else
-                {
-                    matched = 0;
-                }
-            }
-            break;
+            INSTRUCTION(LOAD_NUM)
+                matched = ctx.loadNumber(doubleValue);
+                BRANCH();
 
-            case CODE_TO_STR:
+            INSTRUCTION(CODE_TO_STR)
                 stringValue = matcher->store()->strings()
                     .getGlobalString(codeValue)->rawBytes();
                 // Cannot fail, therefore does not branch
-                continue;
+                NEXT_INSTRUCTION();
 
-            case STR_TO_NUM:
+            INSTRUCTION(STR_TO_NUM)
                 matched = Math::parseDouble(asStringView(stringValue), &doubleValue);
-                break;
+                BRANCH();
 
-            case FEATURE_TYPE:
+            INSTRUCTION(CODE_TO_NUM)
+                // NaN if the global string isn't a number
+                doubleValue = matcher->store()->strings().getNumber(codeValue);
+                matched = !std::isnan(doubleValue);
+                BRANCH();
+
+            INSTRUCTION(FEATURE_TYPE)
             {
                 FeatureTypes types(ctx.getFeatureTypeOperand());
                 matched = (int)types.acceptFlags(pFeature.flags());
             }
-            break;
+            BRANCH();
 
-            case GOTO:
+            INSTRUCTION(GOTO)
                 ctx.ip_ += ctx.ip_.getShort();
-                continue;
+                NEXT_INSTRUCTION();
 
-            case RETURN:
+            INSTRUCTION(RETURN)
                 return op >> 8;
 
+#ifndef GEODESK_MATCHER_COMPUTED_GOTO
             default:
 #ifdef _DEBUG
                 assert(false);
@@ -329,6 +437,392 @@ int MatcherEngine::accept(const Matcher* matcher, FeaturePtr pFeature)
         matched ^= isNegated(op);
         ctx.jumpIf(matched);
     }
+#endif
+}
+
+#undef INSTRUCTION
+#undef NEXT_INSTRUCTION
+#undef BRANCH
+
+
+// ---- Batch evaluation ----
+
+/// The state of the matcher for a single feature of a batch
+///
+struct MatcherEngine::Lane
+{
+    MatcherEngine ctx;
+    uint32_t codeValue;
+    const uint8_t* stringValue;
+    double doubleValue;
+};
+
+// Evaluates the condition of a branching instruction for each lane
+// of the current group, in the same way as the corresponding handler
+// in accept() does for a single feature (but without negation)
+#define FOR_EACH_LANE(...)                                          \
+    do                                                              \
+    {                                                               \
+        uint64_t remaining = current;                               \
+        do                                                          \
+        {                                                           \
+            int i = Bits::countTrailingZerosInNonZero(remaining);   \
+            [[maybe_unused]] Lane& lane = lanes[i];                 \
+            int matched;                                            \
+            __VA_ARGS__;                                            \
+            passed |= static_cast<uint64_t>(matched) << i;          \
+            remaining &= remaining - 1;                             \
+        }                                                           \
+        while (remaining);                                          \
+    }                                                               \
+    while (0)
+
+/// Runs the bytecode for a batch of features at once. Instead of
+/// taking each feature through the entire program, we execute each
+/// instruction for all features that have reached it (decoding its
+/// operands only once), and then split them into two groups based
+/// on the outcome (typically, most features are rejected after their
+/// first key has been checked). Groups that are waiting for their
+/// turn are merged if they continue at the same instruction.
+///
+size_t MatcherEngine::acceptBatch(const Matcher* matcher,
+    const FeaturePtr* features, size_t count, FeaturePtr* accepted)
+{
+    assert(count > 0 && count <= BATCH_SIZE);
+
+    struct Group
+    {
+        const uint8_t* ip;
+        uint64_t lanes;
+    };
+
+    Lane lanes[BATCH_SIZE];
+    Group pending[BATCH_SIZE];
+        // Groups are disjoint, so there can't be more than one per lane
+    int pendingCount = 0;
+    uint64_t acceptedLanes = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        lanes[i].ctx.pTagTable_ = (features[i].ptr() + 8).follow();
+    }
+    pointer ip(reinterpret_cast<const uint8_t*>(matcher) + sizeof(Matcher));
+    uint64_t current = (count == BATCH_SIZE) ? ~0ULL : (1ULL << count) - 1;
+
+    for (;;)
+    {
+        int op = ip.getUnsignedShort();
+        MatcherEngine operands;     // only used to decode the operands
+        operands.ip_ = ip + 2;
+        uint64_t passed = 0;
+        switch (op & 0xff)
+        {
+        case NOP:
+            ip = operands.ip_;
+            continue;
+
+        case GOTO:
+            ip = operands.ip_ + operands.ip_.getShort();
+            continue;
+
+        case CODE_TO_STR:
+        {
+            const StringTable& strings = matcher->store()->strings();
+            uint64_t remaining = current;
+            do
+            {
+                Lane& lane = lanes[Bits::countTrailingZerosInNonZero(remaining)];
+                lane.stringValue = strings.getGlobalString(lane.codeValue)->rawBytes();
+                remaining &= remaining - 1;
+            }
+            while (remaining);
+            ip = operands.ip_;
+            continue;
+        }
+
+        case RETURN:
+            if (op >> 8) acceptedLanes |= current;
+            if (pendingCount == 0) break;
+            pendingCount--;
+            ip = pending[pendingCount].ip;
+            current = pending[pendingCount].lanes;
+            continue;
+
+        case EQ_CODE:
+        {
+            uint16_t code = operands.ip_.getUnsignedShort();
+            operands.ip_ += 2;
+            FOR_EACH_LANE(matched = (lane.codeValue == code));
+            break;
+        }
+
+        case EQ_STR:
+        {
+            std::string_view str = operands.getStringOperand();
+            FOR_EACH_LANE(matched = (geodesk::StringValue(lane.stringValue) == str));
+            break;
+        }
+
+        case STARTS_WITH:
+        {
+            std::string_view str = operands.getStringOperand();
+            FOR_EACH_LANE(matched = asStringView(lane.stringValue).starts_with(str));
+            break;
+        }
+
+        case ENDS_WITH:
+        {
+            std::string_view str = operands.getStringOperand();
+            FOR_EACH_LANE(matched = asStringView(lane.stringValue).ends_with(str));
+            break;
+        }
+
+        case CONTAINS:
+        {
+            std::string_view str = operands.getStringOperand();
+            FOR_EACH_LANE(matched = asStringView(lane.stringValue).find(str)
+                != std::string_view::npos);
+            break;
+        }
+
+        case REGEX:
+        {
+            const Regex* regex = operands.getRegexOperand();
+            FOR_EACH_LANE(matched = regex->match(asStringView(lane.stringValue)));
+            break;
+        }
+
+        case EQ_NUM:
+        {
+            double d = operands.getDoubleOperand();
+            FOR_EACH_LANE(matched = (lane.doubleValue == d));
+            break;
+        }
+
+        case LE:
+        {
+            double d = operands.getDoubleOperand();
+            FOR_EACH_LANE(matched = (lane.doubleValue <= d));
+            break;
+        }
+
+        case LT:
+        {
+            double d = operands.getDoubleOperand();
+            FOR_EACH_LANE(matched = (lane.doubleValue < d));
+            break;
+        }
+
+        case GE:
+        {
+            double d = operands.getDoubleOperand();
+            FOR_EACH_LANE(matched = (lane.doubleValue >= d));
+            break;
+        }
+
+        case GT:
+        {
+            double d = operands.getDoubleOperand();
+            FOR_EACH_LANE(matched = (lane.doubleValue > d));
+            break;
+        }
+
+        case IN_RANGE:
+        {
+            const double* bounds = operands.getDoubleRangeOperand();
+            double min = bounds[0];
+            double max = bounds[1];
+            FOR_EACH_LANE(matched = (lane.doubleValue >= min) & (lane.doubleValue <= max));
+            break;
+        }
+
+        case CODE_IN_SET:
+        {
+            const CodeSet* codeSet = operands.getCodeSetOperand();
+            FOR_EACH_LANE(matched = codeSet->contains(lane.codeValue));
+            break;
+        }
+
+        case GLOBAL_KEY:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                matched = lane.ctx.scanGlobalKeys());
+            operands.ip_ += 2;
+            break;
+
+        case FIRST_GLOBAL_KEY:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                lane.ctx.startGlobalKeys();
+                matched = lane.ctx.scanGlobalKeys());
+            operands.ip_ += 2;
+            break;
+
+        case GLOBAL_KEY_CODE:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                matched = lane.ctx.scanGlobalKeys() &&
+                    lane.ctx.loadCode(lane.codeValue));
+            operands.ip_ += 2;
+            break;
+
+        case FIRST_GLOBAL_KEY_CODE:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                lane.ctx.startGlobalKeys();
+                matched = lane.ctx.scanGlobalKeys() &&
+                    lane.ctx.loadCode(lane.codeValue));
+            operands.ip_ += 2;
+            break;
+
+        case GLOBAL_KEY_EQ_CODE:
+        {
+            uint16_t code = (operands.ip_ + 2).getUnsignedShort();
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                matched = lane.ctx.scanGlobalKeys() &&
+                    lane.ctx.loadCode(lane.codeValue) &&
+                    lane.codeValue == code);
+            operands.ip_ += 4;
+            break;
+        }
+
+        case FIRST_GLOBAL_KEY_EQ_CODE:
+        {
+            uint16_t code = (operands.ip_ + 2).getUnsignedShort();
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                lane.ctx.startGlobalKeys();
+                matched = lane.ctx.scanGlobalKeys() &&
+                    lane.ctx.loadCode(lane.codeValue) &&
+                    lane.codeValue == code);
+            operands.ip_ += 4;
+            break;
+        }
+
+        case LOCAL_KEY:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                // If we're at the last tag, the match fails
+                matched = (lane.ctx.tagKey_ & 4) ? 0 : lane.ctx.scanLocalKeys());
+            operands.ip_ += 2;
+            break;
+
+        case FIRST_LOCAL_KEY:
+            FOR_EACH_LANE(
+                lane.ctx.ip_ = operands.ip_;
+                lane.ctx.pTag_ = lane.ctx.pTagTable_ - 5;   // see accept()
+                lane.ctx.valueOfs_ = -4;
+                lane.ctx.tagKey_ = 0;
+                matched = lane.ctx.scanLocalKeys());
+            operands.ip_ += 2;
+            break;
+
+        case HAS_LOCAL_KEYS:
+            FOR_EACH_LANE(matched = reinterpret_cast<uintptr_t>(lane.ctx.pTagTable_) & 1);
+            break;
+
+        case LOAD_CODE:
+            FOR_EACH_LANE(matched = lane.ctx.loadCode(lane.codeValue));
+            break;
+
+        case LOAD_STRING:
+            FOR_EACH_LANE(matched = lane.ctx.loadString(lane.stringValue));
+            break;
+
+        case LOAD_NUM:
+            FOR_EACH_LANE(matched = lane.ctx.loadNumber(lane.doubleValue));
+            break;
+
+        case STR_TO_NUM:
+            FOR_EACH_LANE(matched = Math::parseDouble(
+                asStringView(lane.stringValue), &lane.doubleValue));
+            break;
+
+        case CODE_TO_NUM:
+        {
+            const double* numbers = matcher->store()->strings().numbers();
+            FOR_EACH_LANE(
+                lane.doubleValue = numbers[lane.codeValue];
+                matched = !std::isnan(lane.doubleValue));
+            break;
+        }
+
+        case FEATURE_TYPE:
+        {
+            FeatureTypes types(operands.getFeatureTypeOperand());
+            FOR_EACH_LANE(matched = (int)types.acceptFlags(features[i].flags()));
+            break;
+        }
+
+        default:
+            assert(false);
+            break;
+        }
+
+        if ((op & 0xff) == RETURN) break;     // no more pending groups
+
+        // operands.ip_ now points to the jump offset
+        if (isNegated(op)) passed ^= current;
+        uint64_t failed = current & ~passed;
+        pointer ifTrue = operands.ip_ + operands.ip_.getShort();
+        pointer ifFalse = operands.ip_ + 2;
+        if (passed == 0)
+        {
+            ip = ifFalse;
+        }
+        else if (failed == 0)
+        {
+            ip = ifTrue;
+        }
+        else
+        {
+            // Continue with the features that failed, and defer the
+            // others (unless another group is already waiting at the
+            // same instruction, in which case they join that group)
+            int i = 0;
+            for (; i < pendingCount; i++)
+            {
+                if (pending[i].ip == ifTrue.asBytePointer())
+                {
+                    pending[i].lanes |= passed;
+                    break;
+                }
+            }
+            if (i == pendingCount)
+            {
+                pending[pendingCount++] = { ifTrue.asBytePointer(), passed };
+            }
+            ip = ifFalse;
+            current = failed;
+        }
+    }
+
+    size_t acceptedCount = 0;
+    while (acceptedLanes)
+    {
+        accepted[acceptedCount++] = features[
+            Bits::countTrailingZerosInNonZero(acceptedLanes)];
+        acceptedLanes &= acceptedLanes - 1;
+    }
+    return acceptedCount;
+}
+
+#undef FOR_EACH_LANE
+
+size_t MatcherEngine::acceptMany(const Matcher* matcher,
+    const FeaturePtr* features, size_t count, FeaturePtr* accepted)
+{
+    size_t acceptedCount = 0;
+    while (count)
+    {
+        size_t batchSize = std::min(count, BATCH_SIZE);
+        acceptedCount += acceptBatch(matcher, features, batchSize,
+            accepted + acceptedCount);
+        features += batchSize;
+        count -= batchSize;
+    }
+    return acceptedCount;
 }
 
 
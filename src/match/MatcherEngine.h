@@ -3,23 +3,52 @@
 
 #pragma once
 #include <cstdint>
-#include <regex>
 #include <string_view>
+#include <clarisma/text/Regex.h>
 #include <clarisma/util/pointer.h>
 #include <clarisma/util/ShortVarString.h>
 #include <geodesk/match/Matcher.h>
 
 namespace geodesk {
 
+struct CodeSet;
 
 class MatcherEngine
 {
 public:
 	static int accept(const Matcher*, FeaturePtr);
+	static size_t acceptMany(const Matcher*, const FeaturePtr* features,
+		size_t count, FeaturePtr* accepted);
 
 private:
+	struct Lane;
+
+	static constexpr size_t BATCH_SIZE = 64;	// one bit per feature
+
+	static size_t acceptBatch(const Matcher*, const FeaturePtr* features,
+		size_t count, FeaturePtr* accepted);
+
 	void jumpIf(int matched) { ip_ += matched ? ip_.getShort() : 2; }
 	inline int scanGlobalKeys();
+
+	// IN: pTagTable_; OUT: pTag_, valueOfs_
+	void startGlobalKeys()
+	{
+		pTag_ = clarisma::pointer(pTagTable_) & (uint64_t)~1;	// mask off the local-keys flag
+		valueOfs_ = -2;
+	}
+
+	// IN: pTag_, tagKey_, valueOfs_; OUT: codeValue
+	// Returns 1 if the current value is a global string
+	int loadCode(uint32_t& codeValue) const
+	{
+		codeValue = pTag_.getUnsignedShort(-valueOfs_); // TODO: decide on sign
+		return (tagKey_ & 3) == 1;
+	}
+
+	inline int loadString(const uint8_t*& stringValue) const;
+	inline int loadNumber(double& doubleValue) const;
+
 	int scanLocalKeys();	// inline not needed for this
 	static inline int isNegated(int op) { return (op >> 8) & 1; }
 		// TODO: Is negate the only flag? If so, no need for AND
@@ -31,7 +60,9 @@ private:
 		return val->toStringView();
 	}
 	inline double getDoubleOperand();
-	inline const std::regex* getRegexOperand();
+	inline const double* getDoubleRangeOperand();
+	inline const clarisma::Regex* getRegexOperand();
+	inline const CodeSet* getCodeSetOperand();
 	inline uint32_t getFeatureTypeOperand();
 
 	clarisma::pointer ip_;
@@ -2,6 +2,7 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include "MatcherParser.h"
+#include <regex>
 
 namespace geodesk {
 
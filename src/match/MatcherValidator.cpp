@@ -2,17 +2,23 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include "MatcherValidator.h"
+#include <geodesk/feature/KeySignature.h>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 
 namespace geodesk {
 
-MatcherValidator::MatcherValidator(OpGraph& graph) :
+MatcherValidator::MatcherValidator(OpGraph& graph, const StringTable& strings) :
 	graph_(graph),
+	strings_(strings),
 	totalInstructionWords_(0),
 	maxExtraGotos_(0),
 	regexCount_(0),
 	resourceSize_(0),
 	featureTypes_(0),
-	featureTypeOpCount_(0)
+	featureTypeOpCount_(0),
+	codeSetSize_(0)
 {
 }
 
@@ -23,7 +29,7 @@ OpNode* MatcherValidator::validate(Selector* firstSel)
 	while (pRegex)
 	{
 		regexCount_++;
-		resourceSize_ += (sizeof(std::regex) + 7) & 0xffff'fff8;
+		resourceSize_ += (sizeof(clarisma::Regex) + 7) & 0xffff'fff8;
 		pRegex = pRegex->next();
 	}
 
@@ -44,6 +50,7 @@ OpNode* MatcherValidator::validate(Selector* firstSel)
 
 	OpNode* root = validateAllSelectors(firstSel);
 	validateOp(root);
+	fuseOps(root);
 	return root;
 }
 
@@ -99,6 +106,7 @@ OpNode* MatcherValidator::validatePolyformSelectors(Selector* selectors)
 	}
 	while (selectors);
 	validateOp(root);
+	fuseOps(root);
 	return root;
 }
 
@@ -118,6 +126,18 @@ void MatcherValidator::validateOp(OpNode* node)
 		break;
 	case OperandType::STRING:
 		resourceSize_ += (node->operandLen + 2 + 7) & 0xffff'fff8;
+		if (op == Opcode::LOCAL_KEY || op == Opcode::FIRST_LOCAL_KEY)
+		{
+			resourceSize_ += sizeof(KeySignature);
+		}
+		break;
+	case OperandType::CODE_SET:
+		resourceSize_ += static_cast<uint32_t>(node->operand.codeSet->byteSize());
+		break;
+	case OperandType::CODE_PAIR:
+	case OperandType::DOUBLE_RANGE:
+		// Fused ops are only created by fuseOps(), after validation
+		assert(false);
 		break;
 	}
 	
@@ -142,6 +162,102 @@ void MatcherValidator::validateOp(OpNode* node)
 }
 
 
+/// Replaces the most common instruction sequences with superinstructions.
+/// This runs after validateOp(), so the instruction and resource sizes
+/// it has calculated become upper bounds (the superinstructions are
+/// always shorter than the instructions they replace, and use the
+/// same resources).
+///
+void MatcherValidator::fuseOps(OpNode* node)
+{
+	while (node && (node->flags & OpFlags::FUSED) == 0)
+	{
+		node->flags |= OpFlags::FUSED;
+		if (!fuseKeyOps(node)) fuseRangeOps(node);
+		fuseOps(node->next[0]);
+		node = node->next[1];
+	}
+}
+
+/// Checks whether `node` can be absorbed into the instruction that
+/// precedes it: It must have the given opcode, must not be negated,
+/// must have no other callers, and must fail to the same instruction
+/// as its predecessor.
+///
+bool MatcherValidator::isFusable(const OpNode* node, int opcode, const OpNode* falseOp)
+{
+	return node->opcode == opcode && !node->isNegated() &&
+		node->callerCount == 1 && node->next[0] == falseOp;
+}
+
+/// Fuses GLOBAL_KEY (or FIRST_GLOBAL_KEY) with the LOAD_CODE that
+/// follows it (and the EQ_CODE after that, if it is the only
+/// value to check), if all of them fail to the same instruction.
+///
+bool MatcherValidator::fuseKeyOps(OpNode* node)
+{
+	if (node->opcode != Opcode::GLOBAL_KEY &&
+		node->opcode != Opcode::FIRST_GLOBAL_KEY) return false;
+	if (node->isNegated()) return false;
+	OpNode* falseOp = node->next[0];
+	OpNode* loadOp = node->next[1];
+	if (!isFusable(loadOp, Opcode::LOAD_CODE, falseOp)) return false;
+
+	bool first = node->opcode == Opcode::FIRST_GLOBAL_KEY;
+	OpNode* valueOp = loadOp->next[1];
+	if (isFusable(valueOp, Opcode::EQ_CODE, falseOp))
+	{
+		node->opcode = first ? Opcode::FIRST_GLOBAL_KEY_EQ_CODE :
+			Opcode::GLOBAL_KEY_EQ_CODE;
+		node->operand2.code = valueOp->operand.code;
+		node->next[1] = valueOp->next[1];
+		falseOp->callerCount -= 2;
+	}
+	else
+	{
+		node->opcode = first ? Opcode::FIRST_GLOBAL_KEY_CODE :
+			Opcode::GLOBAL_KEY_CODE;
+		node->next[1] = valueOp;
+		falseOp->callerCount--;
+	}
+	return true;
+}
+
+/// Fuses a lower-bound and an upper-bound comparison of the same
+/// number (e.g. `[maxspeed>=30][maxspeed<60]`) into a single IN_RANGE
+/// check. Exclusive bounds are turned into inclusive ones by moving
+/// them to the adjacent double; this is exact for finite bounds.
+///
+bool MatcherValidator::fuseRangeOps(OpNode* node)
+{
+	int opcode = node->opcode;
+	if (opcode < Opcode::LE || opcode > Opcode::GT) return false;
+	if (node->isNegated()) return false;
+	OpNode* falseOp = node->next[0];
+	OpNode* other = node->next[1];
+	bool isLower = opcode >= Opcode::GE;
+	int otherOpcode = other->opcode;
+	if (otherOpcode < Opcode::LE || otherOpcode > Opcode::GT) return false;
+	if ((otherOpcode >= Opcode::GE) == isLower) return false;
+	if (!isFusable(other, otherOpcode, falseOp)) return false;
+
+	const OpNode* lowerOp = isLower ? node : other;
+	const OpNode* upperOp = isLower ? other : node;
+	double lower = lowerOp->operand.number;
+	double upper = upperOp->operand.number;
+	if (!std::isfinite(lower) || !std::isfinite(upper)) return false;
+	if (lowerOp->opcode == Opcode::GT) lower = std::nextafter(lower, INFINITY);
+	if (upperOp->opcode == Opcode::LT) upper = std::nextafter(upper, -INFINITY);
+
+	node->opcode = Opcode::IN_RANGE;
+	node->operand.number = lower;
+	node->operand2.number = upper;
+	node->next[1] = other->next[1];
+	falseOp->callerCount--;
+	return true;
+}
+
+
 OpNode* MatcherValidator::findWrongTypeOp(OpNode* firstValueOp)
 {
 	OpNode* wrongTypeOp = firstValueOp;
@@ -155,7 +271,7 @@ OpNode* MatcherValidator::findWrongTypeOp(OpNode* firstValueOp)
 /**
  * Inserts and links up LOAD_CODE, LOAD_STR or LOAD_NUM as needed based
  * on the operand types of the value ops (summarized in flags). Also
- * inserts CODE_TO_STR and STR_TO_NUM, if needed.
+ * inserts CODE_TO_STR, STR_TO_NUM and CODE_TO_NUM, if needed.
  */
 void MatcherValidator::insertLoadOps(TagClause* clause)
 {
@@ -184,12 +300,13 @@ void MatcherValidator::insertLoadOps(TagClause* clause)
 	{
 		// For numeric ops, create a chain that first checks for
 		// number, then wide string (converting string to num),
-		// and finally code (converting first to string, then to num)
+		// and finally code (looking up its pre-parsed number)
 
 		OpNode* strToNumOp = graph_.newOp(Opcode::STR_TO_NUM, wrongTypeOp, firstValueOp);
-		OpNode* codeToStrOp = graph_.newOp(Opcode::CODE_TO_STR, strToNumOp, nullptr);
-		OpNode* loadCodeOp = graph_.newOp(Opcode::LOAD_CODE, wrongTypeOp, codeToStrOp);
+		OpNode* codeToNumOp = graph_.newOp(Opcode::CODE_TO_NUM, wrongTypeOp, firstValueOp);
+		OpNode* loadCodeOp = graph_.newOp(Opcode::LOAD_CODE, wrongTypeOp, codeToNumOp);
 		OpNode* loadStringOp = graph_.newOp(Opcode::LOAD_STRING, loadCodeOp, strToNumOp);
+		strings_.numbers();		// make sure the engine can use getNumber()
 		loadOp = graph_.newOp(Opcode::LOAD_NUM, loadStringOp, firstValueOp);
 	}
 	else
@@ -239,25 +356,112 @@ OpNode* MatcherValidator::createMultiTypeLoadOps(uint32_t valueFlags, OpNode* va
 			TagClause::VALUE_ANY_STRING | TagClause::VALUE_ANY_NUMBER));
 		if (op->isValueOp())
 		{
+			OpNode* wrongTypeOp = findWrongTypeOp(op);
+				// must look for it before createCodeSetOps() turns
+				// the value ops into non-value ops
+			bool needsString = (valueFlags & TagClause::VALUE_ANY_STRING) &&
+				createCodeSetOps(op);
 			if (valueFlags & TagClause::VALUE_ANY_NUMBER)
 			{
-				op = graph_.newOp(Opcode::STR_TO_NUM, op, op);
+				op = graph_.newOp(Opcode::CODE_TO_NUM, op, op);
 				// If string is not a number, the double value will be NaN;
 				// for simplicity, we can continue to value checks in both
 				// false and true case
+				strings_.numbers();
 			}
-			if (valueFlags & (TagClause::VALUE_ANY_STRING | TagClause::VALUE_ANY_NUMBER))
+			if (needsString)
 			{
 				op = graph_.newOp(Opcode::CODE_TO_STR, op, nullptr);
 			}
 			nextOp = graph_.newOp(Opcode::LOAD_CODE, 
-				nextOp ? nextOp : findWrongTypeOp(op), op);
+				nextOp ? nextOp : wrongTypeOp, op);
 		}
 	}
 	assert(nextOp);		// At least one suitable op must have been found
 	return nextOp;
 }
 
+/**
+ * Replaces the string tests (STARTS_WITH, ENDS_WITH, CONTAINS and REGEX)
+ * in a tree of value ops that only applies to global strings with
+ * CODE_IN_SET, which looks up the value's code in the set of global
+ * strings that pass the test (precomputed from the GOL's string table).
+ * Returns true if any of the value ops still needs the string itself
+ * (because its code set would have been too large).
+ */
+bool MatcherValidator::createCodeSetOps(OpNode* node)
+{
+	if (!node->isValueOp()) return false;
+	bool needsString = false;
+	if (node->opcode >= Opcode::STARTS_WITH && node->opcode <= Opcode::REGEX)
+	{
+		const CodeSet* codeSet = createCodeSet(node);
+		if (codeSet)
+		{
+			node->opcode = Opcode::CODE_IN_SET;
+			node->operand.codeSet = codeSet;
+			node->operandLen = 0;
+		}
+		else
+		{
+			needsString = true;
+		}
+	}
+	needsString |= createCodeSetOps(node->next[0]);
+	needsString |= createCodeSetOps(node->next[1]);
+	return needsString;
+}
+
+/**
+ * Evaluates a string test against every global string. Returns the set
+ * of codes of all strings that pass, or nullptr if the combined size of
+ * the code sets would exceed MAX_CODE_SET_SIZE.
+ */
+const CodeSet* MatcherValidator::createCodeSet(const OpNode* node)
+{
+	uint32_t count = strings_.stringCount();
+	CodeSet* codeSet = reinterpret_cast<CodeSet*>(graph_.arena().alloc(
+		CodeSet::byteSize(count), alignof(CodeSet)));
+	uint64_t* bits = codeSet->bits;
+	std::memset(bits, 0, (count + 63) / 64 * 8);
+
+	std::string_view operand(node->operand.string, node->operandLen);
+	uint32_t limit = 0;
+	for (uint32_t code = 0; code < count; code++)
+	{
+		std::string_view str = strings_.getGlobalString(code)->toStringView();
+		bool passed;
+		switch (node->opcode)
+		{
+		case Opcode::STARTS_WITH:
+			passed = str.starts_with(operand);
+			break;
+		case Opcode::ENDS_WITH:
+			passed = str.ends_with(operand);
+			break;
+		case Opcode::CONTAINS:
+			passed = str.find(operand) != std::string_view::npos;
+			break;
+		default:
+			assert(node->opcode == Opcode::REGEX);
+			passed = node->operand.regex->regex().match(str);
+			break;
+		}
+		if (passed)
+		{
+			bits[code >> 6] |= uint64_t(1) << (code & 63);
+			limit = code + 1;
+		}
+	}
+
+	size_t size = CodeSet::byteSize(limit);
+	if (codeSetSize_ + size > MAX_CODE_SET_SIZE) return nullptr;
+	codeSetSize_ += static_cast<uint32_t>(size);
+	codeSet->limit = limit;
+	codeSet->reserved = 0;
+	return codeSet;
+}
+
 /**
  * Creates a copy of the given value op, if it is suitable for acceptedValues.
  * If the value op does not apply, returns the op (or its copy, in case of a
@@ -419,10 +623,14 @@ OpNode* MatcherValidator::validateSelector(Selector* sel)
 			else
 			{
 				// We place the local-key check before the first local-key op
+				// (which has been copied into the true-op of the last
+				// global-key clause, so we need to move it)
 				assert(lastGlobalKeyClause);
 				assert(lastGlobalKeyClause->next);
-				lastGlobalKeyClause->trueOp.opcode = Opcode::HAS_LOCAL_KEYS;
-				lastGlobalKeyClause->trueOp.next[1] = &lastLocalKeyClause->trueOp;
+				OpNode* firstLocalKeyOp = graph_.copyOp(&lastGlobalKeyClause->trueOp);
+				new(&lastGlobalKeyClause->trueOp)OpNode(Opcode::HAS_LOCAL_KEYS);
+				lastGlobalKeyClause->trueOp.next[0] = &lastLocalKeyClause->trueOp;
+				lastGlobalKeyClause->trueOp.next[1] = firstLocalKeyOp;
 			}
 		}
 	}
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include <geodesk/feature/StringTable.h>
 #include "OpGraph.h"
 #include "Selector.h"
 #include "TagClause.h"
@@ -12,7 +13,7 @@ namespace geodesk {
 class MatcherValidator
 {
 public:
-	MatcherValidator(OpGraph& graph);
+	MatcherValidator(OpGraph& graph, const StringTable& strings);
 
 	OpNode* validate(Selector* firstSel);
 
@@ -26,6 +27,10 @@ public:
 
 private:
 	void validateOp(OpNode* node);
+	void fuseOps(OpNode* node);
+	static bool fuseKeyOps(OpNode* node);
+	static bool fuseRangeOps(OpNode* node);
+	static bool isFusable(const OpNode* node, int opcode, const OpNode* falseOp);
 
 	static OpNode* findWrongTypeOp(OpNode* firstValOp);
 	OpNode* validateAllSelectors(Selector* first);
@@ -38,14 +43,23 @@ private:
 	OpNode* createValueOps(const OpNode* keyOp, uint32_t acceptedValues);
 	OpNode* cloneValueOp(OpNode* valOp, uint32_t acceptedValues);
 	OpNode* cloneValueOps(const OpNode* valOps, uint32_t acceptedValues, OpNode* falseOp);  // TODO: remove
+	bool createCodeSetOps(OpNode* node);
+	const CodeSet* createCodeSet(const OpNode* node);
+
+	/// The maximum combined size of all code sets of a Matcher
+	/// (Operands are addressed via 16-bit offsets, so the resources
+	/// of a Matcher must be well below 64 KB)
+	static constexpr size_t MAX_CODE_SET_SIZE = 32 * 1024;
 
 	OpGraph& graph_;
+	const StringTable& strings_;
 	uint32_t totalInstructionWords_;
 	uint32_t maxExtraGotos_;
 	uint32_t regexCount_;
 	uint32_t resourceSize_;
 	FeatureTypes featureTypes_;
 	uint32_t featureTypeOpCount_;
+	uint32_t codeSetSize_;
 };
 
 } // namespace geodesk
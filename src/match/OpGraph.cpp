@@ -57,7 +57,14 @@ const char* OPCODE_NAMES[] =
 	"STR_TO_NUM",
 	"FEATURE_TYPE",
 	"GOTO",
-	"RETURN"
+	"RETURN",
+	"GLOBAL_KEY_CODE",
+	"FIRST_GLOBAL_KEY_CODE",
+	"GLOBAL_KEY_EQ_CODE",
+	"FIRST_GLOBAL_KEY_EQ_CODE",
+	"IN_RANGE",
+	"CODE_IN_SET",
+	"CODE_TO_NUM"
 };
 
 
@@ -87,7 +94,14 @@ uint8_t OPCODE_ARGS[] =
 	1, // STR_TO_NUM
 	3, // FEATURE_TYPE (2-word operand)
 	1, // GOTO
-	0  // RETURN (argument is stored in flags)
+	0, // RETURN (argument is stored in flags)
+	2, // GLOBAL_KEY_CODE
+	2, // FIRST_GLOBAL_KEY_CODE
+	3, // GLOBAL_KEY_EQ_CODE
+	3, // FIRST_GLOBAL_KEY_EQ_CODE
+	2, // IN_RANGE
+	2, // CODE_IN_SET
+	1  // CODE_TO_NUM
 };
 
 
@@ -117,9 +131,20 @@ OperandType OPCODE_OPERAND_TYPES[] =
 	OperandType::NONE, // STR_TO_NUM
 	OperandType::FEATURE_TYPES, // FEATURE_TYPE (2-word operand)
 	OperandType::NONE, // GOTO
-	OperandType::NONE  // RETURN (argument is stored in flags)
+	OperandType::NONE, // RETURN (argument is stored in flags)
+	OperandType::CODE, // GLOBAL_KEY_CODE
+	OperandType::CODE, // FIRST_GLOBAL_KEY_CODE
+	OperandType::CODE_PAIR, // GLOBAL_KEY_EQ_CODE
+	OperandType::CODE_PAIR, // FIRST_GLOBAL_KEY_EQ_CODE
+	OperandType::DOUBLE_RANGE, // IN_RANGE
+	OperandType::CODE_SET, // CODE_IN_SET
+	OperandType::NONE // CODE_TO_NUM
 };
 
+static_assert(sizeof(OPCODE_NAMES) / sizeof(OPCODE_NAMES[0]) == Opcode::OPCODE_COUNT);
+static_assert(sizeof(OPCODE_ARGS) / sizeof(OPCODE_ARGS[0]) == Opcode::OPCODE_COUNT);
+static_assert(sizeof(OPCODE_OPERAND_TYPES) / sizeof(OPCODE_OPERAND_TYPES[0]) == Opcode::OPCODE_COUNT);
+
 
 
 
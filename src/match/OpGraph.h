@@ -2,9 +2,9 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #pragma once
-#include <regex>
 #include <string_view>
 #include <clarisma/alloc/Arena.h>
+#include <clarisma/text/Regex.h>
 #include <geodesk/feature/FeatureTypes.h>
 #include <geodesk/feature/types.h>
 
@@ -48,6 +48,26 @@ enum Opcode
 	FEATURE_TYPE,		// 4-word instruction (opcode, int32, jump)
 	GOTO,
 	RETURN,
+
+	// Superinstructions, created by MatcherValidator::fuseOps()
+
+	GLOBAL_KEY_CODE,			// GLOBAL_KEY + LOAD_CODE
+	FIRST_GLOBAL_KEY_CODE,		// FIRST_GLOBAL_KEY + LOAD_CODE
+	GLOBAL_KEY_EQ_CODE,			// GLOBAL_KEY + LOAD_CODE + EQ_CODE
+	FIRST_GLOBAL_KEY_EQ_CODE,	// FIRST_GLOBAL_KEY + LOAD_CODE + EQ_CODE
+	IN_RANGE,					// GE/GT + LE/LT (bounds are inclusive)
+
+	// Created by MatcherValidator::createCodeSetOps()
+
+	CODE_IN_SET,				// STARTS_WITH, ENDS_WITH, CONTAINS or REGEX,
+								// precomputed for all global strings
+
+	// Created by MatcherValidator::insertLoadOps()
+
+	CODE_TO_NUM,				// CODE_TO_STR + STR_TO_NUM, using the numeric
+								// values pre-parsed by the StringTable
+
+	OPCODE_COUNT
 };
 
 enum OpFlags
@@ -55,6 +75,9 @@ enum OpFlags
 	/* Turns operation into a logical NOT */
 	NEGATE = 1 << 0,	
 
+	/* fuseOps() has looked at this operation */
+	FUSED = 1 << 10,
+
 	VALIDATED = 1 << 11,
 	/*
 	 *  
@@ -74,7 +97,10 @@ enum class OperandType : uint8_t
 	STRING,
 	DOUBLE,
 	REGEX,
-	FEATURE_TYPES
+	FEATURE_TYPES,
+	CODE_PAIR,			// key code and value code
+	DOUBLE_RANGE,		// two doubles (lower and upper bound)
+	CODE_SET			// a set of global-string codes
 };
 
 /*
@@ -94,14 +120,14 @@ class RegexOperand
 {
 public:
 	RegexOperand(const char* s, int len, RegexOperand* next)
-		: next_(next), regexResource_(nullptr), regex_(std::string(s, len)) {}
+		: next_(next), regexResource_(nullptr), regex_(std::string_view(s, len)) {}
 		// Must init next_ first to we have a valid chain in case
 		// regex constructor fails
 	
-	std::regex& regex()  { return regex_; }
+	clarisma::Regex& regex()  { return regex_; }
 	RegexOperand* next() { return next_; }
-	const std::regex* regexResource() const { return regexResource_; }
-	void setRegexResource(const std::regex* pRegex) { regexResource_ = pRegex; }
+	const clarisma::Regex* regexResource() const { return regexResource_; }
+	void setRegexResource(const clarisma::Regex* pRegex) { regexResource_ = pRegex; }
 
 private:
 	/**
@@ -113,14 +139,37 @@ private:
 	 * Pointer to the regex in the MatcherHolder. This is initially null
 	 * and will be assigned an address by the MatcherEmitter.
 	 */
-	const std::regex* regexResource_;
+	const clarisma::Regex* regexResource_;
 
 	/**
 	 * The compiled regex. Once parsing is successful, this regex will be
 	 * transferred to regexResource_ (using move construction) during
 	 * opcode generation. 
 	 */
-	std::regex regex_;
+	clarisma::Regex regex_;
+};
+
+/// A set of global-string codes, stored as a bitset. Only codes below
+/// `limit` can be members of the set, so the bitset only needs to be
+/// as long as required for the highest code in the set.
+///
+struct CodeSet
+{
+	uint32_t limit;
+	uint32_t reserved;
+	uint64_t bits[1];		// variable-length
+
+	static size_t byteSize(uint32_t limit)
+	{
+		return 8 + (limit + 63) / 64 * 8;
+	}
+
+	size_t byteSize() const { return byteSize(limit); }
+
+	bool contains(uint32_t code) const
+	{
+		return code < limit && ((bits[code >> 6] >> (code & 63)) & 1);
+	}
 };
 
 struct Operand
@@ -132,6 +181,7 @@ struct Operand
 		double        number;
 		RegexOperand* regex;
 		uint32_t      featureTypes;
+		const CodeSet* codeSet;
 	};
 };
 
@@ -143,6 +193,7 @@ struct OpNode
 	uint32_t address;
 	uint32_t callerCount;
 	Operand operand;
+	Operand operand2;	// only used by superinstructions
 	OpNode* next[2];
 
 	OpNode(int code)
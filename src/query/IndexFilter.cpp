@@ -0,0 +1,249 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/IndexFilter.h>
+#include <cstring>
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define GEODESK_INDEX_FILTER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define GEODESK_INDEX_FILTER_SSE2
+#endif
+
+namespace geodesk {
+
+namespace IndexFilter
+{
+    static int32_t readInt(const uint8_t* p)
+    {
+        int32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    /// Branchless test of a single entry
+    static uint32_t acceptBounds(const uint8_t* p, const Box& box)
+    {
+        return static_cast<uint32_t>(
+            (readInt(p) <= box.maxX()) &
+            (readInt(p + 4) <= box.maxY()) &
+            (readInt(p + 8) >= box.minX()) &
+            (readInt(p + 12) >= box.minY()));
+    }
+
+    static uint32_t acceptLeafFlags(int32_t flags,
+        uint32_t rejectedFlags, uint32_t acceptedTypes)
+    {
+        return static_cast<uint32_t>((flags & rejectedFlags) == 0) &
+            ((acceptedTypes >> ((flags >> 1) & 0x1f)) & 1);
+    }
+
+#if defined(GEODESK_INDEX_FILTER_AVX2) || defined(GEODESK_INDEX_FILTER_SSE2)
+
+    static __m128i load128(const uint8_t* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+#endif
+
+#if defined(GEODESK_INDEX_FILTER_AVX2)
+
+    /// Returns a mask of the 8 boxes (spaced `stride` bytes apart)
+    /// that intersect the query box
+    static uint32_t acceptBounds8(const uint8_t* p, int stride,
+        __m256i minX, __m256i minY, __m256i maxX, __m256i maxY)
+    {
+        // Entry i goes to the low lane, entry i+4 to the high lane
+        __m256i r0 = _mm256_set_m128i(load128(p + 4 * stride), load128(p));
+        __m256i r1 = _mm256_set_m128i(load128(p + 5 * stride), load128(p + stride));
+        __m256i r2 = _mm256_set_m128i(load128(p + 6 * stride), load128(p + 2 * stride));
+        __m256i r3 = _mm256_set_m128i(load128(p + 7 * stride), load128(p + 3 * stride));
+        __m256i t0 = _mm256_unpacklo_epi32(r0, r1);
+        __m256i t1 = _mm256_unpacklo_epi32(r2, r3);
+        __m256i t2 = _mm256_unpackhi_epi32(r0, r1);
+        __m256i t3 = _mm256_unpackhi_epi32(r2, r3);
+        __m256i reject = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpgt_epi32(_mm256_unpacklo_epi64(t0, t1), maxX),
+                _mm256_cmpgt_epi32(_mm256_unpackhi_epi64(t0, t1), maxY)),
+            _mm256_or_si256(
+                _mm256_cmpgt_epi32(minX, _mm256_unpacklo_epi64(t2, t3)),
+                _mm256_cmpgt_epi32(minY, _mm256_unpackhi_epi64(t2, t3))));
+        return static_cast<uint32_t>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(reject))) ^ 0xff;
+    }
+
+    uint32_t filterLeaf(const uint8_t* p, int count,
+        const Box& box, uint32_t rejectedFlags, uint32_t acceptedTypes)
+    {
+        __m256i minX = _mm256_set1_epi32(box.minX());
+        __m256i minY = _mm256_set1_epi32(box.minY());
+        __m256i maxX = _mm256_set1_epi32(box.maxX());
+        __m256i maxY = _mm256_set1_epi32(box.maxY());
+        __m256i rejected = _mm256_set1_epi32(static_cast<int32_t>(rejectedFlags));
+        __m256i types = _mm256_set1_epi32(static_cast<int32_t>(acceptedTypes));
+        __m256i typeMask = _mm256_set1_epi32(0x1f);
+        __m256i one = _mm256_set1_epi32(1);
+        __m256i zero = _mm256_setzero_si256();
+
+        uint32_t mask = 0;
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            const uint8_t* pEntry = p + i * 32;
+            uint32_t bits = acceptBounds8(pEntry, 32, minX, minY, maxX, maxY);
+            __m256i flags = _mm256_set_epi32(
+                readInt(pEntry + 7 * 32 + 16), readInt(pEntry + 6 * 32 + 16),
+                readInt(pEntry + 5 * 32 + 16), readInt(pEntry + 4 * 32 + 16),
+                readInt(pEntry + 3 * 32 + 16), readInt(pEntry + 2 * 32 + 16),
+                readInt(pEntry + 1 * 32 + 16), readInt(pEntry + 16));
+            __m256i typeOk = _mm256_and_si256(one, _mm256_srlv_epi32(types,
+                _mm256_and_si256(_mm256_srli_epi32(flags, 1), typeMask)));
+            __m256i ok = _mm256_and_si256(
+                _mm256_cmpeq_epi32(_mm256_and_si256(flags, rejected), zero),
+                _mm256_cmpeq_epi32(typeOk, one));
+            bits &= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(ok)));
+            mask |= bits << i;
+        }
+        for (; i < count; i++)
+        {
+            const uint8_t* pEntry = p + i * 32;
+            mask |= (acceptBounds(pEntry, box) &
+                acceptLeafFlags(readInt(pEntry + 16), rejectedFlags, acceptedTypes)) << i;
+        }
+        return mask;
+    }
+
+    uint32_t filterBranch(const uint8_t* p, int count, const Box& box)
+    {
+        __m256i minX = _mm256_set1_epi32(box.minX());
+        __m256i minY = _mm256_set1_epi32(box.minY());
+        __m256i maxX = _mm256_set1_epi32(box.maxX());
+        __m256i maxY = _mm256_set1_epi32(box.maxY());
+
+        uint32_t mask = 0;
+        int i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            mask |= acceptBounds8(p + i * 20 + 4, 20, minX, minY, maxX, maxY) << i;
+        }
+        for (; i < count; i++)
+        {
+            mask |= acceptBounds(p + i * 20 + 4, box) << i;
+        }
+        return mask;
+    }
+
+#elif defined(GEODESK_INDEX_FILTER_SSE2)
+
+    /// Returns a mask of the (up to 4) boxes that intersect the query
+    /// box. The boxes are given in rows (minX, minY, maxX, maxY),
+    /// which are transposed into columns
+    static int acceptBounds4(__m128i r0, __m128i r1, __m128i r2, __m128i r3,
+        __m128i minX, __m128i minY, __m128i maxX, __m128i maxY)
+    {
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1);    // minX0 minX1 minY0 minY1
+        __m128i t1 = _mm_unpacklo_epi32(r2, r3);    // minX2 minX3 minY2 minY3
+        __m128i t2 = _mm_unpackhi_epi32(r0, r1);    // maxX0 maxX1 maxY0 maxY1
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3);    // maxX2 maxX3 maxY2 maxY3
+        __m128i reject = _mm_or_si128(
+            _mm_or_si128(
+                _mm_cmpgt_epi32(_mm_unpacklo_epi64(t0, t1), maxX),
+                _mm_cmpgt_epi32(_mm_unpackhi_epi64(t0, t1), maxY)),
+            _mm_or_si128(
+                _mm_cmplt_epi32(_mm_unpacklo_epi64(t2, t3), minX),
+                _mm_cmplt_epi32(_mm_unpackhi_epi64(t2, t3), minY)));
+        return _mm_movemask_ps(_mm_castsi128_ps(reject)) ^ 0xf;
+    }
+
+    uint32_t filterLeaf(const uint8_t* p, int count,
+        const Box& box, uint32_t rejectedFlags, uint32_t acceptedTypes)
+    {
+        __m128i minX = _mm_set1_epi32(box.minX());
+        __m128i minY = _mm_set1_epi32(box.minY());
+        __m128i maxX = _mm_set1_epi32(box.maxX());
+        __m128i maxY = _mm_set1_epi32(box.maxY());
+
+        uint32_t mask = 0;
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const uint8_t* pEntry = p + i * 32;
+            uint32_t bits = static_cast<uint32_t>(acceptBounds4(
+                load128(pEntry), load128(pEntry + 32),
+                load128(pEntry + 64), load128(pEntry + 96),
+                minX, minY, maxX, maxY));
+            // SSE2 lacks per-lane variable shifts, so the flags are
+            // checked in scalar code (they share the cache lines of
+            // the bounding boxes, which we've just loaded)
+            bits &=
+                acceptLeafFlags(readInt(pEntry + 16), rejectedFlags, acceptedTypes) |
+                (acceptLeafFlags(readInt(pEntry + 48), rejectedFlags, acceptedTypes) << 1) |
+                (acceptLeafFlags(readInt(pEntry + 80), rejectedFlags, acceptedTypes) << 2) |
+                (acceptLeafFlags(readInt(pEntry + 112), rejectedFlags, acceptedTypes) << 3);
+            mask |= bits << i;
+        }
+        for (; i < count; i++)
+        {
+            const uint8_t* pEntry = p + i * 32;
+            mask |= (acceptBounds(pEntry, box) &
+                acceptLeafFlags(readInt(pEntry + 16), rejectedFlags, acceptedTypes)) << i;
+        }
+        return mask;
+    }
+
+    uint32_t filterBranch(const uint8_t* p, int count, const Box& box)
+    {
+        __m128i minX = _mm_set1_epi32(box.minX());
+        __m128i minY = _mm_set1_epi32(box.minY());
+        __m128i maxX = _mm_set1_epi32(box.maxX());
+        __m128i maxY = _mm_set1_epi32(box.maxY());
+
+        uint32_t mask = 0;
+        int i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            const uint8_t* pEntry = p + i * 20 + 4;
+            mask |= static_cast<uint32_t>(acceptBounds4(
+                load128(pEntry), load128(pEntry + 20),
+                load128(pEntry + 40), load128(pEntry + 60),
+                minX, minY, maxX, maxY)) << i;
+        }
+        for (; i < count; i++)
+        {
+            mask |= acceptBounds(p + i * 20 + 4, box) << i;
+        }
+        return mask;
+    }
+
+#else
+
+    uint32_t filterLeaf(const uint8_t* p, int count,
+        const Box& box, uint32_t rejectedFlags, uint32_t acceptedTypes)
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const uint8_t* pEntry = p + i * 32;
+            mask |= (acceptBounds(pEntry, box) &
+                acceptLeafFlags(readInt(pEntry + 16), rejectedFlags, acceptedTypes)) << i;
+        }
+        return mask;
+    }
+
+    uint32_t filterBranch(const uint8_t* p, int count, const Box& box)
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < count; i++)
+        {
+            mask |= acceptBounds(p + i * 20 + 4, box) << i;
+        }
+        return mask;
+    }
+
+#endif
+}
+
+} // namespace geodesk
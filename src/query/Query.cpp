@@ -2,23 +2,26 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/query/Query.h>
+#include <cassert>
 #include <clarisma/util/log.h>
-#include <geodesk/query/TileQueryTask.h>
+#include <geodesk/query/ExecutorTask.h>
 
 namespace geodesk {
 
 // #include <boost/asio.hpp>
 
 
+
 Query::Query(FeatureStore* store, const Box& box, FeatureTypes types,
-    const MatcherHolder* matcher, const Filter* filter) :
-    QueryBase(store, box, types, matcher, filter, &Query::consumeResults),
-    completedTiles_(0),
+    const MatcherHolder* matcher, const Filter* filter,
+    uint32_t limit, QueryStats* stats) :
+    QueryBase(store, box, types, matcher, filter, &Query::consumeResults,
+        QueryReduction::NONE, limit, stats),
     queuedResults_(QueryResults::EMPTY),
     pendingTiles_(0),
-    currentResults_(QueryResults::EMPTY),
     currentPos_(QueryResults::EMPTY->count),
-    allTilesRequested_(false)
+    currentResults_(QueryResults::EMPTY),
+    remainingResults_(limit ? limit : std::numeric_limits<uint64_t>::max())
 {
     /*
     // Don't add refcount to store, wrapper object is responsible for liveness
@@ -38,74 +41,73 @@ Query::Query(FeatureStore* store, const Box& box, FeatureTypes types,
 
 
 
-// TODO: use a flag that indicates that query finished, which makes the destructor
-//  more efficient
 Query::~Query()
 {
     // LOG("Destroying Query...");
-    while(pendingTiles_)
-    {
-        deleteResults(take());
-    }
-    deleteResults(currentResults_);
+    cancel();
+        // If the query was abandoned before all of its results were
+        // consumed, this makes the workers drop the remaining tiles
+        // instead of scanning them in full
     // LOG("Destroyed Query.");
 }
 
 
-void Query::deleteResults(const QueryResults* res)
-{
-    while(res != QueryResults::EMPTY)
-    {
-        QueryResults* next = res->next;
-        delete res;
-        res = next;
-    }
-}
-
-
+/// Called by a worker thread once it has completed a tile.
+/// `res` is the circular list of result buckets, pointing to the
+/// last bucket (or EMPTY if the tile had no results).
+///
 void Query::offer(QueryResults* res)
 {
-    // LOG("Putting fresh results into the queue...");
-    std::unique_lock lock(mutex_);
-    if (queuedResults_ == QueryResults::EMPTY)
-    {
-        queuedResults_ = res;
-    }
-    else if(res != QueryResults::EMPTY)
+    if(res != QueryResults::EMPTY)
     {
-        QueryResults* first = queuedResults_->next;
-        queuedResults_->next = res->next;
-        res->next = first;
-        queuedResults_ = res;
+        // Cut the circular list open and push it onto the stack
+        // as a linear chain, linking its last bucket to the old top
+        QueryResults* first = res->next;
+        QueryResults* top = queuedResults_.load(std::memory_order_relaxed);
+        do
+        {
+            res->next = top;
+        }
+        while (!queuedResults_.compare_exchange_weak(top, first,
+            std::memory_order_release, std::memory_order_relaxed));
     }
 
-    completedTiles_++;
-    resultsReady_.notify_one();
+    // Counting the tile publishes its results as well
+    countCompletedTile();
 }
 
 void Query::cancel()
 {
-    std::unique_lock lock(mutex_);
-    // TODO
+    if (pendingTiles_)
+    {
+        stop();
+        while (pendingTiles_)
+        {
+            recycler_.recycleAll(take());
+        }
+    }
+    allTilesRequested_ = true;
+    recycler_.recycleAll(currentResults_);
+    currentResults_ = QueryResults::EMPTY;
+    currentPos_ = QueryResults::EMPTY->count;
+    if (stats_) [[unlikely]] stats_->stop();
 }
 
+/// Takes the results of all tiles that have been completed since the
+/// last call, blocking if there are none (There must be at least one
+/// pending tile). The returned chain may be EMPTY if none of the tiles
+/// had any results.
+///
 const QueryResults* Query::take()
 {
-    // LOG("Taking next batch...");
-    std::unique_lock lock(mutex_);
-    while (completedTiles_ == 0)
-    {
-        resultsReady_.wait(lock);
-    }
-    QueryResults* res = queuedResults_;
-    queuedResults_ = QueryResults::EMPTY;
-    pendingTiles_ -= completedTiles_;
-    completedTiles_ = 0;
-
-    // Turn the circular list into a simple list ending with EMPTY
-    QueryResults* first = res->next;
-    res->next = QueryResults::EMPTY;
-    return first;
+    assert(pendingTiles_ > 0);
+    uint32_t completed = awaitCompletedTiles();
+    pendingTiles_ -= completed;
+
+    // This may pick up results of tiles that haven't been counted
+    // yet; that's fine, since we'll keep calling take() until all
+    // pending tiles have been accounted for
+    return queuedResults_.exchange(QueryResults::EMPTY, std::memory_order_acquire);
 }
 
 void Query::requestTiles()
@@ -146,57 +148,73 @@ void Query::requestTiles()
     }
     */
 
-    bool postedAny = false;
-    for (;;)
+    // Tiles are submitted in batches, so the executor's queue is touched
+    // (and idle workers are woken) only once per batch. We size each batch
+    // to the free space in the queue; if another thread fills the queue
+    // in the meantime, any tasks that weren't accepted are run on this
+    // thread (This is rare, and keeps the walker from having to back up)
+
+    ExecutorTask batch[MAX_BATCH_SIZE];
+    if (nested_) [[unlikely]]
     {
-        if(tileIndexWalker_.currentEntry().isLoadedAndCurrent()) [[likely]]
+        // We're running on a worker: scan the next tile ourselves,
+        // so next() has something to wait for
+        while (!allTilesRequested_)
         {
-            TileQueryTask task(this,
-                (tileIndexWalker_.currentTip() << 8) |
-                tileIndexWalker_.northwestFlags(),
-                FastFilterHint(tileIndexWalker_.turboFlags(), tileIndexWalker_.currentTile()));
-
-            // LOG("Trying to submit %06X...", tileIndexWalker_.currentTip());
-
-            if (!store_->executor().tryPost(task))
-            {
-                // If the queue is full and we haven't been able to
-                // post at least one task, we'll run the task on the main
-                // thread; otherwise, we'll end up waiting for a tile
-                // that will never arrive = deadlock
-
-                if (postedAny)  [[likely]]
-                {
-                    break;
-                }
-                pendingTiles_++;
-                // LOG("Running %06X on main thread...", tileIndexWalker_.currentTip());
-                task();
-            }
-            else
+            if (nextTiles(batch, 1))
             {
                 pendingTiles_++;
-                // LOG("  Submitted %06X", tileIndexWalker_.currentTip());
+                batch[0]();
+                break;
             }
-            postedAny = true;
         }
-        else
+        return;
+    }
+
+    auto& executor = store_->executor();
+    bool postedAny = false;
+    for (;;)
+    {
+        int room = maxPendingTiles_ - pendingTiles_;
+        if (room <= 0) break;
+            // We're at the cap on parallelism, which means there are
+            // tiles in flight (the cap is at least 1), so next() won't
+            // find the query exhausted
+        int capacity = std::min(executor.minimumRemainingCapacity(), room);
+        if (capacity <= 0)
         {
-            tileIndexWalker_.skipChildren();
+            // If the queue is full and we haven't been able to
+            // post at least one task, we'll run the task on the main
+            // thread; otherwise, we'll end up waiting for a tile
+            // that will never arrive = deadlock
+
+            if (postedAny) [[likely]] break;
+            capacity = 1;
         }
+        capacity = std::min(capacity, MAX_BATCH_SIZE);
 
-        if (!tileIndexWalker_.next())
+        int count = nextTiles(batch, capacity);
+        int posted = executor.tryPostBatch(batch, count);
+        pendingTiles_ += count;
+        for (int i = posted; i < count; i++)
         {
-            // LOG("All tiles submitted.");
-            allTilesRequested_ = true;
-            break;
+            // LOG("Running %06X on main thread...", tip);
+            batch[i]();
         }
+        postedAny |= count > 0;
+        if (allTilesRequested_ || posted < count) break;
     }
-    
 }
 
 FeaturePtr Query::next()
 {
+    if (remainingResults_ == 0) [[unlikely]]
+    {
+        // The caller has taken as many features as it asked for;
+        // the workers may have found a few more, which we drop
+        cancel();
+        return nullptr;
+    }
     for (;;)
     {
         if (currentPos_ == currentResults_->count)
@@ -204,7 +222,7 @@ FeaturePtr Query::next()
             // We're at the end of the current batch;
             // move on to the next
             QueryResults* next = currentResults_->next;
-            if (currentResults_ != QueryResults::EMPTY) delete currentResults_;
+            if (currentResults_ != QueryResults::EMPTY) recycler_.recycle(currentResults_);
             currentPos_ = 0;
             currentResults_ = next;
             if (next == QueryResults::EMPTY)
@@ -215,6 +233,7 @@ FeaturePtr Query::next()
                     if (pendingTiles_ == 0)
                     {
                         // There are no more tiles: We're done
+                        if (stats_) [[unlikely]] stats_->stop();
                         return nullptr;
                     }
                     const QueryResults* res = take();
@@ -233,6 +252,7 @@ FeaturePtr Query::next()
         }
         uint32_t item = currentResults_->items[currentPos_++];
         DataPtr pTile = currentResults_->pTile;
+        remainingResults_--;
         return FeaturePtr(pTile + item);
     }
 }
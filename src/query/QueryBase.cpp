@@ -0,0 +1,169 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/QueryBase.h>
+#include <thread>
+#include <geodesk/query/ExecutorTask.h>
+
+namespace geodesk {
+
+QueryBase::ParkingSpot QueryBase::parkingSpots_[PARKING_SPOT_COUNT];
+
+QueryBase::QueryBase(FeatureStore* store, const Box& box, FeatureTypes types,
+    const MatcherHolder* matcher, const Filter* filter,
+    QueryResultsConsumer consumer, QueryReduction reduction,
+    uint32_t limit, QueryStats* stats) :
+    store_(store),
+    types_(types),
+    matcher_(matcher),
+    filter_(filter),
+    consumer_(consumer),
+    reduction_(reduction),
+    allTilesRequested_(false),
+    nested_(store->executor().currentWorkerIndex() >= 0),
+    limit_(limit),
+    stats_(stats),
+    maxPendingTiles_(0),
+    tileIndexWalker_(store->tileIndex(), store->zoomLevels(), box, filter, stats),
+    tileStatistics_(nullptr),
+    statisticsCriteria_(),
+    precountedFeatures_(0),
+    stopped_(false),
+    remainingHits_(limit),
+    completedTiles_(0),
+    parkingSpot_(&parkingSpots_[(reinterpret_cast<uintptr_t>(this) >> 6)
+        % PARKING_SPOT_COUNT])
+{
+    setMaxParallelism(store->maxQueryParallelism());
+    if (stats) stats->reset(store->executor().threadCount());
+}
+
+
+int QueryBase::nextTiles(ExecutorTask* batch, int maxCount)
+{
+    if (isStopped())
+    {
+        // No point in scanning any more tiles
+        allTilesRequested_ = true;
+        return 0;
+    }
+    if (stats_) [[unlikely]]
+    {
+        QueryStats::Timer timer;
+        int count = walkTiles(batch, maxCount);
+        stats_->tilesVisited += count;
+        stats_->walkNanos += timer.stop();
+        return count;
+    }
+    return walkTiles(batch, maxCount);
+}
+
+
+int QueryBase::walkTiles(ExecutorTask* batch, int maxCount)
+{
+    int count = 0;
+    while (count < maxCount)
+    {
+        if(tileIndexWalker_.currentEntry().isLoadedAndCurrent()) [[likely]]
+        {
+            if (!tileStatistics_ || !countFromStatistics())
+            {
+                batch[count++] = TileQueryTask(this,
+                    (tileIndexWalker_.currentTip() << 8) |
+                    tileIndexWalker_.northwestFlags(),
+                    FastFilterHint(tileIndexWalker_.turboFlags(), tileIndexWalker_.currentTile()));
+            }
+        }
+        else
+        {
+            if (stats_) [[unlikely]] stats_->tilesMissing++;
+            tileIndexWalker_.skipChildren();
+        }
+        if (!tileIndexWalker_.next())
+        {
+            // LOG("All tiles submitted.");
+            allTilesRequested_ = true;
+            break;
+        }
+    }
+    return count;
+}
+
+
+/// If the current tile lies fully within the query's bounds (so its
+/// features cannot be rejected based on their location), adds its
+/// count to `precountedFeatures_`. Returns `false` if the tile must
+/// be scanned.
+///
+bool QueryBase::countFromStatistics()
+{
+    if (!bounds().contains(tileIndexWalker_.currentTile().bounds())) return false;
+    Tip tip = tileIndexWalker_.currentTip();
+    int64_t count = tileStatistics_->count(tip, store_->fetchTile(tip).revision(),
+        tileIndexWalker_.northwestFlags(), statisticsCriteria_);
+    if (count < 0) return false;
+    precountedFeatures_ += count;
+    if (stats_) [[unlikely]] stats_->tilesCounted++;
+    return true;
+}
+
+
+void QueryBase::countCompletedTile()
+{
+    // We must grab the parking spot *before* the count
+    // becomes visible
+    ParkingSpot* parkingSpot = parkingSpot_;
+    uint32_t prev = completedTiles_.fetch_add(1, std::memory_order_seq_cst);
+    if (prev & CONSUMER_WAITING)
+    {
+        parkingSpot->ticket.fetch_add(1, std::memory_order_seq_cst);
+        parkingSpot->ticket.notify_all();
+            // notify all, since other queries may share this spot
+    }
+}
+
+
+uint32_t QueryBase::awaitCompletedTiles()
+{
+    uint32_t completed = completedTiles_.exchange(0, std::memory_order_acquire);
+    if (completed) return completed;
+    if (stats_) [[unlikely]]
+    {
+        QueryStats::Timer timer;
+        completed = waitForCompletedTiles();
+        stats_->waitNanos += timer.stop();
+        return completed;
+    }
+    return waitForCompletedTiles();
+}
+
+
+uint32_t QueryBase::waitForCompletedTiles()
+{
+    uint32_t completed;
+    for (int i = 0; i < SPIN_COUNT; i++)
+    {
+        std::this_thread::yield();
+        completed = completedTiles_.exchange(0, std::memory_order_acquire);
+        if (completed) return completed;
+    }
+    for (;;)
+    {
+        // Park until a worker completes a tile. We take a ticket
+        // *before* announcing that we're waiting; any worker that
+        // sees the flag will bump the ticket, so we can't miss
+        // the wakeup
+        uint32_t ticket = parkingSpot_->ticket.load(std::memory_order_seq_cst);
+        uint32_t expected = 0;
+        if (completedTiles_.compare_exchange_strong(expected,
+            CONSUMER_WAITING, std::memory_order_seq_cst))
+        {
+            parkingSpot_->ticket.wait(ticket, std::memory_order_seq_cst);
+        }
+        completed = completedTiles_.exchange(0, std::memory_order_acquire)
+            & ~CONSUMER_WAITING;
+        if (completed) return completed;
+    }
+}
+
+} // namespace geodesk
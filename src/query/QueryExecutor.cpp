@@ -0,0 +1,222 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/QueryExecutor.h>
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <clarisma/thread/Threads.h>
+
+namespace geodesk {
+
+std::atomic<QueryExecutor::Pool*> QueryExecutor::pool_(nullptr);
+
+namespace {
+
+std::mutex& mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+QueryExecutor::Settings& settings()
+{
+    static QueryExecutor::Settings settings;
+    return settings;
+}
+
+} // namespace
+
+void QueryExecutor::configure(const Settings& newSettings)
+{
+    std::lock_guard lock(mutex());
+    if (isRunning())
+    {
+        throw std::logic_error("Query executor must be configured "
+            "before the first library is opened");
+    }
+    settings() = newSettings;
+}
+
+int QueryExecutor::defaultThreadCount()
+{
+#ifdef NDEBUG
+    int count = static_cast<int>(std::thread::hardware_concurrency());
+    return count > 0 ? count : 4;
+        // hardware_concurrency() returns 0 if the number of CPUs
+        // cannot be determined
+#else
+    return 1;       // run single-threaded in debug mode
+#endif
+}
+
+QueryExecutor::Pool& QueryExecutor::start()
+{
+    std::lock_guard lock(mutex());
+    Pool* pool = pool_.load(std::memory_order_acquire);
+    if (pool) return *pool;
+
+    const Settings& config = settings();
+    int threadCount = config.threadCount > 0 ?
+        config.threadCount : defaultThreadCount();
+    std::function<void(int)> threadInit;
+    if (!config.cpus.empty())
+    {
+        threadInit = [cpus = config.cpus](int index)
+        {
+            clarisma::Threads::setCurrentThreadAffinity(
+                cpus[static_cast<size_t>(index) % cpus.size()]);
+                // Pinning is only a hint; we carry on if it fails
+        };
+    }
+
+    // The pool is intentionally never destroyed: stores (and queries)
+    // may outlive other static objects, and joining threads during
+    // static destruction can deadlock if the library is unloaded as
+    // a DLL. The idle workers are parked, and end with the process.
+    pool = new Pool(threadCount, config.queueSize, std::move(threadInit));
+    pool_.store(pool, std::memory_order_release);
+    return *pool;
+}
+
+/// The items of a parallelFor() call, shared by the caller and its
+/// helpers. Each of them holds a reference; the caller's task lives
+/// on its stack, but is no longer called once all items are claimed.
+/// If a task throws, the remaining items are claimed (and counted as
+/// completed) at once, and the first exception is kept for the caller.
+///
+class ParallelJob
+{
+public:
+    ParallelJob(size_t count, void (*fn)(void*, size_t), void* context, int refcount) :
+        next_(0),
+        completed_(0),
+        refcount_(refcount),
+        failed_(false),
+        count_(count),
+        fn_(fn),
+        context_(context)
+    {
+    }
+
+    void work()
+    {
+        for (;;)
+        {
+            size_t i = next_.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count_) break;
+            size_t done = 1;
+            try
+            {
+                fn_(context_, i);
+            }
+            catch (...)
+            {
+                done += cancel(std::current_exception());
+            }
+            if (completed_.fetch_add(done, std::memory_order_acq_rel) + done == count_)
+            {
+                completed_.notify_all();
+            }
+        }
+    }
+
+    /// Waits until all items have been completed (Items claimed by
+    /// helpers are being worked on, so they are bound to complete)
+    ///
+    void await()
+    {
+        size_t completed;
+        while ((completed = completed_.load(std::memory_order_acquire)) < count_)
+        {
+            completed_.wait(completed, std::memory_order_acquire);
+        }
+    }
+
+    void release()
+    {
+        if (refcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+    }
+
+    /// The exception thrown by the first failed task (valid once
+    /// await() has returned)
+    ///
+    std::exception_ptr exception() const { return exception_; }
+
+private:
+    /// Records the exception (unless another task failed first) and
+    /// claims all unclaimed items, so no one starts another task.
+    /// Returns the number of items claimed.
+    ///
+    size_t cancel(std::exception_ptr ex)
+    {
+        if (!failed_.exchange(true, std::memory_order_relaxed))
+        {
+            exception_ = std::move(ex);
+                // published to the caller by the completed_ count
+        }
+        size_t claimed = next_.exchange(count_, std::memory_order_relaxed);
+        return claimed < count_ ? count_ - claimed : 0;
+    }
+
+    std::atomic<size_t> next_;
+    std::atomic<size_t> completed_;
+    std::atomic<int> refcount_;
+    std::atomic<bool> failed_;
+    size_t count_;
+    void (*fn_)(void*, size_t);
+    void* context_;
+    std::exception_ptr exception_;
+};
+
+void QueryExecutor::run(size_t count, int threadCount,
+    void (*fn)(void* context, size_t i), void* context)
+{
+    if (count <= 1 || threadCount == 1)
+    {
+        // Run serially, without starting the pool
+        for (size_t i = 0; i < count; i++) fn(context, i);
+        return;
+    }
+
+    Pool& pool = get();
+    if (threadCount <= 0) threadCount = pool.threadCount() + 1;
+    size_t helperCount = std::min({ static_cast<size_t>(threadCount - 1),
+        static_cast<size_t>(pool.threadCount()), count - 1 });
+
+    ParallelJob* job = new ParallelJob(count, fn, context,
+        static_cast<int>(helperCount) + 1);
+    std::vector<ExecutorTask> helpers(helperCount, ExecutorTask(job));
+    int posted = pool.tryPostBatch(helpers.data(), static_cast<int>(helperCount));
+    for (size_t i = posted; i < helperCount; i++) job->release();
+        // If the queue is full, we'll make do with fewer helpers
+    job->work();
+    job->await();
+        // Once all items are completed, no one calls the task anymore
+        // (Helpers that haven't run yet find nothing left to claim)
+    std::exception_ptr ex = job->exception();
+    job->release();
+    if (ex) std::rethrow_exception(ex);
+}
+
+void ExecutorTask::operator()()
+{
+    if (job_) [[unlikely]]
+    {
+        // A helper of a parallelFor() job
+        job_->work();
+        job_->release();
+        return;
+    }
+    tile_();
+}
+
+QueryExecutor::Stats QueryExecutor::stats()
+{
+    Pool* pool = pool_.load(std::memory_order_acquire);
+    return pool ? pool->stats() : Stats{};
+}
+
+} // namespace geodesk
@@ -0,0 +1,257 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/QueryResultsPool.h>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace geodesk {
+
+QueryResultsPool::SharedList QueryResultsPool::shared_[SIZE_CLASS_COUNT];
+std::atomic<uint64_t> QueryResultsPool::allocated_(0);
+std::atomic<uint64_t> QueryResultsPool::reused_(0);
+std::atomic<uint64_t> QueryResultsPool::recycled_(0);
+std::atomic<uint64_t> QueryResultsPool::discarded_(0);
+std::atomic<uint64_t> QueryResultsPool::trimmed_(0);
+
+/// The inboxes of a thread that allocates buckets. Homes are never
+/// freed; when a thread ends, its home is handed to the next thread
+/// that needs one. A consumer may still push buckets into the inbox
+/// of a thread that is just ending; these are picked up by the
+/// thread that adopts the home.
+///
+struct alignas(64) QueryResultsPool::Home
+{
+    SharedList inbox[SIZE_CLASS_COUNT];
+    std::atomic<bool> orphaned;
+
+    static Home* acquire()
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        std::vector<Home*>& spare = spareHomes();
+        if (spare.empty()) return new Home();
+        Home* home = spare.back();
+        spare.pop_back();
+        home->orphaned.store(false, std::memory_order_relaxed);
+        return home;
+    }
+
+    static void release(Home* home)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        spareHomes().push_back(home);
+    }
+
+private:
+    static std::mutex& registryMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static std::vector<Home*>& spareHomes()
+    {
+        static std::vector<Home*> homes;
+        return homes;
+    }
+};
+
+void QueryResultsPool::SharedList::push(QueryResults* first, QueryResults* last, int64_t n)
+{
+    QueryResults* top = head.load(std::memory_order_relaxed);
+    do
+    {
+        last->next = top;
+    }
+    while (!head.compare_exchange_weak(top, first,
+        std::memory_order_release, std::memory_order_relaxed));
+    count.fetch_add(n, std::memory_order_relaxed);
+}
+
+QueryResults* QueryResultsPool::SharedList::takeAll()
+{
+    if (head.load(std::memory_order_relaxed) == nullptr) return nullptr;
+    QueryResults* list = head.exchange(nullptr, std::memory_order_acquire);
+    count.store(0, std::memory_order_relaxed);
+        // We don't know how many we took; the count is only used to
+        // cap the size of the list, so an estimate suffices
+    return list;
+}
+
+/// Per-thread free lists and counters. Counters are published to the
+/// global totals in bulk, so the allocation path never touches a
+/// shared cache line unless the free list needs refilling.
+///
+struct QueryResultsPool::LocalCache
+{
+    Home* home = nullptr;
+    QueryResults* free[SIZE_CLASS_COUNT] = {};
+    int64_t freeCount[SIZE_CLASS_COUNT] = {};
+    uint64_t allocated = 0;
+    uint64_t reused = 0;
+
+    ~LocalCache()
+    {
+        publish();
+        if (home == nullptr) return;
+        home->orphaned.store(true, std::memory_order_relaxed);
+        for (int i = 0; i < SIZE_CLASS_COUNT; i++)
+        {
+            // Let other threads use our spare buckets
+            giveBackChain(i, free[i]);
+            giveBackChain(i, home->inbox[i].takeAll());
+        }
+        Home::release(home);
+    }
+
+    void publish()
+    {
+        allocated_.fetch_add(allocated, std::memory_order_relaxed);
+        reused_.fetch_add(reused, std::memory_order_relaxed);
+        allocated = 0;
+        reused = 0;
+    }
+
+    static void giveBackChain(int sizeClass, QueryResults* first)
+    {
+        if (first == nullptr) return;
+        int64_t n = 1;
+        QueryResults* last = first;
+        for (; last->next; last = last->next) n++;
+        giveBack(sizeClass, first, last, n);
+    }
+
+    QueryResults* refill(int sizeClass)
+    {
+        publish();
+        QueryResults* list = home->inbox[sizeClass].takeAll();
+        if (list == nullptr) list = shared_[sizeClass].takeAll();
+        if (list == nullptr) return nullptr;
+
+        // Keep at most MAX_LOCAL_BUCKETS, and hand the rest to
+        // the shared list
+
+        int64_t n = 1;
+        QueryResults* last = list;
+        for (; last->next && n < MAX_LOCAL_BUCKETS[sizeClass]; last = last->next) n++;
+        QueryResults* surplus = last->next;
+        last->next = nullptr;
+        if (surplus)
+        {
+            int64_t surplusCount = 1;
+            QueryResults* surplusLast = surplus;
+            for (; surplusLast->next; surplusLast = surplusLast->next) surplusCount++;
+            trimmed_.fetch_add(surplusCount, std::memory_order_relaxed);
+            giveBack(sizeClass, surplus, surplusLast, surplusCount);
+        }
+        free[sizeClass] = list;
+        freeCount[sizeClass] = n;
+        return list;
+    }
+};
+
+thread_local QueryResultsPool::LocalCache QueryResultsPool::localCache_;
+
+QueryResults* QueryResultsPool::allocate(uint32_t capacity)
+{
+    int sizeClass = sizeClassOf(capacity);
+    LocalCache& cache = localCache_;
+    if (cache.home == nullptr) [[unlikely]] cache.home = Home::acquire();
+    QueryResults* p = cache.free[sizeClass];
+    if (p == nullptr) p = cache.refill(sizeClass);
+    cache.allocated++;
+    if (p) [[likely]]
+    {
+        cache.free[sizeClass] = p->next;
+        cache.freeCount[sizeClass]--;
+        cache.reused++;
+    }
+    else
+    {
+        uint8_t* raw = static_cast<uint8_t*>(::operator new(PREFIX_SIZE +
+            QueryResults::allocationSize(
+                sizeClass == 0 ? QueryResults::SMALL_BUCKET_SIZE :
+                    QueryResults::DEFAULT_BUCKET_SIZE)));
+        p = reinterpret_cast<QueryResults*>(raw + PREFIX_SIZE);
+    }
+    homeOf(p) = cache.home;
+        // A bucket taken from the shared list now belongs to us
+    p->count = 0;
+    p->capacity = capacity;
+    return p;
+}
+
+void QueryResultsPool::free(const QueryResults* res)
+{
+    ::operator delete(reinterpret_cast<uint8_t*>(
+        const_cast<QueryResults*>(res)) - PREFIX_SIZE);
+}
+
+void QueryResultsPool::freeChain(QueryResults* p)
+{
+    while (p)
+    {
+        QueryResults* next = p->next;
+        free(p);
+        p = next;
+    }
+}
+
+void QueryResultsPool::giveBack(int sizeClass, QueryResults* first,
+    QueryResults* last, int64_t n)
+{
+    SharedList& shared = shared_[sizeClass];
+    if (shared.count.load(std::memory_order_relaxed) >= MAX_SHARED_BUCKETS[sizeClass])
+    {
+        // The pool already holds plenty of spare buckets
+        discarded_.fetch_add(n, std::memory_order_relaxed);
+        last->next = nullptr;
+        freeChain(first);
+        return;
+    }
+    shared.push(first, last, n);
+}
+
+void QueryResultsPool::Recycler::flush()
+{
+    if (count_ == 0) return;
+    recycled_.fetch_add(count_, std::memory_order_relaxed);
+    for (int i = 0; i < batchCount_; i++)
+    {
+        Batch& batch = batches_[i];
+        Home* home = batch.home;
+        SharedList& inbox = home->inbox[batch.sizeClass];
+        if (home->orphaned.load(std::memory_order_relaxed) ||
+            inbox.count.load(std::memory_order_relaxed) >=
+                MAX_LOCAL_BUCKETS[batch.sizeClass])
+        {
+            // The thread has ended, or has enough spare buckets
+            giveBack(batch.sizeClass, batch.head, batch.tail, batch.count);
+            continue;
+        }
+        inbox.push(batch.head, batch.tail, batch.count);
+    }
+    batchCount_ = 0;
+    count_ = 0;
+}
+
+QueryResultsPool::Stats QueryResultsPool::stats()
+{
+    localCache_.publish();
+    return
+    {
+        allocated_.load(std::memory_order_relaxed),
+        reused_.load(std::memory_order_relaxed),
+        recycled_.load(std::memory_order_relaxed),
+        discarded_.load(std::memory_order_relaxed),
+        trimmed_.load(std::memory_order_relaxed)
+    };
+}
+
+int64_t QueryResultsPool::localBucketCount(uint32_t capacity)
+{
+    return localCache_.freeCount[sizeClassOf(capacity)];
+}
+
+} // namespace geodesk
@@ -0,0 +1,129 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/QueryStats.h>
+#include <clarisma/util/StringBuilder.h>
+
+using namespace clarisma;
+
+namespace geodesk {
+
+void QueryStats::Counters::add(const Counters& other)
+{
+    tilesScanned += other.tilesScanned;
+    indexesAccepted += other.indexesAccepted;
+    indexesRejected += other.indexesRejected;
+    branchesVisited += other.branchesVisited;
+    branchEntriesPruned += other.branchEntriesPruned;
+    leavesVisited += other.leavesVisited;
+    entriesTested += other.entriesTested;
+    matcherCalls += other.matcherCalls;
+    filterCalls += other.filterCalls;
+    hits += other.hits;
+}
+
+QueryStats::QueryStats(int workerCount)
+{
+    reset(workerCount);
+}
+
+void QueryStats::reset(int workerCount)
+{
+    workers_.assign(workerCount + 1, Worker());
+    tilesVisited = 0;
+    tilesSkipped = 0;
+    tilesFastAccepted = 0;
+    tilesMissing = 0;
+    tilesCounted = 0;
+    walkNanos = 0;
+    waitNanos = 0;
+    totalNanos = 0;
+    start_ = std::chrono::steady_clock::now();
+}
+
+void QueryStats::stop()
+{
+    if (totalNanos) return;
+    totalNanos = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start_).count());
+}
+
+QueryStats::Counters QueryStats::totals() const
+{
+    Counters totals;
+    for (const Worker& w : workers_) totals.add(w.counters);
+    return totals;
+}
+
+uint64_t QueryStats::scanNanos() const
+{
+    uint64_t nanos = 0;
+    for (const Worker& w : workers_) nanos += w.nanos;
+    return nanos;
+}
+
+/// Writes a duration as milliseconds, with 3 decimals
+static void formatMillis(Buffer& out, uint64_t nanos)
+{
+    uint64_t micros = (nanos + 500) / 1000;
+    uint64_t fraction = micros % 1000;
+    out << micros / 1000 << '.'
+        << static_cast<char>('0' + fraction / 100)
+        << static_cast<char>('0' + fraction / 10 % 10)
+        << static_cast<char>('0' + fraction % 10) << " ms";
+}
+
+void QueryStats::format(Buffer& out) const
+{
+    Counters c = totals();
+    out << "Tiles:    " << tilesVisited << " visited, "
+        << tilesSkipped << " skipped, "
+        << tilesFastAccepted << " fast-accepted, "
+        << tilesMissing << " missing, "
+        << tilesCounted << " counted from statistics, "
+        << c.tilesScanned << " scanned\n";
+    out << "Indexes:  " << c.indexesAccepted << " accepted, "
+        << c.indexesRejected << " rejected\n";
+    out << "Branches: " << c.branchesVisited << " visited, "
+        << c.branchEntriesPruned << " children pruned\n";
+    out << "Leaves:   " << c.leavesVisited << " visited, "
+        << c.entriesTested << " entries tested\n";
+    out << "Features: " << c.matcherCalls << " matched, "
+        << c.filterCalls << " filtered, "
+        << c.hits << " hits\n";
+    out << "Time:     ";
+    formatMillis(out, totalNanos);
+    out << " total, ";
+    formatMillis(out, walkNanos);
+    out << " walking index, ";
+    formatMillis(out, waitNanos);
+    out << " waiting, ";
+    formatMillis(out, scanNanos());
+    out << " scanning\n";
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+        const Worker& w = workers_[i];
+        if (w.tiles == 0) continue;
+        if (i == workers_.size() - 1)
+        {
+            out << "  caller:    ";
+        }
+        else
+        {
+            out << "  worker " << static_cast<uint64_t>(i) << ": ";
+        }
+        out << w.tiles << " tiles, ";
+        formatMillis(out, w.nanos);
+        out << ", " << w.counters.hits << " hits\n";
+    }
+}
+
+std::string QueryStats::toString() const
+{
+    StringBuilder str;
+    format(str);
+    return str.toString();
+}
+
+} // namespace geodesk
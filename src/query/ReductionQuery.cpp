@@ -0,0 +1,84 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/ReductionQuery.h>
+#include <geodesk/query/ExecutorTask.h>
+
+namespace geodesk {
+
+ReductionQuery::ReductionQuery(FeatureStore* store, const Box& box, FeatureTypes types,
+    const MatcherHolder* matcher, const Filter* filter,
+    QueryReduction reduction, uint32_t limit, QueryStats* stats) :
+    QueryBase(store, box, types, matcher, filter, nullptr, reduction,
+        limit, stats),
+    count_(0),
+    measure_(0),
+    pendingTiles_(0)
+{
+    assert(reduction != QueryReduction::NONE);
+
+    // If the GOL has tile statistics, a count with a simple matcher
+    // (and no filter) takes the counts of the fully covered tiles
+    // from the statistics
+    if (reduction == QueryReduction::COUNT && filter == nullptr && limit == 0)
+    {
+        const TileStatistics* statistics = store->tileStatistics();
+        if (statistics && statistics->criteria(types, matcher, statisticsCriteria_))
+        {
+            tileStatistics_ = statistics;
+        }
+    }
+}
+
+
+ReductionQuery::Result ReductionQuery::run()
+{
+    auto& executor = store_->executor();
+    ExecutorTask batch[MAX_BATCH_SIZE];
+    while (!allTilesRequested_)
+    {
+        int room = maxPendingTiles_ - pendingTiles_;
+        if (room <= 0)
+        {
+            // At the cap on parallelism: wait for tiles to complete
+            pendingTiles_ -= static_cast<int32_t>(awaitCompletedTiles());
+            continue;
+        }
+        int capacity = nested_ ? 0 :
+            std::min(executor.minimumRemainingCapacity(), room);
+        if (capacity <= 0)
+        {
+            // Rather than wait for room in the queue, make
+            // ourselves useful by scanning a tile (A nested query
+            // always scans its tiles itself)
+            int count = nextTiles(batch, 1);
+            pendingTiles_ += count;
+            if (count) batch[0]();
+            continue;
+        }
+        int count = nextTiles(batch, std::min(capacity, MAX_BATCH_SIZE));
+        int posted = executor.tryPostBatch(batch, count);
+        pendingTiles_ += count;
+        for (int i = posted; i < count; i++) batch[i]();
+    }
+    while (pendingTiles_ > 0)
+    {
+        pendingTiles_ -= static_cast<int32_t>(awaitCompletedTiles());
+    }
+    if (stats_) [[unlikely]] stats_->stop();
+    return { count_.load(std::memory_order_relaxed) + precountedFeatures_,
+        measure_.load(std::memory_order_relaxed) };
+}
+
+
+void ReductionQuery::offer(uint64_t count, double measure)
+{
+    if (count)
+    {
+        count_.fetch_add(count, std::memory_order_relaxed);
+        if (measure != 0) measure_.fetch_add(measure, std::memory_order_relaxed);
+    }
+    countCompletedTile();   // publishes the partial result
+}
+
+} // namespace geodesk
@@ -2,8 +2,10 @@
 // SPDX-License-Identifier: LGPL-3.0-only
 
 #include <geodesk/query/TileIndexWalker.h>
+#include <cstdint>
 #include <clarisma/util/Bits.h>
 #include <geodesk/filter/Filter.h>
+#include <geodesk/query/QueryStats.h>
 
 namespace geodesk {
 
@@ -12,9 +14,11 @@ using namespace clarisma;
 // TODO: Check single-tile GOLs
 
 TileIndexWalker::TileIndexWalker(
-    DataPtr pIndex, uint32_t zoomLevels, const Box& box, const Filter* filter) :
+    DataPtr pIndex, uint32_t zoomLevels, const Box& box,
+    const Filter* filter, QueryStats* stats) :
     box_(box),
     filter_(filter),
+    stats_(stats),
     pIndex_(pIndex),
 	currentLevel_(0),
     currentTile_(Tile::fromColumnRowZoom(0,0,0)),
@@ -22,7 +26,8 @@ TileIndexWalker::TileIndexWalker(
     northwestFlags_(0),
     turboFlags_(0),
     tileBasedAcceleration_(false),
-    trackAcceptedTiles_(false)
+    trackAcceptedTiles_(false),
+    acceptedTileWords_(0)
 {
 	int zoom = 0;
     zoomLevels >>= 1;
@@ -46,12 +51,53 @@ TileIndexWalker::TileIndexWalker(
             if ((filterFlags & FilterFlags::STRICT_BBOX) == 0)
             {
                 trackAcceptedTiles_ = true;
+                initAcceptedTiles(static_cast<int>(level - levels_) + 1);
             }
         }
     }
     startLevel(&levels_[0], 1);
 }
 
+// The accepted tiles all lie within the query bounds, so instead of
+// a hash set, we use a bitmap that covers the bounds at each level
+// (one bit per tile; the root tile is never a neighbor, so it has
+// no bit). The bitmap is only allocated once the filter accepts a
+// tile, since a query whose filter rejects all tiles doesn't need it.
+
+void TileIndexWalker::initAcceptedTiles(int levelCount)
+{
+    size_t bitCount = 0;
+    for (int i = 0; i < levelCount; i++)
+    {
+        Level& level = levels_[i];
+        int zoom = level.topLeftChildTile.zoom();
+        level.gridLeft = Tile::columnFromXZ(box_.minX(), zoom);
+        level.gridTop = Tile::rowFromYZ(box_.maxY(), zoom);
+        level.gridWidth = std::max(
+            Tile::columnFromXZ(box_.maxX(), zoom) - level.gridLeft + 1, 0);
+        level.gridHeight = std::max(
+            Tile::rowFromYZ(box_.minY(), zoom) - level.gridTop + 1, 0);
+        level.gridOffset = bitCount;
+        bitCount += static_cast<size_t>(level.gridWidth) * level.gridHeight;
+    }
+    acceptedTileWords_ = (bitCount + 63) / 64;
+}
+
+/// Returns the position of the bit for the tile at the given column
+/// and row, or SIZE_MAX if the tile lies outside the query bounds
+/// (and hence cannot have been accepted)
+///
+size_t TileIndexWalker::acceptedTileBit(const Level* level, int col, int row) const
+{
+    col -= level->gridLeft;
+    row -= level->gridTop;
+    if (col < 0 || row < 0 || col >= level->gridWidth || row >= level->gridHeight)
+    {
+        return SIZE_MAX;
+    }
+    return level->gridOffset + static_cast<size_t>(row) * level->gridWidth + col;
+}
+
 bool TileIndexWalker::next()
 {
     Level* level = &levels_[currentLevel_];
@@ -117,28 +163,42 @@ bool TileIndexWalker::next()
 
             if (tileBasedAcceleration_)
             {
-                // TODO: Don't call acceptTile() if all turbo-flags are
-                //  set for the current tile
-                //  If the parent is fast-accept, children by definition
-                //  are fast-accept as well
-                //  It's more complicated if there are multiple
-                //  spatial filters, as a tile may be accelerated for
-                //  some but not others
-                
-                int turboFlags = filter_->acceptTile(currentTile_);
+                // The children of a tile that is fully accepted by a
+                // spatial filter are fully accepted as well, so the
+                // filter only has to classify tiles that straddle its
+                // boundary (Prepared filters also remember how they
+                // classified each tile, which benefits repeated queries
+                // against the same area)
+
+                int turboFlags = filter_->acceptChildTile(
+                    currentTile_, level->turboFlags);
+                if (stats_) [[unlikely]]
+                {
+                    stats_->tilesSkipped += (turboFlags < 0);
+                    stats_->tilesFastAccepted += (turboFlags > 0);
+                }
                 if (turboFlags < 0) continue;
                 turboFlags_ = static_cast<uint32_t>(turboFlags);
                 
                 if (trackAcceptedTiles_)
                 {
-                    Tile northTile = currentTile_.neighbor(0, -1);
-                    Tile westTile = currentTile_.neighbor(-1, 0);
+                    if (!acceptedTiles_) [[unlikely]]
+                    {
+                        acceptedTiles_.reset(new uint64_t[acceptedTileWords_]());
+                    }
+                    int col = currentTile_.column();
+                    int row = currentTile_.row();
+                    size_t northBit = acceptedTileBit(level, col, row - 1);
+                    size_t westBit = acceptedTileBit(level, col - 1, row);
+                    size_t bit = acceptedTileBit(level, col, row);
                     northwestFlags_ =
-                        (acceptedTiles_.find(northTile) != acceptedTiles_.end() ?
+                        (northBit != SIZE_MAX &&
+                            (acceptedTiles_[northBit >> 6] & (1ULL << (northBit & 63))) ?
                             FeatureFlags::MULTITILE_NORTH : 0) |
-                        (acceptedTiles_.find(westTile) != acceptedTiles_.end() ?
+                        (westBit != SIZE_MAX &&
+                            (acceptedTiles_[westBit >> 6] & (1ULL << (westBit & 63))) ?
                             FeatureFlags::MULTITILE_WEST : 0);
-                    acceptedTiles_.insert(currentTile_);
+                    acceptedTiles_[bit >> 6] |= 1ULL << (bit & 63);
                 }
                 else
                 {
@@ -210,7 +270,9 @@ void TileIndexWalker::startLevel(Level* level, int tip)
     level->childTileMask = (pIndex_ + (tip + 1) * 4).getUnsignedLong();
         // TODO: Is this unaligned???
     level->pChildEntries = tip + (step == 3 ? 3 : 2);
-    level->turboFlags = 0; // TODO
+    level->turboFlags = turboFlags_;
+        // startLevel() is called right after the parent tile has been
+        // accepted (For the root, turboFlags_ is 0)
 }
 
 } // namespace geodesk
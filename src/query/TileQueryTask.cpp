@@ -5,13 +5,23 @@
 #include <geodesk/feature/FeaturePtr.h>
 #include <geodesk/feature/TileConstants.h>
 #include <geodesk/feature/types.h>
+#include <geodesk/geom/Area.h>
+#include <geodesk/geom/Length.h>
+#include <clarisma/util/Bits.h>
+#include <geodesk/query/IndexFilter.h>
 #include <geodesk/query/QueryBase.h>
+#include <geodesk/query/QueryExecutor.h>
+#include <geodesk/query/QueryResultsPool.h>
+#include <geodesk/query/ReductionQuery.h>
+#include <geodesk/query/RTreeWalker.h>
+#include <geodesk/query/VisitorQuery.h>
 
 using namespace TileConstants;
 
 namespace geodesk {
 
-QueryResultsHeader QueryResults::EMPTY_HEADER = { EMPTY, DataPtr(), DEFAULT_BUCKET_SIZE };
+QueryResultsHeader QueryResults::EMPTY_HEADER = { EMPTY, DataPtr(), 0, 0 };
+	// count == capacity, so EMPTY is always full
 QueryResults* const QueryResults::EMPTY = reinterpret_cast<QueryResults*>(&EMPTY_HEADER);
 
 // TODO: perform type check prior to matcher
@@ -25,17 +35,63 @@ void TileQueryTask::operator()()
 {
 	Tip tip = Tip(tipAndFlags_ >> 8);
 	pTile_ = query_->store()->fetchTile(tip);
-	uint32_t types = query_->types();
 
 	// LOG("Scanning tile %06X", tip);
 
-	if (types & FeatureTypes::NODES) searchNodeIndexes();
-	if (types & FeatureTypes::NONAREA_WAYS) searchIndexes(FeatureIndexType::WAYS);
-	if (types & FeatureTypes::AREAS) searchIndexes(FeatureIndexType::AREAS);
-	if (types & FeatureTypes::NONAREA_RELATIONS) searchIndexes(FeatureIndexType::RELATIONS);
-	query_->consumer()(query_, results_);
+	// If the query has been stopped (cancelled, or it has found enough
+	// features), we skip the tile, but still report it as completed
+	if (!query_->isStopped())
+	{
+		QueryStats* stats = query_->stats();
+		if (stats) [[unlikely]]
+		{
+			scanWithStats(*stats);
+		}
+		else
+		{
+			scan<false>();
+		}
+	}
+	if (query_->reduction() == QueryReduction::NONE) [[likely]]
+	{
+		query_->consumer()(query_, results_);
+	}
+	else
+	{
+		static_cast<ReductionQuery*>(query_)->offer(partialCount_, partialMeasure_);
+	}
 }
 
+template<bool STATS>
+void TileQueryTask::scan()
+{
+	uint32_t types = query_->types();
+	if (types & FeatureTypes::NODES) searchNodeIndexes<STATS>();
+	if (types & FeatureTypes::NONAREA_WAYS) searchIndexes<STATS>(FeatureIndexType::WAYS);
+	if (types & FeatureTypes::AREAS) searchIndexes<STATS>(FeatureIndexType::AREAS);
+	if (types & FeatureTypes::NONAREA_RELATIONS) searchIndexes<STATS>(FeatureIndexType::RELATIONS);
+}
+
+/// Scans the tile, recording the activity in the stats slot of
+/// the current thread. This happens before the tile is reported as
+/// completed, so the stats are visible to the querying thread
+/// once it has accounted for all tiles.
+///
+void TileQueryTask::scanWithStats(QueryStats& stats)
+{
+	QueryStats::Timer timer;
+	QueryStats::Counters counters;
+	counters.tilesScanned = 1;
+	counters_ = &counters;
+	scan<true>();
+	QueryStats::Worker& worker = stats.worker(
+		query_->store()->executor().currentWorkerIndex());
+	worker.counters.add(counters);
+	worker.tiles++;
+	worker.nanos += timer.stop();
+}
+
+template<bool STATS>
 void TileQueryTask::searchNodeIndexes()
 {
 	const MatcherHolder* matcher = query_->matcher();
@@ -51,62 +107,90 @@ void TileQueryTask::searchNodeIndexes()
 		int32_t keys = (p+4).getInt();
 		if (matcher->acceptIndex(FeatureIndexType::NODES, keys))
 		{
-			searchNodeBranch(p + (ptr ^ last));
+			if constexpr (STATS) counters_->indexesAccepted++;
+			searchNodeBranch<STATS>(p + (ptr ^ last));
+		}
+		else
+		{
+			if constexpr (STATS) counters_->indexesRejected++;
 		}
 		if (last != 0) break;
 		p += 8;
 	}
 }
 
+/// Feeds the R-tree walker's progress into the query's counters
+///
+struct BranchCounter
+{
+	void branchVisited()
+	{
+		counters->branchesVisited++;
+	}
 
+	void branchEntriesTested(int count, int accepted)
+	{
+		counters->branchEntriesPruned += count - accepted;
+	}
+
+	QueryStats::Counters* counters;
+};
+
+template<bool STATS>
 void TileQueryTask::searchNodeBranch(DataPtr p)
 {
 	// LOG("Searching branch at %016X", p);
-	Box box = query_->bounds();
-	for (;;)
+	if constexpr (STATS)
 	{
-		int32_t ptr = p.getInt();
-		int32_t last = ptr & 1;
-		if (box.intersects(*reinterpret_cast<const Box*>((const uint8_t *)p + 4)))
-		{
-			DataPtr pChild = p + (ptr & 0xffff'fffc);
-			if (ptr & 2)
-			{
-				searchNodeLeaf(pChild);
-			}
-			else
-			{
-				searchNodeBranch(pChild);
-			}
-		}
-		if (last != 0) break;
-		p += 20;
+		RTreeWalker::walk(p, query_->bounds(),
+			[this](DataPtr pLeaf) { searchNodeLeaf<true>(pLeaf); },
+			[this]() { return query_->isStopped(); },
+			BranchCounter{ counters_ });
+	}
+	else
+	{
+		RTreeWalker::walk(p, query_->bounds(),
+			[this](DataPtr pLeaf) { searchNodeLeaf<false>(pLeaf); },
+			[this]() { return query_->isStopped(); });
 	}
 }
 
+template<bool STATS>
 void TileQueryTask::searchNodeLeaf(DataPtr p)
 {
 	// LOG("Searching leaf at %016X", p);
+	const Filter* filter = query_->filter();
+	if (filter && (filter->flags() & FilterFlags::BATCH_NODES))
+	{
+		searchNodeLeafBatched<STATS>(p, filter);
+		return;
+	}
+
 	Box box = query_->bounds();
 	FeatureTypes acceptedTypes = query_->types();
 	const Matcher& matcher = query_->matcher()->mainMatcher();
+	if constexpr (STATS) counters_->leavesVisited++;
 
 	for (;;)
 	{
+		if constexpr (STATS) counters_->entriesTested++;
 		int32_t flags = (p+8).getInt();
 		if (box.contains(p.getInt(), (p+4).getInt()))	// TODO: Use containsSimple() for efficiency?
 		{
 			if (acceptedTypes.acceptFlags(flags))
 			{
 				FeaturePtr pFeature(p + 8);
+				if constexpr (STATS) counters_->matcherCalls++;
 				if (matcher.accept(pFeature))
 				{
-					const Filter* filter = query_->filter();
+					if constexpr (STATS) counters_->filterCalls += (filter != nullptr);
 					if (filter == nullptr || filter->accept(query_->store(),
 						pFeature, fastFilterHint_))
 					{
 						// LOG("Found node/%llu", Feature::id(pFeature));
-						addResult(static_cast<uint32_t>(pFeature.ptr() - pTile_));
+						if constexpr (STATS) counters_->hits++;
+						addFeature(pFeature);
+						if (query_->isStopped()) [[unlikely]] return;
 					}
 				}
 			}
@@ -119,7 +203,64 @@ void TileQueryTask::searchNodeLeaf(DataPtr p)
 }
 
 
+/// Same as searchNodeLeaf(), but hands the nodes that pass the
+/// matcher to the filter in batches (see Filter::acceptNodes)
+///
+template<bool STATS>
+void TileQueryTask::searchNodeLeafBatched(DataPtr p, const Filter* filter)
+{
+	Box box = query_->bounds();
+	FeatureTypes acceptedTypes = query_->types();
+	const Matcher& matcher = query_->matcher()->mainMatcher();
+	if constexpr (STATS) counters_->leavesVisited++;
+
+	FeaturePtr batch[NODE_BATCH_SIZE];
+	size_t n = 0;
+	for (;;)
+	{
+		if constexpr (STATS) counters_->entriesTested++;
+		int32_t flags = (p+8).getInt();
+		if (box.contains(p.getInt(), (p+4).getInt()) &&
+			acceptedTypes.acceptFlags(flags))
+		{
+			FeaturePtr pFeature(p + 8);
+			if constexpr (STATS) counters_->matcherCalls++;
+			if (matcher.accept(pFeature))
+			{
+				batch[n++] = pFeature;
+				if (n == NODE_BATCH_SIZE)
+				{
+					if (!addNodes<STATS>(filter, batch, n)) return;
+					n = 0;
+				}
+			}
+		}
+		if (flags & 1) break;
+		p += 20 + (flags & 4);
+	}
+	if (n) addNodes<STATS>(filter, batch, n);
+}
+
+
+/// Adds the nodes that the filter accepts; returns `false` if the
+/// query has been stopped
+///
+template<bool STATS>
+bool TileQueryTask::addNodes(const Filter* filter, FeaturePtr* nodes, size_t count)
+{
+	if constexpr (STATS) counters_->filterCalls += count;
+	count = filter->acceptNodes(query_->store(), nodes, count, fastFilterHint_);
+	for (size_t i = 0; i < count; i++)
+	{
+		if constexpr (STATS) counters_->hits++;
+		addFeature(nodes[i]);
+		if (query_->isStopped()) [[unlikely]] return false;
+	}
+	return true;
+}
 
+
+template<bool STATS>
 void TileQueryTask::searchIndexes(FeatureIndexType indexType)
 {
 	const MatcherHolder* matcher = query_->matcher();
@@ -135,7 +276,12 @@ void TileQueryTask::searchIndexes(FeatureIndexType indexType)
 		int32_t keys = (p+4).getInt();
 		if (matcher->acceptIndex(indexType, keys))
 		{
-			searchBranch(p + (ptr ^ last));
+			if constexpr (STATS) counters_->indexesAccepted++;
+			searchBranch<STATS>(p + (ptr ^ last));
+		}
+		else
+		{
+			if constexpr (STATS) counters_->indexesRejected++;
 		}
 		if (last != 0) break;
 		p += 8;
@@ -143,67 +289,106 @@ void TileQueryTask::searchIndexes(FeatureIndexType indexType)
 }
 
 
+template<bool STATS>
 void TileQueryTask::searchBranch(DataPtr p)
 {
-	Box box = query_->bounds();
-	for (;;)
+	if constexpr (STATS)
 	{
-		int32_t ptr = p.getInt();
-		int32_t last = ptr & 1;
-		if (box.intersects(*reinterpret_cast<const Box*>((const uint8_t*)p + 4)))
-		{
-			DataPtr pChild = p + (ptr & 0xffff'fffc);
-			if (ptr & 2)
-			{
-				searchLeaf(pChild);
-			}
-			else
-			{
-				searchBranch(pChild);		// NOLINT recursion
-			}
-		}
-		if (last != 0) break;
-		p += 20;
+		RTreeWalker::walk(p, query_->bounds(),
+			[this](DataPtr pLeaf) { searchLeaf<true>(pLeaf); },
+			[this]() { return query_->isStopped(); },
+			BranchCounter{ counters_ });
+	}
+	else
+	{
+		RTreeWalker::walk(p, query_->bounds(),
+			[this](DataPtr pLeaf) { searchLeaf<false>(pLeaf); },
+			[this]() { return query_->isStopped(); });
 	}
 }
 
 
+template<bool STATS>
 void TileQueryTask::searchLeaf(DataPtr p)
 {
 	Box box = query_->bounds();
-	FeatureTypes acceptedTypes = query_->types();
+	uint32_t acceptedTypes = query_->types();
 	const Matcher& matcher = query_->matcher()->mainMatcher();
 	int multiTileFlags = tipAndFlags_ & (FeatureFlags::MULTITILE_NORTH | FeatureFlags::MULTITILE_WEST);
+	if constexpr (STATS) counters_->leavesVisited++;
 	for (;;)
 	{
-		int32_t flags = (p+16).getInt();
-		if((flags & multiTileFlags) == 0)
+		// Test the bounds, multi-tile flags and types of a run of
+		// entries at once; only the candidates go to the matcher
+		int count = IndexFilter::countEntries(p, 32, 16, IndexFilter::MAX_ENTRIES);
+		uint32_t candidates = IndexFilter::filterLeaf(p, count, box,
+			multiTileFlags, acceptedTypes);
+		if constexpr (STATS) counters_->entriesTested += count;
+		if (candidates)
 		{
-			if (!(p.getInt() > box.maxX() ||
-				(p+4).getInt() > box.maxY() ||
-				(p+8).getInt() < box.minX() ||
-				(p+12).getInt() < box.minY()))
+			// Hand all candidates to the matcher in one batch
+			FeaturePtr batch[IndexFilter::MAX_ENTRIES];
+			size_t n = 0;
+			do
 			{
-				// TODO: replace this branching code with arithmetic?
-				// Useful? https://stackoverflow.com/a/62852710
+				int i = clarisma::Bits::countTrailingZerosInNonZero(candidates);
+				candidates &= candidates - 1;
+				batch[n++] = FeaturePtr(p + i * 32 + 16);
+			}
+			while (candidates);
+			if constexpr (STATS) counters_->matcherCalls += n;
+			n = matcher.acceptMany(batch, n, batch);
 
-				if (acceptedTypes.acceptFlags(flags))
+			const Filter* filter = query_->filter();
+			for (size_t i = 0; i < n; i++)
+			{
+				FeaturePtr pFeature = batch[i];
+				if constexpr (STATS) counters_->filterCalls += (filter != nullptr);
+				if (filter == nullptr || filter->accept(query_->store(),
+					pFeature, fastFilterHint_))
 				{
-					FeaturePtr pFeature (p + 16);
-					if (matcher.accept(pFeature))
-					{
-						const Filter* filter = query_->filter();
-						if (filter == nullptr || filter->accept(query_->store(), 
-							pFeature, fastFilterHint_))
-						{
-							addResult(static_cast<uint32_t>(pFeature.ptr() - pTile_));
-						}
-					}
+					if constexpr (STATS) counters_->hits++;
+					addFeature(pFeature);
+					if (query_->isStopped()) [[unlikely]] return;
 				}
 			}
 		}
-		if (flags & 1) break;
-		p += 32;
+		if ((p + (count - 1) * 32 + 16).getInt() & 1) break;
+		p += count * 32;
+	}
+}
+
+void TileQueryTask::addFeature(FeaturePtr feature)
+{
+	if (query_->limit()) [[unlikely]] query_->countHit();
+	if (query_->reduction() == QueryReduction::NONE) [[likely]]
+	{
+		addResult(static_cast<uint32_t>(feature.ptr() - pTile_));
+		return;
+	}
+	reduce(feature);
+}
+
+/**
+ * Fold a matching feature into the partial result of a ReductionQuery
+ * (or hand it to the visitor of a VisitorQuery).
+ */
+void TileQueryTask::reduce(FeaturePtr feature)
+{
+	partialCount_++;
+	switch (query_->reduction())
+	{
+	case QueryReduction::LENGTH:
+		partialMeasure_ += Length::ofFeature(query_->store(), feature);
+		break;
+	case QueryReduction::AREA:
+		partialMeasure_ += Area::ofFeature(query_->store(), feature);
+		break;
+	case QueryReduction::VISIT:
+		static_cast<VisitorQuery*>(query_)->visit(feature);
+		break;
+	default:
+		break;
 	}
 }
 
@@ -212,14 +397,18 @@ void TileQueryTask::searchLeaf(DataPtr p)
  * If the current bucket is full, place a new bucket at the end
  * of the circular linked list of buckets.
  * - `results_` always points to the last bucket
+ * - The first bucket is small; only tiles with more hits
+ *   get full-size buckets
  */
 void TileQueryTask::addResult(uint32_t item)
 {
 	if (results_->isFull())
 	{
-		QueryResults* next = new QueryResults();
+		QueryResults* next = QueryResultsPool::allocate(
+			results_ == QueryResults::EMPTY ?
+				QueryResults::SMALL_BUCKET_SIZE :
+				QueryResults::DEFAULT_BUCKET_SIZE);
 		QueryResults* last = (results_ == QueryResults::EMPTY) ? next : results_;
-		next->count = 0;
 		next->pTile = pTile_;
 		next->next = last->next;
 		last->next = next;
@@ -0,0 +1,498 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/TileStatistics.h>
+#include <algorithm>
+#include <clarisma/io/File.h>
+#include <clarisma/io/FilePath.h>
+#include <clarisma/util/MutableDataPtr.h>
+#include <geodesk/feature/FeatureStore.h>
+#include <geodesk/feature/GlobalStrings.h>
+#include <geodesk/feature/TileConstants.h>
+#include <geodesk/geom/Box.h>
+#include <geodesk/match/Matcher.h>
+#include <geodesk/query/QueryExecutor.h>
+#include <geodesk/query/RTreeWalker.h>
+#include <geodesk/query/TileIndexWalker.h>
+
+using namespace TileConstants;
+
+namespace geodesk {
+
+using namespace clarisma;
+
+TileStatistics::TileStatistics(const UUID& guid, uint32_t revision,
+    std::vector<uint16_t> keys) :
+    guid_(guid),
+    revision_(revision),
+    keys_(std::move(keys))
+{
+    assert(std::is_sorted(keys_.begin(), keys_.end()));
+    for (size_t i = 0; i < keys_.size(); i++)
+    {
+        uint16_t key = keys_[i];
+        assert(key != 0);
+        if (key >= keySlots_.size()) keySlots_.resize(key + 1, -1);
+        keySlots_[key] = static_cast<int16_t>(i);
+    }
+}
+
+
+TileStatistics::TileBuilder::TileBuilder(const TileStatistics& statistics) :
+    statistics_(statistics),
+    typeCounts_{},
+    keyCounts_(statistics.keys_.size() * BUCKET_COUNT),
+    valueCounts_(statistics.keys_.size())
+{
+}
+
+
+void TileStatistics::TileBuilder::addFeature(FeaturePtr feature)
+{
+    int bucket = (feature.flags() >> 1) & (BUCKET_COUNT - 1);
+    typeCounts_[bucket]++;
+    if (!statistics_.keys_.empty()) addTags(feature, bucket);
+}
+
+
+void TileStatistics::TileBuilder::addTags(FeaturePtr feature, int bucket)
+{
+    DataPtr p = feature.tags().ptr();
+    for (;;)
+    {
+        uint32_t tag = p.getUnsignedIntUnaligned();
+        int slot = statistics_.keySlot((tag & 0x7ffc) >> 2);
+        if (slot >= 0)
+        {
+            bool isGlobalString = (tag & 3) == 1;
+            uint32_t value = tag >> 16;
+            // Same as the matcher for [k]: any value except global "no"
+            if (!isGlobalString || value != GlobalStrings::NO)
+            {
+                keyCounts_[slot * BUCKET_COUNT + bucket]++;
+            }
+            if (isGlobalString)
+            {
+                valueCounts_[slot][(value << 8) | bucket]++;
+            }
+        }
+        if (tag & 0x8000) break;
+        p += 4 + (tag & 2);
+    }
+}
+
+
+void TileStatistics::TileBuilder::finish(std::vector<Entry>& entries)
+{
+    size_t start = entries.size();
+    for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+    {
+        if (typeCounts_[bucket])
+        {
+            entries.push_back({ 0, ANY_VALUE, static_cast<uint16_t>(bucket),
+                0, typeCounts_[bucket] });
+        }
+    }
+    std::fill(std::begin(typeCounts_), std::end(typeCounts_), 0);
+
+    std::vector<std::pair<uint32_t,uint16_t>> totals;    // (count, value)
+    for (size_t slot = 0; slot < statistics_.keys_.size(); slot++)
+    {
+        uint16_t key = statistics_.keys_[slot];
+        uint32_t* keyCounts = &keyCounts_[slot * BUCKET_COUNT];
+        for (int bucket = 0; bucket < BUCKET_COUNT; bucket++)
+        {
+            if (keyCounts[bucket])
+            {
+                entries.push_back({ key, ANY_VALUE, static_cast<uint16_t>(bucket),
+                    0, keyCounts[bucket] });
+            }
+        }
+        std::fill(keyCounts, keyCounts + BUCKET_COUNT, 0);
+
+        auto& valueCounts = valueCounts_[slot];
+        if (valueCounts.empty()) continue;
+        totals.clear();
+        for (const auto& [valueAndBucket, count] : valueCounts)
+        {
+            uint16_t value = static_cast<uint16_t>(valueAndBucket >> 8);
+            auto it = std::find_if(totals.begin(), totals.end(),
+                [value](const auto& total) { return total.second == value; });
+            if (it == totals.end())
+            {
+                totals.emplace_back(count, value);
+            }
+            else
+            {
+                it->first += count;
+            }
+        }
+        if (totals.size() > MAX_VALUES)
+        {
+            // Keep only the most common values (ties are broken by
+            // code, so the statistics don't depend on hash order)
+            std::partial_sort(totals.begin(), totals.begin() + MAX_VALUES,
+                totals.end(), [](const auto& a, const auto& b)
+                {
+                    return a.first > b.first ||
+                        (a.first == b.first && a.second < b.second);
+                });
+            totals.resize(MAX_VALUES);
+            entries.push_back({ key, MORE_VALUES, 0, 0, 0 });
+        }
+        for (const auto& [valueAndBucket, count] : valueCounts)
+        {
+            uint16_t value = static_cast<uint16_t>(valueAndBucket >> 8);
+            if (std::any_of(totals.begin(), totals.end(),
+                [value](const auto& total) { return total.second == value; }))
+            {
+                entries.push_back({ key, value,
+                    static_cast<uint16_t>(valueAndBucket & 0xff), 0, count });
+            }
+        }
+        valueCounts.clear();
+    }
+    std::sort(entries.begin() + static_cast<ptrdiff_t>(start), entries.end(),
+        [](const Entry& a, const Entry& b)
+        {
+            return compareTag(a, b) || (!compareTag(b, a) && a.bucket < b.bucket);
+        });
+}
+
+
+/// Feeds all features of a tile to the builder (the features are
+/// visited via the spatial indexes, just like a query does)
+///
+static void addTile(TilePtr pTile, TileStatistics::TileBuilder& builder)
+{
+    for (int ofs = NODE_INDEX_OFS; ofs <= RELATION_INDEX_OFS; ofs += 4)
+    {
+        DataPtr ppRoot = pTile + ofs;
+        int32_t ptr = ppRoot.getInt();
+        if (ptr == 0) continue;
+
+        DataPtr p = ppRoot + ptr;
+        for (;;)
+        {
+            ptr = p.getInt();
+            int32_t last = ptr & 1;
+            if (ofs == NODE_INDEX_OFS)
+            {
+                RTreeWalker::walk(p + (ptr ^ last), Box::ofWorld(),
+                    [&builder](DataPtr pLeaf)
+                    {
+                        for (;;)
+                        {
+                            int32_t flags = (pLeaf + 8).getInt();
+                            builder.addFeature(FeaturePtr(pLeaf + 8));
+                            if (flags & 1) break;
+                            pLeaf += 20 + (flags & 4);
+                        }
+                    },
+                    []() { return false; });
+            }
+            else
+            {
+                RTreeWalker::walk(p + (ptr ^ last), Box::ofWorld(),
+                    [&builder](DataPtr pLeaf)
+                    {
+                        for (;;)
+                        {
+                            int32_t flags = (pLeaf + 16).getInt();
+                            builder.addFeature(FeaturePtr(pLeaf + 16));
+                            if (flags & 1) break;
+                            pLeaf += 32;
+                        }
+                    },
+                    []() { return false; });
+            }
+            if (last != 0) break;
+            p += 8;
+        }
+    }
+}
+
+
+std::unique_ptr<TileStatistics> TileStatistics::build(
+    FeatureStore* store, int threadCount)
+{
+    std::vector<uint16_t> keys;
+    for (const auto& [key, category] : store->keysToCategories())
+    {
+        keys.push_back(key);
+    }
+    std::sort(keys.begin(), keys.end());
+    auto statistics = std::make_unique<TileStatistics>(
+        store->guid(), store->revision(), std::move(keys));
+
+    std::vector<Tip> tips;
+    TileIndexWalker walker(store->tileIndex(), store->zoomLevels(),
+        Box::ofWorld(), nullptr);
+    do
+    {
+        if (walker.currentEntry().isLoadedAndCurrent())
+        {
+            tips.push_back(walker.currentTip());
+        }
+        else
+        {
+            walker.skipChildren();
+        }
+    }
+    while (walker.next());
+
+    // Tiles are handed out in small batches (each with its own
+    // builder) to the query threads; the calling thread does its
+    // share of the work
+
+    constexpr size_t TILES_PER_BATCH = 16;
+    std::vector<std::vector<Entry>> tileEntries(tips.size());
+    std::vector<uint32_t> tileRevisions(tips.size());
+    size_t batchCount = (tips.size() + TILES_PER_BATCH - 1) / TILES_PER_BATCH;
+    QueryExecutor::parallelFor(batchCount, threadCount, [&](size_t batch)
+    {
+        TileBuilder builder(*statistics);
+        size_t end = std::min((batch + 1) * TILES_PER_BATCH, tips.size());
+        for (size_t i = batch * TILES_PER_BATCH; i < end; i++)
+        {
+            TilePtr pTile = store->fetchTile(tips[i]);
+            addTile(pTile, builder);
+            builder.finish(tileEntries[i]);
+            tileRevisions[i] = pTile.revision();
+        }
+    });
+
+    for (size_t i = 0; i < tips.size(); i++)
+    {
+        statistics->setTile(tips[i], tileRevisions[i], std::move(tileEntries[i]));
+    }
+    return statistics;
+}
+
+
+void TileStatistics::setTile(Tip tip, uint32_t tileRevision, std::vector<Entry> entries)
+{
+    if (tip >= tiles_.size())
+    {
+        tiles_.resize(tip + 1);
+        revisions_.resize(tip + 1);
+        present_.resize(tip + 1);
+    }
+    tiles_[tip] = std::move(entries);
+    revisions_[tip] = tileRevision;
+    present_[tip] = true;
+}
+
+
+std::string TileStatistics::defaultFileName(const FeatureStore* store)
+{
+    return FilePath::withExtension(store->fileName(), ".gol-stats");
+}
+
+
+// The file starts with a header (magic, version, key count, GUID,
+// revision, tile count and entry count), followed by the keys (padded
+// to 4 bytes), a bitmap of the tiles that are present, the index of
+// each tile's first entry (plus the total), the revision of each tile,
+// and the entries of all tiles. Like a GOL, it is written field by field in little-endian
+// byte order.
+
+void TileStatistics::save(const char* fileName) const
+{
+    size_t keysSize = (keys_.size() * 2 + 3) & ~size_t(3);
+    size_t presentCount = (tiles_.size() + 31) / 32;
+    uint32_t entryCount = 0;
+    for (const std::vector<Entry>& entries : tiles_)
+    {
+        entryCount += static_cast<uint32_t>(entries.size());
+    }
+
+    std::vector<uint8_t> data(HEADER_SIZE + keysSize +
+        (presentCount + tiles_.size() * 2 + 1) * 4 + entryCount * ENTRY_SIZE);
+    MutableDataPtr p(data.data());
+    p.putUnsignedIntUnaligned(MAGIC);
+    (p + 4).putUnsignedShortUnaligned(VERSION);
+    (p + 6).putUnsignedShortUnaligned(static_cast<uint16_t>(keys_.size()));
+    (p + 8).putBytes(&guid_, 16);
+    (p + 24).putUnsignedIntUnaligned(revision_);
+    (p + 28).putUnsignedIntUnaligned(static_cast<uint32_t>(tiles_.size()));
+    (p + 32).putUnsignedIntUnaligned(entryCount);
+    p += HEADER_SIZE;
+
+    for (size_t i = 0; i < keys_.size(); i++)
+    {
+        (p + i * 2).putUnsignedShortUnaligned(keys_[i]);
+    }
+    p += keysSize;
+    for (size_t i = 0; i < presentCount; i++)
+    {
+        uint32_t bits = 0;
+        for (size_t tip = i * 32; tip < std::min((i + 1) * 32, tiles_.size()); tip++)
+        {
+            if (present_[tip]) bits |= 1u << (tip % 32);
+        }
+        p.putUnsignedIntUnaligned(bits);
+        p += 4;
+    }
+    uint32_t start = 0;
+    for (const std::vector<Entry>& entries : tiles_)
+    {
+        p.putUnsignedIntUnaligned(start);
+        p += 4;
+        start += static_cast<uint32_t>(entries.size());
+    }
+    p.putUnsignedIntUnaligned(start);
+    p += 4;
+    for (uint32_t revision : revisions_)
+    {
+        p.putUnsignedIntUnaligned(revision);
+        p += 4;
+    }
+    for (const std::vector<Entry>& entries : tiles_)
+    {
+        for (const Entry& entry : entries)
+        {
+            p.putUnsignedShortUnaligned(entry.key);
+            (p + 2).putUnsignedShortUnaligned(entry.value);
+            (p + 4).putUnsignedShortUnaligned(entry.bucket);
+            (p + 6).putUnsignedShortUnaligned(entry.reserved);
+            (p + 8).putUnsignedIntUnaligned(entry.count);
+            p += ENTRY_SIZE;
+        }
+    }
+    assert(p.ptr() == data.data() + data.size());
+    File::writeAll(fileName, data.data(), data.size());
+}
+
+
+std::unique_ptr<TileStatistics> TileStatistics::load(
+    const char* fileName, const UUID& guid, uint32_t revision)
+{
+    if (!File::exists(fileName)) return nullptr;
+    ByteBlock data = File::readAll(fileName);
+    if (data.size() < HEADER_SIZE) return nullptr;
+    DataPtr p(data.data());
+    if (p.getUnsignedIntUnaligned() != MAGIC ||
+        (p + 4).getUnsignedShortUnaligned() != VERSION ||
+        UUID((p + 8).ptr()) != guid ||
+        (p + 24).getUnsignedIntUnaligned() != revision)
+    {
+        return nullptr;
+    }
+    size_t keyCount = (p + 6).getUnsignedShortUnaligned();
+    size_t tileCount = (p + 28).getUnsignedIntUnaligned();
+    uint32_t entryCount = (p + 32).getUnsignedIntUnaligned();
+    size_t keysSize = (keyCount * 2 + 3) & ~size_t(3);
+    size_t presentCount = (tileCount + 31) / 32;
+    if (data.size() != HEADER_SIZE + keysSize + (presentCount + tileCount * 2 + 1) * 4 +
+        static_cast<size_t>(entryCount) * ENTRY_SIZE)
+    {
+        return nullptr;
+    }
+    p += HEADER_SIZE;
+
+    std::vector<uint16_t> keys(keyCount);
+    for (size_t i = 0; i < keyCount; i++)
+    {
+        keys[i] = (p + i * 2).getUnsignedShortUnaligned();
+    }
+    if (!std::is_sorted(keys.begin(), keys.end()) ||
+        (!keys.empty() && keys[0] == 0))
+    {
+        return nullptr;
+    }
+    p += keysSize;
+    DataPtr present = p;
+    p += presentCount * 4;
+    DataPtr starts = p;
+    p += (tileCount + 1) * 4;
+    DataPtr revisions = p;
+    p += tileCount * 4;
+    uint32_t prevStart = 0;
+    for (size_t tip = 0; tip <= tileCount; tip++)
+    {
+        uint32_t start = (starts + tip * 4).getUnsignedIntUnaligned();
+        if (start < prevStart) return nullptr;
+        prevStart = start;
+    }
+    if (prevStart != entryCount) return nullptr;
+
+    auto statistics = std::make_unique<TileStatistics>(
+        guid, revision, std::move(keys));
+    for (uint32_t tip = 0; tip < tileCount; tip++)
+    {
+        uint32_t bits = (present + tip / 32 * 4).getUnsignedIntUnaligned();
+        if ((bits & (1u << (tip % 32))) == 0) continue;
+        uint32_t start = (starts + tip * 4).getUnsignedIntUnaligned();
+        uint32_t end = (starts + (tip + 1) * 4).getUnsignedIntUnaligned();
+        std::vector<Entry> entries(end - start);
+        DataPtr pEntry = p + static_cast<size_t>(start) * ENTRY_SIZE;
+        for (Entry& entry : entries)
+        {
+            entry.key = pEntry.getUnsignedShortUnaligned();
+            entry.value = (pEntry + 2).getUnsignedShortUnaligned();
+            entry.bucket = (pEntry + 4).getUnsignedShortUnaligned();
+            entry.reserved = (pEntry + 6).getUnsignedShortUnaligned();
+            entry.count = (pEntry + 8).getUnsignedIntUnaligned();
+            pEntry += ENTRY_SIZE;
+        }
+        statistics->setTile(Tip(tip),
+            (revisions + tip * 4).getUnsignedIntUnaligned(), std::move(entries));
+    }
+    return statistics;
+}
+
+
+bool TileStatistics::criteria(FeatureTypes types, const MatcherHolder* matcher,
+    Criteria& criteria) const
+{
+    int key = matcher->simpleKeyCode();
+    if (key < 0) return false;
+    if (key != 0 && keySlot(key) < 0) return false;
+    int value = matcher->simpleValueCode();
+    if (value >= MORE_VALUES) return false;
+    criteria.types = types;
+    criteria.key = static_cast<uint16_t>(key);
+    criteria.value = value < 0 ? ANY_VALUE : static_cast<uint16_t>(value);
+    return true;
+}
+
+
+int64_t TileStatistics::count(Tip tip, uint32_t tileRevision,
+    uint32_t northwestFlags, const Criteria& criteria) const
+{
+    if (tip >= tiles_.size() || !present_[tip]) return -1;
+        // (a tile that was missing when the statistics were built)
+    if (revisions_[tip] != tileRevision) return -1;
+        // (a tile that has been replaced since)
+    const std::vector<Entry>& entries = tiles_[tip];
+    Entry tag { criteria.key, criteria.value, 0, 0, 0 };
+    auto [begin, end] = std::equal_range(entries.begin(), entries.end(),
+        tag, compareTag);
+    if (begin == end)
+    {
+        if (criteria.value != ANY_VALUE)
+        {
+            tag.value = MORE_VALUES;
+            if (std::binary_search(entries.begin(), entries.end(),
+                tag, compareTag))
+            {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    int64_t count = 0;
+    for (auto it = begin; it != end; ++it)
+    {
+        int flags = it->bucket << 1;
+        if (criteria.types.acceptFlags(flags) && (flags & northwestFlags) == 0)
+        {
+            count += it->count;
+        }
+    }
+    return count;
+}
+
+} // namespace geodesk
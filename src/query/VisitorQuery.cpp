@@ -0,0 +1,18 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <geodesk/query/VisitorQuery.h>
+
+namespace geodesk {
+
+VisitorQuery::VisitorQuery(FeatureStore* store, const Box& box, FeatureTypes types,
+    const MatcherHolder* matcher, const Filter* filter,
+    FeatureVisitor visitor, void* closure) :
+    ReductionQuery(store, box, types, matcher, filter, QueryReduction::VISIT),
+    visitor_(visitor),
+    closure_(closure),
+    callerSlot_(slotCount(store) - 1)
+{
+}
+
+} // namespace geodesk
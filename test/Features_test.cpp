@@ -1,13 +1,24 @@
 // Copyright (c) 2024 Clarisma / GeoDesk contributors
 // SPDX-License-Identifier: LGPL-3.0-only
 
+#include <atomic>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <memory>
+#include <random>
 #include <set>
+#include <stdexcept>
 #include <string_view>
 #include <catch2/catch_test_macros.hpp>
 #include <geodesk/geodesk.h>
+#include <geodesk/geom/index/MCIndexBuilder.h>
+#include <geodesk/feature/FeatureStore_Transaction.h>
+#include <geodesk/feature/GlobalStrings.h>
+#include <geodesk/query/ReductionQuery.h>
+#include <geodesk/query/TileIndexWalker.h>
+#include <geodesk/query/TileStatistics.h>
 
 using namespace geodesk;
 
@@ -248,4 +259,336 @@ TEST_CASE("WayNodes with IDs (#25)")
 	std::cout << count << " waynodes\n";
 }
 
+TEST_CASE_METHOD(GolFixture, "Counts from tile statistics")
+{
+	FeatureStore* store = world.store();
+	const char* queries[] = { "*", "na", "na[amenity]", "w[highway=primary]", "n[amenity=pharmacy]" };
+	Box boxes[] = { Box::ofWorld(), Box::ofWSEN(-10, 35, 30, 60), Box::ofWSEN(7.3, 43.6, 7.5, 43.8) };
+	std::vector<uint64_t> expected;
+	for (const char* query : queries)
+	{
+		for (const Box& box : boxes) expected.push_back(world(query)(box).count());
+	}
+	store->setTileStatistics(TileStatistics::build(store));
+	size_t i = 0;
+	for (const char* query : queries)
+	{
+		for (const Box& box : boxes)
+		{
+			REQUIRE(world(query)(box).count() == expected[i++]);
+		}
+	}
+	store->setTileStatistics(nullptr);
+}
+
+namespace {
+
+uint64_t countAmenities(FeatureStore* store, QueryStats& stats)
+{
+	const MatcherHolder* matcher = store->getMatcher("n[amenity]");
+	ReductionQuery query(store, Box::ofWorld(), FeatureTypes::NODES, matcher,
+		nullptr, QueryReduction::COUNT, 0, &stats);
+	uint64_t count = query.run().count;
+	matcher->release();
+	return count;
+}
+
+}
+
+TEST_CASE("Counts from tile statistics leave out replaced tiles")
+{
+	// Works on a copy of the GOL (with a sidecar of its own)
+	std::filesystem::path path = std::filesystem::temp_directory_path() /
+		"geodesk-replaced-tile.gol";
+	std::filesystem::copy_file(R"(d:\geodesk\tests\monaco.gol)", path,
+		std::filesystem::copy_options::overwrite_existing);
+	std::string fileName = path.string();
+
+	FeatureStore* store = new FeatureStore();
+	store->open(fileName.c_str(), clarisma::FreeStore::OpenMode::WRITE);
+	std::string statisticsFileName = TileStatistics::defaultFileName(store);
+	TileStatistics::build(store)->save(statisticsFileName.c_str());
+	QueryStats before;
+	uint64_t count = countAmenities(store, before);
+	REQUIRE(before.tilesCounted > 0);
+
+	// Replace a tile with a copy (of a new revision) in which
+	// an amenity has been changed to amenity=no
+	int amenity = store->strings().getCode("amenity");
+	REQUIRE(amenity >= 0);
+	Tip tip;
+	std::vector<uint8_t> data;
+	TileIndexWalker walker(store->tileIndex(), store->zoomLevels(),
+		Box::ofWorld(), nullptr);
+	do
+	{
+		if (!walker.currentEntry().isLoadedAndCurrent())
+		{
+			walker.skipChildren();
+			continue;
+		}
+		TilePtr pTile = store->fetchTile(walker.currentTip());
+		const MatcherHolder* matcher = store->getMatcher("n[amenity]");
+		Query query(store, walker.currentTile().bounds(), FeatureTypes::NODES,
+			matcher, nullptr);
+		for (FeaturePtr f = query.next(); data.empty() && !f.isNull(); f = query.next())
+		{
+			if (f.ptr() < pTile || f.ptr() >= pTile + pTile.totalSize()) continue;
+			DataPtr p = f.tags().ptr();
+			for (;;)
+			{
+				uint32_t tag = p.getUnsignedIntUnaligned();
+				if (((tag & 0x7ffc) >> 2) == amenity && (tag & 3) == 1)
+				{
+					tip = walker.currentTip();
+					data.assign(pTile.ptr(), pTile.ptr() + pTile.totalSize());
+					uint16_t no = GlobalStrings::NO;
+					std::memcpy(&data[p.ptr() - pTile.ptr() + 2], &no, 2);
+					uint32_t revision = pTile.revision() + 1;
+					std::memcpy(&data[REVISION_OFS], &revision, 4);
+					break;
+				}
+				if (tag & 0x8000) break;
+				p += 4 + (tag & 2);
+			}
+		}
+		matcher->release();
+	}
+	while (data.empty() && walker.next());
+	REQUIRE_FALSE(data.empty());
+
+	FeatureStore::Transaction tx(*store);
+	tx.begin();
+	tx.putTile(tip, data);
+	tx.commit();
+	tx.end();
+	store->release();
+
+	// The replaced tile is scanned, rather than counted from
+	// the (unchanged) sidecar
+	store = new FeatureStore();
+	store->open(fileName.c_str());
+	QueryStats after;
+	REQUIRE(countAmenities(store, after) == count - 1);
+	REQUIRE(after.tilesCounted == before.tilesCounted - 1);
+	store->release();
+	std::filesystem::remove(statisticsFileName);
+	std::filesystem::remove(path);
+}
+
 // TODO: Test if parent relation iterator respect types
+
+TEST_CASE_METHOD(GolFixture, "Prepared filters are reused")
+{
+	FeatureStore* store = monaco.store();
+	FilterCache& filters = store->filters();
+	filters.clear();
+	Feature monacoArea = monaco("a[boundary=administrative][admin_level=2]").one();
+	uint64_t within = monaco("na[amenity]").within(monacoArea).count();
+	uint64_t intersecting = monaco("w[highway]").intersecting(monacoArea).count();
+	FilterCache::Stats before = filters.stats();
+	REQUIRE(before.size == 2);
+	REQUIRE(before.memory > 0);
+
+	REQUIRE(monaco("na[amenity]").within(monacoArea).count() == within);
+	REQUIRE(monaco("w[highway]").intersecting(monacoArea).count() == intersecting);
+	FilterCache::Stats after = filters.stats();
+	REQUIRE(after.hits == before.hits + 2);
+	REQUIRE(after.size == 2);
+
+	filters.invalidate(monacoArea.ptr());
+	REQUIRE(filters.stats().size == 0);
+	REQUIRE(filters.stats().memory == 0);
+	filters.setLimits(FilterCache::DEFAULT_CAPACITY, 0);
+	REQUIRE(monaco("na[amenity]").within(monacoArea).count() == within);
+	REQUIRE(filters.stats().size == 0);
+	filters.setLimits(FilterCache::DEFAULT_CAPACITY, FilterCache::DEFAULT_MAX_MEMORY);
+}
+
+TEST_CASE_METHOD(GolFixture, "Parallel MCIndex build")
+{
+	FeatureStore* store = world.store();
+	Feature france = world("a[boundary=administrative][admin_level=2][name=France]").one();
+	RelationPtr relation(france.ptr());
+	MCIndexBuilder serialBuilder;
+	serialBuilder.setThreadCount(1);
+	serialBuilder.segmentizeAreaRelation(store, relation);
+	MCIndex serial = serialBuilder.build(relation.bounds());
+	MCIndexBuilder parallelBuilder;
+	parallelBuilder.setThreadCount(0);
+	parallelBuilder.segmentizeAreaRelation(store, relation);
+	REQUIRE(parallelBuilder.estimatedIndexSize() == serialBuilder.estimatedIndexSize());
+	MCIndex parallel = parallelBuilder.build(relation.bounds());
+
+	Box bounds = relation.bounds();
+	std::mt19937 random(3);
+	for (int i = 0; i < 10000; i++)
+	{
+		Coordinate c(
+			bounds.minX() + static_cast<int32_t>(random() % bounds.widthSimple()),
+			bounds.minY() + static_cast<int32_t>(random() % bounds.height()));
+		REQUIRE(parallel.locatePoint(c) == serial.locatePoint(c));
+		Box box(c.x, c.y, c.x + 50000, c.y + 50000);
+		REQUIRE(parallel.locateBox(box) == serial.locateBox(box));
+	}
+}
+
+TEST_CASE_METHOD(GolFixture, "Tile classification of large areas")
+{
+	Feature france = world("a[boundary=administrative][admin_level=2][name=France]").one();
+	Feature paris = world("a[boundary=administrative][admin_level=8][name=Paris]").one();
+	Features intersecting = world("w[highway]").intersecting(france);
+	Features within = world("na[amenity]").within(france);
+	uint64_t intersectingCount = intersecting.count();
+	uint64_t withinCount = within.count();
+
+	// The filters (and the tile classifications they remember)
+	// are reused by repeated queries
+	QueryStats first = intersecting.explain();
+	QueryStats second = intersecting.explain();
+	REQUIRE(second.tilesVisited == first.tilesVisited);
+	REQUIRE(second.tilesSkipped == first.tilesSkipped);
+	REQUIRE(second.tilesFastAccepted == first.tilesFastAccepted);
+	REQUIRE(first.tilesFastAccepted > 0);
+	REQUIRE(intersecting.count() == intersectingCount);
+	REQUIRE(within.count() == withinCount);
+
+	// Combined spatial filters inherit each filter's classification
+	std::set<const uint8_t*> inFrance;
+	for (Feature f : world("na[amenity]").within(france))
+	{
+		inFrance.insert(f.ptr().ptr().ptr());
+	}
+	uint64_t expected = 0;
+	for (Feature f : world("na[amenity]").intersecting(paris))
+	{
+		expected += inFrance.count(f.ptr().ptr().ptr());
+	}
+	REQUIRE(world("na[amenity]").within(france).intersecting(paris).count() == expected);
+}
+
+TEST_CASE_METHOD(GolFixture, "Nested queries in parallel visitors")
+{
+	// Each visitor runs a query of its own on the worker thread; this
+	// must neither deadlock nor lose any features
+	Features parks = monaco("a[leisure=park]");
+	Features trees = monaco("n[natural=tree]");
+	int64_t serial = 0;
+	for (Feature park : parks) serial += trees.within(park).count();
+	int64_t parallel = parks.reduceParallel(int64_t(0),
+		[&trees](int64_t& total, Feature park) { total += trees.within(park).count(); },
+		[](int64_t& total, int64_t&& partial) { total += partial; });
+	REQUIRE(parallel == serial);
+}
+
+TEST_CASE_METHOD(GolFixture, "Exceptions stop parallel visits")
+{
+	Features buildings = world("a[building]");
+	std::atomic<int64_t> visited(0);
+	REQUIRE_THROWS_AS(buildings.forEachParallel([&visited](Feature)
+		{
+			if (visited.fetch_add(1) == 1000) throw std::runtime_error("stop");
+		}), std::runtime_error);
+	// Once a visitor has failed, only the visits that were already
+	// under way on other threads may still happen
+	REQUIRE(visited <= 1001 + world.store()->executor().threadCount());
+}
+
+TEST_CASE_METHOD(GolFixture, "Capped query parallelism")
+{
+	Features restaurants = monaco("na[amenity=restaurant]");
+	uint64_t count = restaurants.count();
+	size_t iterated = std::vector<Feature>(restaurants).size();
+	restaurants.setMaxQueryParallelism(1);
+	REQUIRE(monaco.maxQueryParallelism() == 1);
+		// The cap applies to the entire GOL
+	REQUIRE(restaurants.count() == count);
+	REQUIRE(std::vector<Feature>(restaurants).size() == iterated);
+	monaco.setMaxQueryParallelism(0);
+}
+
+TEST_CASE_METHOD(GolFixture, "Abandoned iterations")
+{
+	// Leaving an iteration early cancels the query: Once the iterator
+	// is gone, none of its tiles are left in the executor
+	Features buildings = world("a[building]");
+	uint64_t count = buildings.count();
+	for (int i = 0; i < 20; i++)
+	{
+		int n = 0;
+		for (Feature building : buildings)
+		{
+			if (++n == 100) break;
+		}
+		REQUIRE(n == 100);
+		auto stats = world.store()->executor().stats();
+		REQUIRE(stats.queueDepth == 0);
+		REQUIRE(stats.dequeDepth == 0);
+	}
+	REQUIRE(buildings.count() == count);
+}
+
+TEST_CASE_METHOD(GolFixture, "Queries with a limit")
+{
+	FeatureStore* store = monaco.store();
+	const MatcherHolder* matcher = store->getMatcher("na[amenity]");
+	FeatureTypes types = FeatureTypes::NODES | FeatureTypes::AREAS;
+	std::set<const uint8_t*> all;
+	{
+		Query query(store, Box::ofWorld(), types, matcher, nullptr);
+		for (FeaturePtr f = query.next(); !f.isNull(); f = query.next())
+		{
+			all.insert(f.ptr().ptr());
+		}
+	}
+	REQUIRE(all.size() > 100);
+
+	for (uint32_t limit : { 1u, 2u, 10u, 100u, static_cast<uint32_t>(all.size()),
+		static_cast<uint32_t>(all.size() + 10) })
+	{
+		Query query(store, Box::ofWorld(), types, matcher, nullptr, limit);
+		std::set<const uint8_t*> found;
+		for (FeaturePtr f = query.next(); !f.isNull(); f = query.next())
+		{
+			REQUIRE(all.count(f.ptr().ptr()) == 1);
+			found.insert(f.ptr().ptr());
+		}
+		REQUIRE(found.size() == std::min<size_t>(limit, all.size()));
+		REQUIRE(query.next().isNull());
+	}
+
+	// Reductions stop early, but count at least as many
+	// features as the limit (unless there are fewer)
+	for (uint32_t limit : { 1u, 10u, static_cast<uint32_t>(all.size() + 10) })
+	{
+		ReductionQuery query(store, Box::ofWorld(), types, matcher, nullptr,
+			QueryReduction::COUNT, limit);
+		uint64_t count = query.run().count;
+		REQUIRE(count >= std::min<uint64_t>(limit, all.size()));
+		REQUIRE(count <= all.size());
+		if (limit > all.size()) REQUIRE(count == all.size());
+	}
+	REQUIRE_FALSE(monaco("na[amenity]").isEmpty());
+	REQUIRE(monaco("na[xyz:nonsense_tag]").isEmpty());
+	matcher->release();
+}
+
+TEST_CASE_METHOD(GolFixture, "Statistics of an actual iteration")
+{
+	Features restaurants = world("na[amenity=restaurant]")(Box::ofWSEN(-10, 35, 30, 60));
+	QueryStats stats;
+	uint64_t iterated = 0;
+	for (Feature restaurant : restaurants.withStats(stats)) iterated++;
+	REQUIRE(stats.totals().hits == iterated);
+	REQUIRE(stats.tilesCounted == 0);
+	REQUIRE(stats.totalNanos > 0);
+
+	QueryStats countStats;
+	REQUIRE(restaurants.count(countStats) == iterated);
+	REQUIRE(countStats.totalNanos > 0);
+
+	// Leaving the loop early still completes the statistics
+	QueryStats partial;
+	for (Feature restaurant : restaurants.withStats(partial)) break;
+	REQUIRE(partial.totalNanos > 0);
+}
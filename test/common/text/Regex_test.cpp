@@ -0,0 +1,120 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <chrono>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <clarisma/text/Regex.h>
+
+using namespace clarisma;
+
+namespace {
+
+// A sample of tag values, roughly in the proportions in which they
+// occur in OSM data (most values are short and come from a small
+// vocabulary; names, addresses and opening hours make up the rest)
+
+const char* const VALUES[] =
+{
+    "yes", "no", "residential", "service", "footway", "track",
+    "primary", "secondary", "tertiary", "primary_link", "motorway_link",
+    "unclassified", "path", "house", "building", "parking", "asphalt",
+    "Rue de la Paix", "Rue du Faubourg Saint-Honoré", "Avenue Foch",
+    "Hauptstraße", "Berliner Straße", "Am Markt", "Kirchweg",
+    "Main Street", "North 5th Avenue", "Calle Mayor", "Via Roma",
+    "Mo-Fr 08:00-18:00", "Mo-Sa 09:00-20:00; Su off", "24/7",
+    "+49 30 1234567", "+33 1 42 68 53 00", "info@example.com",
+    "https://www.example.org/", "50", "30", "120", "walk", "DE:urban",
+    "10115", "75008", "2a", "117", "",
+};
+
+// Patterns that are typical for queries (plus a few that exercise
+// the fallback to std::regex)
+
+const char* const PATTERNS[] =
+{
+    "^Rue .*", ".*link", "[A-Z].*stra(ss|ß)e", "(primary|secondary|tertiary)(_link)?",
+    "\\d+", "\\d{5}", "[0-9]+[a-z]?", "Mo-(Fr|Sa) .*", "\\+\\d{2} .*",
+    "[\\w.]+@[\\w.]+\\.[a-z]{2,3}", "https?://.*", "(?:Rue|Avenue) .*",
+    ".*[Ss]traße$", "^$", "a|b|yes", "[^a-z]*", ".*(Paix|Foch).*",
+    "(a)\\1", "\\bMain\\b.*",
+};
+
+} // namespace
+
+
+TEST_CASE("Regex matches like std::regex")
+{
+    std::mt19937 random(42);
+    std::vector<std::string> inputs(std::begin(VALUES), std::end(VALUES));
+    const char alphabet[] = "abeinrstuxyz RSM019-_+.:/@()ß";
+    for (int i = 0; i < 2000; i++)
+    {
+        std::string s;
+        int len = random() % 12;
+        for (int j = 0; j < len; j++)
+        {
+            s += alphabet[random() % (sizeof(alphabet) - 1)];
+        }
+        inputs.push_back(s);
+    }
+
+    for (const char* pattern : PATTERNS)
+    {
+        Regex regex(pattern);
+        std::regex stdRegex(pattern);
+        for (const std::string& s : inputs)
+        {
+            INFO(pattern << " / \"" << s << "\"");
+            REQUIRE(regex.match(s) == std::regex_match(s, stdRegex));
+        }
+    }
+}
+
+TEST_CASE("Regex falls back to std::regex")
+{
+    REQUIRE(Regex("a+b").isCompiled());
+    REQUIRE(Regex("(?:ab|cd){2,3}").isCompiled());
+    REQUIRE_FALSE(Regex("(a)\\1").isCompiled());      // backreference
+    REQUIRE_FALSE(Regex("(?=a)a").isCompiled());      // lookahead
+    REQUIRE_FALSE(Regex("\\bx").isCompiled());        // word boundary
+    REQUIRE_THROWS_AS(Regex("(a"), std::regex_error);
+    REQUIRE_THROWS_AS(Regex("[z-a]"), std::regex_error);
+    REQUIRE_THROWS_AS(Regex("a{2,1}"), std::regex_error);
+}
+
+// Run explicitly: geodesk-test "[regex-benchmark]"
+TEST_CASE("Regex benchmark", "[.][regex-benchmark]")
+{
+    std::mt19937 random(7);
+    std::vector<std::string> values;
+    for (int i = 0; i < 100000; i++)
+    {
+        values.push_back(VALUES[random() % std::size(VALUES)]);
+    }
+
+    for (const char* pattern : PATTERNS)
+    {
+        Regex regex(pattern);
+        std::regex stdRegex(pattern);
+
+        auto start = std::chrono::steady_clock::now();
+        size_t hits = 0;
+        for (const std::string& s : values) hits += regex.match(s);
+        auto mid = std::chrono::steady_clock::now();
+        size_t stdHits = 0;
+        for (const std::string& s : values) stdHits += std::regex_match(s, stdRegex);
+        auto end = std::chrono::steady_clock::now();
+        REQUIRE(hits == stdHits);
+
+        double ns = std::chrono::duration<double, std::nano>(mid - start).count()
+            / values.size();
+        double stdNs = std::chrono::duration<double, std::nano>(end - mid).count()
+            / values.size();
+        WARN(pattern << " (" << (regex.isCompiled() ? "dfa" : "std") << "): "
+            << ns << " ns, std::regex " << stdNs << " ns");
+    }
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <atomic>
+#include <catch2/catch_test_macros.hpp>
+#include <clarisma/thread/WorkStealingPool.h>
+
+using namespace clarisma;
+
+namespace {
+
+std::atomic<int64_t> total;
+
+struct AddTask
+{
+	AddTask() : value(0) {}
+	explicit AddTask(int v) : value(v) {}
+
+	void operator()() const
+	{
+		total.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	int value;
+};
+
+} // namespace
+
+TEST_CASE("WorkStealingPool runs all tasks")
+{
+	total = 0;
+	int64_t expected = 0;
+	WorkStealingPool<AddTask> pool(4, 32);
+	for (int i = 1; i <= 10000; i++)
+	{
+		AddTask task(i);
+		// Same fallback as Query::requestTiles(): run on the
+		// caller's thread if the queue is full
+		if (!pool.tryPost(task)) task();
+		expected += i;
+	}
+	pool.awaitCompletion();
+	REQUIRE(total == expected);
+}
+
+TEST_CASE("WorkStealingPool batch submission")
+{
+	total = 0;
+	int64_t expected = 0;
+	WorkStealingPool<AddTask> pool(3, 16);
+	AddTask batch[10];
+	for (int round = 0; round < 1000; round++)
+	{
+		for (int i = 0; i < 10; i++)
+		{
+			batch[i] = AddTask(round * 10 + i);
+			expected += round * 10 + i;
+		}
+		int posted = pool.tryPostBatch(batch, 10);
+		REQUIRE(posted >= 0);
+		REQUIRE(posted <= 10);
+		for (int i = posted; i < 10; i++) batch[i]();
+	}
+	pool.awaitCompletion();
+	REQUIRE(total == expected);
+}
+
+TEST_CASE("WorkStealingPool stats and thread init")
+{
+	total = 0;
+	std::atomic<int> initialized(0);
+	int workerTasks = 0;
+	{
+		WorkStealingPool<AddTask> pool(2, 8,
+			[&initialized](int) { initialized.fetch_add(1); });
+		for (int i = 0; i < 1000; i++)
+		{
+			AddTask task(1);
+			if (pool.tryPost(task)) workerTasks++; else task();
+		}
+		pool.awaitCompletion();
+		auto stats = pool.stats();
+		REQUIRE(stats.threadCount == 2);
+		REQUIRE(stats.queueCapacity == 8);
+		REQUIRE(stats.queueDepth == 0);
+		REQUIRE(stats.tasksRun == static_cast<uint64_t>(workerTasks));
+		REQUIRE(stats.utilization() >= 0);
+		REQUIRE(stats.utilization() <= 1);
+	}
+	REQUIRE(initialized == 2);
+	REQUIRE(total == 1000);
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <clarisma/util/LruCache.h>
+
+using namespace clarisma;
+
+
+TEST_CASE("LruCache evicts the least-recently-used entry")
+{
+	LruCache<std::string, int> cache(3);
+	std::vector<int> evicted;
+	auto evict = [&evicted](int v) { evicted.push_back(v); };
+
+	cache.put("a", 1, evict);
+	cache.put("b", 2, evict);
+	cache.put("c", 3, evict);
+	REQUIRE(*cache.get("a") == 1);		// "b" is now the oldest
+	cache.put("d", 4, evict);
+	REQUIRE(evicted == std::vector<int>{ 2 });
+	REQUIRE(cache.get("b") == nullptr);
+	REQUIRE(*cache.get("c") == 3);
+	REQUIRE(*cache.get("d") == 4);
+
+	LruCache<std::string, int>::Stats stats = cache.stats();
+	REQUIRE(stats.hits == 3);
+	REQUIRE(stats.misses == 1);
+	REQUIRE(stats.evictions == 1);
+	REQUIRE(stats.size == 3);
+
+	cache.setCapacity(1, evict);		// "a" is oldest, then "c"
+	REQUIRE(evicted == std::vector<int>{ 2, 1, 3 });
+	REQUIRE(cache.size() == 1);
+
+	cache.clear(evict);
+	REQUIRE(evicted == std::vector<int>{ 2, 1, 3, 4 });
+	REQUIRE(cache.size() == 0);
+
+	cache.setCapacity(0, evict);
+	cache.put("e", 5, evict);			// not retained
+	REQUIRE(cache.size() == 0);
+	REQUIRE(evicted.back() == 5);
+}
+
+
+TEST_CASE("LruCache can drop single entries")
+{
+	LruCache<std::string, int> cache(3);
+	std::vector<int> evicted;
+	auto evict = [&evicted](int v) { evicted.push_back(v); };
+
+	cache.put("a", 1, evict);
+	cache.put("b", 2, evict);
+	cache.put("c", 3, evict);
+	REQUIRE(cache.remove("b", evict));
+	REQUIRE_FALSE(cache.remove("b", evict));
+	REQUIRE(evicted == std::vector<int>{ 2 });
+	REQUIRE(cache.size() == 2);
+	REQUIRE(cache.stats().evictions == 0);
+
+	REQUIRE(cache.evictLeastRecent(evict));		// "a"
+	REQUIRE(cache.evictLeastRecent(evict));		// "c"
+	REQUIRE_FALSE(cache.evictLeastRecent(evict));
+	REQUIRE(evicted == std::vector<int>{ 2, 1, 3 });
+	REQUIRE(cache.stats().evictions == 2);
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/feature/GlobalKeySearch.h>
+
+using namespace geodesk;
+
+static const uint8_t* findGlobalKeySimple(const uint8_t* p, uint16_t keyBits)
+{
+    for (;;)
+    {
+        uint16_t key;
+        std::memcpy(&key, p, 2);
+        if (key >= keyBits) return p;
+        p += 4 + (key & 2);
+    }
+}
+
+/// Writes the global tags of a tag table (with random keys and
+/// random value sizes) so that it ends at `end`; returns its start
+///
+static size_t writeGlobalTags(std::vector<uint8_t>& buf, size_t end,
+    int count, std::mt19937& random)
+{
+    std::vector<uint8_t> table;
+    int code = 0;
+    for (int i = 0; i < count; i++)
+    {
+        code += 1 + random() % 8;
+        bool wide = random() % 3 == 0;
+        uint16_t key = static_cast<uint16_t>((code << 2) | (wide ? 2 : 0) |
+            (random() % 2) | (i == count - 1 ? 0x8000 : 0));
+        table.push_back(static_cast<uint8_t>(key));
+        table.push_back(static_cast<uint8_t>(key >> 8));
+        for (int j = 0; j < (wide ? 4 : 2); j++)
+        {
+            table.push_back(static_cast<uint8_t>(random()));
+        }
+    }
+    size_t start = (end - table.size()) & ~size_t(1);
+    std::memcpy(&buf[start], table.data(), table.size());
+    return start;
+}
+
+TEST_CASE("findGlobalKey")
+{
+    std::mt19937 random(99);
+    // Tables are placed at random, as well as at the end of a page
+    // (so the search must not read across the page boundary)
+    std::vector<uint8_t> buf(3 * 4096 + 64);
+    uint8_t* page = reinterpret_cast<uint8_t*>(
+        (reinterpret_cast<uintptr_t>(buf.data()) + 4095) & ~uintptr_t(4095));
+    size_t pageEnd = page - buf.data() + 4096;
+
+    for (int run = 0; run < 20000; run++)
+    {
+        int count = 1 + random() % 24;
+        size_t end = (run % 2) ? pageEnd : 200 + random() % 4096;
+        size_t start = writeGlobalTags(buf, end, count, random);
+        const uint8_t* p = buf.data() + start;
+        uint16_t keyBits = static_cast<uint16_t>((random() % (count * 6)) << 2);
+        REQUIRE(findGlobalKey(p, keyBits) == findGlobalKeySimple(p, keyBits));
+    }
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/feature/FeatureStore.h>
+#include <geodesk/feature/TagProjection.h>
+
+using namespace geodesk;
+
+namespace {
+
+const char* const STRINGS[] =
+{
+    "", "no", "yes", "amenity", "name", "highway", "building",
+    "residential", "maxspeed", "level", "shop"
+};
+
+// Keys that aren't global strings (several share their first
+// characters, or their length)
+const char* const LOCAL_KEYS[] =
+{
+    "name:en", "name:de", "name:fr", "addr:street", "addr:city",
+    "opening_hours:covid19", "opening_hours:covid20", "x"
+};
+
+std::vector<uint8_t> stringTable()
+{
+    std::vector<uint8_t> table;
+    uint16_t count = static_cast<uint16_t>(std::size(STRINGS));
+    table.push_back(static_cast<uint8_t>(count));
+    table.push_back(static_cast<uint8_t>(count >> 8));
+    for (const char* s : STRINGS)
+    {
+        size_t len = std::strlen(s);
+        table.push_back(static_cast<uint8_t>(len));
+        table.insert(table.end(), s, s + len);
+    }
+    return table;
+}
+
+/// Writes a tag table with a random selection of keys; global tags
+/// have narrow-number or global-string values, local tags have
+/// narrow-number values. Returns the offset of the tag table, and
+/// whether it has local keys.
+///
+std::pair<size_t,bool> writeTagTable(std::vector<uint8_t>& buf, std::mt19937& random)
+{
+    std::vector<int> globals;
+    for (int code = 3; code < static_cast<int>(std::size(STRINGS)); code++)
+    {
+        if (random() % 2) globals.push_back(code);
+    }
+    std::vector<const char*> locals;
+    for (const char* key : LOCAL_KEYS)
+    {
+        if (random() % 3 == 0) locals.push_back(key);
+    }
+
+    while ((buf.size() + locals.size() * 6) % 4) buf.push_back(0);
+    size_t localStart = buf.size();
+    buf.resize(localStart + locals.size() * 6);
+    size_t table = buf.size();
+    auto put16 = [&buf](uint16_t v)
+    {
+        buf.push_back(static_cast<uint8_t>(v));
+        buf.push_back(static_cast<uint8_t>(v >> 8));
+    };
+    if (globals.empty())
+    {
+        put16(0x8001);      // empty-table marker
+        put16(0);
+    }
+    for (size_t i = 0; i < globals.size(); i++)
+    {
+        uint16_t last = (i == globals.size() - 1) ? 0x8000 : 0;
+        bool isString = random() % 2;
+        put16(static_cast<uint16_t>(last | (globals[i] << 2) | (isString ? 1 : 0)));
+        put16(static_cast<uint16_t>(isString ? 1 + random() % 2 : random() % 100));
+    }
+    size_t keyPos = table - 4;
+    for (size_t i = 0; i < locals.size(); i++)
+    {
+        while (buf.size() % 4) buf.push_back(0);
+        size_t keyString = buf.size();
+        size_t len = std::strlen(locals[i]);
+        buf.push_back(static_cast<uint8_t>(len));
+        buf.insert(buf.end(), locals[i], locals[i] + len);
+        int32_t key = static_cast<int32_t>(
+            ((static_cast<int32_t>(keyString - table) >> 2) << 3) |
+            (i == locals.size() - 1 ? 4 : 0));
+        std::memcpy(&buf[keyPos], &key, 4);
+        uint16_t value = static_cast<uint16_t>(random() % 100);
+        std::memcpy(&buf[keyPos - 2], &value, 2);
+        keyPos -= 6;
+    }
+    for (int i = 0; i < 16; i++) buf.push_back(0);     // slack
+    return { table, !locals.empty() };
+}
+
+} // namespace
+
+
+TEST_CASE("TagProjection finds the same values as individual lookups")
+{
+    std::vector<uint8_t> strings = stringTable();
+    FeatureStore* store = new FeatureStore();
+    store->strings().create(strings.data());
+
+    std::mt19937 random(5);
+    std::vector<uint8_t> buf;
+    std::vector<std::pair<size_t,bool>> tables;
+    for (int i = 0; i < 500; i++) tables.push_back(writeTagTable(buf, random));
+
+    std::vector<std::string> allKeys = { "amenity", "name", "highway",
+        "building", "maxspeed", "level", "shop", "no", "missing",
+        "name:e", "name:en", "name:de", "addr:street", "addr:city",
+        "opening_hours:covid19", "opening_hours:covid20", "x", "y" };
+
+    for (int run = 0; run < 50; run++)
+    {
+        // A random selection of keys in random order (with duplicates)
+        std::vector<std::string_view> keys;
+        int count = random() % 12;
+        for (int i = 0; i < count; i++)
+        {
+            keys.push_back(allKeys[random() % allKeys.size()]);
+        }
+        TagProjection projection(store->strings(), keys);
+        REQUIRE(projection.size() == keys.size());
+
+        std::vector<TagBits> values(keys.size());
+        std::vector<TagValue> tagValues(keys.size());
+        for (size_t i = 0; i < 500; i++)
+        {
+            TagTablePtr tags(buf.data() + tables[i].first, tables[i].second);
+            projection.lookup(tags, values.data());
+            projection.lookup(tags, store->strings(), tagValues.data());
+            for (size_t k = 0; k < keys.size(); k++)
+            {
+                INFO(keys[k]);
+                TagBits expected = tags.getKeyValue(keys[k], store->strings());
+                REQUIRE(values[k] == expected);
+                REQUIRE(static_cast<std::string>(tagValues[k]) ==
+                    static_cast<std::string>(tags.tagValue(expected, store->strings())));
+            }
+        }
+    }
+    store->release();
+}
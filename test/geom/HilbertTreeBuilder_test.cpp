@@ -0,0 +1,103 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/geom/index/HilbertTreeBuilder.h>
+
+using namespace geodesk;
+
+namespace {
+
+using Tree = RTree<const int>;
+
+size_t totalNodeCount(size_t itemCount, int maxItemsPerNode)
+{
+    size_t count = itemCount;
+    size_t n = itemCount;
+    do
+    {
+        n = (n + maxItemsPerNode - 1) / maxItemsPerNode;
+        count += n;
+    }
+    while (n != 1);
+    return count;
+}
+
+bool collect(const Tree::Node* node, std::vector<const int*>* found)
+{
+    found->push_back(node->item());
+    return false;
+}
+
+} // namespace
+
+
+TEST_CASE("HilbertTreeBuilder builds the same tree on multiple threads")
+{
+    std::mt19937 random(11);
+    std::uniform_int_distribution<int> coord(-1'000'000'000, 1'000'000'000);
+    std::uniform_int_distribution<int> extent(0, 5'000'000);
+
+    size_t itemCount = HilbertTreeBuilder::PARALLEL_MIN_ITEMS * 3 + 17;
+    std::vector<int> values(itemCount);
+    std::vector<BoundedItem> items(itemCount);
+    for (size_t i = 0; i < itemCount; i++)
+    {
+        int x = coord(random);
+        int y = coord(random);
+        // Some items share the same center (and Hilbert distance)
+        if (i % 50 == 1)
+        {
+            x = items[i - 1].bounds.minX();
+            y = items[i - 1].bounds.minY();
+        }
+        items[i].bounds = Box(x, y, x + extent(random), y + extent(random));
+        items[i].item = &values[i];
+    }
+
+    HilbertTreeBuilder serialBuilder(nullptr);
+    Tree serial = serialBuilder.build<const int>(items.data(), itemCount, 9, Box());
+    HilbertTreeBuilder parallelBuilder(nullptr);
+    parallelBuilder.setThreadCount(4);
+    Tree parallel = parallelBuilder.build<const int>(items.data(), itemCount, 9, Box());
+
+    // Child pointers must be at the same offsets; items must be the same
+    const Tree::Node* a = serial.root();
+    const Tree::Node* b = parallel.root();
+    size_t nodeCount = totalNodeCount(itemCount, 9);
+    for (size_t i = 0; i < nodeCount; i++)
+    {
+        REQUIRE(a[i].bounds == b[i].bounds);
+        REQUIRE(a[i].endFlag() == b[i].endFlag());
+        auto pa = reinterpret_cast<uintptr_t>(a[i].item());
+        auto pb = reinterpret_cast<uintptr_t>(b[i].item());
+        bool isChild = pa >= reinterpret_cast<uintptr_t>(a) &&
+            pa < reinterpret_cast<uintptr_t>(a + nodeCount);
+        if (isChild)
+        {
+            REQUIRE(pa - reinterpret_cast<uintptr_t>(a) ==
+                pb - reinterpret_cast<uintptr_t>(b));
+        }
+        else
+        {
+            REQUIRE(pa == pb);
+        }
+    }
+
+    for (int run = 0; run < 100; run++)
+    {
+        int x = coord(random);
+        int y = coord(random);
+        Box box(x, y, x + extent(random) * 20, y + extent(random) * 20);
+        std::vector<const int*> found;
+        parallel.search(box, collect, &found);
+        size_t expected = 0;
+        for (const BoundedItem& item : items)
+        {
+            if (box.intersects(item.bounds)) expected++;
+        }
+        REQUIRE(found.size() == expected);
+    }
+}
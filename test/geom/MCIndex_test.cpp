@@ -0,0 +1,93 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <cmath>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/geom/index/MCIndexBuilder.h>
+
+using namespace geodesk;
+
+namespace {
+
+/// A star-shaped ring around the given center, with some horizontal
+/// edges (and a few vertexes that lie on the same row)
+///
+std::vector<Coordinate> ring(std::mt19937& random, Coordinate center,
+    int vertexCount, int radius)
+{
+    std::vector<Coordinate> coords;
+    for (int i = 0; i < vertexCount; i++)
+    {
+        double angle = 2 * 3.14159265358979 * i / vertexCount;
+        double r = radius * (0.5 + (random() % 1000) / 2000.0);
+        Coordinate c(center.x + static_cast<int32_t>(r * std::cos(angle)),
+            center.y + static_cast<int32_t>(r * std::sin(angle)));
+        if (i % 10 == 5) c.y = coords.back().y;
+        coords.push_back(c);
+    }
+    coords.push_back(coords.front());
+    return coords;
+}
+
+} // namespace
+
+
+TEST_CASE("MCIndex locates batches of points like single points")
+{
+    std::mt19937 random(17);
+    MCIndexBuilder builder;
+    std::vector<std::vector<Coordinate>> rings;
+    rings.push_back(ring(random, Coordinate(0, 0), 500, 1'000'000));
+    rings.push_back(ring(random, Coordinate(50'000, -20'000), 60, 200'000));  // hole
+    Box bounds;
+    for (const auto& coords : rings)
+    {
+        for (size_t i = 1; i < coords.size(); i++)
+        {
+            builder.addLineSegment(coords[i - 1], coords[i]);
+            bounds.expandToInclude(coords[i]);
+        }
+    }
+    MCIndex index = builder.build(bounds);
+
+    for (int run = 0; run < 200; run++)
+    {
+        // Points within a small area (like the nodes of a tile),
+        // including vertexes and points on the edges
+        int size = 1 << (8 + run % 14);
+        Coordinate origin(
+            static_cast<int32_t>(random() % 2'400'000) - 1'200'000,
+            static_cast<int32_t>(random() % 2'400'000) - 1'200'000);
+        std::vector<Coordinate> points;
+        int count = 1 + static_cast<int>(random() % 100);
+        for (int i = 0; i < count; i++)
+        {
+            const auto& coords = rings[random() % rings.size()];
+            switch (random() % 8)
+            {
+            case 0:
+                points.push_back(coords[random() % coords.size()]);
+                break;
+            case 1:
+            {
+                Coordinate a = coords[random() % (coords.size() - 1)];
+                points.emplace_back(origin.x + static_cast<int32_t>(random() % size), a.y);
+                break;
+            }
+            default:
+                points.emplace_back(origin.x + static_cast<int32_t>(random() % size),
+                    origin.y + static_cast<int32_t>(random() % size));
+                break;
+            }
+        }
+
+        std::vector<int8_t> locations(points.size());
+        index.locatePoints(points, locations.data());
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            REQUIRE(locations[i] == index.locatePoint(points[i]));
+        }
+    }
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/geom/LineSegment.h>
+#include <geodesk/geom/index/MonotoneChain.h>
+#include <geodesk/geom/index/SegmentIntersection.h>
+
+using namespace geodesk;
+
+namespace {
+
+/// A normalized, quadrant-monotone chain. Small steps on a coarse
+/// grid produce plenty of touching and collinear segments.
+std::vector<Coordinate> chain(std::mt19937& random, Coordinate start,
+    int vertexCount, int32_t maxStep)
+{
+    std::vector<Coordinate> coords;
+    coords.push_back(start);
+    int32_t xDirection = (random() & 1) ? 1 : -1;
+    for (int i = 1; i < vertexCount; i++)
+    {
+        Coordinate prev = coords.back();
+        coords.emplace_back(
+            static_cast<int32_t>(prev.x + xDirection * static_cast<int32_t>(random() % (maxStep + 1))),
+            static_cast<int32_t>(prev.y + 1 + static_cast<int32_t>(random() % maxStep)));
+    }
+    return coords;
+}
+
+const MonotoneChain* toChain(std::vector<uint8_t>& storage,
+    const std::vector<Coordinate>& coords)
+{
+    int count = static_cast<int>(coords.size());
+    storage.resize(MonotoneChain::storageSize(count));
+    MonotoneChain* mc = reinterpret_cast<MonotoneChain*>(storage.data());
+    mc->init(coords.data(), count);
+    return mc;
+}
+
+bool bruteForceIntersects(const std::vector<Coordinate>& a,
+    const std::vector<Coordinate>& b)
+{
+    for (size_t i = 1; i < a.size(); i++)
+    {
+        for (size_t j = 1; j < b.size(); j++)
+        {
+            if (SegmentIntersection::intersects(a[i - 1], a[i], b[j - 1], b[j])) return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+
+TEST_CASE("SegmentIntersection::orientation")
+{
+    std::mt19937 random(5);
+    for (int i = 0; i < 100000; i++)
+    {
+        // Small grid, so many points are collinear
+        auto v = [&random]() { return static_cast<int32_t>(random() % 9) - 4; };
+        Coordinate start(v(), v());
+        Coordinate end(v(), v());
+        Coordinate p(v(), v());
+        REQUIRE(SegmentIntersection::orientation(start, end, p) ==
+            LineSegment::orientation(start, end, p));
+    }
+
+    // Coordinates whose products exceed 64 bits
+    Coordinate a(INT32_MIN, INT32_MIN);
+    Coordinate b(INT32_MAX, INT32_MAX);
+    REQUIRE(SegmentIntersection::orientation(a, b, Coordinate(0, 0)) == 0);
+    REQUIRE(SegmentIntersection::orientation(a, b, Coordinate(INT32_MAX - 1, INT32_MAX)) == -1);
+    REQUIRE(SegmentIntersection::orientation(a, b, Coordinate(INT32_MAX, INT32_MAX - 1)) == 1);
+    REQUIRE(SegmentIntersection::orientation(a, Coordinate(0, 0), b) == 1);
+    REQUIRE(SegmentIntersection::orientation(b, Coordinate(0, 0), a) == 1);
+    REQUIRE(SegmentIntersection::orientation(
+        Coordinate(0, 0), Coordinate(0, 0), b) == 0);
+}
+
+
+TEST_CASE("SegmentIntersection::intersectsAny")
+{
+    std::mt19937 random(7);
+    for (int run = 0; run < 20000; run++)
+    {
+        // Every 4th run uses coordinates whose cross products
+        // exceed 32 bits
+        int32_t maxStep = (run % 4 == 0) ? 100'000'000 : 3;
+        int32_t range = (run % 4 == 0) ? 2'000'000'000 : 20;
+        auto v = [&]() { return static_cast<int32_t>(random() % range) - range / 2; };
+        int count = 1 + static_cast<int>(random() % 12);
+        std::vector<Coordinate> coords = chain(random,
+            Coordinate(v() / 4, v() / 4), count + 1, maxStep);
+        Coordinate start(v(), v());
+        Coordinate end(v(), v());
+        if (run % 5 == 1) start = coords[random() % coords.size()];
+        if (run % 7 == 2) end = start;
+
+        Box bounds = Box::normalizedSimple(start, end);
+        bounds.expandToIncludeSimple(Box::normalizedSimple(coords.front(), coords.back()));
+        if (!SegmentIntersection::isCompact(bounds)) continue;
+
+        bool expected = false;
+        for (int i = 0; i < count; i++)
+        {
+            expected |= SegmentIntersection::intersects(start, end, coords[i], coords[i + 1]);
+        }
+        REQUIRE(SegmentIntersection::intersectsAny(start, end, coords.data(), count) == expected);
+    }
+}
+
+
+TEST_CASE("MonotoneChain::intersects")
+{
+    std::mt19937 random(9);
+    std::vector<uint8_t> storageA;
+    std::vector<uint8_t> storageB;
+    int intersecting = 0;
+    for (int run = 0; run < 40000; run++)
+    {
+        // Every 4th run uses chains that span the entire world
+        bool world = run % 4 == 0;
+        int32_t range = world ? 2'000'000'000 : 40;
+        int32_t maxStep = world ? 30'000'000 : 3;
+        auto v = [&]() { return static_cast<int32_t>(random() % range) - range / 2; };
+        std::vector<Coordinate> a = chain(random, Coordinate(v() / 2, v() / 2),
+            2 + static_cast<int>(random() % 30), maxStep);
+        std::vector<Coordinate> b = chain(random, Coordinate(v() / 2, v() / 2),
+            2 + static_cast<int>(random() % 30), maxStep);
+        if (run % 3 == 0) b.resize(2);
+        if (run % 6 == 0) b[1].y = b[0].y;     // horizontal segment
+        if (!Box::normalizedSimple(a.front(), a.back()).intersects(
+            Box::normalizedSimple(b.front(), b.back())))
+        {
+            continue;
+        }
+        const MonotoneChain* mcA = toChain(storageA, a);
+        const MonotoneChain* mcB = toChain(storageB, b);
+        bool expected = bruteForceIntersects(a, b);
+        REQUIRE(mcA->intersects(mcB) == expected);
+        REQUIRE(mcB->intersects(mcA) == expected);
+        intersecting += expected;
+    }
+    REQUIRE(intersecting > 1000);
+}
@@ -118,3 +118,14 @@ TEST_CASE("Issue 32")
 }
 
 
+
+TEST_CASE("Query normalization")
+{
+    REQUIRE(MatcherCompiler::normalizeQuery("na[amenity=cafe]") == "na[amenity=cafe]");
+    REQUIRE(MatcherCompiler::normalizeQuery("na[ amenity=cafe ,  pub]  ") == "na[amenity=cafe ,pub]");
+    REQUIRE(MatcherCompiler::normalizeQuery("n[a], \tw[b]\n") == "n[a],w[b]");
+    REQUIRE(MatcherCompiler::normalizeQuery("n[name='[ x ],  y']") == "n[name='[ x ],  y']");
+    REQUIRE(MatcherCompiler::normalizeQuery("n[name=\"a\\\" ,  b\"]") == "n[name=\"a\\\" ,  b\"]");
+    REQUIRE(MatcherCompiler::normalizeQuery(" n[a]") == " n[a]");
+        // leading whitespace is an error, so it must be kept
+}
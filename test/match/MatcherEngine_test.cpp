@@ -0,0 +1,875 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <clarisma/util/BufferWriter.h>
+#include <clarisma/util/StringBuilder.h>
+#include <geodesk/feature/FeatureStore.h>
+#include <geodesk/feature/KeySignature.h>
+#include <geodesk/feature/TagValues.h>
+#include <geodesk/match/Matcher.h>
+#include <geodesk/match/MatcherCompiler.h>
+
+using namespace geodesk;
+
+namespace {
+
+// The global strings of our synthetic FeatureStore ("shop", "opening"
+// and "kiosk" are deliberately missing, so they become local strings)
+
+const char* const STRINGS[] =
+{
+    "", "no", "yes", "amenity", "cafe", "restaurant", "highway",
+    "primary", "secondary", "maxspeed", "cuisine", "pizza", "name",
+    "50", "level", "primary_link", "bakery"
+};
+
+struct Value
+{
+    std::string str;
+    bool isNumber = false;
+    double num = 0;
+};
+
+using Tags = std::map<std::string, Value>;
+
+// A large string table has this many additional global strings,
+// named "x0" to "x59999"
+
+constexpr int EXTRA_STRINGS = 60000;
+
+int codeOf(const std::string& s)
+{
+    for (int i = 1; i < static_cast<int>(std::size(STRINGS)); i++)
+    {
+        if (s == STRINGS[i]) return i;
+    }
+    if (s.size() > 1 && s.size() <= 6 && s[0] == 'x' &&
+        std::all_of(s.begin() + 1, s.end(), [](char ch) { return ch >= '0' && ch <= '9'; }))
+    {
+        int n = std::stoi(s.substr(1));
+        if (n < EXTRA_STRINGS) return static_cast<int>(std::size(STRINGS)) + n;
+    }
+    return -1;
+}
+
+std::vector<uint8_t> stringTable(bool large)
+{
+    std::vector<uint8_t> table;
+    uint16_t count = static_cast<uint16_t>(std::size(STRINGS) +
+        (large ? EXTRA_STRINGS : 0));
+    table.push_back(static_cast<uint8_t>(count));
+    table.push_back(static_cast<uint8_t>(count >> 8));
+    for (const char* s : STRINGS)
+    {
+        size_t len = std::strlen(s);
+        table.push_back(static_cast<uint8_t>(len));
+        table.insert(table.end(), s, s + len);
+    }
+    if (large)
+    {
+        for (int i = 0; i < EXTRA_STRINGS; i++)
+        {
+            std::string s = "x" + std::to_string(i);
+            table.push_back(static_cast<uint8_t>(s.size()));
+            table.insert(table.end(), s.begin(), s.end());
+        }
+    }
+    return table;
+}
+
+/// Appends a string in the GOL format (a varint length, followed
+/// by the characters)
+///
+void putStringTo(std::vector<uint8_t>& buf, const std::string& s)
+{
+    if (s.size() < 128)
+    {
+        buf.push_back(static_cast<uint8_t>(s.size()));
+    }
+    else
+    {
+        buf.push_back(static_cast<uint8_t>(s.size() | 0x80));
+        buf.push_back(static_cast<uint8_t>(s.size() >> 7));
+    }
+    buf.insert(buf.end(), s.begin(), s.end());
+}
+
+/// Writes node features in the GOL format (just the parts that
+/// are used by the matcher: the flags and the tag table)
+///
+class Encoder
+{
+public:
+    // Returns the offset of the feature
+    size_t encode(const Tags& tags)
+    {
+        std::vector<std::pair<int, const Value*>> globalTags;
+        std::vector<std::pair<const std::string*, const Value*>> localTags;
+        for (const auto& [k, v] : tags)
+        {
+            int code = codeOf(k);
+            if (code > 0)
+            {
+                globalTags.emplace_back(code, &v);
+            }
+            else
+            {
+                localTags.emplace_back(&k, &v);
+            }
+        }
+        std::sort(globalTags.begin(), globalTags.end(),
+            [](const auto& a, const auto& b) { return a.first < b.first; });
+
+        size_t feature = align(8);
+        put32(0);       // flags (a node)
+        put32(0);
+        size_t ptrPos = put32(0);
+        put32(0);
+
+        // Local tags are placed ahead of the tag table, in reverse
+        size_t localSize = 0;
+        for (const auto& [k, v] : localTags) localSize += 4 + valueSize(*v);
+        while ((buf_.size() + localSize) % 4) buf_.push_back(0);
+        size_t localStart = buf_.size();
+        buf_.resize(localStart + localSize);
+        size_t table = buf_.size();
+        int32_t tablePtr = static_cast<int32_t>(table - ptrPos)
+            | (localTags.empty() ? 0 : 1);
+        std::memcpy(&buf_[ptrPos], &tablePtr, 4);
+
+        std::vector<std::pair<size_t, const std::string*>> stringFixups;
+        if (globalTags.empty())
+        {
+            put16(0x8001);      // empty-table marker
+            put16(0);
+        }
+        for (size_t i = 0; i < globalTags.size(); i++)
+        {
+            const auto& [code, v] = globalTags[i];
+            uint16_t last = (i == globalTags.size() - 1) ? 0x8000 : 0;
+            int type = valueType(*v);
+            put16(static_cast<uint16_t>(last | (code << 2) | type));
+            size_t valuePos = putValue(*v, type);
+            if (type == 3) stringFixups.emplace_back(valuePos, &v->str);
+        }
+
+        size_t keyPos = table - 4;
+        for (size_t i = 0; i < localTags.size(); i++)
+        {
+            const auto& [k, v] = localTags[i];
+            size_t keyString = align(4);
+            putString(*k);
+            int type = valueType(*v);
+            int32_t key = static_cast<int32_t>(
+                ((static_cast<int32_t>(keyString - table) >> 2) << 3) |
+                (i == localTags.size() - 1 ? 4 : 0) | type);
+            std::memcpy(&buf_[keyPos], &key, 4);
+            size_t valuePos = keyPos - valueSize(*v);
+            writeValue(valuePos, *v, type);
+            if (type == 3) stringFixups.emplace_back(valuePos, &v->str);
+            keyPos = valuePos - 4;
+        }
+        assert(keyPos + 4 == localStart);
+
+        for (const auto& [pos, s] : stringFixups)
+        {
+            int32_t rel = static_cast<int32_t>(putString(*s) - pos);
+            std::memcpy(&buf_[pos], &rel, 4);
+        }
+        put32(0);       // slack, since the matcher may read a little
+        put32(0);       // beyond the end of the tag table
+        return feature;
+    }
+
+    FeaturePtr feature(size_t ofs) const { return FeaturePtr(buf_.data() + ofs); }
+
+private:
+    static int valueType(const Value& v)
+    {
+        if (v.isNumber)
+        {
+            double n = v.num;
+            return (n == std::floor(n) && n >= TagValues::MIN_NUMBER &&
+                n <= TagValues::MAX_NARROW_NUMBER) ? 0 : 2;
+        }
+        return codeOf(v.str) > 0 ? 1 : 3;
+    }
+
+    static size_t valueSize(const Value& v)
+    {
+        return (valueType(v) & 2) ? 4 : 2;
+    }
+
+    size_t putValue(const Value& v, int type)
+    {
+        size_t pos = buf_.size();
+        buf_.resize(pos + ((type & 2) ? 4 : 2));
+        writeValue(pos, v, type);
+        return pos;
+    }
+
+    void writeValue(size_t pos, const Value& v, int type)
+    {
+        switch (type)
+        {
+        case 0:
+        {
+            uint16_t n = static_cast<uint16_t>(
+                static_cast<int>(v.num) - TagValues::MIN_NUMBER);
+            std::memcpy(&buf_[pos], &n, 2);
+            break;
+        }
+        case 1:
+        {
+            uint16_t code = static_cast<uint16_t>(codeOf(v.str));
+            std::memcpy(&buf_[pos], &code, 2);
+            break;
+        }
+        case 2:
+        {
+            // Wide number with one decimal place
+            int mantissa = static_cast<int>(std::lround(v.num * 10));
+            uint32_t n = (static_cast<uint32_t>(
+                mantissa - TagValues::MIN_NUMBER) << 2) | 1;
+            std::memcpy(&buf_[pos], &n, 4);
+            break;
+        }
+        default:
+            break;      // local string, filled in later
+        }
+    }
+
+    size_t putString(const std::string& s)
+    {
+        size_t pos = buf_.size();
+        putStringTo(buf_, s);
+        return pos;
+    }
+
+    size_t align(size_t n)
+    {
+        while (buf_.size() % n) buf_.push_back(0);
+        return buf_.size();
+    }
+
+    size_t put16(uint16_t v)
+    {
+        size_t pos = buf_.size();
+        buf_.resize(pos + 2);
+        std::memcpy(&buf_[pos], &v, 2);
+        return pos;
+    }
+
+    size_t put32(uint32_t v)
+    {
+        size_t pos = buf_.size();
+        buf_.resize(pos + 4);
+        std::memcpy(&buf_[pos], &v, 4);
+        return pos;
+    }
+
+    std::vector<uint8_t> buf_;
+};
+
+template<typename T>
+const T& pick(std::mt19937& random, std::initializer_list<T> choices)
+{
+    return *(choices.begin() + random() % choices.size());
+}
+
+Value randomNumber(std::mt19937& random)
+{
+    switch (random() % 4)
+    {
+    case 0: return { "", true, static_cast<double>(random() % 120) };
+    case 1: return { "", true, (random() % 1200) / 10.0 };
+    case 2: return { "", true, -static_cast<double>(random() % 250) / 10.0 };
+    default: return { pick(random, { "50", "fast", "12.5", "" }) };
+    }
+}
+
+Tags randomTags(std::mt19937& random)
+{
+    Tags tags;
+    if (random() % 3)
+    {
+        tags["amenity"] = { pick(random, { "cafe", "restaurant", "bar",
+            "yes", "bakery", "car_wash", "no" }) };
+    }
+    if (random() % 3)
+    {
+        tags["highway"] = { pick(random, { "primary", "secondary",
+            "residential", "primary_link", "motorway_link" }) };
+    }
+    if (random() % 2) tags["maxspeed"] = randomNumber(random);
+    if (random() % 2) tags["cuisine"] = { pick(random, { "pizza", "kebab" }) };
+    if (random() % 3 == 0)
+    {
+        tags["shop"] = { pick(random, { "bakery", "kiosk", "no", "yes" }) };
+    }
+    if (random() % 3 == 0) tags["opening"] = randomNumber(random);
+    // Local keys that only differ in their last characters
+    if (random() % 4 == 0)
+    {
+        tags[pick(random, { "name:en", "name:de", "name:fr" })] = { "Main Street" };
+    }
+    if (random() % 4 == 0)
+    {
+        tags[pick(random, { "opening_hours:covid19",
+            "opening_hours:covid20" })] = { "no" };
+    }
+    return tags;
+}
+
+std::string randomClause(std::mt19937& random, const std::string& k)
+{
+    switch (random() % 9)
+    {
+    case 0: return "[" + k + "]";
+    case 1: return "[!" + k + "]";
+    case 2:
+        return "[" + k + "=" + pick(random, { "cafe", "primary", "bakery",
+            "kiosk", "pizza", "50", "yes" }) + "]";
+    case 3:
+        return "[" + k + "!=" + pick(random, { "cafe,bar", "primary",
+            "bakery,kiosk", "no" }) + "]";
+    case 4:
+        return "[" + k + pick(random, { "<", "<=", ">", ">=" }) +
+            pick(random, { "30", "50", "12.5", "-4" }) + "]";
+    case 5:
+        return "[" + k + "=" + pick(random, { "*link", "ba*", "*a*",
+            "primary,*link" }) + "]";
+    case 6:
+        return "[" + k + "!=" + pick(random, { "*link", "ba*" }) + "]";
+    case 7:
+        return "[" + k + "~\"" + pick(random, { "^c.*", ".*a.*", "[0-9]+",
+            "(primary|secondary)(_link)?" }) + "\"]";
+    default:
+        return "[" + k + ">=" + pick(random, { "10", "0" }) + "][" + k +
+            "<" + pick(random, { "60", "100.5" }) + "]";
+    }
+}
+
+std::string randomQuery(std::mt19937& random)
+{
+    std::string query;
+    int selectors = 1 + random() % 3;
+    for (int i = 0; i < selectors; i++)
+    {
+        if (i > 0) query += ", ";
+        query += pick(random, { "n", "*", "na" });
+        // Each key is used by only one clause (range checks aside)
+        std::vector<std::string> keys = { "amenity", "highway", "maxspeed",
+            "cuisine", "shop", "opening" };
+        std::shuffle(keys.begin(), keys.end(), random);
+        int clauses = 1 + random() % 3;
+        for (int j = 0; j < clauses; j++) query += randomClause(random, keys[j]);
+    }
+    return query;
+}
+
+bool has(const Tags& tags, const char* key, const char* value)
+{
+    auto it = tags.find(key);
+    return it != tags.end() && !it->second.isNumber && it->second.str == value;
+}
+
+double number(const Tags& tags, const char* key)
+{
+    auto it = tags.find(key);
+    if (it == tags.end()) return NAN;
+    const Value& v = it->second;
+    if (v.isNumber) return v.num;
+    char* end;
+    double d = std::strtod(v.str.c_str(), &end);
+    return (v.str.empty() || *end) ? NAN : d;
+}
+
+const std::string* stringOf(const Tags& tags, const char* key)
+{
+    auto it = tags.find(key);
+    return (it == tags.end() || it->second.isNumber) ? nullptr : &it->second.str;
+}
+
+/// Tags whose values are mostly drawn from the extra strings of a
+/// large string table, mixed with local strings that look similar
+///
+Tags randomExtraTags(std::mt19937& random)
+{
+    Tags tags;
+    for (const char* key : { "amenity", "highway", "cuisine", "name", "level" })
+    {
+        if (random() % 4 == 0) continue;
+        std::string value = "x" + std::to_string(random() % EXTRA_STRINGS);
+        switch (random() % 4)
+        {
+        case 0: value += "b"; break;                // local
+        case 1: value = "y" + value; break;         // local
+        default: break;                             // global
+        }
+        tags[key] = { value };
+    }
+    return tags;
+}
+
+struct Fixture
+{
+    explicit Fixture(bool largeStringTable = false) :
+        strings(stringTable(largeStringTable)),
+        store(new FeatureStore()),
+        random(42)
+    {
+        store->strings().create(strings.data());
+        std::vector<size_t> offsets;
+        for (int i = 0; i < 2000; i++)
+        {
+            tags.push_back(largeStringTable ?
+                randomExtraTags(random) : randomTags(random));
+            offsets.push_back(encoder.encode(tags.back()));
+        }
+        // The buffer is final now, so we can take pointers into it
+        for (size_t ofs : offsets) features.push_back(encoder.feature(ofs));
+    }
+
+    ~Fixture()
+    {
+        store->release();
+    }
+
+    std::vector<uint8_t> strings;
+    FeatureStore* store;
+    std::mt19937 random;
+    Encoder encoder;
+    std::vector<Tags> tags;
+    std::vector<FeaturePtr> features;
+};
+
+/// Checks that acceptMany() yields the same features as calling
+/// accept() for each, for batches of various sizes (with the
+/// accepted features written to a separate array, or in place)
+///
+void checkBatches(const Matcher& matcher, const std::vector<FeaturePtr>& features,
+    std::mt19937& random)
+{
+    std::vector<FeaturePtr> expected;
+    for (FeaturePtr f : features)
+    {
+        if (matcher.accept(f)) expected.push_back(f);
+    }
+
+    std::vector<FeaturePtr> accepted;
+    size_t start = 0;
+    while (start < features.size())
+    {
+        size_t count = std::min(features.size() - start,
+            static_cast<size_t>(pick(random, { 1, 7, 32, 63, 64, 65, 200 })));
+        bool inPlace = random() % 2;
+        std::vector<FeaturePtr> batch(features.begin() + start,
+            features.begin() + start + count);
+        std::vector<FeaturePtr> out(inPlace ? 0 : count);
+        FeaturePtr* pOut = inPlace ? batch.data() : out.data();
+        size_t n = matcher.acceptMany(batch.data(), count, pOut);
+        REQUIRE(n <= count);
+        accepted.insert(accepted.end(), pOut, pOut + n);
+        start += count;
+    }
+    REQUIRE(accepted.size() == expected.size());
+    for (size_t i = 0; i < expected.size(); i++)
+    {
+        REQUIRE(accepted[i].ptr() == expected[i].ptr());
+    }
+}
+
+/// Returns the disassembled bytecode of a matcher
+///
+std::string disassemble(const MatcherHolder* matcher)
+{
+    clarisma::StringBuilder str;
+    clarisma::BufferWriter out(&str);
+    matcher->explain(out);
+    return str.toString();
+}
+
+/// Counts the instructions with the given opcode (the name must
+/// be surrounded by spaces, since names may be parts of others)
+///
+int countOps(const std::string& code, const std::string& opcode)
+{
+    int count = 0;
+    size_t pos = 0;
+    std::string name = " " + opcode + " ";
+    while ((pos = code.find(name, pos)) != std::string::npos)
+    {
+        count++;
+        pos += name.size();
+    }
+    return count;
+}
+
+} // namespace
+
+
+TEST_CASE("Compiled matchers accept the expected features")
+{
+    Fixture fixture;
+    MatcherCompiler compiler(fixture.store);
+
+    struct Case
+    {
+        const char* query;
+        bool (*expected)(const Tags&);
+    };
+
+    Case cases[] =
+    {
+        { "n[amenity=cafe]", [](const Tags& t)
+            { return has(t, "amenity", "cafe"); } },
+        { "n[amenity=cafe][highway=primary]", [](const Tags& t)
+            { return has(t, "amenity", "cafe") && has(t, "highway", "primary"); } },
+        { "n[highway=primary,secondary][cuisine=pizza]", [](const Tags& t)
+            { return (has(t, "highway", "primary") || has(t, "highway", "secondary"))
+                && has(t, "cuisine", "pizza"); } },
+        { "n[maxspeed>=30][maxspeed<=60]", [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n >= 30 && n <= 60; } },
+        { "n[maxspeed>50.5]", [](const Tags& t)
+            { return number(t, "maxspeed") > 50.5; } },
+        { "n[amenity!=cafe][highway]", [](const Tags& t)
+            { return !has(t, "amenity", "cafe") && stringOf(t, "highway")
+                && *stringOf(t, "highway") != "no"; } },
+        { "n[amenity=cafe], n[highway=primary][maxspeed<50]", [](const Tags& t)
+            { return has(t, "amenity", "cafe") || (has(t, "highway", "primary")
+                && number(t, "maxspeed") < 50); } },
+        { "n[highway=*link]", [](const Tags& t)
+            { auto s = stringOf(t, "highway"); return s && s->ends_with("link"); } },
+        { "n[highway!=*link]", [](const Tags& t)
+            { auto s = stringOf(t, "highway"); return !(s && s->ends_with("link")); } },
+        { "n[amenity=ba*]", [](const Tags& t)
+            { auto s = stringOf(t, "amenity"); return s && s->starts_with("ba"); } },
+        { "n[amenity~\"^c.*\"]", [](const Tags& t)
+            { auto s = stringOf(t, "amenity"); return s && s->starts_with("c"); } },
+        { "n[shop=kiosk]", [](const Tags& t)
+            { return has(t, "shop", "kiosk"); } },
+        { "n[shop=bakery][amenity]", [](const Tags& t)
+            { return has(t, "shop", "bakery") && stringOf(t, "amenity")
+                && *stringOf(t, "amenity") != "no"; } },
+        { "n[opening>10]", [](const Tags& t)
+            { return number(t, "opening") > 10; } },
+        { "n[shop!=bakery,kiosk]", [](const Tags& t)
+            { return !has(t, "shop", "bakery") && !has(t, "shop", "kiosk"); } },
+        { "n[maxspeed=50,fast]", [](const Tags& t)
+            { return number(t, "maxspeed") == 50 || has(t, "maxspeed", "fast"); } },
+        { "n[name:de]", [](const Tags& t)
+            { return t.count("name:de") > 0; } },
+        { "n[opening_hours:covid19=no][!name:en]", [](const Tags& t)
+            { return has(t, "opening_hours:covid19", "no") && !t.count("name:en"); } },
+    };
+
+    for (const Case& c : cases)
+    {
+        const MatcherHolder* matcher = compiler.getMatcher(c.query);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO(c.query << " / feature #" << i);
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                c.expected(fixture.tags[i]));
+        }
+        checkBatches(matcher->mainMatcher(), fixture.features, fixture.random);
+        matcher->release();
+    }
+}
+
+TEST_CASE("Simple queries use specialized matchers")
+{
+    Fixture fixture;
+    MatcherCompiler compiler(fixture.store);
+
+    auto hasKey = [](const Tags& t, const char* key)
+    {
+        auto it = t.find(key);
+        return it != t.end() && (it->second.isNumber || it->second.str != "no");
+    };
+
+    struct Case
+    {
+        const char* query;
+        int keyCode;
+        int valueCode;
+        std::function<bool(const Tags&)> expected;
+    };
+
+    // [maxspeed] covers tags with narrow-number values, which the key
+    // matcher used to skip; the types-only matcher must be released
+    // the same way as all other matchers
+    Case cases[] =
+    {
+        { "n", 0, -1, [](const Tags&) { return true; } },
+        { "n[amenity]", codeOf("amenity"), -1,
+            [&hasKey](const Tags& t) { return hasKey(t, "amenity"); } },
+        { "n[maxspeed]", codeOf("maxspeed"), -1,
+            [&hasKey](const Tags& t) { return hasKey(t, "maxspeed"); } },
+        { "n[amenity=cafe]", codeOf("amenity"), codeOf("cafe"),
+            [](const Tags& t) { return has(t, "amenity", "cafe"); } },
+    };
+
+    for (const Case& c : cases)
+    {
+        INFO(c.query);
+        const MatcherHolder* matcher = compiler.getMatcher(c.query);
+        REQUIRE(matcher->simpleKeyCode() == c.keyCode);
+        REQUIRE(matcher->simpleValueCode() == c.valueCode);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO("feature #" << i);
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                c.expected(fixture.tags[i]));
+        }
+        matcher->release();
+    }
+}
+
+TEST_CASE("Batch matching is equivalent to matching one feature at a time")
+{
+    Fixture fixture;
+    MatcherCompiler compiler(fixture.store);
+    std::mt19937 random(7);
+
+    for (int i = 0; i < 300; i++)
+    {
+        std::string query = randomQuery(random);
+        INFO(query);
+        const MatcherHolder* matcher = compiler.getMatcher(query.c_str());
+        std::vector<FeaturePtr> features = fixture.features;
+        std::shuffle(features.begin(), features.end(), random);
+        checkBatches(matcher->mainMatcher(), features, random);
+        matcher->release();
+    }
+}
+
+TEST_CASE("Global strings are pre-parsed as numbers")
+{
+    Fixture fixture;
+    const StringTable& strings = fixture.store->strings();
+    const double* numbers = strings.numbers();
+    REQUIRE(numbers == strings.numbers());      // built only once
+    for (int i = 0; i < static_cast<int>(std::size(STRINGS)); i++)
+    {
+        INFO(STRINGS[i]);
+        if (std::strcmp(STRINGS[i], "50") == 0)
+        {
+            REQUIRE(strings.getNumber(i) == 50);
+        }
+        else
+        {
+            REQUIRE(std::isnan(strings.getNumber(i)));
+        }
+    }
+}
+
+TEST_CASE("Key signatures only match identical keys")
+{
+    std::vector<std::string> keys = { "", "a", "ab", "abc", "abcd",
+        "abcde", "name:en", "name:de", "name:en2", "note:en",
+        "opening_hours:covid19", "opening_hours:covid20",
+        "opening_hours:Covid19", std::string(127, 'x'),
+        std::string(128, 'x'), std::string(200, 'x'),
+        std::string(199, 'x') + "y" };
+
+    for (const std::string& key : keys)
+    {
+        KeySignature signature(key.data(), key.size());
+        for (const std::string& other : keys)
+        {
+            INFO("\"" << key << "\" vs. \"" << other << "\"");
+            std::vector<uint8_t> buf;
+            putStringTo(buf, other);
+            buf.resize(buf.size() + 4);     // a signature may read beyond the end
+            auto str = reinterpret_cast<const clarisma::ShortVarString*>(buf.data());
+            REQUIRE(signature.matches(str, key.data(), key.size()) == (key == other));
+            if (signature.isExact())
+            {
+                REQUIRE(signature.mayMatch(str) == (key == other));
+            }
+        }
+    }
+}
+
+TEST_CASE("Superinstructions match like the instructions they replace")
+{
+    Fixture fixture;
+    MatcherCompiler compiler(fixture.store);
+
+    struct Case
+    {
+        const char* query;
+        const char* opcode;     // must occur in the bytecode
+        int opcodeCount;
+        bool (*expected)(const Tags&);
+    };
+
+    Case cases[] =
+    {
+        // Key, value load and single-value check (a lone [k=v] is
+        // turned into a simpler matcher, so we need two clauses)
+        { "n[amenity=cafe][cuisine=pizza]", "FIRST_GLOBAL_KEY_EQ_CODE", 1, [](const Tags& t)
+            { return has(t, "amenity", "cafe") && has(t, "cuisine", "pizza"); } },
+        { "n[amenity=cafe][highway=primary]", "GLOBAL_KEY_EQ_CODE", 1, [](const Tags& t)
+            { return has(t, "amenity", "cafe") && has(t, "highway", "primary"); } },
+        // Key and value load only (multiple values)
+        { "n[amenity=cafe,restaurant]", "FIRST_GLOBAL_KEY_CODE", 1, [](const Tags& t)
+            { return has(t, "amenity", "cafe") || has(t, "amenity", "restaurant"); } },
+        { "n[amenity=cafe][highway=primary,secondary]", "GLOBAL_KEY_CODE", 1, [](const Tags& t)
+            { return has(t, "amenity", "cafe") && (has(t, "highway", "primary")
+                || has(t, "highway", "secondary")); } },
+        // Ranges, with inclusive and exclusive bounds (in either order);
+        // the first comparison is reached from every value load, so
+        // only the second one must have no other callers
+        { "n[maxspeed>=30][maxspeed<=60]", "IN_RANGE", 1, [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n >= 30 && n <= 60; } },
+        { "n[maxspeed>30][maxspeed<60]", "IN_RANGE", 1, [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n > 30 && n < 60; } },
+        { "n[maxspeed<60][maxspeed>30]", "IN_RANGE", 1, [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n > 30 && n < 60; } },
+        { "n[maxspeed>12.5][maxspeed<=50]", "IN_RANGE", 1, [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n > 12.5 && n <= 50; } },
+        { "n[maxspeed>=-4][maxspeed<12.5]", "IN_RANGE", 1, [](const Tags& t)
+            { double n = number(t, "maxspeed"); return n >= -4 && n < 12.5; } },
+    };
+
+    for (const Case& c : cases)
+    {
+        const MatcherHolder* matcher = compiler.getMatcher(c.query);
+        std::string code = disassemble(matcher);
+        INFO(c.query << "\n" << code);
+        REQUIRE(countOps(code, c.opcode) == c.opcodeCount);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO("feature #" << i);
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                c.expected(fixture.tags[i]));
+        }
+        checkBatches(matcher->mainMatcher(), fixture.features, fixture.random);
+        matcher->release();
+    }
+
+    // Negated keys, and ops with more than one caller (which happens
+    // when several selectors or alternatives share a clause), must not
+    // be fused; either way, the matchers must accept the same features
+    Case unfused[] =
+    {
+        { "n[!amenity]", "GLOBAL_KEY_EQ_CODE", 0, [](const Tags& t)
+            { return !stringOf(t, "amenity") || *stringOf(t, "amenity") == "no"; } },
+        { "n[amenity!=cafe]", "FIRST_GLOBAL_KEY_EQ_CODE", 0, [](const Tags& t)
+            { return !has(t, "amenity", "cafe"); } },
+        { "n[highway][amenity!=cafe]", "GLOBAL_KEY_EQ_CODE", 0, [](const Tags& t)
+            { return stringOf(t, "highway") && *stringOf(t, "highway") != "no"
+                && !has(t, "amenity", "cafe"); } },
+        { "n[amenity=cafe][maxspeed>30], n[amenity=cafe][maxspeed<60]", "IN_RANGE", 0,
+            [](const Tags& t)
+            { double n = number(t, "maxspeed");
+              return has(t, "amenity", "cafe") && (n > 30 || n < 60); } },
+        { "n[maxspeed>30][maxspeed<60], n[highway=primary][maxspeed<60]", "LT", 1,
+            [](const Tags& t)
+            { double n = number(t, "maxspeed");
+              return (n > 30 && n < 60) || (has(t, "highway", "primary") && n < 60); } },
+        { "n[amenity=cafe][highway=primary], n[amenity=cafe][cuisine=pizza]",
+            "GLOBAL_KEY_EQ_CODE", 2,
+            [](const Tags& t)
+            { return has(t, "amenity", "cafe") && (has(t, "highway", "primary")
+                || has(t, "cuisine", "pizza")); } },
+    };
+
+    for (const Case& c : unfused)
+    {
+        const MatcherHolder* matcher = compiler.getMatcher(c.query);
+        std::string code = disassemble(matcher);
+        INFO(c.query << "\n" << code);
+        REQUIRE(countOps(code, c.opcode) == c.opcodeCount);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO("feature #" << i);
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                c.expected(fixture.tags[i]));
+        }
+        checkBatches(matcher->mainMatcher(), fixture.features, fixture.random);
+        matcher->release();
+    }
+}
+
+
+TEST_CASE("String tests on global strings use code sets")
+{
+    Fixture fixture(true);
+    MatcherCompiler compiler(fixture.store);
+
+    auto startsWith = [](const Tags& t, const char* key, const char* prefix)
+    {
+        auto s = stringOf(t, key);
+        return s && s->starts_with(prefix);
+    };
+    auto endsWith = [](const Tags& t, const char* key, const char* suffix)
+    {
+        auto s = stringOf(t, key);
+        return s && s->ends_with(suffix);
+    };
+    auto contains = [](const Tags& t, const char* key, const char* part)
+    {
+        auto s = stringOf(t, key);
+        return s && s->find(part) != std::string::npos;
+    };
+
+    SECTION("A large set, and strings that aren't global")
+    {
+        // Thousands of global strings pass, as well as some of the
+        // local ones (which must still be tested as strings)
+        const MatcherHolder* matcher = compiler.getMatcher(
+            "n[name~\".*5.*\"][highway!=x1*]");
+        std::string code = disassemble(matcher);
+        INFO(code);
+        REQUIRE(countOps(code, "CODE_IN_SET") == 2);
+        REQUIRE(countOps(code, "REGEX") == 1);
+        REQUIRE(countOps(code, "STARTS_WITH") == 1);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO("feature #" << i);
+            const Tags& t = fixture.tags[i];
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                (contains(t, "name", "5") && !startsWith(t, "highway", "x1")));
+        }
+        checkBatches(matcher->mainMatcher(), fixture.features, fixture.random);
+        matcher->release();
+    }
+
+    SECTION("Sets that are too large in combination")
+    {
+        // Each test accepts one of the last global strings, so each set
+        // takes up about 7.5 KB; the fifth set would exceed MAX_CODE_SET_SIZE,
+        // so its clause keeps testing the string instead
+        const MatcherHolder* matcher = compiler.getMatcher(
+            "n[amenity~\".*9\"][highway=x5*][cuisine~\".*99.*\"][name~\".*0.*\"][level=x*]");
+        std::string code = disassemble(matcher);
+        INFO(code);
+        REQUIRE(countOps(code, "CODE_IN_SET") == 4);
+        REQUIRE(countOps(code, "STARTS_WITH") + countOps(code, "REGEX") == 5 + 1);
+        for (size_t i = 0; i < fixture.features.size(); i++)
+        {
+            INFO("feature #" << i);
+            const Tags& t = fixture.tags[i];
+            REQUIRE(matcher->mainMatcher().accept(fixture.features[i]) ==
+                (endsWith(t, "amenity", "9") && startsWith(t, "highway", "x5") &&
+                contains(t, "cuisine", "99") && contains(t, "name", "0") &&
+                startsWith(t, "level", "x")));
+        }
+        checkBatches(matcher->mainMatcher(), fixture.features, fixture.random);
+        matcher->release();
+    }
+}
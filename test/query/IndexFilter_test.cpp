@@ -0,0 +1,95 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/feature/FeatureTypes.h>
+#include <geodesk/feature/types.h>
+#include <geodesk/query/IndexFilter.h>
+
+using namespace geodesk;
+
+// Coordinates are drawn from a small range, so that many boxes touch
+// the edges of the query box (the comparisons are inclusive)
+
+static int32_t randomCoordinate(std::mt19937& random)
+{
+    return std::uniform_int_distribution<int32_t>(-20, 20)(random);
+}
+
+static Box randomBox(std::mt19937& random)
+{
+    int32_t x1 = randomCoordinate(random);
+    int32_t x2 = randomCoordinate(random);
+    int32_t y1 = randomCoordinate(random);
+    int32_t y2 = randomCoordinate(random);
+    return Box(std::min(x1, x2), std::min(y1, y2), std::max(x1, x2), std::max(y1, y2));
+}
+
+TEST_CASE("IndexFilter::filterLeaf")
+{
+    std::mt19937 random(12345);
+    std::vector<uint8_t> buf(IndexFilter::MAX_ENTRIES * 32);
+    uint32_t multiTileFlags = FeatureFlags::MULTITILE_NORTH | FeatureFlags::MULTITILE_WEST;
+    uint32_t typeChoices[] = { FeatureTypes::ALL, FeatureTypes::WAYS,
+        FeatureTypes::AREAS, FeatureTypes::NODES | FeatureTypes::RELATIONS };
+    for (int run = 0; run < 2000; run++)
+    {
+        int count = 1 + run % IndexFilter::MAX_ENTRIES;
+        for (int i = 0; i < count; i++)
+        {
+            Box box = randomBox(random);
+            int32_t flags = static_cast<int32_t>(random()) & 0xfe;
+            memcpy(&buf[i * 32], &box, 16);
+            memcpy(&buf[i * 32 + 16], &flags, 4);
+        }
+        Box query = randomBox(random);
+        uint32_t rejected = (run & 1) ? multiTileFlags : 0;
+        FeatureTypes types = typeChoices[run % 4];
+
+        uint32_t expected = 0;
+        for (int i = 0; i < count; i++)
+        {
+            Box box;
+            int32_t flags;
+            memcpy(&box, &buf[i * 32], 16);
+            memcpy(&flags, &buf[i * 32 + 16], 4);
+            if (box.intersects(query) && (flags & rejected) == 0 &&
+                types.acceptFlags(flags))
+            {
+                expected |= 1u << i;
+            }
+        }
+        REQUIRE(IndexFilter::filterLeaf(buf.data(), count, query, rejected, types) == expected);
+    }
+}
+
+TEST_CASE("IndexFilter::filterBranch")
+{
+    std::mt19937 random(54321);
+    std::vector<uint8_t> buf(IndexFilter::MAX_ENTRIES * 20);
+    for (int run = 0; run < 2000; run++)
+    {
+        int count = 1 + run % IndexFilter::MAX_ENTRIES;
+        for (int i = 0; i < count; i++)
+        {
+            Box box = randomBox(random);
+            int32_t ptr = (i == count - 1) ? 1 : 0;
+            memcpy(&buf[i * 20], &ptr, 4);
+            memcpy(&buf[i * 20 + 4], &box, 16);
+        }
+        Box query = randomBox(random);
+
+        uint32_t expected = 0;
+        for (int i = 0; i < count; i++)
+        {
+            Box box;
+            memcpy(&box, &buf[i * 20 + 4], 16);
+            if (box.intersects(query)) expected |= 1u << i;
+        }
+        REQUIRE(IndexFilter::countEntries(buf.data(), 20, 0, IndexFilter::MAX_ENTRIES) == count);
+        REQUIRE(IndexFilter::filterBranch(buf.data(), count, query) == expected);
+    }
+}
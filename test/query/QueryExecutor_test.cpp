@@ -0,0 +1,68 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/query/QueryExecutor.h>
+
+using namespace geodesk;
+
+TEST_CASE("QueryExecutor::parallelFor calls each task once")
+{
+    for (int threadCount : { 0, 1, 2, 64 })
+    {
+        std::vector<std::atomic<int>> calls(1000);
+        QueryExecutor::parallelFor(calls.size(), threadCount, [&calls](size_t i)
+        {
+            calls[i].fetch_add(1, std::memory_order_relaxed);
+        });
+        for (const std::atomic<int>& n : calls) REQUIRE(n == 1);
+    }
+    QueryExecutor::parallelFor(0, 0, [](size_t) { FAIL("no tasks expected"); });
+}
+
+TEST_CASE("QueryExecutor::parallelFor can be nested")
+{
+    // The inner calls may run on the executor's workers; since the
+    // caller never waits for helpers that haven't started, this
+    // can't deadlock, even if every worker is busy
+    constexpr size_t OUTER = 64;
+    constexpr size_t INNER = 256;
+    std::atomic<size_t> total(0);
+    QueryExecutor::parallelFor(OUTER, 0, [&total](size_t)
+    {
+        QueryExecutor::parallelFor(INNER, 0, [&total](size_t)
+        {
+            total.fetch_add(1, std::memory_order_relaxed);
+        });
+    });
+    REQUIRE(total == OUTER * INNER);
+}
+
+TEST_CASE("QueryExecutor::parallelFor rethrows the exception of a task")
+{
+    for (int threadCount : { 0, 1, 2 })
+    {
+        std::atomic<size_t> calls(0);
+        REQUIRE_THROWS_AS(QueryExecutor::parallelFor(1000, threadCount,
+            [&calls](size_t i)
+            {
+                calls.fetch_add(1, std::memory_order_relaxed);
+                if (i == 10) throw std::runtime_error("task failed");
+            }), std::runtime_error);
+        size_t callsOnReturn = calls;
+        REQUIRE(callsOnReturn <= 1000);
+
+        // No task is called once parallelFor has returned, and the
+        // executor's workers are still usable
+        std::atomic<size_t> total(0);
+        QueryExecutor::parallelFor(1000, threadCount, [&total](size_t)
+        {
+            total.fetch_add(1, std::memory_order_relaxed);
+        });
+        REQUIRE(total == 1000);
+        REQUIRE(calls == callsOnReturn);
+    }
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <thread>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/query/QueryResultsPool.h>
+
+using namespace geodesk;
+
+namespace {
+
+std::vector<QueryResults*> allocateMany(int count, uint32_t capacity)
+{
+    std::vector<QueryResults*> buckets;
+    for (int i = 0; i < count; i++)
+    {
+        QueryResults* res = QueryResultsPool::allocate(capacity);
+        res->next = QueryResults::EMPTY;
+        buckets.push_back(res);
+    }
+    return buckets;
+}
+
+void recycleAll(const std::vector<QueryResults*>& buckets)
+{
+    QueryResultsPool::Recycler recycler;
+    for (QueryResults* res : buckets) recycler.recycle(res);
+}
+
+} // namespace
+
+
+TEST_CASE("QueryResultsPool recycles buckets on the same thread")
+{
+    // Run on a fresh thread, so earlier tests don't affect its cache
+    std::thread thread([]()
+    {
+        constexpr uint32_t CAPACITY = QueryResults::DEFAULT_BUCKET_SIZE;
+        std::vector<QueryResults*> buckets = allocateMany(100, CAPACITY);
+        recycleAll(buckets);
+        QueryResultsPool::Stats before = QueryResultsPool::stats();
+        std::vector<QueryResults*> again = allocateMany(100, CAPACITY);
+        QueryResultsPool::Stats after = QueryResultsPool::stats();
+        REQUIRE(after.allocated - before.allocated == 100);
+        REQUIRE(after.reused - before.reused == 100);
+        for (QueryResults* res : again)
+        {
+            REQUIRE(res->count == 0);
+            REQUIRE(res->capacity == CAPACITY);
+        }
+        recycleAll(again);
+    });
+    thread.join();
+}
+
+
+TEST_CASE("QueryResultsPool returns buckets released by another thread")
+{
+    constexpr uint32_t CAPACITY = QueryResults::SMALL_BUCKET_SIZE;
+    std::vector<QueryResults*> buckets;
+    std::atomic<int> phase(0);
+    uint64_t reused = 0;
+    // Earlier tests may have left buckets in the cache of the
+    // main thread (queries can run tiles on the calling thread)
+    int64_t localBefore = QueryResultsPool::localBucketCount(CAPACITY);
+
+    std::thread worker([&]()
+    {
+        buckets = allocateMany(64, CAPACITY);
+        phase = 1;
+        while (phase != 2) std::this_thread::yield();
+
+        // The consumer has released our buckets; they must come
+        // back to us, not just to any thread
+        QueryResultsPool::Stats before = QueryResultsPool::stats();
+        std::vector<QueryResults*> again = allocateMany(64, CAPACITY);
+        QueryResultsPool::Stats after = QueryResultsPool::stats();
+        reused = after.reused - before.reused;
+        recycleAll(again);
+    });
+
+    while (phase != 1) std::this_thread::yield();
+    QueryResultsPool::Stats before = QueryResultsPool::stats();
+    recycleAll(buckets);
+    QueryResultsPool::Stats after = QueryResultsPool::stats();
+    REQUIRE(after.recycled - before.recycled == 64);
+    REQUIRE(QueryResultsPool::localBucketCount(CAPACITY) == localBefore);
+        // The released buckets did not end up with the main thread
+    phase = 2;
+    worker.join();
+    REQUIRE(reused == 64);
+}
+
+
+TEST_CASE("QueryResultsPool trims the cache of a thread")
+{
+    std::thread thread([]()
+    {
+        constexpr uint32_t CAPACITY = QueryResults::DEFAULT_BUCKET_SIZE;
+        constexpr int64_t LIMIT = QueryResultsPool::MAX_LOCAL_BUCKETS[1];
+
+        // Release a burst far larger than the limit: Our inbox takes
+        // up to the limit, the rest goes to the shared list
+
+        std::vector<QueryResults*> buckets = allocateMany(
+            static_cast<int>(LIMIT) * 3, CAPACITY);
+        recycleAll(buckets);
+        QueryResultsPool::Stats before = QueryResultsPool::stats();
+
+        // The first allocation takes the inbox; once it is used up,
+        // we take the entire shared list, but keep only up to the
+        // limit for ourselves
+
+        std::vector<QueryResults*> again = allocateMany(
+            static_cast<int>(LIMIT) + 1, CAPACITY);
+        QueryResultsPool::Stats after = QueryResultsPool::stats();
+        REQUIRE(after.reused - before.reused == static_cast<uint64_t>(LIMIT) + 1);
+        REQUIRE(after.trimmed - before.trimmed >= static_cast<uint64_t>(LIMIT));
+        REQUIRE(QueryResultsPool::localBucketCount(CAPACITY) < LIMIT);
+        recycleAll(again);
+    });
+    thread.join();
+}
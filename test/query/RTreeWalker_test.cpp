@@ -0,0 +1,338 @@
+// Copyright (c) 2024 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/query/RTreeWalker.h>
+
+using namespace geodesk;
+using namespace clarisma;
+
+// Builds the feature index of a synthetic tile: a complete R-tree with
+// `fanout` entries per branch and `featuresPerLeaf` features per leaf,
+// over a square of random features. Like in a real tile, children are
+// always placed after their parents; within each level, nodes are laid
+// out in random order, so siblings are not adjacent in memory.
+
+class SyntheticTile
+{
+public:
+    SyntheticTile(int depth, int fanout, int featuresPerLeaf, uint32_t seed) :
+        fanout_(fanout),
+        featuresPerLeaf_(featuresPerLeaf),
+        random_(seed)
+    {
+        levels_.resize(depth + 1);
+        build(0, depth, Box(0, 0, EXTENT, EXTENT));
+        layout();
+    }
+
+    DataPtr root() const { return DataPtr(data_.data() + nodes_[0].offset); }
+
+    static constexpr int EXTENT = 1 << 24;
+
+private:
+    struct Node
+    {
+        bool isLeaf;
+        Box bounds;
+        std::vector<Box> boxes;         // of children or features
+        std::vector<int> children;
+        uint32_t offset = 0;
+    };
+
+    int build(int level, int depth, const Box& region)
+    {
+        int index = static_cast<int>(nodes_.size());
+        nodes_.push_back({});
+        levels_[level].push_back(index);
+        Node node;
+        node.isLeaf = (level == depth);
+        if (node.isLeaf)
+        {
+            for (int i = 0; i < featuresPerLeaf_; i++)
+            {
+                int32_t x = randomBetween(region.minX(), region.maxX());
+                int32_t y = randomBetween(region.minY(), region.maxY());
+                int32_t w = randomBetween(0, static_cast<int32_t>(region.widthSimple() / 8));
+                int32_t h = randomBetween(0, static_cast<int32_t>(region.height() / 8));
+                Box box(x, y, x + w, y + h);
+                node.boxes.push_back(box);
+                node.bounds.expandToIncludeSimple(box);
+            }
+        }
+        else
+        {
+            // Split the region into strips, alternating between
+            // vertical and horizontal strips at each level
+            bool vertical = (level % 2) == 0;
+            int64_t length = vertical ? region.widthSimple() : region.height();
+            int64_t start = vertical ? region.minX() : region.minY();
+            for (int i = 0; i < fanout_; i++)
+            {
+                int32_t lo = static_cast<int32_t>(start + length * i / fanout_);
+                int32_t hi = static_cast<int32_t>(start + length * (i + 1) / fanout_ - 1);
+                Box childRegion = vertical ?
+                    Box(lo, region.minY(), hi, region.maxY()) :
+                    Box(region.minX(), lo, region.maxX(), hi);
+                int child = build(level + 1, depth, childRegion);
+                node.children.push_back(child);
+                node.boxes.push_back(nodes_[child].bounds);
+                node.bounds.expandToIncludeSimple(nodes_[child].bounds);
+            }
+        }
+        nodes_[index] = std::move(node);
+        return index;
+    }
+
+    void layout()
+    {
+        uint32_t pos = 0;
+        for (std::vector<int>& level : levels_)
+        {
+            std::shuffle(level.begin(), level.end(), random_);
+            for (int index : level)
+            {
+                Node& node = nodes_[index];
+                node.offset = pos;
+                pos += static_cast<uint32_t>(node.boxes.size()) * (node.isLeaf ? 32 : 20);
+            }
+        }
+        data_.assign(pos, 0);
+        for (const Node& node : nodes_)
+        {
+            uint8_t* p = data_.data() + node.offset;
+            for (size_t i = 0; i < node.boxes.size(); i++)
+            {
+                int32_t last = (i == node.boxes.size() - 1) ? 1 : 0;
+                if (node.isLeaf)
+                {
+                    std::memcpy(p, &node.boxes[i], 16);
+                    int32_t flags = last;
+                    std::memcpy(p + 16, &flags, 4);
+                    p += 32;
+                }
+                else
+                {
+                    const Node& child = nodes_[node.children[i]];
+                    int32_t ptr = static_cast<int32_t>(child.offset -
+                        static_cast<uint32_t>(p - data_.data()));
+                    ptr |= (child.isLeaf ? 2 : 0) | last;
+                    std::memcpy(p, &ptr, 4);
+                    std::memcpy(p + 4, &node.boxes[i], 16);
+                    p += 20;
+                }
+            }
+        }
+    }
+
+    int32_t randomBetween(int32_t min, int32_t max)
+    {
+        return std::uniform_int_distribution<int32_t>(min, max)(random_);
+    }
+
+    int fanout_;
+    int featuresPerLeaf_;
+    std::mt19937 random_;
+    std::vector<Node> nodes_;
+    std::vector<std::vector<int>> levels_;
+    std::vector<uint8_t> data_;
+};
+
+
+// The recursive search that RTreeWalker replaces
+template<typename LeafVisitor>
+static void searchRecursive(DataPtr p, const Box& box, LeafVisitor& visitLeaf)
+{
+    for (;;)
+    {
+        int32_t ptr = p.getInt();
+        int32_t last = ptr & 1;
+        if (box.intersects(*reinterpret_cast<const Box*>(p.ptr() + 4)))
+        {
+            DataPtr pChild = p + (ptr & 0xffff'fffc);
+            if (ptr & 2)
+            {
+                visitLeaf(pChild);
+            }
+            else
+            {
+                searchRecursive(pChild, box, visitLeaf);
+            }
+        }
+        if (last != 0) break;
+        p += 20;
+    }
+}
+
+struct LeafScanner
+{
+    explicit LeafScanner(const Box& box) : box(box) {}
+
+    void operator()(DataPtr p)
+    {
+        for (;;)
+        {
+            if (box.intersects(*reinterpret_cast<const Box*>(p.ptr())))
+            {
+                count++;
+                checksum += p.getInt();
+            }
+            int32_t flags = (p + 16).getInt();
+            if (flags & 1) break;
+            p += 32;
+        }
+    }
+
+    Box box;
+    uint64_t count = 0;
+    uint64_t checksum = 0;
+};
+
+static Box randomQueryBox(std::mt19937& random, int32_t size)
+{
+    std::uniform_int_distribution<int32_t> dist(0, SyntheticTile::EXTENT - size);
+    int32_t x = dist(random);
+    int32_t y = dist(random);
+    return Box(x, y, x + size, y + size);
+}
+
+
+TEST_CASE("RTreeWalker finds the same features as a recursive search")
+{
+    SyntheticTile tile(3, 8, 12, 42);
+    std::mt19937 random(7);
+    for (int i = 0; i < 200; i++)
+    {
+        Box box = randomQueryBox(random, SyntheticTile::EXTENT >> (i % 6));
+        LeafScanner expected(box);
+        searchRecursive(tile.root(), box, expected);
+        LeafScanner actual(box);
+        RTreeWalker::walk(tile.root(), box,
+            [&actual](DataPtr p) { actual(p); },
+            []() { return false; });
+        REQUIRE(actual.count == expected.count);
+        REQUIRE(actual.checksum == expected.checksum);
+    }
+}
+
+TEST_CASE("RTreeWalker stops when asked")
+{
+    SyntheticTile tile(2, 4, 4, 1);
+    Box box(0, 0, SyntheticTile::EXTENT, SyntheticTile::EXTENT);
+    int leaves = 0;
+    RTreeWalker::walk(tile.root(), box,
+        [&leaves](DataPtr) { leaves++; },
+        [&leaves]() { return leaves >= 3; });
+    REQUIRE(leaves == 3);
+}
+
+// Counts the branches and pruned entries of the recursive search
+static void countRecursive(DataPtr p, const Box& box,
+    uint64_t& branches, uint64_t& pruned)
+{
+    branches++;
+    for (;;)
+    {
+        int32_t ptr = p.getInt();
+        int32_t last = ptr & 1;
+        if (box.intersects(*reinterpret_cast<const Box*>(p.ptr() + 4)))
+        {
+            if ((ptr & 2) == 0)
+            {
+                countRecursive(p + (ptr & 0xffff'fffc), box, branches, pruned);
+            }
+        }
+        else
+        {
+            pruned++;
+        }
+        if (last != 0) break;
+        p += 20;
+    }
+}
+
+struct CountingObserver
+{
+    void branchVisited() { branches++; }
+    void branchEntriesTested(int count, int accepted) { pruned += count - accepted; }
+
+    uint64_t branches = 0;
+    uint64_t pruned = 0;
+};
+
+TEST_CASE("RTreeWalker reports its progress to an observer")
+{
+    SyntheticTile tile(3, 8, 12, 42);
+    std::mt19937 random(11);
+    for (int i = 0; i < 50; i++)
+    {
+        Box box = randomQueryBox(random, SyntheticTile::EXTENT >> (i % 6));
+        uint64_t branches = 0;
+        uint64_t pruned = 0;
+        countRecursive(tile.root(), box, branches, pruned);
+        CountingObserver observer;
+        RTreeWalker::walk(tile.root(), box,
+            [](DataPtr) {}, []() { return false; }, observer);
+        REQUIRE(observer.branches == branches);
+        REQUIRE(observer.pruned == pruned);
+    }
+}
+
+// Run explicitly: geodesk-test "[rtree-benchmark]"
+TEST_CASE("RTreeWalker benchmark", "[.][rtree-benchmark]")
+{
+    SyntheticTile tile(5, 8, 16, 42);      // 32K leaves, ~17 MB
+    constexpr int QUERIES = 400;
+    std::vector<Box> boxes;
+    std::mt19937 random(99);
+    for (int i = 0; i < QUERIES; i++)
+    {
+        boxes.push_back(randomQueryBox(random, SyntheticTile::EXTENT / 4));
+    }
+
+    // Evicts the tile from the cache between queries
+    std::vector<uint8_t> scratch(64 * 1024 * 1024, 1);
+    uint64_t sink = 0;
+    auto flushCache = [&scratch, &sink]()
+    {
+        for (size_t i = 0; i < scratch.size(); i += 64) sink += scratch[i]++;
+    };
+
+    auto run = [&](const char* name, auto search)
+    {
+        std::chrono::nanoseconds total{0};
+        uint64_t count = 0;
+        for (const Box& box : boxes)
+        {
+            flushCache();
+            LeafScanner scanner(box);
+            auto start = std::chrono::steady_clock::now();
+            search(box, scanner);
+            total += std::chrono::steady_clock::now() - start;
+            count += scanner.count;
+        }
+        printf("%-10s %8.1f us/query  (%llu features)\n", name,
+            std::chrono::duration<double, std::micro>(total).count() / QUERIES,
+            static_cast<unsigned long long>(count));
+        return count;
+    };
+
+    uint64_t recursive = run("recursive", [&tile](const Box& box, LeafScanner& scanner)
+    {
+        searchRecursive(tile.root(), box, scanner);
+    });
+    uint64_t iterative = run("walker", [&tile](const Box& box, LeafScanner& scanner)
+    {
+        RTreeWalker::walk(tile.root(), box,
+            [&scanner](DataPtr p) { scanner(p); },
+            []() { return false; });
+    });
+    REQUIRE(recursive == iterative);
+    REQUIRE(sink != 0);
+}
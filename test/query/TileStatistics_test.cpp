@@ -0,0 +1,216 @@
+// Copyright (c) 2025 Clarisma / GeoDesk contributors
+// SPDX-License-Identifier: LGPL-3.0-only
+
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <geodesk/feature/GlobalStrings.h>
+#include <geodesk/feature/types.h>
+#include <geodesk/match/Matcher.h>
+#include <geodesk/query/TileStatistics.h>
+
+using namespace geodesk;
+
+namespace {
+
+// Indexed keys are 5 to 8; key 9 is global, but not indexed
+constexpr int FIRST_KEY = 5;
+constexpr int KEY_COUNT = 4;
+
+struct Feature
+{
+    int flags;
+    std::vector<std::pair<int,uint32_t>> tags;     // key code, tag bits
+};
+
+/// Writes a feature (flags, a dummy ID, and a pointer to its
+/// tag table, followed by the global tags) and returns its offset
+///
+size_t writeFeature(std::vector<uint8_t>& buf, const Feature& feature)
+{
+    while (buf.size() % 4) buf.push_back(0);
+    size_t pos = buf.size();
+    buf.resize(pos + 12);
+    std::memcpy(&buf[pos], &feature.flags, 4);
+    int32_t rel = 12 - 8;
+    std::memcpy(&buf[pos + 8], &rel, 4);
+    auto put16 = [&buf](uint16_t v)
+    {
+        buf.push_back(static_cast<uint8_t>(v));
+        buf.push_back(static_cast<uint8_t>(v >> 8));
+    };
+    if (feature.tags.empty())
+    {
+        put16(0x8001);      // empty-table marker
+        put16(0);
+    }
+    for (size_t i = 0; i < feature.tags.size(); i++)
+    {
+        uint32_t tag = feature.tags[i].second;
+        uint16_t last = (i == feature.tags.size() - 1) ? 0x8000 : 0;
+        put16(static_cast<uint16_t>(tag | last));
+        put16(static_cast<uint16_t>(tag >> 16));
+    }
+    for (int i = 0; i < 8; i++) buf.push_back(0);     // slack
+    return pos;
+}
+
+uint32_t tileRevision(int tip)
+{
+    return static_cast<uint32_t>(tip * 3 + 1);
+}
+
+Feature randomFeature(std::mt19937& random, int valueRange)
+{
+    Feature feature;
+    feature.flags = static_cast<int>(random() % TileStatistics::BUCKET_COUNT) << 1;
+    for (int key = FIRST_KEY; key < FIRST_KEY + KEY_COUNT + 1; key++)
+    {
+        if (random() % 2) continue;
+        uint32_t value;
+        int type;
+        switch (random() % 4)
+        {
+        case 0:     // narrow number
+            type = 0;
+            value = random() % 100;
+            break;
+        case 1:     // "no"
+            type = 1;
+            value = GlobalStrings::NO;
+            break;
+        default:
+            type = 1;
+            value = 2 + random() % valueRange;
+            break;
+        }
+        feature.tags.emplace_back(key, (value << 16) | (key << 2) | type);
+    }
+    return feature;
+}
+
+} // namespace
+
+
+TEST_CASE("TileStatistics counts the same features as a tile scan")
+{
+    std::mt19937 random(7);
+    clarisma::UUID guid;
+    std::vector<uint16_t> keys;
+    for (int i = 0; i < KEY_COUNT; i++) keys.push_back(FIRST_KEY + i);
+    TileStatistics statistics(guid, 42, keys);
+    TileStatistics::TileBuilder builder(statistics);
+
+    // Some tiles have few distinct values per key, others have
+    // more than can be recorded
+    constexpr int TILE_COUNT = 40;
+    std::vector<std::vector<uint8_t>> tiles(TILE_COUNT);
+    std::vector<std::vector<size_t>> featureOffsets(TILE_COUNT);
+    for (int tip = 1; tip < TILE_COUNT; tip++)
+    {
+        if (tip % 7 == 0) continue;     // missing tile
+        int valueRange = (tip % 3 == 0) ? 60 : 10;
+        int featureCount = static_cast<int>(random() % 500);
+        std::vector<uint8_t>& buf = tiles[tip];
+        std::vector<size_t>& offsets = featureOffsets[tip];
+        for (int i = 0; i < featureCount; i++)
+        {
+            offsets.push_back(writeFeature(buf, randomFeature(random, valueRange)));
+        }
+        for (size_t ofs : offsets) builder.addFeature(FeaturePtr(buf.data() + ofs));
+        std::vector<TileStatistics::Entry> entries;
+        builder.finish(entries);
+        statistics.setTile(Tip(tip), tileRevision(tip), std::move(entries));
+    }
+
+    std::filesystem::path fileName = std::filesystem::temp_directory_path() /
+        "geodesk-test.gol-stats";
+    statistics.save(fileName.string().c_str());
+    REQUIRE(TileStatistics::load(fileName.string().c_str(), guid, 41) == nullptr);
+    std::unique_ptr<TileStatistics> loaded =
+        TileStatistics::load(fileName.string().c_str(), guid, 42);
+    std::filesystem::remove(fileName);
+    REQUIRE(loaded);
+    REQUIRE(loaded->keys() == keys);
+
+    const uint32_t TYPES[] =
+    {
+        FeatureTypes::ALL, FeatureTypes::NODES, FeatureTypes::WAYS,
+        FeatureTypes::AREAS, FeatureTypes::RELATIONS | FeatureTypes::NODES,
+        FeatureTypes::WAYNODE_FLAGGED, FeatureTypes::RELATION_MEMBERS
+    };
+    const uint32_t NORTHWEST_FLAGS[] =
+    {
+        0, FeatureFlags::MULTITILE_WEST, FeatureFlags::MULTITILE_NORTH,
+        FeatureFlags::MULTITILE_WEST | FeatureFlags::MULTITILE_NORTH
+    };
+
+    int unknownCount = 0;
+    for (int run = 0; run < 500; run++)
+    {
+        FeatureTypes types = TYPES[random() % std::size(TYPES)];
+        int key = (run % 5 == 0) ? 0 : FIRST_KEY + static_cast<int>(random() % KEY_COUNT);
+        int value = (run % 2 == 0) ? -1 : 2 + static_cast<int>(random() % 70);
+        const MatcherHolder* matcher =
+            key == 0 ? MatcherHolder::createMatchAll(types) :
+            value < 0 ? MatcherHolder::createMatchKey(types, 0, key, GlobalStrings::NO) :
+            MatcherHolder::createMatchKeyValue(types, 0, key, value);
+        TileStatistics::Criteria criteria;
+        REQUIRE(loaded->criteria(types, matcher, criteria));
+        if (key == 0) value = -1;
+
+        for (int tip = 0; tip < TILE_COUNT + 2; tip++)
+        {
+            uint32_t northwestFlags = NORTHWEST_FLAGS[random() % 4];
+            int64_t count = loaded->count(Tip(tip), tileRevision(tip),
+                northwestFlags, criteria);
+            if (tip == 0 || tip >= TILE_COUNT || tip % 7 == 0)
+            {
+                REQUIRE(count == -1);
+                continue;
+            }
+
+            // The counts of a replaced tile are unknown
+            REQUIRE(loaded->count(Tip(tip), tileRevision(tip) + 1,
+                northwestFlags, criteria) == -1);
+
+            // Count the features the same way a query does: by type,
+            // by the matcher itself, and skipping features that
+            // extend into a tile to the north or west
+            int64_t expected = 0;
+            for (size_t ofs : featureOffsets[tip])
+            {
+                FeaturePtr feature(tiles[tip].data() + ofs);
+                if (types.acceptFlags(feature.flags()) &&
+                    (feature.flags() & northwestFlags) == 0 &&
+                    matcher->mainMatcher().accept(feature))
+                {
+                    expected++;
+                }
+            }
+            if (count < 0)
+            {
+                // Only rare values of keys with many values are unknown
+                REQUIRE(value >= 0);
+                REQUIRE(tip % 3 == 0);
+                unknownCount++;
+                continue;
+            }
+            REQUIRE(count == expected);
+        }
+        matcher->release();
+    }
+    REQUIRE(unknownCount > 0);
+
+    // A key that isn't recorded, and a matcher that isn't simple
+    FeatureTypes types = FeatureTypes::ALL;
+    TileStatistics::Criteria criteria;
+    const MatcherHolder* matcher = MatcherHolder::createMatchKey(
+        types, 0, FIRST_KEY + KEY_COUNT, GlobalStrings::NO);
+    REQUIRE_FALSE(loaded->criteria(types, matcher, criteria));
+    matcher->release();
+    MatcherHolder complex(types, 0xffff'ffff, 0);
+    REQUIRE_FALSE(loaded->criteria(types, &complex, criteria));
+}